@@ -0,0 +1,299 @@
+#include "AxisConditioner.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+AxisConditioner::AxisConditioner(int32_t min, int32_t max, bool centered) :
+    _min(min),
+    _max(max),
+    _centered(centered),
+    _deadzone(0),
+    _outerDeadzone(0),
+    _hysteresis(0),
+    _filter(AXIS_FILTER_NONE),
+    _emaAlpha(AXIS_EMA_ALPHA_ONE),
+    _minCutoff(1.0f),
+    _beta(0.007f),
+    _derivativeCutoff(1.0f)
+{
+    reset();
+}
+
+void AxisConditioner::setRange(int32_t min, int32_t max)
+{
+    if (min > max)
+    {
+        int32_t temp = min;
+        min = max;
+        max = temp;
+    }
+
+    _min = min;
+    _max = max;
+    reset();
+}
+
+void AxisConditioner::setCentered(bool value)
+{
+    _centered = value;
+    reset();
+}
+
+void AxisConditioner::setDeadzone(uint16_t value) { _deadzone = value; }
+void AxisConditioner::setOuterDeadzone(uint16_t value) { _outerDeadzone = value; }
+void AxisConditioner::setHysteresis(uint16_t value) { _hysteresis = value; }
+
+void AxisConditioner::setNoFilter()
+{
+    _filter = AXIS_FILTER_NONE;
+    reset();
+}
+
+void AxisConditioner::setEmaFilter(uint16_t alpha)
+{
+    if (alpha < 1)
+        alpha = 1;
+    if (alpha > AXIS_EMA_ALPHA_ONE)
+        alpha = AXIS_EMA_ALPHA_ONE;
+
+    _filter = AXIS_FILTER_EMA;
+    _emaAlpha = alpha;
+    reset();
+}
+
+void AxisConditioner::setOneEuroFilter(float minCutoff, float beta, float derivativeCutoff)
+{
+    _filter = AXIS_FILTER_ONE_EURO;
+    _minCutoff = minCutoff > 0.0f ? minCutoff : 1.0f;
+    _beta = beta >= 0.0f ? beta : 0.0f;
+    _derivativeCutoff = derivativeCutoff > 0.0f ? derivativeCutoff : 1.0f;
+    reset();
+}
+
+int32_t AxisConditioner::getMin() const { return _min; }
+int32_t AxisConditioner::getMax() const { return _max; }
+int32_t AxisConditioner::getRest() const { return _centered ? (_min + _max) / 2 : _min; }
+bool AxisConditioner::getCentered() const { return _centered; }
+uint16_t AxisConditioner::getDeadzone() const { return _deadzone; }
+uint16_t AxisConditioner::getOuterDeadzone() const { return _outerDeadzone; }
+uint16_t AxisConditioner::getHysteresis() const { return _hysteresis; }
+uint8_t AxisConditioner::getFilter() const { return _filter; }
+
+int32_t AxisConditioner::getOutput() const { return _output; }
+int32_t AxisConditioner::getFilteredValue() const { return _filtered; }
+
+void AxisConditioner::reset()
+{
+    _primed = false;
+    _emaState = 0;
+    _euroValue = 0.0f;
+    _euroDerivative = 0.0f;
+    _lastSampleMs = 0;
+    _filtered = getRest();
+    _output = getRest();
+}
+
+int32_t AxisConditioner::process(int32_t value, uint32_t nowMs)
+{
+    return settle(shape(filter(value, nowMs)));
+}
+
+int32_t AxisConditioner::filter(int32_t value, uint32_t nowMs)
+{
+    value = clamp(value);
+
+    if (_filter == AXIS_FILTER_EMA)
+    {
+        int32_t sample = value * 256;
+        if (!_primed)
+        {
+            _emaState = sample;
+        }
+        else
+        {
+            _emaState += (int32_t)(((int64_t)(sample - _emaState) * _emaAlpha) / AXIS_EMA_ALPHA_ONE);
+        }
+        value = (_emaState >= 0 ? _emaState + 128 : _emaState - 128) / 256;
+    }
+    else if (_filter == AXIS_FILTER_ONE_EURO)
+    {
+        if (!_primed)
+        {
+            _euroValue = (float)value;
+            _euroDerivative = 0.0f;
+        }
+        else
+        {
+            float dt = (nowMs - _lastSampleMs) / 1000.0f;
+            if (dt <= 0.0f)
+                dt = 0.001f;
+
+            // Smooth the speed of the input, then let faster motion raise the cutoff
+            float derivative = ((float)value - _euroValue) / dt;
+            float derivativeAlpha = oneEuroAlpha(_derivativeCutoff, dt);
+            _euroDerivative += derivativeAlpha * (derivative - _euroDerivative);
+
+            float cutoff = _minCutoff + _beta * fabsf(_euroDerivative);
+            _euroValue += oneEuroAlpha(cutoff, dt) * ((float)value - _euroValue);
+        }
+        value = clamp((int32_t)lroundf(_euroValue));
+    }
+
+    _primed = true;
+    _lastSampleMs = nowMs;
+    _filtered = value;
+    return value;
+}
+
+int32_t AxisConditioner::shape(int32_t value) const
+{
+    if (_deadzone == 0 && _outerDeadzone == 0)
+        return clamp(value);
+
+    int32_t rest = getRest();
+    int32_t offset = clamp(value) - rest;
+    int32_t span = offset >= 0 ? _max - rest : rest - _min;
+    int32_t magnitude = offset >= 0 ? offset : -offset;
+    int32_t extreme = offset >= 0 ? _max : _min;
+
+    if (magnitude <= _deadzone || span <= 0)
+        return rest;
+
+    int32_t usable = span - _deadzone - _outerDeadzone;
+    if (magnitude >= span - _outerDeadzone || usable <= 0)
+        return extreme;
+
+    // Rescale what is left between the two deadzones back onto the full range
+    int32_t scaled = (int32_t)(((int64_t)(magnitude - _deadzone) * span) / usable);
+    return offset >= 0 ? rest + scaled : rest - scaled;
+}
+
+int32_t AxisConditioner::settle(int32_t value)
+{
+    int32_t delta = value - _output;
+    if (delta < 0)
+        delta = -delta;
+
+    // Always let the axis reach its rest position and its extremes
+    if (_hysteresis == 0 || delta >= _hysteresis || value == getRest() || value == _min || value == _max)
+    {
+        _output = value;
+    }
+
+    return _output;
+}
+
+int32_t AxisConditioner::clamp(int32_t value) const
+{
+    if (value < _min)
+        return _min;
+    if (value > _max)
+        return _max;
+    return value;
+}
+
+float AxisConditioner::oneEuroAlpha(float cutoff, float dt)
+{
+    float tau = 1.0f / (2.0f * (float)M_PI * cutoff);
+    return 1.0f / (1.0f + tau / dt);
+}
+
+StickConditioner::StickConditioner(int32_t min, int32_t max) :
+    _x(min, max, true),
+    _y(min, max, true),
+    _radial(false)
+{
+}
+
+void StickConditioner::setRadialDeadzone(bool value) { _radial = value; }
+bool StickConditioner::getRadialDeadzone() const { return _radial; }
+
+AxisConditioner& StickConditioner::getXConditioner() { return _x; }
+AxisConditioner& StickConditioner::getYConditioner() { return _y; }
+
+void StickConditioner::process(int32_t& x, int32_t& y, uint32_t nowMs)
+{
+    x = _x.filter(x, nowMs);
+    y = _y.filter(y, nowMs);
+    shapeAndSettle(x, y);
+}
+
+int32_t StickConditioner::processX(int32_t x, uint32_t nowMs)
+{
+    int32_t y = _y.getFilteredValue();
+    x = _x.filter(x, nowMs);
+    shapeAndSettle(x, y);
+    return x;
+}
+
+int32_t StickConditioner::processY(int32_t y, uint32_t nowMs)
+{
+    int32_t x = _x.getFilteredValue();
+    y = _y.filter(y, nowMs);
+    shapeAndSettle(x, y);
+    return y;
+}
+
+void StickConditioner::reset()
+{
+    _x.reset();
+    _y.reset();
+}
+
+void StickConditioner::shapeAndSettle(int32_t& x, int32_t& y)
+{
+    if (_radial)
+    {
+        shapeRadial(x, y);
+    }
+    else
+    {
+        x = _x.shape(x);
+        y = _y.shape(y);
+    }
+
+    x = _x.settle(x);
+    y = _y.settle(y);
+}
+
+void StickConditioner::shapeRadial(int32_t& x, int32_t& y) const
+{
+    if (_x.getDeadzone() == 0 && _x.getOuterDeadzone() == 0)
+        return;
+
+    int32_t restX = _x.getRest();
+    int32_t restY = _y.getRest();
+    float spanX = (float)(_x.getMax() - restX);
+    float spanY = (float)(_y.getMax() - restY);
+    if (spanX <= 0.0f || spanY <= 0.0f)
+        return;
+
+    // Work on the deflection normalised to a unit circle
+    float nx = (x - restX) / spanX;
+    float ny = (y - restY) / spanY;
+    float magnitude = sqrtf(nx * nx + ny * ny);
+
+    float inner = _x.getDeadzone() / spanX;
+    float outer = 1.0f - _x.getOuterDeadzone() / spanX;
+
+    if (magnitude <= inner)
+    {
+        x = restX;
+        y = restY;
+        return;
+    }
+
+    float scaled = outer > inner ? (magnitude - inner) / (outer - inner) : 1.0f;
+    if (scaled > 1.0f)
+        scaled = 1.0f;
+
+    float factor = scaled / magnitude;
+    x = restX + (int32_t)lroundf(nx * factor * spanX);
+    y = restY + (int32_t)lroundf(ny * factor * spanY);
+
+    // Diagonals can land just outside the square range
+    x = x < _x.getMin() ? _x.getMin() : (x > _x.getMax() ? _x.getMax() : x);
+    y = y < _y.getMin() ? _y.getMin() : (y > _y.getMax() ? _y.getMax() : y);
+}
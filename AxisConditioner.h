@@ -0,0 +1,125 @@
+#ifndef AXIS_CONDITIONER_H
+#define AXIS_CONDITIONER_H
+
+#include <stdint.h>
+
+#define AXIS_FILTER_NONE 0
+#define AXIS_FILTER_EMA 1
+#define AXIS_FILTER_ONE_EURO 2
+
+// EMA weights are Q8 fixed point, this weight passes the input straight through
+#define AXIS_EMA_ALPHA_ONE 256
+
+// Conditions a single analog axis before it is stored in a report.
+// Every stage is disabled by default so an unconfigured conditioner passes values through unchanged.
+//
+// The stages run in this order:
+//  - filter: fixed point EMA or One-Euro smoothing of the raw reading
+//  - shape: inner deadzone around the rest position and outer saturation near the extremes,
+//           the range in between is rescaled so the output still covers the full axis
+//  - settle: hysteresis, the output only moves once the input has moved at least the threshold away
+class AxisConditioner
+{
+public:
+    AxisConditioner(int32_t min = -32767, int32_t max = 32767, bool centered = true);
+
+    // Output range and where the axis rests, either its midpoint (sticks) or its minimum (triggers, sliders)
+    void setRange(int32_t min, int32_t max);
+    void setCentered(bool value);
+
+    // Inner deadzone around the rest position, in axis units
+    void setDeadzone(uint16_t value);
+    // Readings within this many units of either extreme are reported as the extreme
+    void setOuterDeadzone(uint16_t value);
+    // Minimum change in axis units before a new output is produced
+    void setHysteresis(uint16_t value);
+
+    void setNoFilter();
+    // alpha is the Q8 weight given to each new sample, 1 (heavy smoothing) to 256 (no smoothing)
+    void setEmaFilter(uint16_t alpha);
+    // One-Euro filter, minCutoff in Hz sets jitter removal at rest, beta sets how quickly fast motion is followed
+    void setOneEuroFilter(float minCutoff = 1.0f, float beta = 0.007f, float derivativeCutoff = 1.0f);
+
+    int32_t getMin() const;
+    int32_t getMax() const;
+    int32_t getRest() const;
+    bool getCentered() const;
+    uint16_t getDeadzone() const;
+    uint16_t getOuterDeadzone() const;
+    uint16_t getHysteresis() const;
+    uint8_t getFilter() const;
+
+    // Runs every stage and returns the conditioned value
+    int32_t process(int32_t value, uint32_t nowMs);
+
+    // The individual stages, used by StickConditioner to shape both axes of a stick together
+    int32_t filter(int32_t value, uint32_t nowMs);
+    int32_t shape(int32_t value) const;
+    int32_t settle(int32_t value);
+
+    int32_t getOutput() const;
+    int32_t getFilteredValue() const;
+
+    // Forgets the filter history and last output
+    void reset();
+
+private:
+    int32_t clamp(int32_t value) const;
+    static float oneEuroAlpha(float cutoff, float dt);
+
+    int32_t _min;
+    int32_t _max;
+    bool _centered;
+    uint16_t _deadzone;
+    uint16_t _outerDeadzone;
+    uint16_t _hysteresis;
+
+    uint8_t _filter;
+    uint16_t _emaAlpha;
+    float _minCutoff;
+    float _beta;
+    float _derivativeCutoff;
+
+    // Filter state
+    bool _primed;
+    int32_t _emaState;          // Q8
+    float _euroValue;
+    float _euroDerivative;
+    uint32_t _lastSampleMs;
+    int32_t _filtered;
+
+    // Hysteresis state
+    int32_t _output;
+};
+
+// Conditions both axes of a stick. With a radial deadzone the inner deadzone and outer saturation
+// are applied to the stick deflection as a whole rather than per axis, which keeps diagonals intact.
+// The deadzone settings of the X conditioner are used for both axes in radial mode.
+class StickConditioner
+{
+public:
+    StickConditioner(int32_t min = -32767, int32_t max = 32767);
+
+    void setRadialDeadzone(bool value);
+    bool getRadialDeadzone() const;
+
+    AxisConditioner& getXConditioner();
+    AxisConditioner& getYConditioner();
+
+    void process(int32_t& x, int32_t& y, uint32_t nowMs);
+    // Conditions one axis, the other axis keeps its last filtered value for the radial deadzone
+    int32_t processX(int32_t x, uint32_t nowMs);
+    int32_t processY(int32_t y, uint32_t nowMs);
+
+    void reset();
+
+private:
+    void shapeRadial(int32_t& x, int32_t& y) const;
+    void shapeAndSettle(int32_t& x, int32_t& y);
+
+    AxisConditioner _x;
+    AxisConditioner _y;
+    bool _radial;
+};
+
+#endif // AXIS_CONDITIONER_H
@@ -1,6 +1,13 @@
 #include "BLEHostConfiguration.h"
 #include "NimBLEHIDDevice.h"
 
+// Indexed by CONNECTION_PROFILE_*, the supervision timeout always covers the skipped events with room to spare
+static const ConnectionParameters connectionProfiles[] = {
+    { 6, 7, 0, 600 },       // CONNECTION_PROFILE_LOW_LATENCY_GAMING
+    { 12, 24, 4, 400 },     // CONNECTION_PROFILE_TYPING
+    { 48, 64, 8, 600 }      // CONNECTION_PROFILE_POWER_SAVER
+};
+
 BLEHostConfiguration::BLEHostConfiguration() :
     _vidSource(0x01),
     _vid(0xe502),
@@ -14,7 +21,39 @@ BLEHostConfiguration::BLEHostConfiguration() :
     _hardwareRevision("1.0.0"),
     _systemID(""),
     _deferSendRate(240),
-    _threadedAutoSend(false)
+    _threadedAutoSend(false),
+    _restoreStateOnReconnect(true),
+    _disconnectedReportPolicy(DISCONNECTED_REPORTS_DISCARD),
+    _disconnectedReportTTL(1000),
+    _reportMapStore(nullptr),
+    _reconnectMode(RECONNECT_MODE_NONE),
+    _reconnectAdvertisingDuration(1280),
+    _fastAdvertisingMinInterval(0),
+    _fastAdvertisingMaxInterval(0),
+    _fastAdvertisingDuration(0),
+    _slowAdvertisingMinInterval(1636),
+    _slowAdvertisingMaxInterval(1636),
+    _connectionProfile(CONNECTION_PROFILE_LOW_LATENCY_GAMING),
+    _idleConnectionProfile(CONNECTION_PROFILE_POWER_SAVER),
+    _idleTimeout(0),
+    _customConnectionParameters{ 6, 7, 0, 600 },
+    _maxConnections(1),
+    _reportRouting(REPORT_ROUTING_BROADCAST),
+    _preferredMTU(0),
+    _dataLength(0),
+    _preferredPhy(0),
+    _diagnosticsPeriod(0),
+    _powerIdleTimeout(0),
+    _automaticLightSleep(false),
+    _maxCpuFrequency(0),
+    _minCpuFrequency(0),
+    _serverTaskCore(TASK_CORE_ANY),
+    _serverTaskPriority(5),
+    _serverTaskStackSize(4096),
+    _autoSendTaskCore(TASK_CORE_ANY),
+    _autoSendTaskPriority(5),
+    _autoSendTaskStackSize(4096),
+    _notifyWindow(0)
 {               
 }
 
@@ -47,4 +86,116 @@ void BLEHostConfiguration::setQueueSendRate(uint32_t value) { _deferSendRate = v
 uint32_t BLEHostConfiguration::getQueueSendRate() const { return _deferSendRate; }
 
 void BLEHostConfiguration::setQueuedSending(bool value) { _threadedAutoSend = value; }
-bool BLEHostConfiguration::getQueuedSending() const { return _threadedAutoSend; }
\ No newline at end of file
+bool BLEHostConfiguration::getQueuedSending() const { return _threadedAutoSend; }
+
+void BLEHostConfiguration::setRestoreStateOnReconnect(bool value) { _restoreStateOnReconnect = value; }
+bool BLEHostConfiguration::getRestoreStateOnReconnect() const { return _restoreStateOnReconnect; }
+
+void BLEHostConfiguration::setDisconnectedReportPolicy(uint8_t policy) { _disconnectedReportPolicy = policy; }
+uint8_t BLEHostConfiguration::getDisconnectedReportPolicy() const { return _disconnectedReportPolicy; }
+
+void BLEHostConfiguration::setDisconnectedReportTTL(uint32_t milliseconds) { _disconnectedReportTTL = milliseconds; }
+uint32_t BLEHostConfiguration::getDisconnectedReportTTL() const { return _disconnectedReportTTL; }
+
+void BLEHostConfiguration::setReportMapStore(KeyValueStore* store) { _reportMapStore = store; }
+KeyValueStore* BLEHostConfiguration::getReportMapStore() const { return _reportMapStore; }
+
+void BLEHostConfiguration::setReconnectMode(uint8_t mode) { _reconnectMode = mode; }
+uint8_t BLEHostConfiguration::getReconnectMode() const { return _reconnectMode; }
+
+void BLEHostConfiguration::setReconnectAdvertisingDuration(uint32_t milliseconds) { _reconnectAdvertisingDuration = milliseconds; }
+uint32_t BLEHostConfiguration::getReconnectAdvertisingDuration() const { return _reconnectAdvertisingDuration; }
+
+void BLEHostConfiguration::setFastAdvertisingInterval(uint16_t minInterval, uint16_t maxInterval)
+{
+    _fastAdvertisingMinInterval = minInterval;
+    _fastAdvertisingMaxInterval = maxInterval;
+}
+uint16_t BLEHostConfiguration::getFastAdvertisingMinInterval() const { return _fastAdvertisingMinInterval; }
+uint16_t BLEHostConfiguration::getFastAdvertisingMaxInterval() const { return _fastAdvertisingMaxInterval; }
+
+void BLEHostConfiguration::setFastAdvertisingDuration(uint32_t milliseconds) { _fastAdvertisingDuration = milliseconds; }
+uint32_t BLEHostConfiguration::getFastAdvertisingDuration() const { return _fastAdvertisingDuration; }
+
+void BLEHostConfiguration::setSlowAdvertisingInterval(uint16_t minInterval, uint16_t maxInterval)
+{
+    _slowAdvertisingMinInterval = minInterval;
+    _slowAdvertisingMaxInterval = maxInterval;
+}
+uint16_t BLEHostConfiguration::getSlowAdvertisingMinInterval() const { return _slowAdvertisingMinInterval; }
+uint16_t BLEHostConfiguration::getSlowAdvertisingMaxInterval() const { return _slowAdvertisingMaxInterval; }
+
+void BLEHostConfiguration::setConnectionProfile(uint8_t profile) { _connectionProfile = profile; }
+uint8_t BLEHostConfiguration::getConnectionProfile() const { return _connectionProfile; }
+
+void BLEHostConfiguration::setCustomConnectionParameters(const ConnectionParameters& parameters) { _customConnectionParameters = parameters; }
+ConnectionParameters BLEHostConfiguration::getCustomConnectionParameters() const { return _customConnectionParameters; }
+
+void BLEHostConfiguration::setIdleConnectionProfile(uint8_t profile) { _idleConnectionProfile = profile; }
+uint8_t BLEHostConfiguration::getIdleConnectionProfile() const { return _idleConnectionProfile; }
+
+void BLEHostConfiguration::setIdleTimeout(uint32_t milliseconds) { _idleTimeout = milliseconds; }
+uint32_t BLEHostConfiguration::getIdleTimeout() const { return _idleTimeout; }
+
+ConnectionParameters BLEHostConfiguration::getConnectionParameters(uint8_t profile) const
+{
+    if (profile < sizeof(connectionProfiles) / sizeof(connectionProfiles[0]))
+        return connectionProfiles[profile];
+
+    return _customConnectionParameters;
+}
+
+void BLEHostConfiguration::setMaxConnections(uint8_t count) { _maxConnections = count; }
+uint8_t BLEHostConfiguration::getMaxConnections() const { return _maxConnections; }
+
+void BLEHostConfiguration::setReportRouting(uint8_t routing) { _reportRouting = routing; }
+uint8_t BLEHostConfiguration::getReportRouting() const { return _reportRouting; }
+
+void BLEHostConfiguration::setPreferredMTU(uint16_t mtu) { _preferredMTU = mtu; }
+uint16_t BLEHostConfiguration::getPreferredMTU() const { return _preferredMTU; }
+
+void BLEHostConfiguration::setDataLength(uint16_t octets) { _dataLength = octets; }
+uint16_t BLEHostConfiguration::getDataLength() const { return _dataLength; }
+
+void BLEHostConfiguration::setPreferredPhy(uint8_t phyMask) { _preferredPhy = phyMask; }
+uint8_t BLEHostConfiguration::getPreferredPhy() const { return _preferredPhy; }
+
+void BLEHostConfiguration::setDiagnosticsPeriod(uint32_t milliseconds) { _diagnosticsPeriod = milliseconds; }
+uint32_t BLEHostConfiguration::getDiagnosticsPeriod() const { return _diagnosticsPeriod; }
+
+void BLEHostConfiguration::setPowerIdleTimeout(uint32_t milliseconds) { _powerIdleTimeout = milliseconds; }
+uint32_t BLEHostConfiguration::getPowerIdleTimeout() const { return _powerIdleTimeout; }
+
+void BLEHostConfiguration::setAutomaticLightSleep(bool value) { _automaticLightSleep = value; }
+bool BLEHostConfiguration::getAutomaticLightSleep() const { return _automaticLightSleep; }
+
+void BLEHostConfiguration::setCpuFrequencyRange(uint16_t maxMhz, uint16_t minMhz)
+{
+    _maxCpuFrequency = maxMhz;
+    _minCpuFrequency = minMhz;
+}
+uint16_t BLEHostConfiguration::getMaxCpuFrequency() const { return _maxCpuFrequency; }
+uint16_t BLEHostConfiguration::getMinCpuFrequency() const { return _minCpuFrequency; }
+
+void BLEHostConfiguration::setServerTask(uint8_t core, uint8_t priority, uint32_t stackSize)
+{
+    _serverTaskCore = core;
+    _serverTaskPriority = priority;
+    _serverTaskStackSize = stackSize;
+}
+uint8_t BLEHostConfiguration::getServerTaskCore() const { return _serverTaskCore; }
+uint8_t BLEHostConfiguration::getServerTaskPriority() const { return _serverTaskPriority; }
+uint32_t BLEHostConfiguration::getServerTaskStackSize() const { return _serverTaskStackSize; }
+
+void BLEHostConfiguration::setAutoSendTask(uint8_t core, uint8_t priority, uint32_t stackSize)
+{
+    _autoSendTaskCore = core;
+    _autoSendTaskPriority = priority;
+    _autoSendTaskStackSize = stackSize;
+}
+uint8_t BLEHostConfiguration::getAutoSendTaskCore() const { return _autoSendTaskCore; }
+uint8_t BLEHostConfiguration::getAutoSendTaskPriority() const { return _autoSendTaskPriority; }
+uint32_t BLEHostConfiguration::getAutoSendTaskStackSize() const { return _autoSendTaskStackSize; }
+
+void BLEHostConfiguration::setNotifyWindow(uint8_t window) { _notifyWindow = window; }
+uint8_t BLEHostConfiguration::getNotifyWindow() const { return _notifyWindow; }
@@ -8,6 +8,40 @@
 #define VENDOR_BLUETOOTH_SOURCE 0x01
 #define VENDOR_USB_SOURCE 0x02
 
+// What happens to reports made while no host is connected. Reports only carry the state at the time they
+// are sent, so none of them is held back: replaying each would only repeat the device's current state.
+#define DISCONNECTED_REPORTS_DISCARD 0x00   // Drop them
+#define DISCONNECTED_REPORTS_KEEP 0x01      // Drop them, but send the device's current state once on reconnect if one was younger than the TTL
+
+// How advertising first tries to get the most recently bonded host back
+#define RECONNECT_MODE_NONE 0x00            // Undirected advertising straight away
+#define RECONNECT_MODE_DIRECTED 0x01        // Directed advertising addressed to the bonded host
+#define RECONNECT_MODE_ACCEPT_LIST 0x02     // Undirected advertising that only accepts connections from the bonded host
+
+// Which connected hosts receive each input report
+#define REPORT_ROUTING_BROADCAST 0x00       // Every host
+#define REPORT_ROUTING_PER_DEVICE 0x01      // The host set with BaseCompositeDevice::setHostIndex
+#define REPORT_ROUTING_ACTIVE_HOST 0x02     // The host set with BleCompositeHID::setActiveHost
+
+// Connection parameter profiles requested from the host
+#define CONNECTION_PROFILE_LOW_LATENCY_GAMING 0x00  // 7.5 - 8.75 ms interval, no latency
+#define CONNECTION_PROFILE_TYPING 0x01              // 15 - 30 ms interval, latency 4
+#define CONNECTION_PROFILE_POWER_SAVER 0x02         // 60 - 80 ms interval, latency 8
+#define CONNECTION_PROFILE_CUSTOM 0x03              // Uses the parameters set with setCustomConnectionParameters
+
+// Core a library task may run on
+#define TASK_CORE_ANY 0xFF                  // Unpinned, the scheduler picks a core
+
+struct ConnectionParameters {
+    uint16_t minInterval;   // 1.25 ms units
+    uint16_t maxInterval;   // 1.25 ms units
+    uint16_t latency;       // Connection events the device may skip while it has nothing to send
+    uint16_t timeout;       // Supervision timeout, 10 ms units
+};
+
+// Forwards
+class KeyValueStore;
+
 class BLEHostConfiguration
 {
 private:
@@ -57,9 +91,157 @@ public:
     void setQueuedSending(bool value);
     bool getQueuedSending() const;
 
+    // Re-send every device's current state as soon as a host (re)connects,
+    // so held keys and axis positions do not wait for the next input change
+    void setRestoreStateOnReconnect(bool value);
+    bool getRestoreStateOnReconnect() const;
+
+    void setDisconnectedReportPolicy(uint8_t policy);
+    uint8_t getDisconnectedReportPolicy() const;
+
+    // How old the last report made while disconnected may be for DISCONNECTED_REPORTS_KEEP to restore the state, in milliseconds
+    void setDisconnectedReportTTL(uint32_t milliseconds);
+    uint32_t getDisconnectedReportTTL() const;
+
+    // Persists the combined HID report map so later boots with the same devices skip rebuilding it.
+    // The store is not owned and must outlive the composite device, nullptr disables the cache.
+    void setReportMapStore(KeyValueStore* store);
+    KeyValueStore* getReportMapStore() const;
+
+    // Advertising runs through up to three phases: reconnect (only with a bonded host and a reconnect mode),
+    // then fast, then slow. Intervals are in 0.625 ms units, 0 leaves the NimBLE default.
+    void setReconnectMode(uint8_t mode);
+    uint8_t getReconnectMode() const;
+
+    // How long the reconnect phase lasts in milliseconds before falling back to undirected advertising
+    void setReconnectAdvertisingDuration(uint32_t milliseconds);
+    uint32_t getReconnectAdvertisingDuration() const;
+
+    void setFastAdvertisingInterval(uint16_t minInterval, uint16_t maxInterval);
+    uint16_t getFastAdvertisingMinInterval() const;
+    uint16_t getFastAdvertisingMaxInterval() const;
+
+    // How long the fast phase lasts in milliseconds, 0 keeps advertising fast until a host connects
+    void setFastAdvertisingDuration(uint32_t milliseconds);
+    uint32_t getFastAdvertisingDuration() const;
+
+    void setSlowAdvertisingInterval(uint16_t minInterval, uint16_t maxInterval);
+    uint16_t getSlowAdvertisingMinInterval() const;
+    uint16_t getSlowAdvertisingMaxInterval() const;
+
+    // Parameters requested while input is flowing
+    void setConnectionProfile(uint8_t profile);
+    uint8_t getConnectionProfile() const;
+
+    void setCustomConnectionParameters(const ConnectionParameters& parameters);
+    ConnectionParameters getCustomConnectionParameters() const;
+
+    // After idleTimeout milliseconds without a report the idle profile is requested,
+    // the next report switches back to the connection profile. 0 disables idle switching.
+    void setIdleConnectionProfile(uint8_t profile);
+    uint8_t getIdleConnectionProfile() const;
+    void setIdleTimeout(uint32_t milliseconds);
+    uint32_t getIdleTimeout() const;
+
+    // Resolves a profile into the parameters it requests
+    ConnectionParameters getConnectionParameters(uint8_t profile) const;
+
+    // Number of hosts that can be connected at the same time, limited by CONFIG_BT_NIMBLE_MAX_CONNECTIONS.
+    // Advertising continues until that many hosts are connected.
+    void setMaxConnections(uint8_t count);
+    uint8_t getMaxConnections() const;
+
+    void setReportRouting(uint8_t routing);
+    uint8_t getReportRouting() const;
+
+    // ATT MTU offered to hosts during the MTU exchange, 0 keeps the NimBLE default (CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU)
+    void setPreferredMTU(uint16_t mtu);
+    uint16_t getPreferredMTU() const;
+
+    // LE Data Length Extension, link layer payload requested on every connection in octets (27 - 251), 0 doesn't request one
+    void setDataLength(uint16_t octets);
+    uint16_t getDataLength() const;
+
+    // Preferred PHYs as a mask of BLE_GAP_LE_PHY_1M_MASK, BLE_GAP_LE_PHY_2M_MASK and BLE_GAP_LE_PHY_CODED_MASK,
+    // requested on every connection. 0 leaves the PHY to the host.
+    void setPreferredPhy(uint8_t phyMask);
+    uint8_t getPreferredPhy() const;
+
+    // Period of the vendor diagnostics service notifications, 0 leaves the service out of the GATT table entirely
+    void setDiagnosticsPeriod(uint32_t milliseconds);
+    uint32_t getDiagnosticsPeriod() const;
+
+    // Time without input before the device counts as idle and allows light sleep, 0 never goes idle
+    void setPowerIdleTimeout(uint32_t milliseconds);
+    uint32_t getPowerIdleTimeout() const;
+
+    // Lets the chip enter light sleep on its own while idle, needs CONFIG_PM_ENABLE in the SDK configuration
+    void setAutomaticLightSleep(bool value);
+    bool getAutomaticLightSleep() const;
+
+    // CPU frequency range used with automatic light sleep, 0 keeps the current CPU and crystal frequency
+    void setCpuFrequencyRange(uint16_t maxMhz, uint16_t minMhz);
+    uint16_t getMaxCpuFrequency() const;
+    uint16_t getMinCpuFrequency() const;
+
+    // Placement of the server task, which sets up NimBLE and the GATT table and then exits. On dual core chips
+    // core is 0 or 1, TASK_CORE_ANY leaves it unpinned. priority must be below configMAX_PRIORITIES, stack is in bytes.
+    // The report map is built on the heap, the default 4096 bytes only cover NimBLE's setup. taskServer logs its
+    // stack high water mark when it finishes.
+    void setServerTask(uint8_t core, uint8_t priority, uint32_t stackSize);
+    uint8_t getServerTaskCore() const;
+    uint8_t getServerTaskPriority() const;
+    uint32_t getServerTaskStackSize() const;
+
+    // Placement of the task that sends deferred reports when threaded auto send is enabled. Pinning it away from
+    // the core the application's input loop runs on keeps the two from delaying each other.
+    void setAutoSendTask(uint8_t core, uint8_t priority, uint32_t stackSize);
+    uint8_t getAutoSendTaskCore() const;
+    uint8_t getAutoSendTaskPriority() const;
+    uint32_t getAutoSendTaskStackSize() const;
+
+    // Notifications kept in flight per connection, up to NOTIFY_WINDOW_MAX. The next deferred report goes out
+    // as soon as every host has room for it instead of after the fixed queue send rate, and reports sent
+    // directly wait for room the same way. State restored from the BLE stack's callbacks never waits, it goes out
+    // at once. 0 keeps the fixed rate and never waits.
+    void setNotifyWindow(uint8_t window);
+    uint8_t getNotifyWindow() const;
+
 private:
     uint32_t _deferSendRate;
     bool _threadedAutoSend;
+    bool _restoreStateOnReconnect;
+    uint8_t _disconnectedReportPolicy;
+    uint32_t _disconnectedReportTTL;
+    KeyValueStore* _reportMapStore;
+    uint8_t _reconnectMode;
+    uint32_t _reconnectAdvertisingDuration;
+    uint16_t _fastAdvertisingMinInterval;
+    uint16_t _fastAdvertisingMaxInterval;
+    uint32_t _fastAdvertisingDuration;
+    uint16_t _slowAdvertisingMinInterval;
+    uint16_t _slowAdvertisingMaxInterval;
+    uint8_t _connectionProfile;
+    uint8_t _idleConnectionProfile;
+    uint32_t _idleTimeout;
+    ConnectionParameters _customConnectionParameters;
+    uint8_t _maxConnections;
+    uint8_t _reportRouting;
+    uint16_t _preferredMTU;
+    uint16_t _dataLength;
+    uint8_t _preferredPhy;
+    uint32_t _diagnosticsPeriod;
+    uint32_t _powerIdleTimeout;
+    bool _automaticLightSleep;
+    uint16_t _maxCpuFrequency;
+    uint16_t _minCpuFrequency;
+    uint8_t _serverTaskCore;
+    uint8_t _serverTaskPriority;
+    uint32_t _serverTaskStackSize;
+    uint8_t _autoSendTaskCore;
+    uint8_t _autoSendTaskPriority;
+    uint32_t _autoSendTaskStackSize;
+    uint8_t _notifyWindow;
 };
 
 #endif
@@ -1,6 +1,8 @@
 #include "BaseCompositeDevice.h"
 #include "BleCompositeHID.h"
 
+#include <vector>
+
 BaseCompositeDeviceConfiguration::BaseCompositeDeviceConfiguration(uint8_t reportId) : 
     _autoReport(true),
     _reportId(reportId),
@@ -25,11 +27,39 @@ void BaseCompositeDeviceConfiguration::setHidReportId(uint8_t value) { _reportId
 void BaseCompositeDeviceConfiguration::setAutoDefer(bool value) { _autoDefer = value; }
 bool BaseCompositeDeviceConfiguration::getAutoDefer() const { return _autoDefer; }
 
+size_t BaseCompositeDeviceConfiguration::getDeviceReportDescriptorSize() const {
+    // Only needed once per device while the report map is set up, so it comes from the heap rather than the stack
+    std::vector<uint8_t> scratch(DEVICE_REPORT_DESCRIPTOR_MAX_SIZE);
+    return makeDeviceReport(scratch.data(), scratch.size());
+}
+
+uint32_t BaseCompositeDeviceConfiguration::getConfigHash() const {
+    // Unknown configurations always rebuild their descriptor
+    return 0;
+}
+
+uint32_t BaseCompositeDeviceConfiguration::hashConfigBytes(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t BaseCompositeDeviceConfiguration::getBaseConfigHash() const {
+    uint32_t hash = 2166136261u;
+    const char* name = getDeviceName();
+    hash = hashConfigBytes(hash, name, strlen(name));
+    hash = hashConfigBytes(hash, &_reportId, sizeof(_reportId));
+    return hash;
+}
+
 // ---------------
 
-void BaseCompositeDevice::queueDeferredReport(std::function<void()> && reportFunc) {
+void BaseCompositeDevice::queueDeferredReport(DeferredReportFunction && reportFunc) {
     if(auto parent = getParent()){
-        parent->queueDeviceDeferredReport(std::forward<std::function<void()>>(reportFunc));
+        parent->queueDeviceDeferredReport(std::move(reportFunc), this);
     }
 }
 
@@ -38,7 +68,110 @@ BleCompositeHID* BaseCompositeDevice::getParent() { return _parent; }
 void BaseCompositeDevice::setCharacteristics(NimBLECharacteristic* input, NimBLECharacteristic* output) {
     _input = input;
     _output = output;
+    registerInput(input, getDeviceConfig()->getReportId());
 }
 
+void BaseCompositeDevice::registerInput(NimBLECharacteristic* input, uint8_t reportId) {
+    if (!input)
+        return;
+
+    if (_parent) {
+        input->setCallbacks(&_parent->_connectionStatus);
+    }
+
+    // Characteristics are created again when the HID service is rebuilt, the report ID stays the same
+    uint8_t index = 0;
+    while (index < _inputCount && _inputReportIds[index] != reportId)
+        index++;
+    if (index == MAX_DEVICE_INPUTS)
+        return;
+
+    _inputs[index] = input;
+    _inputReportIds[index] = reportId;
+    if (index == _inputCount)
+        _inputCount++;
+}
+
+uint8_t BaseCompositeDevice::getInputReportId(NimBLECharacteristic* input) const {
+    for (uint8_t i = 0; i < _inputCount; i++) {
+        if (_inputs[i] == input)
+            return _inputReportIds[i];
+    }
+    return 0;
+}
+
+NimBLECharacteristic* BaseCompositeDevice::getInputReport(uint8_t reportId) const {
+    for (uint8_t i = 0; i < _inputCount; i++) {
+        if (_inputReportIds[i] == reportId)
+            return _inputs[i];
+    }
+    return nullptr;
+}
+
+uint8_t BaseCompositeDevice::getCharacteristics(NimBLECharacteristic** characteristics, uint8_t maxCount) {
+    uint8_t count = 0;
+    if (_input && count < maxCount)
+        characteristics[count++] = _input;
+    if (_output && count < maxCount)
+        characteristics[count++] = _output;
+    return count;
+}
+
+void BaseCompositeDevice::setHostIndex(uint8_t index) { _hostIndex = index; }
+uint8_t BaseCompositeDevice::getHostIndex() const { return _hostIndex; }
+
 NimBLECharacteristic* BaseCompositeDevice::getInput() { return _input; }
 NimBLECharacteristic* BaseCompositeDevice::getOutput() { return _output; }
+
+void BaseCompositeDevice::notifyInput(NimBLECharacteristic* characteristic) {
+    if (_parent) {
+        _parent->waitToNotify(this);
+        _parent->notifyReport(this, characteristic);
+    } else {
+        characteristic->notify();
+    }
+}
+
+bool BaseCompositeDevice::isSubscribed() {
+    return _input && _parent && _parent->isReportSubscribed(this, _input);
+}
+
+bool BaseCompositeDevice::isInputSubscribed(NimBLECharacteristic* input) {
+    if (!input || !_parent)
+        return false;
+
+    // Only the report paths ask through here, so every false is a report that won't be built
+    if (!_parent->isReportSubscribed(this, input)) {
+        _parent->_telemetry.add(_telemetrySlot, TELEMETRY_REPORTS_SUPPRESSED);
+        return false;
+    }
+    return true;
+}
+
+void BaseCompositeDevice::countDroppedReport() {
+    if (_parent)
+        _parent->onReportWithoutHost(this, _telemetrySlot, millis());
+}
+
+bool BaseCompositeDevice::shouldReport(NimBLECharacteristic* input) {
+    // Every report starts here, which makes it the place input activity is seen
+    if (_parent)
+        _parent->_powerManager.onActivity();
+
+    if (!_parent || !_parent->isConnected())
+        return true;
+
+    return isInputSubscribed(input);
+}
+
+uint16_t BaseCompositeDevice::getMaxReportPayload() {
+    return _parent ? _parent->getMaxReportPayload(this) : BLE_ATT_MTU_DFLT - 3;
+}
+
+uint16_t BaseCompositeDevice::getInputReportSize() const {
+    if (_inputReportSize > 0)
+        return _inputReportSize;
+
+    auto config = getDeviceConfig();
+    return config ? config->getDeviceReportSize() : 0;
+}
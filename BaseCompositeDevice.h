@@ -6,10 +6,60 @@
 #include <NimBLECharacteristic.h>
 #include <NimBLEHIDDevice.h>
 #include "BLEHostConfiguration.h"
+#include "Telemetry.h"
+#include "InplaceFunction.hpp"
+#include <atomic>
+
+// Define COMPOSITE_HID_STATIC_ALLOCATION to keep the report path off the heap. Deferred reports then
+// hold their send function in place and wait in a queue of fixed capacity, a report queued while it
+// is full is dropped and counted as such.
+#if defined(COMPOSITE_HID_STATIC_ALLOCATION)
+#ifndef COMPOSITE_HID_DEFERRED_QUEUE_SIZE
+#define COMPOSITE_HID_DEFERRED_QUEUE_SIZE 32
+#endif
+#ifndef COMPOSITE_HID_DEFERRED_FUNCTION_SIZE
+#define COMPOSITE_HID_DEFERRED_FUNCTION_SIZE (4 * sizeof(void*))    // Fits a std::bind of a member function and this
+#endif
+typedef InplaceFunction<COMPOSITE_HID_DEFERRED_FUNCTION_SIZE> DeferredReportFunction;
+#else
+typedef std::function<void()> DeferredReportFunction;
+#endif
+
+#define MAX_DEVICE_INPUTS 4                 // Input reports one device can register
+#define DEVICE_REPORT_DESCRIPTOR_MAX_SIZE BLE_ATT_ATTR_MAX_LEN  // Largest part of the report map one device may have
 
 // Forwards
 class BleCompositeHID;
 
+// Writes a HID report descriptor straight into the caller's buffer.
+// Without a buffer nothing is written and only the size is counted, so the same code
+// can first measure a descriptor and then write it into an exactly sized buffer.
+class DescriptorWriter
+{
+public:
+    DescriptorWriter(uint8_t* buffer, size_t capacity) : _buffer(buffer), _capacity(capacity), _discard(0) {}
+
+    // Bytes past the end of the buffer are discarded, finish() reports the overflow
+    uint8_t& operator[](size_t index) { return (_buffer && index < _capacity) ? _buffer[index] : _discard; }
+
+    void copy(size_t index, const uint8_t* data, size_t size) {
+        if (_buffer && index < _capacity)
+            memcpy(_buffer + index, data, size < _capacity - index ? size : _capacity - index);
+    }
+
+    // The value makeDeviceReport returns: the size, or -1 if the descriptor did not fit into the buffer
+    size_t finish(size_t size) const {
+        if (_buffer && size > _capacity)
+            return -1;
+        return size;
+    }
+
+private:
+    uint8_t* _buffer;
+    size_t _capacity;
+    uint8_t _discard;
+};
+
 class BaseCompositeDeviceConfiguration 
 {
 public:
@@ -27,7 +77,23 @@ public:
     virtual const char* getDeviceName() const;
     virtual BLEHostConfiguration getIdealHostConfiguration() const;
     virtual uint8_t getDeviceReportSize() const = 0;
+
+    // Writes the device's part of the report map and returns its size, or -1 if it does not fit into bufferSize
     virtual size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const = 0;
+    // Size makeDeviceReport will return, used to size the report map before it is built. The default builds the
+    // descriptor once into a DEVICE_REPORT_DESCRIPTOR_MAX_SIZE scratch buffer, configurations that know their
+    // size override it.
+    virtual size_t getDeviceReportDescriptorSize() const;
+
+    // Identifies the descriptor makeDeviceReport would produce, used to reuse a cached report map.
+    // Must change whenever a setting or code that affects the descriptor changes. 0 means the descriptor can't be cached.
+    virtual uint32_t getConfigHash() const;
+
+protected:
+    // FNV-1a, chain calls by passing the previous hash back in
+    static uint32_t hashConfigBytes(uint32_t hash, const void* data, size_t size);
+    // Hash of the report ID and device name, a starting point for getConfigHash overrides
+    uint32_t getBaseConfigHash() const;
 
 private:
     bool _autoReport;
@@ -42,19 +108,67 @@ class BaseCompositeDevice
 public:
     virtual void init(NimBLEHIDDevice* hid) = 0;
     virtual const BaseCompositeDeviceConfiguration* getDeviceConfig() const = 0;
+
+    // Sends the device's current input state again, called once a host has (re)connected
+    virtual void restoreState() {}
+    // Drops input still waiting to be sent, called once the last host has disconnected
+    virtual void discardPendingState() {}
+
+    // Every characteristic the device created in init, used to add and remove it at runtime.
+    // The default returns the input and output set with setCharacteristics.
+    virtual uint8_t getCharacteristics(NimBLECharacteristic** characteristics, uint8_t maxCount);
     
     BleCompositeHID* getParent();
 
+    // Host this device reports to when the host configuration routes reports per device
+    void setHostIndex(uint8_t index);
+    uint8_t getHostIndex() const;
+
+    // Whether a host this device reports to has enabled notifications on its input report
+    bool isSubscribed();
+    // Largest report that reaches every host this device reports to in a single notification
+    uint16_t getMaxReportPayload();
+    // Size of the device's input report as declared by the parsed report map, without the report ID.
+    // Falls back to the configuration's getDeviceReportSize() until the map has been parsed.
+    uint16_t getInputReportSize() const;
+
+    // Report ID an input characteristic was registered with, 0 if it isn't one of this device's inputs
+    uint8_t getInputReportId(NimBLECharacteristic* input) const;
+    // Input characteristic registered for reportId, null if the device has none
+    NimBLECharacteristic* getInputReport(uint8_t reportId) const;
+
 protected:
-    void queueDeferredReport(std::function<void()> && reportFunc);
+    void queueDeferredReport(DeferredReportFunction && reportFunc);
     void setCharacteristics(NimBLECharacteristic* input, NimBLECharacteristic* output);
     NimBLECharacteristic* getInput();
     NimBLECharacteristic* getOutput();
+    // Lets the composite device track which hosts subscribed to an input report and which report ID it carries.
+    // setCharacteristics registers the main input, devices with more input reports register those too.
+    void registerInput(NimBLECharacteristic* input, uint8_t reportId);
+    // Sends an input report that has already been set on characteristic to the hosts it is routed to
+    void notifyInput(NimBLECharacteristic* characteristic);
+    bool isInputSubscribed(NimBLECharacteristic* input);
+    // Whether a report on input is worth building or queuing. While no host is connected
+    // this is always true and the disconnected report policy decides what happens to it.
+    bool shouldReport(NimBLECharacteristic* input);
+    // Counts a report the device gave up on because no host was connected. With DISCONNECTED_REPORTS_KEEP
+    // the device's state is then sent once when a host is back.
+    void countDroppedReport();
 
 private:
     BleCompositeHID* _parent;
     NimBLECharacteristic* _input;
     NimBLECharacteristic* _output;
+    NimBLECharacteristic* _inputs[MAX_DEVICE_INPUTS] = {};
+    uint8_t _inputReportIds[MAX_DEVICE_INPUTS] = {};
+    uint8_t _inputCount = 0;
+    uint8_t _hostIndex = 0;
+    uint16_t _reportMapSize = 0;        // Size of this device's part of the report map, 0 until known
+    uint16_t _inputReportSize = 0;      // From the parsed report map, 0 until parsed
+    uint8_t _telemetrySlot = TELEMETRY_SLOT_NONE;
+    // A report was given up on while disconnected at _stateKeptMs, see DISCONNECTED_REPORTS_KEEP
+    std::atomic<bool> _stateKept{false};
+    std::atomic<uint32_t> _stateKeptMs{0};
 };
 
 #endif
\ No newline at end of file
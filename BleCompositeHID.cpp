@@ -9,10 +9,12 @@
 
 #include "BleCompositeHID.h"
 #include "BleConnectionStatus.h"
+#include "KeyValueStore.h"
 
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 
 #if defined(CONFIG_ARDUHAL_ESP_LOG)
@@ -32,17 +34,21 @@ static const char *LOG_TAG = "BLECompositeHID";
 #define CHARACTERISTIC_UUID_FIRMWARE_REVISION  "2A26"      // Characteristic - Firmware Revision String - 0x2A26
 #define CHARACTERISTIC_UUID_HARDWARE_REVISION  "2A27"      // Characteristic - Hardware Revision String - 0x2A27
 
+#define REPORT_MAP_CACHE_KEY "reportmap"
+#define REPORT_MAP_CACHE_HASH_KEY "reportmaphash"         // Config hash and size of the cached map
+#define REPORT_MAP_FORMAT_VERSION 1                       // Bump when a built-in configuration's descriptor changes, drops cached maps
+
+#define RECONNECT_ADVERTISING_INTERVAL 0x20                // 20 ms, the fastest interval allowed for connectable advertising
+
+#define MAX_DEVICE_CHARACTERISTICS 4                      // Characteristics a single device may create
+
+#define HID_REPORT_MAP_MAX_SIZE 2048                      // Upper bound for the combined descriptor
+
 uint16_t vidSource;
 uint16_t vid;
 uint16_t pid;
 uint16_t guidVersion;
 uint16_t hidType;
-std::string modelNumber;
-std::string softwareRevision;
-std::string serialNumber;
-std::string firmwareRevision;
-std::string hardwareRevision;
-std::string systemID;
 
 std::string uint8_to_hex_string(const uint8_t *v, const size_t s) {
   std::stringstream ss;
@@ -56,18 +62,37 @@ std::string uint8_to_hex_string(const uint8_t *v, const size_t s) {
   return ss.str();
 }
 
-BleCompositeHID::BleCompositeHID(std::string deviceName, std::string deviceManufacturer, uint8_t batteryLevel) : _hid(nullptr), _autoSendTaskHandle(NULL) // Initialize task handle
+BaseType_t BleCompositeHID::createTask(TaskFunction_t function, const char* name, uint8_t core, uint8_t priority, uint32_t stackSize, void* parameter, TaskHandle_t* handle)
+{
+    BaseType_t coreId = tskNO_AFFINITY;
+    if (core != TASK_CORE_ANY)
+    {
+        if (core < portNUM_PROCESSORS)
+            coreId = core;
+        else
+            ESP_LOGW(LOG_TAG, "Task %s can't be pinned to core %u, leaving it unpinned", name, core);
+    }
+
+    ESP_LOGD(LOG_TAG, "Creating task %s: core %d, priority %u, stack %u bytes", name, (int)(coreId == tskNO_AFFINITY ? -1 : coreId), priority, (unsigned)stackSize);
+    return xTaskCreatePinnedToCore(function, name, stackSize, parameter, priority, handle, coreId);
+}
+
+// Device information strings are set straight from the configuration, without a copy
+static void setStringValue(NimBLECharacteristic* characteristic, const char* value)
+{
+    characteristic->setValue((const uint8_t*)value, strlen(value));
+}
+
+BleCompositeHID::BleCompositeHID(std::string deviceName, std::string deviceManufacturer, uint8_t batteryLevel) : _connectionStatus(this), _hid(nullptr), _servicesStarted(false), _autoSendTaskHandle(NULL), _reportMapSetupMicros(0), _reportMapFromCache(false), _diagnostics(this), _serverStackHighWater(0), _advertisingPhase(ADVERTISING_PHASE_NONE), _reconnectAddressOnAcceptList(false), _activeHost(0), _idleTimer(NULL), _connectionIdle(false), _lastReportMs(0), _recorder(nullptr), _notifyWithoutWaitTask(NULL) // Initialize task handle
 {
     this->deviceName = deviceName.substr(0, CONFIG_BT_NIMBLE_GAP_DEVICE_NAME_MAX_LEN - 1);
     this->deviceManufacturer = deviceManufacturer;
     this->batteryLevel = batteryLevel;
-    this->_connectionStatus = new BleConnectionStatus();
 }
 
 BleCompositeHID::~BleCompositeHID()
 {
     // Consider calling end() here to clean up tasks if not done elsewhere
-    delete this->_connectionStatus;
     // if (_hid) { delete _hid; _hid = nullptr; } // NimBLEHIDDevice might be managed by NimBLEServer? Check docs.
 }
 
@@ -79,13 +104,7 @@ void BleCompositeHID::begin()
 void BleCompositeHID::begin(const BLEHostConfiguration& config)
 {
     _configuration = config; // we make a copy, so the user can't change actual values midway through operation, without calling the begin function again
-
-    modelNumber = _configuration.getModelNumber();
-    softwareRevision = _configuration.getSoftwareRevision();
-    serialNumber = _configuration.getSerialNumber();
-    firmwareRevision = _configuration.getFirmwareRevision();
-    hardwareRevision = _configuration.getHardwareRevision();
-    systemID = _configuration.getSystemID();
+    _connectionStatus.setMaxConnections(_configuration.getMaxConnections());
 
     vidSource = _configuration.getVidSource();
 	vid = _configuration.getVid();
@@ -111,8 +130,11 @@ void BleCompositeHID::begin(const BLEHostConfiguration& config)
 #endif
 
     // Start BLE server task
-    // Increased stack size slightly, adjust if needed
-    xTaskCreate(this->taskServer, "server", 5120, (void *)this, 5, NULL);
+    // The descriptor is assembled in an exactly sized heap buffer, so the stack only needs to cover NimBLE setup
+    if (createTask(this->taskServer, "server", _configuration.getServerTaskCore(), _configuration.getServerTaskPriority(),
+            _configuration.getServerTaskStackSize(), (void *)this, NULL) != pdPASS) {
+        ESP_LOGE(LOG_TAG, "Failed to create the server task!");
+    }
 }
 
 void BleCompositeHID::end(void)
@@ -121,11 +143,43 @@ void BleCompositeHID::end(void)
         vTaskDelete(this->_autoSendTaskHandle);
         _autoSendTaskHandle = NULL; // Set handle to NULL after deletion
     }
+    if(_idleTimer != NULL) {
+        xTimerDelete(_idleTimer, 0);
+        _idleTimer = NULL;
+    }
+    _diagnostics.end();
+    _powerManager.end();
     // Optional: Add NimBLEDevice::deinit(true); // true to release memory
     ESP_LOGI(LOG_TAG, "BleCompositeHID ended.");
 }
 
 
+namespace {
+
+// Marks the calling task while it sends from a NimBLE callback or with _devicesMutex held. Waiting for
+// the notify window there would stall the host stack or every other sender, its reports go out at once.
+// Only set with _devicesMutex held, so no other task can be marked at the same time.
+class NotifyWithoutWaiting
+{
+public:
+    NotifyWithoutWaiting(std::atomic<TaskHandle_t>& task) :
+        _task(task),
+        _previous(task.exchange(xTaskGetCurrentTaskHandle()))
+    {
+    }
+
+    ~NotifyWithoutWaiting()
+    {
+        _task = _previous;
+    }
+
+private:
+    std::atomic<TaskHandle_t>& _task;
+    TaskHandle_t _previous;
+};
+
+}
+
 void BleCompositeHID::timedSendDeferredReports(void *pvParameter)
 {
     BleCompositeHID *BleCompositeHIDInstance = (BleCompositeHID *)pvParameter;
@@ -133,18 +187,21 @@ void BleCompositeHID::timedSendDeferredReports(void *pvParameter)
     ESP_LOGI(LOG_TAG, "timedSendDeferredReports task started.");
     if (BleCompositeHIDInstance && BleCompositeHIDInstance->_hid) // Check instance validity
     {
-        std::function<void()> reportFunc;
+        DeferredReport report;
         while(true) { // Loop indefinitely until task is deleted
-            if(BleCompositeHIDInstance->_deferredReports.ConsumeSync(reportFunc)) { // ConsumeSync waits
-                if (BleCompositeHIDInstance->isConnected()) { // Only send if connected
-                    reportFunc();
-                    if(BleCompositeHIDInstance->_configuration.getQueueSendRate() > 0) {
+            if(BleCompositeHIDInstance->_deferredReports.ConsumeSync(report)) { // ConsumeSync waits
+                BleCompositeHIDInstance->_telemetry.onReportDequeued();
+                if (BleCompositeHIDInstance->isConnected()) {
+                    // Reports aren't routed yet at this point, so every host needs room
+                    BleCompositeHIDInstance->waitForNotifyWindow();
+                    BleCompositeHIDInstance->sendDeferredReport(report);
+                    if(BleCompositeHIDInstance->_configuration.getNotifyWindow() == 0 && BleCompositeHIDInstance->_configuration.getQueueSendRate() > 0) {
                         vTaskDelay((1000 / BleCompositeHIDInstance->_configuration.getQueueSendRate()) / portTICK_PERIOD_MS);
                     }
                 } else {
-                     ESP_LOGD(LOG_TAG, "Deferred report skipped, not connected.");
-                     // Optional: Add a small delay here if not connected to prevent busy-waiting on ConsumeSync if queue fills rapidly?
-                     vTaskDelay(10 / portTICK_PERIOD_MS);
+                     // Dropped without delay, ConsumeSync blocks once the queue is empty
+                     ESP_LOGD(LOG_TAG, "Deferred report dropped, not connected.");
+                     BleCompositeHIDInstance->onReportWithoutHost(report.device, report.telemetrySlot, report.queuedAt);
                 }
             } else {
                 // ConsumeSync returned false, likely because Finish() was called or queue is empty and processing should stop
@@ -158,20 +215,859 @@ void BleCompositeHID::timedSendDeferredReports(void *pvParameter)
     vTaskDelete(NULL); // Delete task when exiting loop
 }
 
+void BleCompositeHID::onHostConnected(uint8_t hostIndex, NimBLEConnInfo& connInfo)
+{
+    bool firstHost = _connectionStatus.getConnectedCount() == 1;
+    _telemetry.onConnected(millis(), firstHost);
+    if (firstHost) {
+        _connectionTimings.connectedMs = millis();
+        _connectionTimings.connectedPhase = _advertisingPhase;
+    }
+    _advertisingPhase = ADVERTISING_PHASE_NONE;
+
+    ESP_LOGI(LOG_TAG, "Host %u connected: %s", hostIndex, connInfo.getIdAddress().toString().c_str());
+
+    // Later hosts join in whatever state the first one is in, the idle timer takes over once input stops
+    if (firstHost) {
+        _connectionIdle = false;
+        _lastReportMs = millis();
+        if (_idleTimer) {
+            xTimerChangePeriod(_idleTimer, pdMS_TO_TICKS(_configuration.getIdleTimeout()), 0);
+        }
+    }
+    ConnectionParameters parameters = _configuration.getConnectionParameters(
+        _connectionIdle ? _configuration.getIdleConnectionProfile() : _configuration.getConnectionProfile());
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    pServer->updateConnParams(connInfo.getConnHandle(), parameters.minInterval, parameters.maxInterval, parameters.latency, parameters.timeout);
+
+    // Link layer tuning, the outcome is reported back through onPhyUpdate
+    if (_configuration.getDataLength() > 0) {
+        pServer->setDataLen(connInfo.getConnHandle(), _configuration.getDataLength());
+        _connectionStatus.setDataLength(connInfo.getConnHandle(), _configuration.getDataLength());
+    }
+    if (_configuration.getPreferredPhy() != 0) {
+        pServer->updatePhy(connInfo.getConnHandle(), _configuration.getPreferredPhy(), _configuration.getPreferredPhy());
+    }
+
+    // NimBLE stops advertising on every connection, keep going while there are free host slots
+    if (_connectionStatus.getConnectedCount() < _connectionStatus.getMaxConnections() && !startAdvertising()) {
+        ESP_LOGE(LOG_TAG, "Failed to restart advertising for further hosts!");
+    }
+}
+
+void BleCompositeHID::onHostDisconnected(uint8_t hostIndex, int reason)
+{
+    ESP_LOGI(LOG_TAG, "Host %u disconnected, reason 0x%X.", hostIndex, reason);
+    _telemetry.onDisconnected(millis(), _connectionStatus.getConnectedCount() == 0, reason);
+
+    if (_connectionStatus.getConnectedCount() == 0) {
+        if (_idleTimer) {
+            xTimerStop(_idleTimer, 0);
+        }
+        _connectionIdle = false;
+
+        // Start timing the next connection cycle from here
+        _connectionTimings = ConnectionTimings();
+        _connectionTimings.cycleStartMs = millis();
+
+        std::lock_guard<std::recursive_mutex> lock(_devicesMutex);
+        for (auto device : _devices)
+        {
+            if (device)
+                device->discardPendingState();
+        }
+    }
+
+    // Advertising may still be running if other host slots were free
+    if (_advertisingPhase == ADVERTISING_PHASE_NONE && !startAdvertising()) {
+        ESP_LOGE(LOG_TAG, "Failed to restart advertising after disconnect!");
+    }
+}
+
+void BleCompositeHID::onHostAuthenticated(uint8_t hostIndex)
+{
+    if (_connectionTimings.authenticatedMs == 0) {
+        _connectionTimings.authenticatedMs = millis();
+    }
+
+    bool restoreAll = _configuration.getRestoreStateOnReconnect();
+    if (restoreAll)
+        ESP_LOGI(LOG_TAG, "Host %u authenticated, restoring device state.", hostIndex);
+
+    std::lock_guard<std::recursive_mutex> lock(_devicesMutex);
+    NotifyWithoutWaiting noWait(_notifyWithoutWaitTask);
+    for (auto device : _devices)
+    {
+        if (!device)
+            continue;
+
+        if (restoreAll)
+        {
+            device->_stateKept = false;
+            device->restoreState();
+        }
+        else
+        {
+            restoreKeptState(device);
+        }
+    }
+}
+
+void BleCompositeHID::restoreKeptState(BaseCompositeDevice* device)
+{
+    // A host that hasn't subscribed yet gets it from onInputSubscribed
+    if (!device->_stateKept || !isReportSubscribed(device, device->getInput()))
+        return;
+
+    if (device->_stateKept.exchange(false) &&
+        (uint32_t)(millis() - device->_stateKeptMs) <= _configuration.getDisconnectedReportTTL())
+        device->restoreState();
+}
+
+void BleCompositeHID::onConnectionParametersUpdated(NimBLEConnInfo& connInfo)
+{
+    ESP_LOGD(LOG_TAG, "Connection parameters updated for handle %u: interval %u, latency %u, timeout %u",
+        connInfo.getConnHandle(), connInfo.getConnInterval(), connInfo.getConnLatency(), connInfo.getConnTimeout());
+}
+
+ConnectionParameters BleCompositeHID::getNegotiatedConnectionParameters(uint8_t hostIndex) const
+{
+    HostConnection host;
+    if (!_connectionStatus.getHost(hostIndex, host))
+        return ConnectionParameters();
+
+    return host.parameters;
+}
+
+bool BleCompositeHID::isConnectionIdle() const
+{
+    return _connectionIdle;
+}
+
+void BleCompositeHID::requestConnectionProfile(uint8_t profile)
+{
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    if (!pServer)
+        return;
+
+    ConnectionParameters parameters = _configuration.getConnectionParameters(profile);
+    uint16_t connHandles[CONFIG_BT_NIMBLE_MAX_CONNECTIONS];
+    uint8_t count = _connectionStatus.getConnHandles(connHandles, CONFIG_BT_NIMBLE_MAX_CONNECTIONS);
+    for (uint8_t i = 0; i < count; i++) {
+        pServer->updateConnParams(connHandles[i], parameters.minInterval, parameters.maxInterval, parameters.latency, parameters.timeout);
+    }
+}
+
+void BleCompositeHID::idleTimerCallback(TimerHandle_t timer)
+{
+    BleCompositeHID* BleCompositeHIDInstance = (BleCompositeHID*)pvTimerGetTimerID(timer);
+    BleCompositeHIDInstance->onIdleTimer();
+}
+
+void BleCompositeHID::onIdleTimer()
+{
+    if (_connectionStatus.getConnectedCount() == 0 || _connectionIdle)
+        return;
+
+    // Reports don't touch the timer, so check how long it has really been since the last one
+    uint32_t idleTimeout = _configuration.getIdleTimeout();
+    uint32_t elapsed = millis() - _lastReportMs;
+    if (elapsed < idleTimeout) {
+        xTimerChangePeriod(_idleTimer, pdMS_TO_TICKS(idleTimeout - elapsed), 0);
+        return;
+    }
+
+    ESP_LOGD(LOG_TAG, "No input for %u ms, switching to the idle connection profile.", elapsed);
+    _connectionIdle = true;
+    requestConnectionProfile(_configuration.getIdleConnectionProfile());
+}
+
+uint32_t BleCompositeHID::getHostMask(BaseCompositeDevice* device) const
+{
+    switch (_configuration.getReportRouting()) {
+        case REPORT_ROUTING_PER_DEVICE:
+            return device->getHostIndex() < 32 ? 1UL << device->getHostIndex() : 0;
+        case REPORT_ROUTING_ACTIVE_HOST:
+            return _activeHost < 32 ? 1UL << _activeHost : 0;
+        default:
+            return 0xFFFFFFFF;
+    }
+}
+
+bool BleCompositeHID::isReportSubscribed(BaseCompositeDevice* device, NimBLECharacteristic* characteristic)
+{
+    return _connectionStatus.hasReportTarget(characteristic->getHandle(), getHostMask(device));
+}
+
+void BleCompositeHID::onInputSubscribed(NimBLECharacteristic* characteristic)
+{
+    // Reports skipped before the host subscribed never reached it, send the current state now
+    std::lock_guard<std::recursive_mutex> lock(_devicesMutex);
+    NotifyWithoutWaiting noWait(_notifyWithoutWaitTask);
+    for (auto device : _devices)
+    {
+        if (!device || device->getInput() != characteristic)
+            continue;
+
+        if (_configuration.getRestoreStateOnReconnect())
+        {
+            device->_stateKept = false;
+            device->restoreState();
+        }
+        else
+        {
+            restoreKeptState(device);
+        }
+    }
+}
+
+void BleCompositeHID::notifyReport(BaseCompositeDevice* device, NimBLECharacteristic* characteristic)
+{
+    uint32_t hostMask = getHostMask(device);
+    uint16_t connHandles[CONFIG_BT_NIMBLE_MAX_CONNECTIONS];
+    uint8_t count = _connectionStatus.getReportTargets(characteristic->getHandle(), hostMask, connHandles, CONFIG_BT_NIMBLE_MAX_CONNECTIONS);
+
+    uint8_t slot = device->_telemetrySlot;
+    _telemetry.add(slot, TELEMETRY_REPORTS_BUILT);
+    if (_recorder.load(std::memory_order_relaxed))
+        recordReport(device, characteristic);
+    size_t length = count > 0 ? characteristic->getLength() : 0;
+
+    // The report was built once into the characteristic value, every host is sent that same value
+    for (uint8_t i = 0; i < count; i++) {
+        if (characteristic->notify(connHandles[i])) {
+            _connectionStatus.onNotifySent(connHandles[i]);
+            _telemetry.add(slot, TELEMETRY_REPORTS_NOTIFIED);
+            _telemetry.add(slot, TELEMETRY_BYTES_SENT, length);
+        } else {
+            // Out of buffers, the notify window holds off this host until they drained
+            _connectionStatus.onNotifyFailed(connHandles[i]);
+            _telemetry.add(slot, TELEMETRY_NOTIFY_FAILURES);
+        }
+    }
+
+    if (count > 0) {
+        onReportNotified();
+    }
+}
+
+void BleCompositeHID::recordReport(BaseCompositeDevice* device, NimBLECharacteristic* characteristic)
+{
+    ReportRecorder* recorder = _recorder.load();
+    if (!recorder || !recorder->isRecording())
+        return;
+
+    // Devices are identified by the order they were added, like the owners of the parsed report map
+    uint8_t deviceIndex = 0;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_devicesMutex);
+        while (deviceIndex < _devices.size() && _devices[deviceIndex] != device)
+            deviceIndex++;
+        if (deviceIndex == _devices.size())
+            return;
+    }
+
+    NimBLEAttValue value = characteristic->getValue();
+    recorder->record(deviceIndex, device->getInputReportId(characteristic), value.data(), value.size());
+}
+
+void BleCompositeHID::setReportRecorder(ReportRecorder* recorder)
+{
+    _recorder = recorder;
+}
+
+ReportRecorder* BleCompositeHID::getReportRecorder() const
+{
+    return _recorder;
+}
+
+bool BleCompositeHID::replayReport(uint8_t deviceIndex, uint8_t reportId, const uint8_t* data, size_t length)
+{
+    BaseCompositeDevice* device;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_devicesMutex);
+        if (deviceIndex >= _devices.size())
+            return false;
+        device = _devices[deviceIndex];
+    }
+
+    NimBLECharacteristic* characteristic = device ? device->getInputReport(reportId) : nullptr;
+    if (!characteristic)
+        return false;
+
+    // A replayed report is input activity like any other
+    _powerManager.onActivity();
+    characteristic->setValue(data, length);
+    waitToNotify(device);
+    notifyReport(device, characteristic);
+    return true;
+}
+
+void BleCompositeHID::onNotifyStatus(int code)
+{
+    // Notifications complete with 0, indications with BLE_HS_EDONE
+    if (code != 0 && code != BLE_HS_EDONE) {
+        _telemetry.onNotifyStatus(code);
+    }
+}
+
+void BleCompositeHID::onReportNotified()
+{
+    _lastReportMs = millis();
+    if (_connectionIdle) {
+        // First input after idling, get the low latency parameters back and restart the idle countdown
+        _connectionIdle = false;
+        requestConnectionProfile(_configuration.getConnectionProfile());
+        xTimerChangePeriod(_idleTimer, pdMS_TO_TICKS(_configuration.getIdleTimeout()), 0);
+    }
+
+    // Only the first report of each connection is traced
+    if (_connectionTimings.firstReportMs != 0 || _connectionTimings.connectedMs == 0)
+        return;
+
+    _connectionTimings.firstReportMs = millis();
+
+    const ConnectionTimings& timings = _connectionTimings;
+    ESP_LOGI(LOG_TAG, "Connection trace: advertising +%u ms, connected +%u ms (phase %u), authenticated +%u ms, first report +%u ms",
+        timings.advertisingStartMs - timings.cycleStartMs,
+        timings.connectedMs - timings.cycleStartMs,
+        timings.connectedPhase,
+        timings.authenticatedMs ? timings.authenticatedMs - timings.cycleStartMs : 0,
+        timings.firstReportMs - timings.cycleStartMs);
+}
+
+ConnectionTimings BleCompositeHID::getConnectionTimings() const
+{
+    return _connectionTimings;
+}
+
+uint8_t BleCompositeHID::getAdvertisingPhase() const
+{
+    return _advertisingPhase;
+}
+
+bool BleCompositeHID::getReconnectAddress(NimBLEAddress& address) const
+{
+    // NimBLE appends new bonds to the end of its store, so the last one is the most recent
+    int bondCount = NimBLEDevice::getNumBonds();
+    if (bondCount <= 0)
+        return false;
+
+    address = NimBLEDevice::getBondedAddress(bondCount - 1);
+    return !address.isNull();
+}
+
+bool BleCompositeHID::startAdvertising()
+{
+    // The reconnect phase only makes sense while no host is connected, otherwise it may target a connected one
+    NimBLEAddress address;
+    if (_configuration.getReconnectMode() != RECONNECT_MODE_NONE && _connectionStatus.getConnectedCount() == 0 && getReconnectAddress(address)) {
+        _reconnectAddress = address;
+        if (startAdvertisingPhase(ADVERTISING_PHASE_RECONNECT))
+            return true;
+
+        ESP_LOGW(LOG_TAG, "Reconnect advertising to %s failed, falling back to undirected advertising.", address.toString().c_str());
+    }
+
+    return startAdvertisingPhase(ADVERTISING_PHASE_FAST);
+}
+
+bool BleCompositeHID::startAdvertisingPhase(uint8_t phase)
+{
+    NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
+    const NimBLEAddress* directedAddress = nullptr;
+    uint32_t duration = 0;
+
+    // Undo whatever the reconnect phase changed
+    pAdvertising->setConnectableMode(BLE_GAP_CONN_MODE_UND);
+    pAdvertising->setScanFilter(false, false);
+    if (_reconnectAddressOnAcceptList) {
+        NimBLEDevice::whiteListRemove(_reconnectAddress);
+        _reconnectAddressOnAcceptList = false;
+    }
+
+    switch (phase) {
+        case ADVERTISING_PHASE_RECONNECT:
+            duration = _configuration.getReconnectAdvertisingDuration();
+            pAdvertising->setMinInterval(RECONNECT_ADVERTISING_INTERVAL);
+            pAdvertising->setMaxInterval(RECONNECT_ADVERTISING_INTERVAL);
+
+            if (_configuration.getReconnectMode() == RECONNECT_MODE_DIRECTED) {
+                pAdvertising->setConnectableMode(BLE_GAP_CONN_MODE_DIR);
+                directedAddress = &_reconnectAddress;
+            } else {
+                if (!NimBLEDevice::whiteListAdd(_reconnectAddress))
+                    return false;
+                _reconnectAddressOnAcceptList = true;
+                pAdvertising->setScanFilter(false, true);
+            }
+            break;
+
+        case ADVERTISING_PHASE_FAST:
+            duration = _configuration.getFastAdvertisingDuration();
+            pAdvertising->setMinInterval(_configuration.getFastAdvertisingMinInterval());
+            pAdvertising->setMaxInterval(_configuration.getFastAdvertisingMaxInterval());
+            break;
+
+        case ADVERTISING_PHASE_SLOW:
+            pAdvertising->setMinInterval(_configuration.getSlowAdvertisingMinInterval());
+            pAdvertising->setMaxInterval(_configuration.getSlowAdvertisingMaxInterval());
+            break;
+
+        default:
+            return false;
+    }
+
+    _advertisingPhase = phase;
+    if (_connectionTimings.advertisingStartMs == 0) {
+        _connectionTimings.advertisingStartMs = millis();
+    }
+
+    ESP_LOGD(LOG_TAG, "Advertising phase %u for %u ms", phase, duration);
+    if (!pAdvertising->start(duration, directedAddress)) {
+        _advertisingPhase = ADVERTISING_PHASE_NONE;
+        return false;
+    }
+
+    return true;
+}
+
+void BleCompositeHID::onAdvertisingComplete()
+{
+    // Advertising also completes when a host connects, which clears the phase
+    uint8_t phase = _advertisingPhase;
+    if (phase == ADVERTISING_PHASE_NONE || _connectionStatus.getConnectedCount() >= _connectionStatus.getMaxConnections())
+        return;
+
+    uint8_t nextPhase = phase == ADVERTISING_PHASE_RECONNECT ? ADVERTISING_PHASE_FAST : ADVERTISING_PHASE_SLOW;
+    if (!startAdvertisingPhase(nextPhase)) {
+        ESP_LOGE(LOG_TAG, "Failed to start advertising phase %u!", nextPhase);
+    }
+}
+
+size_t BleCompositeHID::measureReportMap() const
+{
+    size_t hidReportDescriptorSize = 0;
+
+    for(auto device : _devices){
+        if (!device)
+            continue;
+
+        auto config = device->getDeviceConfig();
+        if (!config)
+            continue;
+
+        size_t reportSize = config->getDeviceReportDescriptorSize();
+        if(reportSize == 0 || reportSize == (size_t)-1)
+            continue; // buildReportMap skips these too
+
+        hidReportDescriptorSize += reportSize;
+    }
+
+    return hidReportDescriptorSize;
+}
+
+size_t BleCompositeHID::buildReportMap(uint8_t* buffer, size_t bufferSize)
+{
+    size_t hidReportDescriptorSize = 0;
+
+    for(auto device : _devices){
+        if (!device)
+            continue;
+
+        auto config = device->getDeviceConfig();
+        if (!config) {
+            ESP_LOGE(LOG_TAG, "Device %p has NULL configuration, skipping.", (void*)device);
+            continue;
+        }
+        const char* currentDeviceName = config->getDeviceName();
+
+        // Each device writes its part straight into the combined descriptor
+        size_t reportSize = config->makeDeviceReport(buffer + hidReportDescriptorSize, bufferSize - hidReportDescriptorSize);
+
+        // Validate the returned size
+        if(reportSize == 0 || reportSize == (size_t)-1){ // Check for 0, error or not enough room (-1 cast to size_t)
+             ESP_LOGE(LOG_TAG, "Error creating or empty report descriptor for device %s (size: %zu)", currentDeviceName, reportSize); // Use %zu for size_t
+             continue; // Skip this device if its descriptor is invalid
+        }
+
+        ESP_LOGD(LOG_TAG, "Created device %s descriptor part with size %zu", currentDeviceName, reportSize); // Use %zu
+        device->_reportMapSize = reportSize;
+        hidReportDescriptorSize += reportSize;
+    }
+
+    return hidReportDescriptorSize;
+}
+
+bool BleCompositeHID::setupReportMap()
+{
+    uint32_t reportMapStart = micros();
+    uint32_t reportMapHash = getReportMapHash();
+
+    // First pass: find the exact descriptor size, from the cache or by measuring every device
+    size_t hidReportDescriptorSize = getCachedReportMapSize(reportMapHash);
+    _reportMapFromCache = hidReportDescriptorSize > 0;
+    if (!_reportMapFromCache) {
+        hidReportDescriptorSize = measureReportMap();
+    }
+
+    if (hidReportDescriptorSize == 0 || hidReportDescriptorSize > HID_REPORT_MAP_MAX_SIZE) {
+        ESP_LOGE(LOG_TAG, "Invalid HID descriptor size: %zu bytes", hidReportDescriptorSize);
+        return false;
+    }
+
+    // Second pass: fill a buffer of exactly that size. It comes from the heap, the server task's stack
+    // has no room for a descriptor up to HID_REPORT_MAP_MAX_SIZE, and setReportMap keeps its own copy.
+    std::vector<uint8_t> hidReportDescriptorBuffer(hidReportDescriptorSize);
+    uint8_t* hidReportDescriptor = hidReportDescriptorBuffer.data();
+
+    if (_reportMapFromCache && !loadCachedReportMap(hidReportDescriptor, hidReportDescriptorSize)) {
+        _reportMapFromCache = false;
+    }
+
+    if (!_reportMapFromCache) {
+        ESP_LOGI(LOG_TAG, "Building HID descriptor...");
+        size_t builtSize = buildReportMap(hidReportDescriptor, hidReportDescriptorSize);
+        if (builtSize != hidReportDescriptorSize) {
+            ESP_LOGE(LOG_TAG, "HID descriptor size changed between passes (%zu measured, %zu built)", hidReportDescriptorSize, builtSize);
+            return false;
+        }
+        saveCachedReportMap(reportMapHash, hidReportDescriptor, hidReportDescriptorSize);
+    }
+
+    _reportMapSetupMicros = micros() - reportMapStart;
+    ESP_LOGI(LOG_TAG, "Final Combined HID Report Descriptor Size: %zu bytes, %s in %u us", hidReportDescriptorSize,
+        _reportMapFromCache ? "loaded from cache" : "built", _reportMapSetupMicros);
+
+    parseReportMap(hidReportDescriptor, hidReportDescriptorSize);
+
+    // Log the final descriptor for debugging if needed (use VERBOSE level)
+    // ESP_LOG_BUFFER_HEXDUMP(LOG_TAG, hidReportDescriptor, hidReportDescriptorSize, ESP_LOG_VERBOSE);
+    _hid->setReportMap(hidReportDescriptor, hidReportDescriptorSize);
+    ESP_LOGI(LOG_TAG, "HID Report Map set successfully.");
+    return true;
+}
+
+bool BleCompositeHID::parseReportMap(const uint8_t* reportMap, size_t size)
+{
+    // Parse every device's part on its own so report IDs shared between devices show up as collisions
+    _reportMapInfo.reset();
+    size_t offset = 0;
+    for (uint8_t owner = 0; owner < _devices.size(); owner++) {
+        BaseCompositeDevice* device = _devices[owner];
+        if (!device || !device->getDeviceConfig())
+            continue;
+
+        size_t segmentSize = getReportMapSegmentSize(device);
+        if (segmentSize == 0 || offset + segmentSize > size)
+            continue;
+
+        auto config = device->getDeviceConfig();
+        if (_reportMapInfo.parse(reportMap + offset, segmentSize, owner) != HID_PARSE_OK) {
+            ESP_LOGE(LOG_TAG, "Report map part of device %s: %s (report ID 0x%02X, offset %zu)", config->getDeviceName(),
+                HIDDescriptorParser::getErrorName(_reportMapInfo.getError()), _reportMapInfo.getErrorReportId(), _reportMapInfo.getErrorOffset());
+        }
+        offset += segmentSize;
+
+        // Devices size their report buffers from the map rather than from hand maintained sizes. The report
+        // builders still write what the configuration expects, so the buffer never gets smaller than that.
+        uint16_t inputSize = _reportMapInfo.getReportSize(config->getReportId(), HID_REPORT_TYPE_INPUT);
+        if (inputSize > 0 && inputSize != config->getDeviceReportSize()) {
+            ESP_LOGW(LOG_TAG, "Device %s input report is %u bytes, the configuration expects %u", config->getDeviceName(),
+                inputSize, config->getDeviceReportSize());
+            if (inputSize < config->getDeviceReportSize())
+                inputSize = config->getDeviceReportSize();
+        }
+        device->_inputReportSize = inputSize;
+    }
+
+    for (uint8_t i = 0; i < _reportMapInfo.getReportCount(); i++) {
+        const HIDReportInfo* report = _reportMapInfo.getReport(i);
+        ESP_LOGD(LOG_TAG, "Report 0x%02X: input %u, output %u, feature %u bytes", report->reportId,
+            report->getSize(HID_REPORT_TYPE_INPUT), report->getSize(HID_REPORT_TYPE_OUTPUT), report->getSize(HID_REPORT_TYPE_FEATURE));
+    }
+
+    return _reportMapInfo.getError() == HID_PARSE_OK;
+}
+
+uint32_t BleCompositeHID::getReportMapHash() const
+{
+    // Configuration hashes only cover settings, the format version covers the code generating the descriptors
+    uint32_t hash = 2166136261u;
+    uint32_t version = REPORT_MAP_FORMAT_VERSION;
+    for (uint8_t i = 0; i < sizeof(version); i++) {
+        hash = (hash ^ (uint8_t)(version >> (i * 8))) * 16777619u;
+    }
+
+    for (auto device : _devices) {
+        if (!device)
+            continue;
+
+        auto config = device->getDeviceConfig();
+        uint32_t deviceHash = config ? config->getConfigHash() : 0;
+        if (deviceHash == 0)
+            return 0; // At least one device can't be cached
+
+        for (uint8_t i = 0; i < sizeof(deviceHash); i++) {
+            hash = (hash ^ (uint8_t)(deviceHash >> (i * 8))) * 16777619u;
+        }
+    }
+
+    // 0 is reserved for uncacheable
+    return hash != 0 ? hash : 1;
+}
+
+size_t BleCompositeHID::getCachedReportMapSize(uint32_t hash)
+{
+    KeyValueStore* store = _configuration.getReportMapStore();
+    if (!store || hash == 0)
+        return 0;
+
+    // Config hash followed by the size of the cached map, both little endian
+    uint8_t header[6];
+    if (store->read(REPORT_MAP_CACHE_HASH_KEY, header, sizeof(header)) != sizeof(header))
+        return 0;
+
+    if ((header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24)) != hash) {
+        ESP_LOGI(LOG_TAG, "Cached report map is stale, rebuilding.");
+        return 0;
+    }
+
+    return header[4] | (header[5] << 8);
+}
+
+bool BleCompositeHID::loadCachedReportMap(uint8_t* buffer, size_t size)
+{
+    KeyValueStore* store = _configuration.getReportMapStore();
+    if (!store)
+        return false;
+
+    // Read straight into the caller's buffer, the server task has little stack to spare
+    return store->read(REPORT_MAP_CACHE_KEY, buffer, size) == size;
+}
+
+void BleCompositeHID::saveCachedReportMap(uint32_t hash, const uint8_t* reportMap, size_t size)
+{
+    KeyValueStore* store = _configuration.getReportMapStore();
+    if (!store || hash == 0 || size == 0)
+        return;
+
+    uint8_t header[6] = {
+        (uint8_t)(hash & 0xFF),
+        (uint8_t)((hash >> 8) & 0xFF),
+        (uint8_t)((hash >> 16) & 0xFF),
+        (uint8_t)((hash >> 24) & 0xFF),
+        (uint8_t)(size & 0xFF),
+        (uint8_t)((size >> 8) & 0xFF)
+    };
+
+    // The header is removed first and written last so an interrupted write never pairs it with a partial map
+    store->erase(REPORT_MAP_CACHE_HASH_KEY);
+    if (!store->write(REPORT_MAP_CACHE_KEY, reportMap, size) || !store->write(REPORT_MAP_CACHE_HASH_KEY, header, sizeof(header))) {
+        ESP_LOGW(LOG_TAG, "Failed to cache the report map.");
+    }
+}
+
+uint32_t BleCompositeHID::getReportMapSetupMicros() const
+{
+    return _reportMapSetupMicros;
+}
+
+bool BleCompositeHID::getReportMapFromCache() const
+{
+    return _reportMapFromCache;
+}
+
+const HIDDescriptorParser& BleCompositeHID::getReportMapInfo() const
+{
+    return _reportMapInfo;
+}
+
 void BleCompositeHID::addDevice(BaseCompositeDevice *device)
 {
-    if(device) { // Basic null check
-        device->_parent = this;
-        _devices.push_back(device);
-    } else {
+    if(!device) { // Basic null check
         ESP_LOGW(LOG_TAG, "Attempted to add a NULL device.");
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_devicesMutex);
+    device->_parent = this;
+    if (device->_telemetrySlot == TELEMETRY_SLOT_NONE) {
+        auto config = device->getDeviceConfig();
+        device->_telemetrySlot = _telemetry.registerDevice(config ? config->getDeviceName() : nullptr);
+    }
+
+    if (!_servicesStarted) {
+        // taskServer sets the device up along with the rest
+        _devices.push_back(device);
+        return;
+    }
+
+    // Hot-plug, the characteristics may be ones NimBLE kept from an earlier removal so add them back explicitly
+    device->init(_hid);
+    NimBLECharacteristic* characteristics[MAX_DEVICE_CHARACTERISTICS];
+    uint8_t count = device->getCharacteristics(characteristics, MAX_DEVICE_CHARACTERISTICS);
+    for (uint8_t i = 0; i < count; i++) {
+        _hid->getHidService()->addCharacteristic(characteristics[i]);
+    }
+
+    // The new part goes on the end of the current map
+    auto config = device->getDeviceConfig();
+    size_t reportSize = config ? config->getDeviceReportDescriptorSize() : 0;
+    if (reportSize == 0 || reportSize == (size_t)-1 ||
+        !replaceReportMapSegment(_hid->getReportMap()->getLength(), 0, device, reportSize)) {
+        ESP_LOGE(LOG_TAG, "Could not add device %s to the report map.", config ? config->getDeviceName() : "(null)");
+
+        // Leave the service as it was, the device can be added again later
+        for (uint8_t i = 0; i < count; i++) {
+            _hid->getHidService()->removeCharacteristic(characteristics[i], false);
+        }
+        _telemetry.unregisterDevice(device->_telemetrySlot);
+        device->_telemetrySlot = TELEMETRY_SLOT_NONE;
+        device->_parent = nullptr;
+        return;
+    }
+
+    _devices.push_back(device);
+    NimBLEAttValue reportMap = _hid->getReportMap()->getValue();
+    parseReportMap(reportMap.data(), reportMap.size());
+    ESP_LOGI(LOG_TAG, "Added device %s, call applyDeviceChanges() to update connected hosts.", config->getDeviceName());
+}
+
+void BleCompositeHID::removeDevice(BaseCompositeDevice *device)
+{
+    std::lock_guard<std::recursive_mutex> lock(_devicesMutex);
+
+    size_t offset = 0;
+    for (auto it = _devices.begin(); it != _devices.end(); ++it) {
+        if (*it != device) {
+            if (_servicesStarted && *it)
+                offset += getReportMapSegmentSize(*it);
+            continue;
+        }
+
+        if (_servicesStarted) {
+            // Cut this device's part out of the map and hide its characteristics, NimBLE keeps them
+            // alive so the device can still be destroyed or added again later
+            if (!replaceReportMapSegment(offset, getReportMapSegmentSize(device), nullptr, 0)) {
+                ESP_LOGE(LOG_TAG, "Could not remove device from the report map.");
+                return;
+            }
+
+            NimBLECharacteristic* characteristics[MAX_DEVICE_CHARACTERISTICS];
+            uint8_t count = device->getCharacteristics(characteristics, MAX_DEVICE_CHARACTERISTICS);
+            for (uint8_t i = 0; i < count; i++) {
+                _hid->getHidService()->removeCharacteristic(characteristics[i], false);
+            }
+        }
+
+        // Queued reports call into the device, none may be left once the caller destroys it
+        size_t purged = _deferredReports.RemoveIf([device](DeferredReport& report) { return report.device == device; });
+        for (size_t i = 0; i < purged; i++) {
+            _telemetry.onReportDequeued();
+        }
+
+        _devices.erase(it);
+        device->_reportMapSize = 0;
+        device->_inputReportSize = 0;
+        _telemetry.unregisterDevice(device->_telemetrySlot);
+        device->_telemetrySlot = TELEMETRY_SLOT_NONE;
+
+        if (_servicesStarted) {
+            NimBLEAttValue reportMap = _hid->getReportMap()->getValue();
+            parseReportMap(reportMap.data(), reportMap.size());
+        }
+        return;
     }
+
+    ESP_LOGW(LOG_TAG, "Attempted to remove a device that was never added.");
+}
+
+void BleCompositeHID::applyDeviceChanges()
+{
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    if (!pServer || !_servicesStarted)
+        return;
+
+    uint16_t connHandles[CONFIG_BT_NIMBLE_MAX_CONNECTIONS];
+    uint8_t count = _connectionStatus.getConnHandles(connHandles, CONFIG_BT_NIMBLE_MAX_CONNECTIONS);
+    if (count == 0) {
+        // Nobody to wait for, apply the GATT changes straight away
+        pServer->start();
+        return;
+    }
+
+    ESP_LOGI(LOG_TAG, "Disconnecting %u host(s) to apply device changes.", count);
+    for (uint8_t i = 0; i < count; i++) {
+        pServer->disconnect(connHandles[i]);
+    }
+}
+
+uint16_t BleCompositeHID::getReportMapSegmentSize(BaseCompositeDevice* device)
+{
+    // Maps loaded from the cache were never built, so the sizes are measured the first time they are needed
+    if (device->_reportMapSize == 0) {
+        auto config = device->getDeviceConfig();
+        size_t reportSize = config ? config->getDeviceReportDescriptorSize() : 0;
+        device->_reportMapSize = reportSize != (size_t)-1 ? reportSize : 0;
+    }
+    return device->_reportMapSize;
+}
+
+bool BleCompositeHID::replaceReportMapSegment(size_t offset, size_t removeSize, BaseCompositeDevice* insertDevice, size_t insertSize)
+{
+    NimBLEAttValue current = _hid->getReportMap()->getValue();
+    if (offset + removeSize > current.size())
+        return false;
+
+    size_t newSize = current.size() - removeSize + insertSize;
+    if (newSize == 0 || newSize > HID_REPORT_MAP_MAX_SIZE)
+        return false;
+
+    // Everything around the changed part is copied from the current map rather than rebuilt
+    std::vector<uint8_t> reportMap(newSize);
+    memcpy(reportMap.data(), current.data(), offset);
+    if (insertDevice) {
+        if (insertDevice->getDeviceConfig()->makeDeviceReport(reportMap.data() + offset, insertSize) != insertSize)
+            return false;
+        insertDevice->_reportMapSize = insertSize;
+    }
+    memcpy(reportMap.data() + offset + insertSize, current.data() + offset + removeSize, current.size() - offset - removeSize);
+
+    _hid->setReportMap(reportMap.data(), newSize);
+    return true;
 }
 
 bool BleCompositeHID::isConnected()
 {
-    // Delegate to connection status helper, ensure it's not null
-    return (this->_connectionStatus != nullptr && this->_connectionStatus->isConnected());
+    // Delegate to connection status helper
+    return this->_connectionStatus.isConnected();
+}
+
+uint8_t BleCompositeHID::getConnectedCount()
+{
+    return this->_connectionStatus.getConnectedCount();
+}
+
+bool BleCompositeHID::getHost(uint8_t index, HostConnection& host)
+{
+    return this->_connectionStatus.getHost(index, host);
+}
+
+uint16_t BleCompositeHID::getMaxReportPayload(BaseCompositeDevice* device)
+{
+    // A notification spends 3 bytes of the MTU on its opcode and attribute handle
+    return this->_connectionStatus.getMinMTU(device ? getHostMask(device) : 0xFFFFFFFF) - 3;
+}
+
+void BleCompositeHID::setActiveHost(uint8_t index)
+{
+    _activeHost = index;
+}
+
+uint8_t BleCompositeHID::getActiveHost() const
+{
+    return _activeHost;
 }
 
 void BleCompositeHID::setBatteryLevel(uint8_t level)
@@ -184,18 +1080,119 @@ void BleCompositeHID::setBatteryLevel(uint8_t level)
     }
 }
 
-void BleCompositeHID::queueDeviceDeferredReport(std::function<void()> && reportFunc)
+void BleCompositeHID::queueDeviceDeferredReport(DeferredReportFunction && reportFunc, BaseCompositeDevice* device)
+{
+    uint8_t telemetrySlot = device ? device->_telemetrySlot : TELEMETRY_SLOT_NONE;
+    if (!isConnected()) {
+        // Queuing it would only hold on to a send of whatever the state is by the time a host is back
+        onReportWithoutHost(device, telemetrySlot, millis());
+        return;
+    }
+
+    DeferredReport report;
+    report.send = std::move(reportFunc);
+    report.device = device;
+    report.queuedAt = millis();
+    report.telemetrySlot = telemetrySlot;
+    report.queuedAtMicros = micros();
+    _telemetry.onReportQueued();
+#if defined(COMPOSITE_HID_STATIC_ALLOCATION)
+    // The queue can't grow, a report that doesn't fit is lost like one that expired
+    if (!this->_deferredReports.Produce(std::move(report))) {
+        _telemetry.onReportDequeued();
+        dropDeferredReport(report);
+    }
+#else
+    this->_deferredReports.Produce(std::move(report)); // Use std::move
+#endif
+}
+
+void BleCompositeHID::sendDeferredReport(DeferredReport& report)
+{
+    // Held while the report is built so removeDevice can't take its device away halfway through.
+    // A report consumed just before removeDevice purged the queue finds its device gone here.
+    std::lock_guard<std::recursive_mutex> lock(_devicesMutex);
+    if (report.device && std::find(_devices.begin(), _devices.end(), report.device) == _devices.end())
+        return;
+    // The autoSend task waited for the window before it took the report, sendDeferredReports checks it
+    NotifyWithoutWaiting noWait(_notifyWithoutWaitTask);
+
+    _telemetry.addQueueLatency(micros() - report.queuedAtMicros);
+    report.send();
+}
+
+void BleCompositeHID::dropDeferredReport(const DeferredReport& report)
+{
+    _telemetry.add(report.telemetrySlot, TELEMETRY_REPORTS_DROPPED);
+}
+
+void BleCompositeHID::onReportWithoutHost(BaseCompositeDevice* device, uint8_t telemetrySlot, uint32_t madeAtMs)
+{
+    _telemetry.add(telemetrySlot, TELEMETRY_REPORTS_DROPPED);
+
+    // The newest report decides whether the state is still worth restoring on reconnect
+    if (device && _configuration.getDisconnectedReportPolicy() == DISCONNECTED_REPORTS_KEEP) {
+        device->_stateKeptMs = madeAtMs;
+        device->_stateKept = true;
+    }
+}
+
+TelemetrySnapshot BleCompositeHID::getTelemetry(bool reset)
+{
+    return _telemetry.getSnapshot(millis(), reset);
+}
+
+uint8_t BleCompositeHID::getNotifyInFlight(uint8_t hostIndex)
+{
+    return _connectionStatus.getNotifyInFlight(hostIndex);
+}
+
+void BleCompositeHID::waitForNotifyWindow(uint32_t hostMask)
+{
+    uint8_t window = _configuration.getNotifyWindow();
+    if (window == 0)
+        return;
+
+    uint32_t wait;
+    while (isConnected() && (wait = _connectionStatus.getNotifyWait(hostMask, window)) > 0) {
+        TickType_t ticks = pdMS_TO_TICKS((wait + 999) / 1000);
+        vTaskDelay(ticks > 0 ? ticks : 1);
+    }
+}
+
+void BleCompositeHID::waitToNotify(BaseCompositeDevice* device)
 {
-    this->_deferredReports.Produce(std::move(reportFunc)); // Use std::move
+    // Direct sends, split reports and replays are held to the window like the queued ones,
+    // a full window only delays them until the next connection event
+    if (_notifyWithoutWaitTask.load() != xTaskGetCurrentTaskHandle())
+        waitForNotifyWindow(getHostMask(device));
+}
+
+PowerManager& BleCompositeHID::getPowerManager()
+{
+    return _powerManager;
 }
 
 void BleCompositeHID::sendDeferredReports()
 {
-    if (this->_hid && this->isConnected()) // Check HID and connection status
+    if (!this->_hid)
+        return;
+
+    DeferredReport report;
+    if (this->isConnected())
+    {
+        uint8_t window = _configuration.getNotifyWindow();
+        while((window == 0 || _connectionStatus.getNotifyWait(0xFFFFFFFF, window) == 0) && this->_deferredReports.Consume(report)){ // Non-blocking consume
+            _telemetry.onReportDequeued();
+            sendDeferredReport(report);
+        }
+    }
+    else
     {
-        std::function<void()> reportFunc;
-        while(this->_deferredReports.Consume(reportFunc)){ // Non-blocking consume
-            reportFunc();
+        // Reports queued before the host left, don't let them wait for the next one
+        while(this->_deferredReports.Consume(report)){
+            _telemetry.onReportDequeued();
+            onReportWithoutHost(report.device, report.telemetrySlot, report.queuedAt);
         }
     }
 }
@@ -213,6 +1210,19 @@ void BleCompositeHID::taskServer(void *pvParameter)
     ESP_LOGI(LOG_TAG, "Initializing NimBLE device: %s", BleCompositeHIDInstance->deviceName.c_str());
     NimBLEDevice::init(BleCompositeHIDInstance->deviceName); // Initialize NimBLE with the device name (for internal use by NimBLE)
 
+    if (BleCompositeHIDInstance->_configuration.getPreferredMTU() > 0) {
+        NimBLEDevice::setMTU(BleCompositeHIDInstance->_configuration.getPreferredMTU());
+    }
+    if (BleCompositeHIDInstance->_configuration.getPreferredPhy() != 0) {
+        NimBLEDevice::setDefaultPhy(BleCompositeHIDInstance->_configuration.getPreferredPhy(), BleCompositeHIDInstance->_configuration.getPreferredPhy());
+    }
+
+    // The controller is up, light sleep can now be configured around it
+    const BLEHostConfiguration& config = BleCompositeHIDInstance->_configuration;
+    BleCompositeHIDInstance->_powerManager.begin(config.getPowerIdleTimeout(), config.getAutomaticLightSleep(),
+        config.getMaxCpuFrequency() > 0 ? config.getMaxCpuFrequency() : getCpuFrequencyMhz(),
+        config.getMinCpuFrequency() > 0 ? config.getMinCpuFrequency() : getXtalFrequencyMhz());
+
     ESP_LOGI(LOG_TAG, "Creating NimBLE server...");
     NimBLEServer *pServer = NimBLEDevice::createServer();
     if (!pServer) {
@@ -220,11 +1230,15 @@ void BleCompositeHID::taskServer(void *pvParameter)
         vTaskDelete(NULL);
         return;
     }
-    pServer->setCallbacks(BleCompositeHIDInstance->_connectionStatus);
-    pServer->advertiseOnDisconnect(true); // start advertising again after disconnecting
+    pServer->setCallbacks(&BleCompositeHIDInstance->_connectionStatus, false); // a member, not for the server to delete
+    pServer->advertiseOnDisconnect(false); // the advertising schedule is restarted from onHostDisconnected instead
 
     ESP_LOGI(LOG_TAG, "Creating NimBLE HID device...");
+#if defined(COMPOSITE_HID_STATIC_ALLOCATION)
+    BleCompositeHIDInstance->_hid = new (BleCompositeHIDInstance->_hidStorage) NimBLEHIDDevice(pServer);
+#else
     BleCompositeHIDInstance->_hid = new NimBLEHIDDevice(pServer);
+#endif
     if (!BleCompositeHIDInstance->_hid) {
         ESP_LOGE(LOG_TAG, "Failed to create NimBLEHIDDevice!");
         // Clean up server? NimBLEDevice::deinit?
@@ -232,80 +1246,34 @@ void BleCompositeHID::taskServer(void *pvParameter)
         return;
     }
 
-    // Setup the HID descriptor buffers
-    size_t totalBufferSize = 2048; // Should be enough for most composite devices
-    uint8_t tempHidReportDescriptor[totalBufferSize];
-    int hidReportDescriptorSize = 0;
-    ESP_LOGI(LOG_TAG, "Initializing child devices and building HID descriptor...");
+    ESP_LOGI(LOG_TAG, "Initializing child devices...");
+    std::unique_lock<std::recursive_mutex> devicesLock(BleCompositeHIDInstance->_devicesMutex);
 
-    // Setup child devices to build the HID report descriptor
+    // Child devices always create their characteristics, only the descriptor can come from the cache
     for(auto device : BleCompositeHIDInstance->_devices){
         if (!device) {
             ESP_LOGW(LOG_TAG, "Skipping NULL device pointer in _devices vector.");
             continue;
         }
-        const char* currentDeviceName = "Unknown"; // Default name
-        auto config = device->getDeviceConfig();
-        if (config) {
-            currentDeviceName = config->getDeviceName();
-        }
-
-        ESP_LOGD(LOG_TAG, "Before device %s init", currentDeviceName);
         device->init(BleCompositeHIDInstance->_hid); // Pass HID device pointer to child
-        ESP_LOGD(LOG_TAG, "After device %s init", currentDeviceName);
-
-        if (!config) {
-            ESP_LOGE(LOG_TAG, "Device %p has NULL configuration, skipping.", (void*)device);
-            continue;
-        }
-
-        // Use a temporary buffer for each device's report descriptor part
-        uint8_t deviceReportBuffer[BLE_ATT_ATTR_MAX_LEN]; // Max size for one part
-        size_t reportSize = config->makeDeviceReport(deviceReportBuffer, sizeof(deviceReportBuffer));
-
-        // Validate the returned size
-        if(reportSize == 0 || reportSize == (size_t)-1){ // Check for 0 or error (-1 cast to size_t)
-             ESP_LOGE(LOG_TAG, "Error creating or empty report descriptor for device %s (size: %zu)", currentDeviceName, reportSize); // Use %zu for size_t
-             continue; // Skip this device if its descriptor is invalid
-        } else if (reportSize > sizeof(deviceReportBuffer)) {
-             // This case should technically not happen if makeDeviceReport respects bufferSize
-             ESP_LOGE(LOG_TAG, "Device %s report size %zu exceeds temporary buffer %zu", currentDeviceName, reportSize, sizeof(deviceReportBuffer)); // Use %zu
-             continue;
-        } else {
-             ESP_LOGD(LOG_TAG, "Created device %s descriptor part with size %zu", currentDeviceName, reportSize); // Use %zu
-        }
-
-        // Check if adding this report part exceeds the total composite descriptor buffer
-        if (hidReportDescriptorSize + reportSize > totalBufferSize) {
-            ESP_LOGE(LOG_TAG, "Total HID descriptor size exceeds buffer limit (%zu bytes) while adding device %s. Stopping descriptor build.", totalBufferSize, currentDeviceName); // Use %zu
-            break; // Stop adding more devices
-        }
-
-        // Append the device's descriptor part to the combined descriptor
-        memcpy(tempHidReportDescriptor + hidReportDescriptorSize, deviceReportBuffer, reportSize);
-        hidReportDescriptorSize += reportSize;
     }
-    ESP_LOGI(LOG_TAG, "Final Combined HID Report Descriptor Size: %d bytes", hidReportDescriptorSize); // %d is okay for int
-
-    // Set the final combined report map (only if it's valid)
-    if (hidReportDescriptorSize > 0) {
-        // Create a correctly sized buffer for the final map
-        uint8_t finalHidReportDescriptor[hidReportDescriptorSize];
-        memcpy(finalHidReportDescriptor, tempHidReportDescriptor, hidReportDescriptorSize);
-        // Log the final descriptor for debugging if needed (use VERBOSE level)
-        // ESP_LOG_BUFFER_HEXDUMP(LOG_TAG, finalHidReportDescriptor, hidReportDescriptorSize, ESP_LOG_VERBOSE);
-        BleCompositeHIDInstance->_hid->setReportMap(finalHidReportDescriptor, hidReportDescriptorSize);
-        ESP_LOGI(LOG_TAG, "HID Report Map set successfully.");
-    } else {
+
+    if (!BleCompositeHIDInstance->setupReportMap()) {
         ESP_LOGE(LOG_TAG, "No valid HID descriptors were added. Cannot set Report Map. Aborting server setup.");
         // Clean up resources before exiting task
+#if defined(COMPOSITE_HID_STATIC_ALLOCATION)
+        BleCompositeHIDInstance->_hid->~NimBLEHIDDevice();
+#else
         delete BleCompositeHIDInstance->_hid;
+#endif
         BleCompositeHIDInstance->_hid = nullptr;
         // Optional: NimBLEDevice::deinit(true);
         vTaskDelete(NULL); // Exit task
         return;
     }
 
+    devicesLock.unlock();
+
     // Set manufacturer info
     BleCompositeHIDInstance->_hid->setManufacturer(BleCompositeHIDInstance->deviceManufacturer);
 
@@ -338,27 +1306,27 @@ void BleCompositeHID::taskServer(void *pvParameter)
         // Model Number
         BLECharacteristic* pChr = pService->getCharacteristic(CHARACTERISTIC_UUID_MODEL_NUMBER);
         if(!pChr){ pChr = pService->createCharacteristic(CHARACTERISTIC_UUID_MODEL_NUMBER, NIMBLE_PROPERTY::READ);}
-        if(pChr) pChr->setValue(modelNumber); else { ESP_LOGE(LOG_TAG, "Failed to create/get Model Number Characteristic"); }
+        if(pChr) setStringValue(pChr, BleCompositeHIDInstance->_configuration.getModelNumber()); else { ESP_LOGE(LOG_TAG, "Failed to create/get Model Number Characteristic"); }
         // Software Revision
         pChr = pService->getCharacteristic(CHARACTERISTIC_UUID_SOFTWARE_REVISION);
         if(!pChr){ pChr = pService->createCharacteristic(CHARACTERISTIC_UUID_SOFTWARE_REVISION, NIMBLE_PROPERTY::READ);}
-        if(pChr) pChr->setValue(softwareRevision); else { ESP_LOGE(LOG_TAG, "Failed to create/get Software Revision Characteristic"); }
+        if(pChr) setStringValue(pChr, BleCompositeHIDInstance->_configuration.getSoftwareRevision()); else { ESP_LOGE(LOG_TAG, "Failed to create/get Software Revision Characteristic"); }
         // Serial Number
         pChr = pService->getCharacteristic(CHARACTERISTIC_UUID_SERIAL_NUMBER);
         if(!pChr){ pChr = pService->createCharacteristic(CHARACTERISTIC_UUID_SERIAL_NUMBER, NIMBLE_PROPERTY::READ);}
-        if(pChr) pChr->setValue(serialNumber); else { ESP_LOGE(LOG_TAG, "Failed to create/get Serial Number Characteristic"); }
+        if(pChr) setStringValue(pChr, BleCompositeHIDInstance->_configuration.getSerialNumber()); else { ESP_LOGE(LOG_TAG, "Failed to create/get Serial Number Characteristic"); }
         // Firmware Revision
         pChr = pService->getCharacteristic(CHARACTERISTIC_UUID_FIRMWARE_REVISION);
         if(!pChr){ pChr = pService->createCharacteristic(CHARACTERISTIC_UUID_FIRMWARE_REVISION, NIMBLE_PROPERTY::READ);}
-        if(pChr) pChr->setValue(firmwareRevision); else { ESP_LOGE(LOG_TAG, "Failed to create/get Firmware Revision Characteristic"); }
+        if(pChr) setStringValue(pChr, BleCompositeHIDInstance->_configuration.getFirmwareRevision()); else { ESP_LOGE(LOG_TAG, "Failed to create/get Firmware Revision Characteristic"); }
         // Hardware Revision
         pChr = pService->getCharacteristic(CHARACTERISTIC_UUID_HARDWARE_REVISION);
         if(!pChr){ pChr = pService->createCharacteristic(CHARACTERISTIC_UUID_HARDWARE_REVISION, NIMBLE_PROPERTY::READ);}
-        if(pChr) pChr->setValue(hardwareRevision); else { ESP_LOGE(LOG_TAG, "Failed to create/get Hardware Revision Characteristic"); }
+        if(pChr) setStringValue(pChr, BleCompositeHIDInstance->_configuration.getHardwareRevision()); else { ESP_LOGE(LOG_TAG, "Failed to create/get Hardware Revision Characteristic"); }
         // System ID (Example - Make sure systemID string is populated if used)
         // pChr = pService->getCharacteristic(CHARACTERISTIC_UUID_SYSTEM_ID);
         // if(!pChr){ pChr = pService->createCharacteristic(CHARACTERISTIC_UUID_SYSTEM_ID, NIMBLE_PROPERTY::READ);}
-        // if(pChr) pChr->setValue(systemID); else { ESP_LOGE(LOG_TAG, "Failed to create/get System ID Characteristic"); }
+        // if(pChr) setStringValue(pChr, BleCompositeHIDInstance->_configuration.getSystemID()); else { ESP_LOGE(LOG_TAG, "Failed to create/get System ID Characteristic"); }
 
     } else {
         ESP_LOGE(LOG_TAG, "Failed to get Device Information Service even after setPnP.");
@@ -370,9 +1338,19 @@ void BleCompositeHID::taskServer(void *pvParameter)
     NimBLEDevice::setSecurityAuth(true, false, false); // Bonding enabled, No MITM, SC off (Legacy Pairing - common default)
     ESP_LOGI(LOG_TAG, "Security settings configured.");
 
+    // The diagnostics service only exists when a period is configured
+    if (BleCompositeHIDInstance->_configuration.getDiagnosticsPeriod() > 0) {
+        BleCompositeHIDInstance->_diagnostics.begin(pServer, BleCompositeHIDInstance->_configuration.getDiagnosticsPeriod());
+    }
+
     // Start BLE services (HID, Device Info, Battery)
     ESP_LOGI(LOG_TAG, "Starting BLE services...");
     BleCompositeHIDInstance->_hid->startServices();
+    {
+        // From here on devices are hot-plugged
+        std::lock_guard<std::recursive_mutex> lock(BleCompositeHIDInstance->_devicesMutex);
+        BleCompositeHIDInstance->_servicesStarted = true;
+    }
     BleCompositeHIDInstance->onStarted(pServer); // User callback
 
     // --- Configure and Start BLE advertisement ---
@@ -401,10 +1379,24 @@ void BleCompositeHID::taskServer(void *pvParameter)
     // pAdvertising->setScanResponseData(...);
     // --- MODIFICACIÓN CLAVE FIN ---
 
+    // Drop to the idle connection profile when input stops
+    if (BleCompositeHIDInstance->_configuration.getIdleTimeout() > 0) {
+        BleCompositeHIDInstance->_idleTimer = xTimerCreate("connIdle", pdMS_TO_TICKS(BleCompositeHIDInstance->_configuration.getIdleTimeout()), pdFALSE,
+            BleCompositeHIDInstance, idleTimerCallback);
+        if (BleCompositeHIDInstance->_idleTimer == NULL) {
+            ESP_LOGE(LOG_TAG, "Failed to create the connection idle timer!");
+        }
+    }
+
+    // Move through the advertising phases as each one times out
+    pAdvertising->setAdvertisingCompleteCallback([BleCompositeHIDInstance](NimBLEAdvertising*) {
+        BleCompositeHIDInstance->onAdvertisingComplete();
+    });
+
     // Start advertising
     ESP_LOGI(LOG_TAG, "Starting advertising...");
-    bool success = pAdvertising->start();
-    ESP_LOGI(LOG_TAG, "pAdvertising->start() call returned: %s", success ? "true" : "false");
+    bool success = BleCompositeHIDInstance->startAdvertising();
+    ESP_LOGI(LOG_TAG, "startAdvertising() call returned: %s", success ? "true" : "false");
     if(success) {
         ESP_LOGI(LOG_TAG, "Advertising started successfully as '%s'", BleCompositeHIDInstance->deviceName.c_str()); // Use INFO for successful start
     } else {
@@ -419,8 +1411,9 @@ void BleCompositeHID::taskServer(void *pvParameter)
     // Start timed auto send for deferred reports (if enabled in config)
     if(BleCompositeHIDInstance->_configuration.getQueuedSending()){
         ESP_LOGI(LOG_TAG, "Starting timedSendDeferredReports task...");
-        // Increased stack size slightly, adjust if needed. Priority 5 is standard.
-        xTaskCreate(BleCompositeHIDInstance->timedSendDeferredReports, "autoSend", 4096, (void *)BleCompositeHIDInstance, 5, &BleCompositeHIDInstance->_autoSendTaskHandle);
+        // Core, priority and stack come from the host configuration, by default unpinned at priority 5
+        createTask(BleCompositeHIDInstance->timedSendDeferredReports, "autoSend", config.getAutoSendTaskCore(), config.getAutoSendTaskPriority(),
+            config.getAutoSendTaskStackSize(), (void *)BleCompositeHIDInstance, &BleCompositeHIDInstance->_autoSendTaskHandle);
         if (BleCompositeHIDInstance->_autoSendTaskHandle == NULL) {
             ESP_LOGE(LOG_TAG, "Failed to create timedSendDeferredReports task!");
         }
@@ -429,6 +1422,7 @@ void BleCompositeHID::taskServer(void *pvParameter)
     }
 
     // Task setup is complete, NimBLE handles events in its own tasks.
-    ESP_LOGI(LOG_TAG, "taskServer setup finished. Task will exit.");
+    BleCompositeHIDInstance->_serverStackHighWater = uxTaskGetStackHighWaterMark(NULL);
+    ESP_LOGI(LOG_TAG, "taskServer setup finished, stack high water mark: %u bytes. Task will exit.", (unsigned)BleCompositeHIDInstance->_serverStackHighWater);
     vTaskDelete(NULL); // Allow this setup task to complete and be removed
 }
\ No newline at end of file
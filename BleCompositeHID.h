@@ -12,12 +12,49 @@
 
 #include "BLEHostConfiguration.h"
 #include "BaseCompositeDevice.h"
+#include "HIDDescriptorParser.h"
+#include "Telemetry.h"
+#include "DiagnosticsService.h"
+#include "PowerManager.h"
+#include "ReportRecorder.h"
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include "SafeQueue.hpp"
+#include "StaticSafeQueue.hpp"
+#include "freertos/timers.h"
+
+// Which part of the advertising schedule is running
+#define ADVERTISING_PHASE_NONE 0x00         // Not advertising, or a host is connected
+#define ADVERTISING_PHASE_RECONNECT 0x01    // Directed or accept list advertising to the last bonded host
+#define ADVERTISING_PHASE_FAST 0x02
+#define ADVERTISING_PHASE_SLOW 0x03
+
+// millis() timestamps for one connection cycle, 0 until that step has happened.
+// The first cycle starts at boot, later ones start when the previous host disconnects.
+struct ConnectionTimings {
+    uint32_t cycleStartMs = 0;
+    uint32_t advertisingStartMs = 0;
+    uint32_t connectedMs = 0;
+    uint32_t authenticatedMs = 0;
+    uint32_t firstReportMs = 0;
+    uint8_t connectedPhase = ADVERTISING_PHASE_NONE;  // Advertising phase the host connected during
+};
+
+struct DeferredReport {
+    DeferredReportFunction send;
+    BaseCompositeDevice* device = nullptr;  // Device that queued the report, null for reports queued from outside
+    uint32_t queuedAt = 0;      // millis() when the report was queued
+    uint8_t telemetrySlot = TELEMETRY_SLOT_NONE;
+    uint32_t queuedAtMicros = 0;
+};
 
 class BleCompositeHID
 {
+    friend class BleConnectionStatus;
+    friend class BaseCompositeDevice;
+    friend class DiagnosticsService;
 public:
     BleCompositeHID(std::string deviceName = "ESP32 BLE Composite HID", std::string deviceManufacturer = "Espressif", uint8_t batteryLevel = 100);
     ~BleCompositeHID();
@@ -25,13 +62,74 @@ public:
     void begin(const BLEHostConfiguration& config);
     void end();
 
+    // Devices can be added and removed after begin(). Only the changed device's part of the report map is
+    // rebuilt and its characteristics are added to or removed from the HID service.
     void addDevice(BaseCompositeDevice* device);
+    // Also discards the device's queued reports and waits for one being sent to finish. The device may be
+    // destroyed once this returns, as long as the application no longer calls it from other tasks.
+    void removeDevice(BaseCompositeDevice* device);
+    // Hands runtime device changes to connected hosts. NimBLE can only change the GATT table with no host
+    // connected, so hosts are disconnected. The table is then rebuilt and bonded hosts are sent Service Changed
+    // when they reconnect, which the reconnect advertising schedule speeds up.
+    void applyDeviceChanges();
     bool isConnected();
 
-    void queueDeviceDeferredReport(std::function<void()> && reportFunc);
+    // Hosts connected at the same time, see BLEHostConfiguration::setMaxConnections
+    uint8_t getConnectedCount();
+    bool getHost(uint8_t index, HostConnection& host);
+
+    // Largest report that fits into one notification to every host device reports to (every host if null)
+    uint16_t getMaxReportPayload(BaseCompositeDevice* device = nullptr);
+
+    // Host that receives every report with REPORT_ROUTING_ACTIVE_HOST
+    void setActiveHost(uint8_t index);
+    uint8_t getActiveHost() const;
+
+    // Queues a report for sendDeferredReports or the autoSend task. device is the device the report belongs to, if any.
+    void queueDeviceDeferredReport(DeferredReportFunction && reportFunc, BaseCompositeDevice* device = nullptr);
+    // Sends the queued reports. With a notify window it stops once a host has no room left, the rest stay queued.
     void sendDeferredReports();
 
+    // Notifications to the host that haven't had their connection event yet, see BLEHostConfiguration::setNotifyWindow
+    uint8_t getNotifyInFlight(uint8_t hostIndex = 0);
+
     void setBatteryLevel(uint8_t level);
+
+    // Boot time instrumentation for the report map
+    uint32_t getReportMapSetupMicros() const;
+    bool getReportMapFromCache() const;
+    // Report sizes and errors found in the current report map, one owner per device in the order they were added
+    const HIDDescriptorParser& getReportMapInfo() const;
+
+    // Connection time tracing, from boot (or the last disconnect) to the first report sent
+    ConnectionTimings getConnectionTimings() const;
+    uint8_t getAdvertisingPhase() const;
+
+    // Parameters the host actually applied, min and max interval both hold the current interval
+    ConnectionParameters getNegotiatedConnectionParameters(uint8_t hostIndex = 0) const;
+    // Whether the idle connection profile is currently requested
+    bool isConnectionIdle() const;
+
+    // Counters since begin() or the last reset. Resetting while taking the snapshot loses no updates.
+    TelemetrySnapshot getTelemetry(bool reset = false);
+
+    // Idle tracking and light sleep, set up from the power settings of the host configuration.
+    // Reports count as input activity on their own, call onActivity for input that doesn't send one.
+    PowerManager& getPowerManager();
+
+    // Records every report sent from now on, null stops. The recorder has to be started and stays owned by the caller.
+    void setReportRecorder(ReportRecorder* recorder);
+    ReportRecorder* getReportRecorder() const;
+    // Sends a recorded report the way its device's own report would go out, see ReportReplayer. The device's
+    // input state is left alone, so it sends its real state again when a host reconnects. False if the device
+    // at deviceIndex doesn't exist or has no input report with reportId.
+    bool replayReport(uint8_t deviceIndex, uint8_t reportId, const uint8_t* data, size_t length);
+
+    // Creates a library task pinned to core, or unpinned with TASK_CORE_ANY or a core the chip doesn't have.
+    // Devices use it for their own tasks so every task the library runs can be placed the same way.
+    static BaseType_t createTask(TaskFunction_t function, const char* name, uint8_t core, uint8_t priority,
+        uint32_t stackSize, void* parameter, TaskHandle_t* handle);
+
     uint8_t batteryLevel;
     std::string deviceManufacturer;
     std::string deviceName;
@@ -42,14 +140,85 @@ protected:
 private:
     static void taskServer(void *pvParameter);
     static void timedSendDeferredReports(void *pvParameter);
+    void onHostConnected(uint8_t hostIndex, NimBLEConnInfo& connInfo);
+    void onHostDisconnected(uint8_t hostIndex, int reason);
+    void onConnectionParametersUpdated(NimBLEConnInfo& connInfo);
+    void onHostAuthenticated(uint8_t hostIndex);
+    void notifyReport(BaseCompositeDevice* device, NimBLECharacteristic* characteristic);
+    bool isReportSubscribed(BaseCompositeDevice* device, NimBLECharacteristic* characteristic);
+    void onInputSubscribed(NimBLECharacteristic* characteristic);
+    void onNotifyStatus(int code);
+    void sendDeferredReport(DeferredReport& report);
+    void dropDeferredReport(const DeferredReport& report);
+    void onReportWithoutHost(BaseCompositeDevice* device, uint8_t telemetrySlot, uint32_t madeAtMs);
+    // Sends the state of a device that gave up on a report while disconnected, see DISCONNECTED_REPORTS_KEEP
+    void restoreKeptState(BaseCompositeDevice* device);
+    // Blocks until every connected host in hostMask has room in the notify window
+    void waitForNotifyWindow(uint32_t hostMask = 0xFFFFFFFF);
+    // Holds an explicit send to the notify window, returns at once in the task marked by NotifyWithoutWaiting
+    void waitToNotify(BaseCompositeDevice* device);
+    uint32_t getHostMask(BaseCompositeDevice* device) const;
+    void recordReport(BaseCompositeDevice* device, NimBLECharacteristic* characteristic);
+
+    uint16_t getReportMapSegmentSize(BaseCompositeDevice* device);
+    bool replaceReportMapSegment(size_t offset, size_t removeSize, BaseCompositeDevice* insertDevice, size_t insertSize);
+    void onReportNotified();
+
+    bool setupReportMap();
+    size_t measureReportMap() const;
+    size_t buildReportMap(uint8_t* buffer, size_t bufferSize);
+    uint32_t getReportMapHash() const;
+    size_t getCachedReportMapSize(uint32_t hash);
+    bool loadCachedReportMap(uint8_t* buffer, size_t size);
+    void saveCachedReportMap(uint32_t hash, const uint8_t* reportMap, size_t size);
+    bool parseReportMap(const uint8_t* reportMap, size_t size);
+
+    bool startAdvertising();
+    bool startAdvertisingPhase(uint8_t phase);
+    void onAdvertisingComplete();
+    bool getReconnectAddress(NimBLEAddress& address) const;
+
+    void requestConnectionProfile(uint8_t profile);
+    static void idleTimerCallback(TimerHandle_t timer);
+    void onIdleTimer();
 
     BLEHostConfiguration _configuration;
-    BleConnectionStatus* _connectionStatus;
+    BleConnectionStatus _connectionStatus;
     NimBLEHIDDevice* _hid;
+#if defined(COMPOSITE_HID_STATIC_ALLOCATION)
+    // _hid is constructed in here rather than on the heap
+    alignas(NimBLEHIDDevice) uint8_t _hidStorage[sizeof(NimBLEHIDDevice)];
+#endif
 
     std::vector<BaseCompositeDevice*> _devices;
-    SafeQueue<std::function<void()>> _deferredReports;
+    std::recursive_mutex _devicesMutex;
+    bool _servicesStarted;
+#if defined(COMPOSITE_HID_STATIC_ALLOCATION)
+    StaticSafeQueue<DeferredReport, COMPOSITE_HID_DEFERRED_QUEUE_SIZE> _deferredReports;
+#else
+    SafeQueue<DeferredReport> _deferredReports;
+#endif
     TaskHandle_t _autoSendTaskHandle;
+
+    uint32_t _reportMapSetupMicros;
+    bool _reportMapFromCache;
+    HIDDescriptorParser _reportMapInfo;
+    Telemetry _telemetry;
+    DiagnosticsService _diagnostics;
+    PowerManager _powerManager;
+    uint32_t _serverStackHighWater;
+
+    volatile uint8_t _advertisingPhase;
+    NimBLEAddress _reconnectAddress;
+    bool _reconnectAddressOnAcceptList;
+    ConnectionTimings _connectionTimings;
+
+    volatile uint8_t _activeHost;
+    TimerHandle_t _idleTimer;
+    volatile bool _connectionIdle;
+    volatile uint32_t _lastReportMs;
+    std::atomic<ReportRecorder*> _recorder;
+    std::atomic<TaskHandle_t> _notifyWithoutWaitTask; // Sending from a NimBLE callback or with _devicesMutex held
 };
 
 #endif // CONFIG_BT_NIMBLE_ROLE_PERIPHERAL
@@ -1,24 +1,429 @@
 #include "BleConnectionStatus.h"
+#include "BleCompositeHID.h"
 
-BleConnectionStatus::BleConnectionStatus(void)
+#if defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define LOG_TAG "BleConnectionStatus"
+#else
+#include "esp_log.h"
+static const char *LOG_TAG = "BleConnectionStatus";
+#endif
+
+BleConnectionStatus::BleConnectionStatus(BleCompositeHID* parent) :
+    _parent(parent),
+    _hosts(1)
 {
 }
 
 void BleConnectionStatus::onConnect(NimBLEServer *pServer, NimBLEConnInfo& connInfo)
 {
-    pServer->updateConnParams(connInfo.getConnHandle(), 6, 7, 0, 600);
+    uint8_t hostIndex = HOST_INDEX_NONE;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Take the lowest free index
+        for (uint8_t i = 0; i < _hosts.size(); i++)
+        {
+            if (_hosts[i].connHandle == BLE_HS_CONN_HANDLE_NONE)
+            {
+                _hosts[i] = HostConnection();
+                _hosts[i].connHandle = connInfo.getConnHandle();
+                _hosts[i].address = connInfo.getIdAddress();
+                _hosts[i].parameters = { connInfo.getConnInterval(), connInfo.getConnInterval(), connInfo.getConnLatency(), connInfo.getConnTimeout() };
+                _hosts[i].mtu = connInfo.getMTU();
+                hostIndex = i;
+                break;
+            }
+        }
+    }
+
+    if (hostIndex == HOST_INDEX_NONE)
+    {
+        // More centrals than configured, NimBLE allows up to CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+        pServer->disconnect(connInfo.getConnHandle());
+        return;
+    }
+
+    if (_parent)
+    {
+        // The parent requests the parameters of the configured connection profile
+        _parent->onHostConnected(hostIndex, connInfo);
+    }
+    else
+    {
+        pServer->updateConnParams(connInfo.getConnHandle(), 6, 7, 0, 600);
+    }
 }
 
 void BleConnectionStatus::onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason)
 {
-    this->connected = false;
+    uint8_t hostIndex = HOST_INDEX_NONE;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        HostConnection* host = findHost(connInfo.getConnHandle());
+        if (!host)
+            return;
+
+        hostIndex = host - _hosts.data();
+        *host = HostConnection();
+    }
+
+    if (_parent)
+    {
+        _parent->onHostDisconnected(hostIndex, reason);
+    }
 }
 
 bool BleConnectionStatus::isConnected(){
-    return this->connected;
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto& host : _hosts)
+    {
+        if (host.authenticated)
+            return true;
+    }
+    return false;
 }
 
 void BleConnectionStatus::onAuthenticationComplete(NimBLEConnInfo& connInfo)
 {
-    this->connected = true;
+    uint8_t hostIndex = HOST_INDEX_NONE;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        HostConnection* host = findHost(connInfo.getConnHandle());
+        if (!host)
+            return;
+
+        host->authenticated = true;
+        hostIndex = host - _hosts.data();
+    }
+
+    if (_parent)
+    {
+        _parent->onHostAuthenticated(hostIndex);
+    }
+}
+
+void BleConnectionStatus::onConnParamsUpdate(NimBLEConnInfo& connInfo)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        HostConnection* host = findHost(connInfo.getConnHandle());
+        if (!host)
+            return;
+
+        host->parameters = { connInfo.getConnInterval(), connInfo.getConnInterval(), connInfo.getConnLatency(), connInfo.getConnTimeout() };
+    }
+
+    if (_parent)
+    {
+        _parent->onConnectionParametersUpdated(connInfo);
+    }
+}
+
+void BleConnectionStatus::onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo)
+{
+    uint8_t hostIndex = HOST_INDEX_NONE;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        HostConnection* host = findHost(connInfo.getConnHandle());
+        if (!host)
+            return;
+
+        host->mtu = MTU;
+        hostIndex = host - _hosts.data();
+    }
+
+    ESP_LOGI(LOG_TAG, "Host %u MTU: %u", hostIndex, MTU);
+}
+
+void BleConnectionStatus::onPhyUpdate(NimBLEConnInfo& connInfo, uint8_t txPhy, uint8_t rxPhy)
+{
+    uint8_t hostIndex = HOST_INDEX_NONE;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        HostConnection* host = findHost(connInfo.getConnHandle());
+        if (!host)
+            return;
+
+        host->txPhy = txPhy;
+        host->rxPhy = rxPhy;
+        hostIndex = host - _hosts.data();
+    }
+
+    ESP_LOGI(LOG_TAG, "Host %u PHY: tx %u, rx %u", hostIndex, txPhy, rxPhy);
+}
+
+void BleConnectionStatus::onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    HostConnection* host = findHost(connInfo.getConnHandle());
+    if (!host)
+        return;
+
+    uint16_t attrHandle = pCharacteristic->getHandle();
+    for (uint8_t i = 0; i < host->subscriptionCount; i++)
+    {
+        if (host->subscriptions[i] == attrHandle)
+        {
+            host->subscriptions[i] = host->subscriptions[--host->subscriptionCount];
+            break;
+        }
+    }
+
+    // Bit 0 is notifications, input reports don't use indications
+    bool subscribed = subValue & 0x0001;
+    if (subscribed)
+    {
+        if (host->subscriptionCount < HOST_MAX_SUBSCRIPTIONS)
+        {
+            host->subscriptions[host->subscriptionCount++] = attrHandle;
+        }
+        else
+        {
+            ESP_LOGW(LOG_TAG, "Host subscribed to more than %u input reports, ignoring 0x%04X", HOST_MAX_SUBSCRIPTIONS, attrHandle);
+            subscribed = false;
+        }
+    }
+    lock.unlock();
+
+    if (subscribed && _parent)
+    {
+        _parent->onInputSubscribed(pCharacteristic);
+    }
+}
+
+void BleConnectionStatus::onStatus(NimBLECharacteristic* pCharacteristic, int code)
+{
+    if (_parent)
+    {
+        _parent->onNotifyStatus(code);
+    }
+}
+
+void BleConnectionStatus::setMaxConnections(uint8_t count)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (count < 1)
+        count = 1;
+    if (count > CONFIG_BT_NIMBLE_MAX_CONNECTIONS)
+        count = CONFIG_BT_NIMBLE_MAX_CONNECTIONS;
+
+    _hosts.resize(count);
+}
+
+uint8_t BleConnectionStatus::getMaxConnections()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _hosts.size();
+}
+
+uint8_t BleConnectionStatus::getConnectedCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint8_t count = 0;
+    for (auto& host : _hosts)
+    {
+        if (host.connHandle != BLE_HS_CONN_HANDLE_NONE)
+            count++;
+    }
+    return count;
+}
+
+bool BleConnectionStatus::getHost(uint8_t index, HostConnection& host) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (index >= _hosts.size() || _hosts[index].connHandle == BLE_HS_CONN_HANDLE_NONE)
+        return false;
+
+    host = _hosts[index];
+    return true;
+}
+
+uint8_t BleConnectionStatus::getHostIndex(uint16_t connHandle)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    HostConnection* host = findHost(connHandle);
+    return host ? host - _hosts.data() : HOST_INDEX_NONE;
+}
+
+uint8_t BleConnectionStatus::getReportTargets(uint16_t attrHandle, uint32_t hostMask, uint16_t* connHandles, uint8_t maxCount)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _hosts.size() && count < maxCount; i++)
+    {
+        const HostConnection& host = _hosts[i];
+        if (!(hostMask & (1UL << i)) || !host.authenticated)
+            continue;
+
+        for (uint8_t j = 0; j < host.subscriptionCount; j++)
+        {
+            if (host.subscriptions[j] == attrHandle)
+            {
+                connHandles[count++] = host.connHandle;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+bool BleConnectionStatus::hasReportTarget(uint16_t attrHandle, uint32_t hostMask)
+{
+    uint16_t connHandle;
+    return getReportTargets(attrHandle, hostMask, &connHandle, 1) > 0;
+}
+
+uint8_t BleConnectionStatus::getConnHandles(uint16_t* connHandles, uint8_t maxCount)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _hosts.size() && count < maxCount; i++)
+    {
+        if (_hosts[i].connHandle != BLE_HS_CONN_HANDLE_NONE)
+        {
+            connHandles[count++] = _hosts[i].connHandle;
+        }
+    }
+    return count;
+}
+
+void BleConnectionStatus::setDataLength(uint16_t connHandle, uint16_t octets)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    HostConnection* host = findHost(connHandle);
+    if (host)
+    {
+        host->dataLength = octets;
+    }
+}
+
+uint16_t BleConnectionStatus::getMinMTU(uint32_t hostMask)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint16_t mtu = 0;
+    for (uint8_t i = 0; i < _hosts.size(); i++)
+    {
+        const HostConnection& host = _hosts[i];
+        if (!(hostMask & (1UL << i)) || host.connHandle == BLE_HS_CONN_HANDLE_NONE)
+            continue;
+
+        if (mtu == 0 || host.mtu < mtu)
+            mtu = host.mtu;
+    }
+    return mtu != 0 ? mtu : BLE_ATT_MTU_DFLT;
+}
+
+void BleConnectionStatus::onNotifySent(uint16_t connHandle)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    HostConnection* host = findHost(connHandle);
+    if (!host)
+        return;
+
+    host->notifySentMicros[host->notifyNext] = micros();
+    host->notifyNext = (host->notifyNext + 1) % NOTIFY_WINDOW_MAX;
+}
+
+void BleConnectionStatus::onNotifyFailed(uint16_t connHandle)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    HostConnection* host = findHost(connHandle);
+    if (!host)
+        return;
+
+    // Nothing more goes to this host until the buffers had a connection event to drain
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < NOTIFY_WINDOW_MAX; i++)
+    {
+        host->notifySentMicros[i] = now;
+    }
+}
+
+uint8_t BleConnectionStatus::getNotifyInFlight(uint8_t index)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (index >= _hosts.size() || _hosts[index].connHandle == BLE_HS_CONN_HANDLE_NONE)
+        return 0;
+
+    return countInFlight(_hosts[index], micros());
+}
+
+uint32_t BleConnectionStatus::getNotifyWait(uint32_t hostMask, uint8_t window)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (window == 0)
+        return 0;
+    if (window > NOTIFY_WINDOW_MAX)
+        window = NOTIFY_WINDOW_MAX;
+
+    uint32_t now = micros();
+    uint32_t wait = 0;
+    for (uint8_t i = 0; i < _hosts.size(); i++)
+    {
+        const HostConnection& host = _hosts[i];
+        if (!(hostMask & (1UL << i)) || host.connHandle == BLE_HS_CONN_HANDLE_NONE)
+            continue;
+
+        uint8_t inFlight = countInFlight(host, now);
+        if (inFlight < window)
+            continue;
+
+        // The ring runs oldest first and in flight are the newest entries, so a slot opens once
+        // the entry window places from the newest has completed
+        uint32_t interval = getIntervalMicros(host);
+        uint32_t age = now - host.notifySentMicros[(host.notifyNext + NOTIFY_WINDOW_MAX - window) % NOTIFY_WINDOW_MAX];
+        uint32_t hostWait = age < interval ? interval - age : 0;
+        if (hostWait > wait)
+            wait = hostWait;
+    }
+    return wait;
+}
+
+uint32_t BleConnectionStatus::getIntervalMicros(const HostConnection& host)
+{
+    // 1.25 ms units
+    return host.parameters.minInterval * 1250UL;
+}
+
+uint8_t BleConnectionStatus::countInFlight(const HostConnection& host, uint32_t now)
+{
+    uint32_t interval = getIntervalMicros(host);
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < NOTIFY_WINDOW_MAX; i++)
+    {
+        uint32_t sent = host.notifySentMicros[i];
+        if (sent != 0 && now - sent < interval)
+            count++;
+    }
+    return count;
+}
+
+HostConnection* BleConnectionStatus::findHost(uint16_t connHandle)
+{
+    for (auto& host : _hosts)
+    {
+        if (host.connHandle == connHandle)
+            return &host;
+    }
+    return nullptr;
 }
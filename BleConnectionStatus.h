@@ -9,18 +9,88 @@
 #include <NimBLEServer.h>
 #include "NimBLECharacteristic.h"
 #include "NimBLEConnInfo.h"
+#include "BLEHostConfiguration.h"
 
-class BleConnectionStatus : public NimBLEServerCallbacks
+#include <mutex>
+#include <vector>
+
+#define HOST_INDEX_NONE 0xFF
+#define HOST_MAX_SUBSCRIPTIONS 16         // Input reports a single host can enable notifications on
+#define NOTIFY_WINDOW_MAX 8                 // Largest notify window, see BLEHostConfiguration::setNotifyWindow
+
+// One connected central. Hosts keep their index for as long as they stay connected.
+struct HostConnection {
+    uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE;
+    NimBLEAddress address;
+    bool authenticated = false;
+    ConnectionParameters parameters = {};       // As negotiated, min and max interval both hold the current interval
+    uint16_t mtu = BLE_ATT_MTU_DFLT;            // As negotiated, notifications carry up to mtu - 3 bytes
+    uint16_t dataLength = 0;                    // Link layer payload requested for this connection, 0 if none was
+    uint8_t txPhy = BLE_GAP_LE_PHY_1M;
+    uint8_t rxPhy = BLE_GAP_LE_PHY_1M;
+    uint16_t subscriptions[HOST_MAX_SUBSCRIPTIONS] = {};   // Handles of the input reports this host enabled notifications on
+    uint8_t subscriptionCount = 0;
+    uint32_t notifySentMicros[NOTIFY_WINDOW_MAX] = {};     // Ring of the latest notifications the stack accepted
+    uint8_t notifyNext = 0;                     // Oldest entry, overwritten by the next notification
+};
+
+// Forwards
+class BleCompositeHID;
+
+// Tracks every connected host, and which input reports each of them subscribed to
+class BleConnectionStatus : public NimBLEServerCallbacks, public NimBLECharacteristicCallbacks
 {
 public:
-    BleConnectionStatus(void);
+    BleConnectionStatus(BleCompositeHID* parent = nullptr);
     void onConnect(NimBLEServer *pServer, NimBLEConnInfo& connInfo) override;
     void onDisconnect(NimBLEServer *pServer, NimBLEConnInfo& connInfo, int reason) override;
     //NimBLECharacteristic *inputGamepad;
     bool isConnected();
     void onAuthenticationComplete(NimBLEConnInfo& connInfo) override;
+    void onConnParamsUpdate(NimBLEConnInfo& connInfo) override;
+    void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo) override;
+    void onPhyUpdate(NimBLEConnInfo& connInfo, uint8_t txPhy, uint8_t rxPhy) override;
+
+    // Input report characteristics use these callbacks to track subscriptions
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override;
+    void onStatus(NimBLECharacteristic* pCharacteristic, int code) override;
+
+    void setMaxConnections(uint8_t count);
+    uint8_t getMaxConnections();
+    uint8_t getConnectedCount();
+
+    // Copies the host at index, returns false if no host is connected there
+    bool getHost(uint8_t index, HostConnection& host) const;
+    uint8_t getHostIndex(uint16_t connHandle);
+
+    // Fills connHandles with the authenticated hosts selected by hostMask (bit n is host index n) that
+    // subscribed to the input report with attrHandle, and returns how many there are
+    uint8_t getReportTargets(uint16_t attrHandle, uint32_t hostMask, uint16_t* connHandles, uint8_t maxCount);
+    bool hasReportTarget(uint16_t attrHandle, uint32_t hostMask);
+    // Connection handles of every connected host
+    uint8_t getConnHandles(uint16_t* connHandles, uint8_t maxCount);
+
+    // Notify flow control. A notification counts as in flight from the moment the stack accepts it until the
+    // connection event carrying it has passed, taken to be one connection interval later. A refused notification
+    // means the stack ran out of buffers, the host then counts as full for an interval.
+    void onNotifySent(uint16_t connHandle);
+    void onNotifyFailed(uint16_t connHandle);
+    uint8_t getNotifyInFlight(uint8_t index);
+    // Microseconds until every connected host selected by hostMask has fewer than window notifications in flight
+    uint32_t getNotifyWait(uint32_t hostMask, uint8_t window);
+
+    void setDataLength(uint16_t connHandle, uint16_t octets);
+    // Smallest MTU among the connected hosts selected by hostMask, the default MTU if there are none
+    uint16_t getMinMTU(uint32_t hostMask);
+
 private:
-    bool connected = false;
+    HostConnection* findHost(uint16_t connHandle);
+    static uint32_t getIntervalMicros(const HostConnection& host);
+    static uint8_t countInFlight(const HostConnection& host, uint32_t now);
+
+    BleCompositeHID* _parent;
+    mutable std::mutex _mutex;
+    std::vector<HostConnection> _hosts;
 };
 
 #endif // CONFIG_BT_NIMBLE_ROLE_PERIPHERAL
@@ -14,6 +14,17 @@ BrailleConfiguration::BrailleConfiguration(uint8_t reportId) :
 }
 
 uint8_t BrailleConfiguration::getDeviceReportSize() const
+{
+    // One byte per cell, the display only has an output report
+    return BRAILLE_CELL_COUNT;
+}
+
+uint32_t BrailleConfiguration::getConfigHash() const
+{
+    return getBaseConfigHash();
+}
+
+size_t BrailleConfiguration::getDeviceReportDescriptorSize() const
 {
     return sizeof(_brailleHIDReportDescriptor);
 }
@@ -21,7 +32,7 @@ uint8_t BrailleConfiguration::getDeviceReportSize() const
 size_t BrailleConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize) const
 {
     size_t hidDescriptorSize = sizeof(_brailleHIDReportDescriptor);
-    if(hidDescriptorSize < bufferSize){
+    if(hidDescriptorSize <= bufferSize){
         memcpy(buffer, _brailleHIDReportDescriptor, hidDescriptorSize);
     } else {
         return -1;
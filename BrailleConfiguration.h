@@ -9,7 +9,9 @@ public:
     BrailleConfiguration();
     BrailleConfiguration(uint8_t reportId);
     uint8_t getDeviceReportSize() const override;
+    uint32_t getConfigHash() const override;
     size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override;
+    size_t getDeviceReportDescriptorSize() const override;
 };
 
 #endif
\ No newline at end of file
@@ -3,7 +3,8 @@
 
 #include <HIDTypes.h>
 
-#define BRAILLE_REPORT_ID 0x40
+#define BRAILLE_REPORT_ID 0x50
+#define BRAILLE_CELL_COUNT 40
 
 
 // The report map describes the HID device (a braille display in this case) and
@@ -20,7 +21,7 @@ static const uint8_t _brailleHIDReportDescriptor[] = {
       0x15, 0x00,        // Logical Minimum (0)
       0x26, 0xFF, 0x00,  // Logical Maximum (255)
       0x75, 0x08,        // Report Size (8 bits per cell) for 8 Dot
-      0x95, 0x28,        // Report Count (40 cells)
+      0x95, BRAILLE_CELL_COUNT, // Report Count (40 cells)
       0x91, 0x02,        // Output (Data, Var, Abs)
 
   0xC0,              // End Collection (Logical)
@@ -67,7 +67,7 @@ BrailleDevice::BrailleDevice() :
     _input(),
     _output(),
     _inputReport(),
-    _callbacks(nullptr)
+    _callbacks(this)
 {
     
 }
@@ -77,17 +77,15 @@ BrailleDevice::BrailleDevice(const BrailleConfiguration& config) :
     _input(),
     _output(),
     _inputReport(),
-    _callbacks(nullptr)
+    _callbacks(this)
 {
     
 }
 
 BrailleDevice::~BrailleDevice()
 {
-    if (getOutput() && _callbacks){
+    if (getOutput()){
         getOutput()->setCallbacks(nullptr);
-        delete _callbacks;
-        _callbacks = nullptr;
     }
 }
 
@@ -95,8 +93,7 @@ void BrailleDevice::init(NimBLEHIDDevice* hid)
 {
     _input = hid->getInputReport(_config.getReportId());
     _output = hid->getOutputReport(_config.getReportId());
-    _callbacks = new BrailleCallbacks(this);
-    _output->setCallbacks(_callbacks);
+    _output->setCallbacks(&_callbacks);
 
     setCharacteristics(_input, _output);
 }
@@ -37,7 +37,7 @@ private:
     NimBLECharacteristic* _output;
 
     BrailleInputReport _inputReport;
-    BrailleCallbacks* _callbacks;
+    BrailleCallbacks _callbacks;
 
 public:
     BrailleDevice();
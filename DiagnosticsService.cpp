@@ -0,0 +1,157 @@
+#include "DiagnosticsService.h"
+#include "BleCompositeHID.h"
+#include "esp_heap_caps.h"
+
+#if defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define LOG_TAG "DiagnosticsService"
+#else
+#include "esp_log.h"
+static const char *LOG_TAG = "DiagnosticsService";
+#endif
+
+static void putUint16(uint8_t* buffer, size_t& index, uint32_t value)
+{
+    // Saturate rather than wrap, a capped value is still meaningful
+    if (value > 0xFFFF)
+        value = 0xFFFF;
+    buffer[index++] = value & 0xFF;
+    buffer[index++] = value >> 8;
+}
+
+static void putUint32(uint8_t* buffer, size_t& index, uint32_t value)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        buffer[index++] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+// Counters only ever grow, unless the application reset them in between
+static uint32_t getDelta(uint32_t current, uint32_t previous)
+{
+    return current >= previous ? current - previous : current;
+}
+
+DiagnosticsService::DiagnosticsService(BleCompositeHID* parent) :
+    _parent(parent),
+    _metrics(nullptr),
+    _timer(NULL),
+    _snapshots(),
+    _current(0),
+    _latency(),
+    _previousMs(0)
+{
+}
+
+DiagnosticsService::~DiagnosticsService()
+{
+    end();
+}
+
+bool DiagnosticsService::begin(NimBLEServer* pServer, uint32_t periodMs)
+{
+    NimBLEService* pService = pServer->createService(DIAGNOSTICS_SERVICE_UUID);
+    if (!pService)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to create the diagnostics service!");
+        return false;
+    }
+
+    _metrics = pService->createCharacteristic(DIAGNOSTICS_METRICS_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+    if (!_metrics)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to create the diagnostics characteristic!");
+        return false;
+    }
+    pService->start();
+
+    _parent->_telemetry.getSnapshot(_snapshots[_current], millis());
+    _previousMs = millis();
+
+    _timer = xTimerCreate("diagnostics", pdMS_TO_TICKS(periodMs), pdTRUE, this, timerCallback);
+    if (_timer == NULL || xTimerStart(_timer, 0) != pdPASS)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to start the diagnostics timer!");
+        return false;
+    }
+
+    ESP_LOGI(LOG_TAG, "Diagnostics service started, period %u ms", periodMs);
+    return true;
+}
+
+void DiagnosticsService::end()
+{
+    if (_timer != NULL)
+    {
+        xTimerDelete(_timer, 0);
+        _timer = NULL;
+    }
+}
+
+void DiagnosticsService::timerCallback(TimerHandle_t timer)
+{
+    DiagnosticsService* service = (DiagnosticsService*)pvTimerGetTimerID(timer);
+    service->sendMetrics();
+}
+
+void DiagnosticsService::sendMetrics()
+{
+    // Nothing is gathered while nobody listens
+    if (!_metrics || !_parent->isConnected())
+        return;
+
+    uint32_t now = millis();
+    const TelemetrySnapshot& previousSnapshot = _snapshots[_current];
+    _current ^= 1;
+    TelemetrySnapshot& current = _snapshots[_current];
+    _parent->_telemetry.getSnapshot(current, now);
+    uint32_t elapsedMs = now - _previousMs;
+    if (elapsedMs == 0)
+        elapsedMs = 1;
+
+    for (uint8_t bucket = 0; bucket < TELEMETRY_LATENCY_BUCKETS; bucket++)
+    {
+        _latency[bucket] = getDelta(current.queueLatency[bucket], previousSnapshot.queueLatency[bucket]);
+    }
+
+    uint8_t record[20];
+    size_t index = 0;
+    record[index++] = DIAGNOSTICS_RECORD_SYSTEM;
+    putUint16(record, index, current.deferredQueueDepth);
+    putUint16(record, index, current.deferredQueueHighWater);
+    putUint16(record, index, Telemetry::getLatencyPercentile(_latency, 50));
+    putUint16(record, index, Telemetry::getLatencyPercentile(_latency, 90));
+    putUint16(record, index, Telemetry::getLatencyPercentile(_latency, 99));
+    putUint32(record, index, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    putUint16(record, index, _parent->_autoSendTaskHandle ? uxTaskGetStackHighWaterMark(_parent->_autoSendTaskHandle) : 0);
+    putUint16(record, index, _parent->_serverStackHighWater);
+    notifyRecord(record, index);
+
+    for (uint8_t slot = 0; slot < TELEMETRY_MAX_DEVICES; slot++)
+    {
+        const DeviceTelemetry& device = current.devices[slot];
+        const DeviceTelemetry& previous = previousSnapshot.devices[slot];
+        if (!device.deviceName)
+            continue;
+
+        index = 0;
+        record[index++] = DIAGNOSTICS_RECORD_DEVICE;
+        record[index++] = slot;
+        uint64_t rate = (uint64_t)getDelta(device.counters[TELEMETRY_REPORTS_NOTIFIED], previous.counters[TELEMETRY_REPORTS_NOTIFIED]) * 1000 / elapsedMs;
+        putUint16(record, index, rate > 0xFFFF ? 0xFFFF : (uint32_t)rate);
+        putUint16(record, index, getDelta(device.counters[TELEMETRY_NOTIFY_FAILURES], previous.counters[TELEMETRY_NOTIFY_FAILURES]));
+        putUint16(record, index, getDelta(device.counters[TELEMETRY_REPORTS_DROPPED], previous.counters[TELEMETRY_REPORTS_DROPPED]));
+        putUint16(record, index, getDelta(device.counters[TELEMETRY_REPORTS_SUPPRESSED], previous.counters[TELEMETRY_REPORTS_SUPPRESSED]));
+        notifyRecord(record, index);
+    }
+
+    _previousMs = now;
+}
+
+void DiagnosticsService::notifyRecord(const uint8_t* record, size_t size)
+{
+    // Reads return the latest record, notifications go to every subscribed host
+    _metrics->setValue(record, size);
+    _metrics->notify();
+}
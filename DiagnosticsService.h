@@ -0,0 +1,71 @@
+#ifndef ESP32_DIAGNOSTICS_SERVICE_H
+#define ESP32_DIAGNOSTICS_SERVICE_H
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+
+#include "nimconfig.h"
+#if defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL)
+
+#include <NimBLEServer.h>
+#include "NimBLECharacteristic.h"
+#include "Telemetry.h"
+#include "freertos/timers.h"
+
+#define DIAGNOSTICS_SERVICE_UUID "6d8b0001-4d1a-4c2e-9a49-7c2f5a3b8e10"
+#define DIAGNOSTICS_METRICS_UUID "6d8b0002-4d1a-4c2e-9a49-7c2f5a3b8e10"
+
+// Every notification carries one record and starts with its type. All fields are little endian, and
+// each record fits into the 20 bytes of the default MTU.
+#define DIAGNOSTICS_RECORD_SYSTEM 0x01
+// uint8  type
+// uint16 deferred queue depth
+// uint16 deferred queue high water mark since boot
+// uint16 queue latency p50, p90 and p99 over the last period, microseconds (upper bucket bounds, capped)
+// uint32 free heap, bytes
+// uint16 autoSend task stack high water mark, bytes (0 without the task)
+// uint16 server task stack high water mark, bytes
+#define DIAGNOSTICS_RECORD_DEVICE 0x02
+// uint8  type
+// uint8  device slot
+// uint16 reports notified per second over the last period
+// uint16 notify failures over the last period
+// uint16 reports dropped over the last period
+// uint16 reports suppressed over the last period
+
+// Forwards
+class BleCompositeHID;
+
+// Optional vendor GATT service that streams performance metrics as notifications, so they can be
+// watched from a phone without a serial console. Only created when a diagnostics period is configured.
+class DiagnosticsService
+{
+public:
+    DiagnosticsService(BleCompositeHID* parent);
+    ~DiagnosticsService();
+
+    // Adds the service to the server, call before the GATT table is started
+    bool begin(NimBLEServer* pServer, uint32_t periodMs);
+    void end();
+
+    // Sends one round of records to the subscribed hosts
+    void sendMetrics();
+
+private:
+    static void timerCallback(TimerHandle_t timer);
+    void notifyRecord(const uint8_t* record, size_t size);
+
+    BleCompositeHID* _parent;
+    NimBLECharacteristic* _metrics;
+    TimerHandle_t _timer;
+
+    // The round's snapshot and the previous one, the records carry the difference. Kept here
+    // rather than on the stack of the timer service task, which is small.
+    TelemetrySnapshot _snapshots[2];
+    uint8_t _current;
+    uint32_t _latency[TELEMETRY_LATENCY_BUCKETS];
+    uint32_t _previousMs;
+};
+
+#endif // CONFIG_BT_NIMBLE_ROLE_PERIPHERAL
+#endif // CONFIG_BT_ENABLED
+#endif // ESP32_DIAGNOSTICS_SERVICE_H
@@ -42,77 +42,101 @@ uint8_t GamepadConfiguration::getDeviceReportSize() const
     return reportSize;
 }
 
+uint32_t GamepadConfiguration::getConfigHash() const
+{
+    uint32_t hash = getBaseConfigHash();
+    hash = hashConfigBytes(hash, &_controllerType, sizeof(_controllerType));
+    hash = hashConfigBytes(hash, &_buttonCount, sizeof(_buttonCount));
+    hash = hashConfigBytes(hash, &_hatSwitchCount, sizeof(_hatSwitchCount));
+    hash = hashConfigBytes(hash, _whichSpecialButtons, sizeof(_whichSpecialButtons));
+    hash = hashConfigBytes(hash, _whichAxes, sizeof(_whichAxes));
+    hash = hashConfigBytes(hash, _whichSimulationControls, sizeof(_whichSimulationControls));
+    hash = hashConfigBytes(hash, &_axesMin, sizeof(_axesMin));
+    hash = hashConfigBytes(hash, &_axesMax, sizeof(_axesMax));
+    hash = hashConfigBytes(hash, &_simulationMin, sizeof(_simulationMin));
+    hash = hashConfigBytes(hash, &_simulationMax, sizeof(_simulationMax));
+    hash = hashConfigBytes(hash, &_includeRumble, sizeof(_includeRumble));
+    hash = hashConfigBytes(hash, &_includePlayerIndicators, sizeof(_includePlayerIndicators));
+    return hash;
+}
+
+size_t GamepadConfiguration::getDeviceReportDescriptorSize() const
+{
+    // The DescriptorWriter in makeDeviceReport only counts when there is no buffer
+    return makeDeviceReport(nullptr, 0);
+}
+
 size_t GamepadConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize) const
 {
     // Report description START -------------------------------------------------
 
-    uint8_t tempHidReportDescriptor[BLE_ATT_ATTR_MAX_LEN];
+    DescriptorWriter descriptor(buffer, bufferSize);
     size_t reportSize = 0;
 
     // USAGE_PAGE (Generic Desktop)
-    tempHidReportDescriptor[reportSize++] = USAGE_PAGE(1); //0x05;
-    tempHidReportDescriptor[reportSize++] = 0x01; //Generic Desktop
+    descriptor[reportSize++] = USAGE_PAGE(1); //0x05;
+    descriptor[reportSize++] = 0x01; //Generic Desktop
 
     // USAGE (Joystick - 0x04; Gamepad - 0x05; Multi-axis Controller - 0x08)
-    tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-    tempHidReportDescriptor[reportSize++] = this->getControllerType();
+    descriptor[reportSize++] = USAGE(1); //0x09;
+    descriptor[reportSize++] = this->getControllerType();
 
     // COLLECTION (Application)
-    tempHidReportDescriptor[reportSize++] = COLLECTION(1); //0xa1;
-    tempHidReportDescriptor[reportSize++] = 0x01;
+    descriptor[reportSize++] = COLLECTION(1); //0xa1;
+    descriptor[reportSize++] = 0x01;
     {
         // REPORT_ID (Gamepad)
-        tempHidReportDescriptor[reportSize++] = REPORT_ID(1);
-        tempHidReportDescriptor[reportSize++] = this->getReportId();
+        descriptor[reportSize++] = REPORT_ID(1);
+        descriptor[reportSize++] = this->getReportId();
 
         if (this->getButtonCount() > 0)
         {
             // USAGE_PAGE (Button)
-            tempHidReportDescriptor[reportSize++] = USAGE_PAGE(1); //0x05;
-            tempHidReportDescriptor[reportSize++] = 0x09;
+            descriptor[reportSize++] = USAGE_PAGE(1); //0x05;
+            descriptor[reportSize++] = 0x09;
 
             // LOGICAL_MINIMUM (0)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MINIMUM(1);//0x15;
-            tempHidReportDescriptor[reportSize++] = 0x00;
+            descriptor[reportSize++] = LOGICAL_MINIMUM(1);//0x15;
+            descriptor[reportSize++] = 0x00;
 
             // LOGICAL_MAXIMUM (1)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MAXIMUM(1); //0x25;
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = LOGICAL_MAXIMUM(1); //0x25;
+            descriptor[reportSize++] = 0x01;
 
             // REPORT_SIZE (1)
-            tempHidReportDescriptor[reportSize++] = REPORT_SIZE(1); //0x75;
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = REPORT_SIZE(1); //0x75;
+            descriptor[reportSize++] = 0x01;
 
             // USAGE_MINIMUM (Button 1)
-            tempHidReportDescriptor[reportSize++] = USAGE_MINIMUM(1);//0x19;
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = USAGE_MINIMUM(1);//0x19;
+            descriptor[reportSize++] = 0x01;
 
             // USAGE_MAXIMUM (Up to 128 buttons possible)
-            tempHidReportDescriptor[reportSize++] = USAGE_MAXIMUM(1);//0x29;
-            tempHidReportDescriptor[reportSize++] = this->getButtonCount();
+            descriptor[reportSize++] = USAGE_MAXIMUM(1);//0x29;
+            descriptor[reportSize++] = this->getButtonCount();
 
             // REPORT_COUNT (# of buttons)
-            tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); //0x95;
-            tempHidReportDescriptor[reportSize++] = this->getButtonCount();
+            descriptor[reportSize++] = REPORT_COUNT(1); //0x95;
+            descriptor[reportSize++] = this->getButtonCount();
 
             // INPUT (Data,Var,Abs)
-            tempHidReportDescriptor[reportSize++] = HIDINPUT(1); //0x81;
-            tempHidReportDescriptor[reportSize++] = 0x02;
+            descriptor[reportSize++] = HIDINPUT(1); //0x81;
+            descriptor[reportSize++] = 0x02;
 
             uint8_t buttonPaddingBits = getButtonNumPaddingBits();
             if (buttonPaddingBits > 0)
             {
                 // REPORT_SIZE (1)
-                tempHidReportDescriptor[reportSize++] = REPORT_SIZE(1); //0x75;
-                tempHidReportDescriptor[reportSize++] = 0x01;
+                descriptor[reportSize++] = REPORT_SIZE(1); //0x75;
+                descriptor[reportSize++] = 0x01;
 
                 // REPORT_COUNT (# of padding bits)
-                tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); //0x95;
-                tempHidReportDescriptor[reportSize++] = buttonPaddingBits;
+                descriptor[reportSize++] = REPORT_COUNT(1); //0x95;
+                descriptor[reportSize++] = buttonPaddingBits;
 
                 // INPUT (Const,Var,Abs)
-                tempHidReportDescriptor[reportSize++] = HIDINPUT(1); //0x81;
-                tempHidReportDescriptor[reportSize++] = 0x03;
+                descriptor[reportSize++] = HIDINPUT(1); //0x81;
+                descriptor[reportSize++] = 0x03;
 
             } // Padding Bits Needed
 
@@ -121,118 +145,118 @@ size_t GamepadConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize
         if (this->getTotalSpecialButtonCount() > 0)
         {
             // LOGICAL_MINIMUM (0)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MINIMUM(1); //0x15;
-            tempHidReportDescriptor[reportSize++] = 0x00;
+            descriptor[reportSize++] = LOGICAL_MINIMUM(1); //0x15;
+            descriptor[reportSize++] = 0x00;
 
             // LOGICAL_MAXIMUM (1)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MAXIMUM(1); //;0x25;
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = LOGICAL_MAXIMUM(1); //;0x25;
+            descriptor[reportSize++] = 0x01;
 
             // REPORT_SIZE (1)
-            tempHidReportDescriptor[reportSize++] = REPORT_SIZE(1); //0x75;
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = REPORT_SIZE(1); //0x75;
+            descriptor[reportSize++] = 0x01;
 
             if (this->getDesktopSpecialButtonCount() > 0)
             {
                 // USAGE_PAGE (Generic Desktop)
-                tempHidReportDescriptor[reportSize++] = USAGE_PAGE(1); // 0x05;
-                tempHidReportDescriptor[reportSize++] = 0x01;
+                descriptor[reportSize++] = USAGE_PAGE(1); // 0x05;
+                descriptor[reportSize++] = 0x01;
 
                 // REPORT_COUNT
-                tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); //0x95;
-                tempHidReportDescriptor[reportSize++] = this->getDesktopSpecialButtonCount();
+                descriptor[reportSize++] = REPORT_COUNT(1); //0x95;
+                descriptor[reportSize++] = this->getDesktopSpecialButtonCount();
                 if (this->getIncludeStart())
                 {
                     // USAGE (Start)
-                    tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                    tempHidReportDescriptor[reportSize++] = 0x3D;
+                    descriptor[reportSize++] = USAGE(1); //0x09;
+                    descriptor[reportSize++] = 0x3D;
                 }
 
                 if (this->getIncludeSelect())
                 {
                     // USAGE (Select)
-                    tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                    tempHidReportDescriptor[reportSize++] = 0x3E;
+                    descriptor[reportSize++] = USAGE(1); //0x09;
+                    descriptor[reportSize++] = 0x3E;
                 }
 
                 if (this->getIncludeMenu())
                 {
                     // USAGE (App Menu)
-                    tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                    tempHidReportDescriptor[reportSize++] = 0x86;
+                    descriptor[reportSize++] = USAGE(1); //0x09;
+                    descriptor[reportSize++] = 0x86;
                 }
 
                 // INPUT (Data,Var,Abs)
-                tempHidReportDescriptor[reportSize++] = HIDINPUT(1); //0x81;
-                tempHidReportDescriptor[reportSize++] = 0x02;
+                descriptor[reportSize++] = HIDINPUT(1); //0x81;
+                descriptor[reportSize++] = 0x02;
             }
 
             if (this->getConsumerSpecialButtonCount() > 0)
             {
                 // USAGE_PAGE (Consumer Page)
-                tempHidReportDescriptor[reportSize++] = USAGE_PAGE(1); //0x05;
-                tempHidReportDescriptor[reportSize++] = 0x0C;
+                descriptor[reportSize++] = USAGE_PAGE(1); //0x05;
+                descriptor[reportSize++] = 0x0C;
 
                 // REPORT_COUNT
-                tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); //0x95;
-                tempHidReportDescriptor[reportSize++] = this->getConsumerSpecialButtonCount();
+                descriptor[reportSize++] = REPORT_COUNT(1); //0x95;
+                descriptor[reportSize++] = this->getConsumerSpecialButtonCount();
 
                 if (this->getIncludeHome())
                 {
                     // USAGE (Home)
-                    tempHidReportDescriptor[reportSize++] = USAGE(2); //0x0A;
-                    tempHidReportDescriptor[reportSize++] = 0x23;
-                    tempHidReportDescriptor[reportSize++] = 0x02;
+                    descriptor[reportSize++] = USAGE(2); //0x0A;
+                    descriptor[reportSize++] = 0x23;
+                    descriptor[reportSize++] = 0x02;
                 }
 
                 if (this->getIncludeBack())
                 {
                     // USAGE (Back)
-                    tempHidReportDescriptor[reportSize++] = USAGE(2); //0x0A;
-                    tempHidReportDescriptor[reportSize++] = 0x24;
-                    tempHidReportDescriptor[reportSize++] = 0x02;
+                    descriptor[reportSize++] = USAGE(2); //0x0A;
+                    descriptor[reportSize++] = 0x24;
+                    descriptor[reportSize++] = 0x02;
                 }
 
                 if (this->getIncludeVolumeInc())
                 {
                     // USAGE (Volume Increment)
-                    tempHidReportDescriptor[reportSize++] =  USAGE(1); //0x09;
-                    tempHidReportDescriptor[reportSize++] = 0xE9;
+                    descriptor[reportSize++] =  USAGE(1); //0x09;
+                    descriptor[reportSize++] = 0xE9;
                 }
 
                 if (this->getIncludeVolumeDec())
                 {
                     // USAGE (Volume Decrement)
-                    tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                    tempHidReportDescriptor[reportSize++] = 0xEA;
+                    descriptor[reportSize++] = USAGE(1); //0x09;
+                    descriptor[reportSize++] = 0xEA;
                 }
 
                 if (this->getIncludeVolumeMute())
                 {
                     // USAGE (Mute)
-                    tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                    tempHidReportDescriptor[reportSize++] = 0xE2;
+                    descriptor[reportSize++] = USAGE(1); //0x09;
+                    descriptor[reportSize++] = 0xE2;
                 }
 
                 // INPUT (Data,Var,Abs)
-                tempHidReportDescriptor[reportSize++] = HIDINPUT(1); //0x81;
-                tempHidReportDescriptor[reportSize++] = 0x02;
+                descriptor[reportSize++] = HIDINPUT(1); //0x81;
+                descriptor[reportSize++] = 0x02;
             }
 
             uint8_t specialButtonPaddingBits = getSpecialButtonNumPaddingBits();
             if (specialButtonPaddingBits > 0)
             {
                 // REPORT_SIZE (1)
-                tempHidReportDescriptor[reportSize++] = REPORT_SIZE(1); //0x75;
-                tempHidReportDescriptor[reportSize++] = 0x01;
+                descriptor[reportSize++] = REPORT_SIZE(1); //0x75;
+                descriptor[reportSize++] = 0x01;
 
                 // REPORT_COUNT (# of padding bits)
-                tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); //0x95;
-                tempHidReportDescriptor[reportSize++] = specialButtonPaddingBits;
+                descriptor[reportSize++] = REPORT_COUNT(1); //0x95;
+                descriptor[reportSize++] = specialButtonPaddingBits;
 
                 // INPUT (Const,Var,Abs)
-                tempHidReportDescriptor[reportSize++] = HIDINPUT(1); //0x81;
-                tempHidReportDescriptor[reportSize++] = 0x03;
+                descriptor[reportSize++] = HIDINPUT(1); //0x81;
+                descriptor[reportSize++] = 0x03;
 
             } // Padding Bits Needed
 
@@ -241,185 +265,185 @@ size_t GamepadConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize
         if (this->getAxisCount() > 0)
         {
             // USAGE_PAGE (Generic Desktop)
-            tempHidReportDescriptor[reportSize++] = USAGE_PAGE(1); 0x05;
-            tempHidReportDescriptor[reportSize++] = 0x01; // Generic desktop controls
+            descriptor[reportSize++] = USAGE_PAGE(1); 0x05;
+            descriptor[reportSize++] = 0x01; // Generic desktop controls
 
             // USAGE (Pointer)
-            tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-            tempHidReportDescriptor[reportSize++] = 0x01; 
+            descriptor[reportSize++] = USAGE(1); //0x09;
+            descriptor[reportSize++] = 0x01; 
 
             // LOGICAL_MINIMUM (-32767)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MINIMUM(2); //0x16;
-            tempHidReportDescriptor[reportSize++] = lowByte(this->getAxesMin());
-            tempHidReportDescriptor[reportSize++] = highByte(this->getAxesMin());
-            //tempHidReportDescriptor[reportSize++] = 0x00;		// Use these two lines for 0 min
-            //tempHidReportDescriptor[reportSize++] = 0x00;
-                //tempHidReportDescriptor[reportSize++] = 0x01;	// Use these two lines for -32767 min
-            //tempHidReportDescriptor[reportSize++] = 0x80;
+            descriptor[reportSize++] = LOGICAL_MINIMUM(2); //0x16;
+            descriptor[reportSize++] = lowByte(this->getAxesMin());
+            descriptor[reportSize++] = highByte(this->getAxesMin());
+            //descriptor[reportSize++] = 0x00;		// Use these two lines for 0 min
+            //descriptor[reportSize++] = 0x00;
+                //descriptor[reportSize++] = 0x01;	// Use these two lines for -32767 min
+            //descriptor[reportSize++] = 0x80;
 
             // LOGICAL_MAXIMUM (+32767)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MAXIMUM(2);//0x26;
-            tempHidReportDescriptor[reportSize++] = lowByte(this->getAxesMax());
-            tempHidReportDescriptor[reportSize++] = highByte(this->getAxesMax());
-            //tempHidReportDescriptor[reportSize++] = 0xFF;	// Use these two lines for 255 max
-            //tempHidReportDescriptor[reportSize++] = 0x00;
-                //tempHidReportDescriptor[reportSize++] = 0xFF;	// Use these two lines for +32767 max
-            //tempHidReportDescriptor[reportSize++] = 0x7F;
+            descriptor[reportSize++] = LOGICAL_MAXIMUM(2);//0x26;
+            descriptor[reportSize++] = lowByte(this->getAxesMax());
+            descriptor[reportSize++] = highByte(this->getAxesMax());
+            //descriptor[reportSize++] = 0xFF;	// Use these two lines for 255 max
+            //descriptor[reportSize++] = 0x00;
+                //descriptor[reportSize++] = 0xFF;	// Use these two lines for +32767 max
+            //descriptor[reportSize++] = 0x7F;
 
             // REPORT_SIZE (16)
-            tempHidReportDescriptor[reportSize++] = REPORT_SIZE(1); //0x75;
-            tempHidReportDescriptor[reportSize++] = 0x10;
+            descriptor[reportSize++] = REPORT_SIZE(1); //0x75;
+            descriptor[reportSize++] = 0x10;
 
             // REPORT_COUNT (this->getAxisCount())
-            tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); //0x95;
-            tempHidReportDescriptor[reportSize++] = this->getAxisCount();
+            descriptor[reportSize++] = REPORT_COUNT(1); //0x95;
+            descriptor[reportSize++] = this->getAxisCount();
 
             // COLLECTION (Physical)
-            tempHidReportDescriptor[reportSize++] = COLLECTION(1); //0xA1;
-            tempHidReportDescriptor[reportSize++] = 0x00;
+            descriptor[reportSize++] = COLLECTION(1); //0xA1;
+            descriptor[reportSize++] = 0x00;
 
             if (this->getIncludeXAxis())
             {
                 // USAGE (X)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0x30;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0x30;
             }
 
             if (this->getIncludeYAxis())
             {
                 // USAGE (Y)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0x31;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0x31;
             }
 
             if (this->getIncludeZAxis())
             {
                 // USAGE (Z)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0x32;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0x32;
             }
 
             if (this->getIncludeRzAxis())
             {
                 // USAGE (Rz)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0x35;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0x35;
             }
 
             if (this->getIncludeRxAxis())
             {
                 // USAGE (Rx)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0x33;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0x33;
             }
 
             if (this->getIncludeRyAxis())
             {
                 // USAGE (Ry)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0x34;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0x34;
             }
 
             if (this->getIncludeSlider1())
             {
                 // USAGE (Slider)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0x36;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0x36;
             }
 
             if (this->getIncludeSlider2())
             {
                 // USAGE (Slider)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0x36;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0x36;
             }
 
             // INPUT (Data,Var,Abs)
-            tempHidReportDescriptor[reportSize++] = HIDINPUT(1); //0x81;
-            tempHidReportDescriptor[reportSize++] = 0x02;
+            descriptor[reportSize++] = HIDINPUT(1); //0x81;
+            descriptor[reportSize++] = 0x02;
 
             // END_COLLECTION (Physical)
-            tempHidReportDescriptor[reportSize++] = END_COLLECTION(0); //0xc0;
+            descriptor[reportSize++] = END_COLLECTION(0); //0xc0;
 
         } // X, Y, Z, Rx, Ry, and Rz Axis
 
         if (this->getSimulationCount() > 0)
         {
             // USAGE_PAGE (Simulation Controls)
-            tempHidReportDescriptor[reportSize++] = USAGE_PAGE(1); //0x05;
-            tempHidReportDescriptor[reportSize++] = 0x02;
+            descriptor[reportSize++] = USAGE_PAGE(1); //0x05;
+            descriptor[reportSize++] = 0x02;
 
             // LOGICAL_MINIMUM (-32767)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MINIMUM(2); //0x16;
-            tempHidReportDescriptor[reportSize++] = lowByte(this->getSimulationMin());
-            tempHidReportDescriptor[reportSize++] = highByte(this->getSimulationMin());
-            //tempHidReportDescriptor[reportSize++] = 0x00;		// Use these two lines for 0 min
-            //tempHidReportDescriptor[reportSize++] = 0x00;
-            //tempHidReportDescriptor[reportSize++] = 0x01;	    // Use these two lines for -32767 min
-            //tempHidReportDescriptor[reportSize++] = 0x80;
+            descriptor[reportSize++] = LOGICAL_MINIMUM(2); //0x16;
+            descriptor[reportSize++] = lowByte(this->getSimulationMin());
+            descriptor[reportSize++] = highByte(this->getSimulationMin());
+            //descriptor[reportSize++] = 0x00;		// Use these two lines for 0 min
+            //descriptor[reportSize++] = 0x00;
+            //descriptor[reportSize++] = 0x01;	    // Use these two lines for -32767 min
+            //descriptor[reportSize++] = 0x80;
 
             // LOGICAL_MAXIMUM (+32767)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MAXIMUM(2); //0x26;
-            tempHidReportDescriptor[reportSize++] = lowByte(this->getSimulationMax());
-            tempHidReportDescriptor[reportSize++] = highByte(this->getSimulationMax());
-            //tempHidReportDescriptor[reportSize++] = 0xFF;	    // Use these two lines for 255 max
-            //tempHidReportDescriptor[reportSize++] = 0x00;
-            //tempHidReportDescriptor[reportSize++] = 0xFF;		// Use these two lines for +32767 max
-            //tempHidReportDescriptor[reportSize++] = 0x7F;
+            descriptor[reportSize++] = LOGICAL_MAXIMUM(2); //0x26;
+            descriptor[reportSize++] = lowByte(this->getSimulationMax());
+            descriptor[reportSize++] = highByte(this->getSimulationMax());
+            //descriptor[reportSize++] = 0xFF;	    // Use these two lines for 255 max
+            //descriptor[reportSize++] = 0x00;
+            //descriptor[reportSize++] = 0xFF;		// Use these two lines for +32767 max
+            //descriptor[reportSize++] = 0x7F;
 
             // REPORT_SIZE (16)
-            tempHidReportDescriptor[reportSize++] = REPORT_SIZE(1); //0x75;
-            tempHidReportDescriptor[reportSize++] = 0x10;
+            descriptor[reportSize++] = REPORT_SIZE(1); //0x75;
+            descriptor[reportSize++] = 0x10;
 
             // REPORT_COUNT (this->getSimulationCount())
-            tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); //0x95;
-            tempHidReportDescriptor[reportSize++] = this->getSimulationCount();
+            descriptor[reportSize++] = REPORT_COUNT(1); //0x95;
+            descriptor[reportSize++] = this->getSimulationCount();
 
             // COLLECTION (Physical)
-            tempHidReportDescriptor[reportSize++] = COLLECTION(1); //0xA1;
-            tempHidReportDescriptor[reportSize++] = 0x00;
+            descriptor[reportSize++] = COLLECTION(1); //0xA1;
+            descriptor[reportSize++] = 0x00;
 
             if (this->getIncludeRudder())
             {
                 // USAGE (Rudder)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0xBA;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0xBA;
             }
 
             if (this->getIncludeThrottle())
             {
                 // USAGE (Throttle)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0xBB;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0xBB;
             }
 
             if (this->getIncludeAccelerator())
             {
                 // USAGE (Accelerator)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0xC4;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0xC4;
             }
 
             if (this->getIncludeBrake())
             {
                 // USAGE (Brake)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0xC5;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0xC5;
             }
 
             if (this->getIncludeSteering())
             {
                 // USAGE (Steering)
-                tempHidReportDescriptor[reportSize++] = USAGE(1); //0x09;
-                tempHidReportDescriptor[reportSize++] = 0xC8;
+                descriptor[reportSize++] = USAGE(1); //0x09;
+                descriptor[reportSize++] = 0xC8;
             }
 
             // INPUT (Data,Var,Abs)
-            tempHidReportDescriptor[reportSize++] = HIDINPUT(1); 0x81;
-            tempHidReportDescriptor[reportSize++] = 0x02;
+            descriptor[reportSize++] = HIDINPUT(1); 0x81;
+            descriptor[reportSize++] = 0x02;
 
             // END_COLLECTION (Physical)
-            tempHidReportDescriptor[reportSize++] = END_COLLECTION(0); //0xc0;
+            descriptor[reportSize++] = END_COLLECTION(0); //0xc0;
 
         } // Simulation Controls
 
@@ -427,108 +451,102 @@ size_t GamepadConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize
         {
 
             // COLLECTION (Physical)
-            tempHidReportDescriptor[reportSize++] = COLLECTION(1); //0xA1;
-            tempHidReportDescriptor[reportSize++] = 0x00;
+            descriptor[reportSize++] = COLLECTION(1); //0xA1;
+            descriptor[reportSize++] = 0x00;
 
             // USAGE_PAGE (Generic Desktop)
-            tempHidReportDescriptor[reportSize++] = USAGE_PAGE(1);
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = USAGE_PAGE(1);
+            descriptor[reportSize++] = 0x01;
 
             // USAGE (Hat Switch)
             for (int currentHatIndex = 0; currentHatIndex < this->getHatSwitchCount(); currentHatIndex++)
             {
-                tempHidReportDescriptor[reportSize++] = USAGE(1);
-                tempHidReportDescriptor[reportSize++] = 0x39;
+                descriptor[reportSize++] = USAGE(1);
+                descriptor[reportSize++] = 0x39;
             }
 
             // Logical Min (1)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MINIMUM(1); //0x15;
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = LOGICAL_MINIMUM(1); //0x15;
+            descriptor[reportSize++] = 0x01;
 
             // Logical Max (8)
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MAXIMUM(1); //0x25;
-            tempHidReportDescriptor[reportSize++] = 0x08;
+            descriptor[reportSize++] = LOGICAL_MAXIMUM(1); //0x25;
+            descriptor[reportSize++] = 0x08;
 
             // Physical Min (0)
-            tempHidReportDescriptor[reportSize++] = PHYSICAL_MINIMUM(1); //0x35;
-            tempHidReportDescriptor[reportSize++] = 0x00;
+            descriptor[reportSize++] = PHYSICAL_MINIMUM(1); //0x35;
+            descriptor[reportSize++] = 0x00;
 
             // Physical Max (315)
-            tempHidReportDescriptor[reportSize++] = PHYSICAL_MAXIMUM(2); //0x46;
-            tempHidReportDescriptor[reportSize++] = 0x3B;
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = PHYSICAL_MAXIMUM(2); //0x46;
+            descriptor[reportSize++] = 0x3B;
+            descriptor[reportSize++] = 0x01;
 
             // Unit (SI Rot : Ang Pos)
-            tempHidReportDescriptor[reportSize++] = UNIT(1); //0x65;
-            tempHidReportDescriptor[reportSize++] = 0x12;
+            descriptor[reportSize++] = UNIT(1); //0x65;
+            descriptor[reportSize++] = 0x12;
 
             // Report Size (8)
-            tempHidReportDescriptor[reportSize++] = REPORT_SIZE(1); //0x75;
-            tempHidReportDescriptor[reportSize++] = 0x08;
+            descriptor[reportSize++] = REPORT_SIZE(1); //0x75;
+            descriptor[reportSize++] = 0x08;
 
             // Report Count (4)
-            tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); //0x95;
-            tempHidReportDescriptor[reportSize++] = this->getHatSwitchCount();
+            descriptor[reportSize++] = REPORT_COUNT(1); //0x95;
+            descriptor[reportSize++] = this->getHatSwitchCount();
 
             // Input (Data, Variable, Absolute)
-            tempHidReportDescriptor[reportSize++] = HIDINPUT(1); //0x81;
-            tempHidReportDescriptor[reportSize++] = 0x42;
+            descriptor[reportSize++] = HIDINPUT(1); //0x81;
+            descriptor[reportSize++] = 0x42;
 
             // END_COLLECTION (Physical)
-            tempHidReportDescriptor[reportSize++] = END_COLLECTION(0); //0xc0;
+            descriptor[reportSize++] = END_COLLECTION(0); //0xc0;
         }
 
         if(this->getIncludeRumble()){
-            ESP_LOGI(LOG_TAG, "Start offset: %d, Bytes to copy: %d, Final size: %d", reportSize, sizeof(pidReportDescriptor), reportSize + sizeof(pidReportDescriptor));
-            memcpy(&tempHidReportDescriptor[reportSize], &pidReportDescriptor[0], sizeof(pidReportDescriptor));
+            ESP_LOGD(LOG_TAG, "Start offset: %d, Bytes to copy: %d, Final size: %d", reportSize, sizeof(pidReportDescriptor), reportSize + sizeof(pidReportDescriptor));
+            descriptor.copy(reportSize, &pidReportDescriptor[0], sizeof(pidReportDescriptor));
             reportSize += sizeof(pidReportDescriptor) / sizeof(pidReportDescriptor[0]);
         }
 
         if(this->getIncludePlayerIndicators()){
-            tempHidReportDescriptor[reportSize++] = COLLECTION(1); // Physical collection
-            tempHidReportDescriptor[reportSize++] = 0x00;
+            descriptor[reportSize++] = COLLECTION(1); // Physical collection
+            descriptor[reportSize++] = 0x00;
 
-            tempHidReportDescriptor[reportSize++] = REPORT_ID(1); // Report ID
-            tempHidReportDescriptor[reportSize++] = this->getReportId();
+            descriptor[reportSize++] = REPORT_ID(1); // Report ID
+            descriptor[reportSize++] = this->getReportId();
 
-            tempHidReportDescriptor[reportSize++] = USAGE_PAGE(1); // Usage page - LED usage page
-            tempHidReportDescriptor[reportSize++] = 0x08;
+            descriptor[reportSize++] = USAGE_PAGE(1); // Usage page - LED usage page
+            descriptor[reportSize++] = 0x08;
 
-            tempHidReportDescriptor[reportSize++] = USAGE_MINIMUM(1); // Usage minimum
-            tempHidReportDescriptor[reportSize++] = 0x61;
+            descriptor[reportSize++] = USAGE_MINIMUM(1); // Usage minimum
+            descriptor[reportSize++] = 0x61;
 
-            tempHidReportDescriptor[reportSize++] = USAGE_MAXIMUM(1); // Usage maximum
-            tempHidReportDescriptor[reportSize++] = 0x68;
+            descriptor[reportSize++] = USAGE_MAXIMUM(1); // Usage maximum
+            descriptor[reportSize++] = 0x68;
 
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MINIMUM(1); // Logical minimum
-            tempHidReportDescriptor[reportSize++] = 0x00;
+            descriptor[reportSize++] = LOGICAL_MINIMUM(1); // Logical minimum
+            descriptor[reportSize++] = 0x00;
 
-            tempHidReportDescriptor[reportSize++] = LOGICAL_MAXIMUM(1); // Logical maximum
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = LOGICAL_MAXIMUM(1); // Logical maximum
+            descriptor[reportSize++] = 0x01;
 
-            tempHidReportDescriptor[reportSize++] = REPORT_COUNT(1); // Report count - 8 bits
-            tempHidReportDescriptor[reportSize++] = 0x08;
+            descriptor[reportSize++] = REPORT_COUNT(1); // Report count - 8 bits
+            descriptor[reportSize++] = 0x08;
 
-            tempHidReportDescriptor[reportSize++] = REPORT_SIZE(1);  // Report size
-            tempHidReportDescriptor[reportSize++] = 0x01;
+            descriptor[reportSize++] = REPORT_SIZE(1);  // Report size
+            descriptor[reportSize++] = 0x01;
 
-            tempHidReportDescriptor[reportSize++] = HIDOUTPUT(1); // Output
-            tempHidReportDescriptor[reportSize++] = 0x02;
+            descriptor[reportSize++] = HIDOUTPUT(1); // Output
+            descriptor[reportSize++] = 0x02;
 
-            tempHidReportDescriptor[reportSize++] = END_COLLECTION(0); // End physical collection
+            descriptor[reportSize++] = END_COLLECTION(0); // End physical collection
         }
     }
     
     // End gamepad collection
-    tempHidReportDescriptor[reportSize++] = END_COLLECTION(0); //0xc0;
+    descriptor[reportSize++] = END_COLLECTION(0); //0xc0;
     
-    if(reportSize < bufferSize){
-        memcpy(buffer, tempHidReportDescriptor, reportSize);
-    } else {
-        return -1;
-    }
-
-    return reportSize;
+    return descriptor.finish(reportSize);
 }
 
 
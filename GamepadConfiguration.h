@@ -266,7 +266,9 @@ public:
 
     const char* getDeviceName() const override;
     uint8_t getDeviceReportSize() const override;
+    uint32_t getConfigHash() const override;
     size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override;
+    size_t getDeviceReportDescriptorSize() const override;
     uint8_t getButtonNumBytes() const;
     uint8_t getSpecialButtonNumBytes() const;
 
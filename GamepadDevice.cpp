@@ -74,7 +74,8 @@ GamepadDevice::GamepadDevice() :
     _hat2(0),
     _hat3(0),
     _hat4(0),
-    _callbacks(nullptr)
+    _avoidedReports(0),
+    _callbacks(this)
     // _setEffectCharacteristic(nullptr),
     // _setEnvelopeCharacteristic(nullptr),
     // _setConditionCharacteristic(nullptr),
@@ -92,6 +93,7 @@ GamepadDevice::GamepadDevice() :
     // _pidPool(nullptr)
 {
     this->resetButtons();
+    this->setupAxisConditioners();
 }
 
 GamepadDevice::GamepadDevice(const GamepadConfiguration& config):
@@ -115,7 +117,8 @@ GamepadDevice::GamepadDevice(const GamepadConfiguration& config):
     _hat2(0),
     _hat3(0),
     _hat4(0),
-    _callbacks(nullptr)
+    _avoidedReports(0),
+    _callbacks(this)
     // _setEffectCharacteristic(nullptr),
     // _setEnvelopeCharacteristic(nullptr),
     // _setConditionCharacteristic(nullptr),
@@ -133,13 +136,13 @@ GamepadDevice::GamepadDevice(const GamepadConfiguration& config):
     // _pidPool(nullptr)
 {
     this->resetButtons();
+    this->setupAxisConditioners();
 }
 
 GamepadDevice::~GamepadDevice()
 {
-    if (getOutput() && _callbacks){
+    if (getOutput()){
         getOutput()->setCallbacks(nullptr);
-        delete _callbacks;
     }
 }
 
@@ -152,8 +155,7 @@ void GamepadDevice::init(NimBLEHIDDevice* hid)
     auto output = hid->getOutputReport(_config.getReportId());
 
     // Set callbacks
-    _callbacks = new GamepadCallbacks(this);
-    output->setCallbacks(_callbacks);
+    output->setCallbacks(&_callbacks);
 
     setCharacteristics(input, output);
 }
@@ -163,6 +165,135 @@ const BaseCompositeDeviceConfiguration* GamepadDevice::getDeviceConfig() const
     return &_config;
 }
 
+void GamepadDevice::restoreState()
+{
+    sendGamepadReportImp();
+}
+
+void GamepadDevice::setupAxisConditioners()
+{
+    for (uint8_t stick = 0; stick < GAMEPAD_STICK_COUNT; stick++)
+    {
+        _sticks[stick].getXConditioner().setRange(_config.getAxesMin(), _config.getAxesMax());
+        _sticks[stick].getYConditioner().setRange(_config.getAxesMin(), _config.getAxesMax());
+    }
+
+    // Triggers and sliders rest at their minimum
+    for (uint8_t axis = GAMEPAD_AXIS_RX; axis <= GAMEPAD_AXIS_SLIDER2; axis++)
+    {
+        AxisConditioner& conditioner = getAxisConditioner(axis);
+        conditioner.setRange(_config.getAxesMin(), _config.getAxesMax());
+        conditioner.setCentered(false);
+    }
+
+    for (uint8_t axis = GAMEPAD_AXIS_RUDDER; axis <= GAMEPAD_AXIS_STEERING; axis++)
+    {
+        AxisConditioner& conditioner = getAxisConditioner(axis);
+        conditioner.setRange(_config.getSimulationMin(), _config.getSimulationMax());
+        conditioner.setCentered(axis == GAMEPAD_AXIS_RUDDER || axis == GAMEPAD_AXIS_STEERING);
+    }
+}
+
+AxisConditioner& GamepadDevice::getAxisConditioner(uint8_t axis)
+{
+    if (axis >= GAMEPAD_CONDITIONED_AXIS_COUNT)
+        throw std::invalid_argument("Index out of range");
+
+    switch (axis)
+    {
+        case GAMEPAD_AXIS_X: return _sticks[GAMEPAD_LEFT_STICK].getXConditioner();
+        case GAMEPAD_AXIS_Y: return _sticks[GAMEPAD_LEFT_STICK].getYConditioner();
+        case GAMEPAD_AXIS_Z: return _sticks[GAMEPAD_RIGHT_STICK].getXConditioner();
+        case GAMEPAD_AXIS_RZ: return _sticks[GAMEPAD_RIGHT_STICK].getYConditioner();
+        default: return _axisConditioners[axis - GAMEPAD_AXIS_RX];
+    }
+}
+
+StickConditioner& GamepadDevice::getStickConditioner(uint8_t stick)
+{
+    if (stick >= GAMEPAD_STICK_COUNT)
+        throw std::invalid_argument("Index out of range");
+
+    return _sticks[stick];
+}
+
+uint32_t GamepadDevice::getAvoidedReportCount() const
+{
+    return _avoidedReports;
+}
+
+void GamepadDevice::resetAvoidedReportCount()
+{
+    _avoidedReports = 0;
+}
+
+int16_t* GamepadDevice::getAxisStorage(uint8_t axis)
+{
+    int16_t* storage[GAMEPAD_CONDITIONED_AXIS_COUNT] = {
+        &_x, &_y, &_z, &_rZ, &_rX, &_rY, &_slider1, &_slider2,
+        &_rudder, &_throttle, &_accelerator, &_brake, &_steering
+    };
+    return storage[axis];
+}
+
+// Must be called with _mutex held
+bool GamepadDevice::updateAxis(uint8_t axis, int16_t value, uint32_t nowMs)
+{
+    if (axis <= GAMEPAD_AXIS_RZ)
+    {
+        // A single stick axis still moves the pair, a radial deadzone depends on both
+        uint8_t stick = axis <= GAMEPAD_AXIS_Y ? GAMEPAD_LEFT_STICK : GAMEPAD_RIGHT_STICK;
+        int16_t* x = getAxisStorage(stick == GAMEPAD_LEFT_STICK ? GAMEPAD_AXIS_X : GAMEPAD_AXIS_Z);
+        int16_t* y = getAxisStorage(stick == GAMEPAD_LEFT_STICK ? GAMEPAD_AXIS_Y : GAMEPAD_AXIS_RZ);
+
+        if (axis == GAMEPAD_AXIS_X || axis == GAMEPAD_AXIS_Z)
+            _sticks[stick].processX(value, nowMs);
+        else
+            _sticks[stick].processY(value, nowMs);
+
+        int16_t newX = _sticks[stick].getXConditioner().getOutput();
+        int16_t newY = _sticks[stick].getYConditioner().getOutput();
+        bool changed = newX != *x || newY != *y;
+        *x = newX;
+        *y = newY;
+        return changed;
+    }
+
+    int16_t* storage = getAxisStorage(axis);
+    int16_t conditioned = _axisConditioners[axis - GAMEPAD_AXIS_RX].process(value, nowMs);
+    bool changed = conditioned != *storage;
+    *storage = conditioned;
+    return changed;
+}
+
+// Must be called with _mutex held
+bool GamepadDevice::updateStick(uint8_t stick, int16_t x, int16_t y, uint32_t nowMs)
+{
+    int16_t* storageX = getAxisStorage(stick == GAMEPAD_LEFT_STICK ? GAMEPAD_AXIS_X : GAMEPAD_AXIS_Z);
+    int16_t* storageY = getAxisStorage(stick == GAMEPAD_LEFT_STICK ? GAMEPAD_AXIS_Y : GAMEPAD_AXIS_RZ);
+
+    int32_t conditionedX = x;
+    int32_t conditionedY = y;
+    _sticks[stick].process(conditionedX, conditionedY, nowMs);
+
+    bool changed = conditionedX != *storageX || conditionedY != *storageY;
+    *storageX = conditionedX;
+    *storageY = conditionedY;
+    return changed;
+}
+
+void GamepadDevice::sendGamepadReportIfChanged(bool changed)
+{
+    if (changed)
+    {
+        sendGamepadReport();
+    }
+    else
+    {
+        _avoidedReports++;
+    }
+}
+
 void GamepadDevice::resetButtons()
 {
     std::lock_guard<std::mutex> lock(_mutex);
@@ -204,21 +335,21 @@ void GamepadDevice::setAxes(int16_t x, int16_t y, int16_t z, int16_t rZ, int16_t
         slider2 = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _x = x;
-        _y = y;
-        _z = z;
-        _rZ = rZ;
-        _rX = rX;
-        _rY = rY;
-        _slider1 = slider1;
-        _slider2 = slider2;
+        uint32_t now = millis();
+        changed |= updateStick(GAMEPAD_LEFT_STICK, x, y, now);
+        changed |= updateStick(GAMEPAD_RIGHT_STICK, z, rZ, now);
+        changed |= updateAxis(GAMEPAD_AXIS_RX, rX, now);
+        changed |= updateAxis(GAMEPAD_AXIS_RY, rY, now);
+        changed |= updateAxis(GAMEPAD_AXIS_SLIDER1, slider1, now);
+        changed |= updateAxis(GAMEPAD_AXIS_SLIDER2, slider2, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -245,18 +376,20 @@ void GamepadDevice::setSimulationControls(int16_t rudder, int16_t throttle, int1
         steering = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _rudder = rudder;
-        _throttle = throttle;
-        _accelerator = accelerator;
-        _brake = brake;
-        _steering = steering;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_RUDDER, rudder, now);
+        changed |= updateAxis(GAMEPAD_AXIS_THROTTLE, throttle, now);
+        changed |= updateAxis(GAMEPAD_AXIS_ACCELERATOR, accelerator, now);
+        changed |= updateAxis(GAMEPAD_AXIS_BRAKE, brake, now);
+        changed |= updateAxis(GAMEPAD_AXIS_STEERING, steering, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -287,15 +420,17 @@ void GamepadDevice::setSliders(int16_t slider1, int16_t slider2)
         slider2 = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _slider1 = slider1;
-        _slider2 = slider2;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_SLIDER1, slider1, now);
+        changed |= updateAxis(GAMEPAD_AXIS_SLIDER2, slider2, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -483,15 +618,16 @@ void GamepadDevice::setLeftThumb(int16_t x, int16_t y)
         y = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _x = x;
-        _y = y;
+        uint32_t now = millis();
+        changed |= updateStick(GAMEPAD_LEFT_STICK, x, y, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -506,15 +642,16 @@ void GamepadDevice::setRightThumb(int16_t z, int16_t rZ)
         rZ = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _z = z;
-        _rZ = rZ;
+        uint32_t now = millis();
+        changed |= updateStick(GAMEPAD_RIGHT_STICK, z, rZ, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -525,14 +662,16 @@ void GamepadDevice::setLeftTrigger(int16_t rX)
         rX = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _rX = rX;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_RX, rX, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -543,14 +682,16 @@ void GamepadDevice::setRightTrigger(int16_t rY)
         rY = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _rY = rY;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_RY, rY, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -565,15 +706,17 @@ void GamepadDevice::setTriggers(int16_t rX, int16_t rY)
         rY = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _rX = rX;
-        _rY = rY;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_RX, rX, now);
+        changed |= updateAxis(GAMEPAD_AXIS_RY, rY, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -650,14 +793,16 @@ void GamepadDevice::setX(int16_t x)
         x = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _x = x;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_X, x, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -668,14 +813,16 @@ void GamepadDevice::setY(int16_t y)
         y = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _y = y;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_Y, y, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -686,14 +833,16 @@ void GamepadDevice::setZ(int16_t z)
         z = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _z = z;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_Z, z, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -704,14 +853,16 @@ void GamepadDevice::setRZ(int16_t rZ)
         rZ = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _rZ = rZ;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_RZ, rZ, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -722,14 +873,16 @@ void GamepadDevice::setRX(int16_t rX)
         rX = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _rX = rX;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_RX, rX, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -740,14 +893,16 @@ void GamepadDevice::setRY(int16_t rY)
         rY = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _rY = rY;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_RY, rY, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -758,14 +913,16 @@ void GamepadDevice::setSlider(int16_t slider)
         slider = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _slider1 = slider;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_SLIDER1, slider, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -776,14 +933,16 @@ void GamepadDevice::setSlider1(int16_t slider1)
         slider1 = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _slider1 = slider1;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_SLIDER1, slider1, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -794,14 +953,16 @@ void GamepadDevice::setSlider2(int16_t slider2)
         slider2 = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _slider2 = slider2;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_SLIDER2, slider2, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -812,14 +973,16 @@ void GamepadDevice::setRudder(int16_t rudder)
         rudder = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _rudder = rudder;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_RUDDER, rudder, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -830,14 +993,16 @@ void GamepadDevice::setThrottle(int16_t throttle)
         throttle = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _throttle = throttle;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_THROTTLE, throttle, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -848,14 +1013,16 @@ void GamepadDevice::setAccelerator(int16_t accelerator)
         accelerator = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _accelerator = accelerator;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_ACCELERATOR, accelerator, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -866,14 +1033,16 @@ void GamepadDevice::setBrake(int16_t brake)
         brake = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _brake = brake;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_BRAKE, brake, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -884,14 +1053,16 @@ void GamepadDevice::setSteering(int16_t steering)
         steering = -32767;
     }
 
+    bool changed = false;
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _steering = steering;
+        uint32_t now = millis();
+        changed |= updateAxis(GAMEPAD_AXIS_STEERING, steering, now);
     }
 
     if (_config.getAutoReport())
     {
-        sendGamepadReport();
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -908,6 +1079,9 @@ bool GamepadDevice::isPressed(uint8_t b)
 
 void GamepadDevice::sendGamepadReport(bool defer)
 {
+    if(!shouldReport(getInput()))
+        return;
+
     if(defer || _config.getAutoReport()){
         queueDeferredReport(std::bind(&GamepadDevice::sendGamepadReportImp, this));
     } else {
@@ -923,11 +1097,17 @@ void GamepadDevice::sendGamepadReportImp()
     if (!input || !parentDevice)
         return;
 
-    if(!parentDevice->isConnected())
+    if(!parentDevice->isConnected()) {
+        countDroppedReport();
+        return;
+    }
+
+    // Hosts that didn't subscribe to this report never read it, skip building it
+    if(!isInputSubscribed(input))
         return;
 
     uint8_t currentReportIndex = 0;
-    uint8_t m[_config.getDeviceReportSize()];
+    uint8_t m[getInputReportSize()];
 
     {
         // Lock the device input data
@@ -1029,5 +1209,5 @@ void GamepadDevice::sendGamepadReportImp()
 
     // Notify
     input->setValue(m, sizeof(m));
-    input->notify();
+    notifyInput(input);
 }
@@ -6,6 +6,28 @@
 #include <BaseCompositeDevice.h>
 #include <Callback.h>
 #include <mutex>
+#include "AxisConditioner.h"
+
+// Axis indices used for input conditioning
+#define GAMEPAD_AXIS_X 0
+#define GAMEPAD_AXIS_Y 1
+#define GAMEPAD_AXIS_Z 2
+#define GAMEPAD_AXIS_RZ 3
+#define GAMEPAD_AXIS_RX 4
+#define GAMEPAD_AXIS_RY 5
+#define GAMEPAD_AXIS_SLIDER1 6
+#define GAMEPAD_AXIS_SLIDER2 7
+#define GAMEPAD_AXIS_RUDDER 8
+#define GAMEPAD_AXIS_THROTTLE 9
+#define GAMEPAD_AXIS_ACCELERATOR 10
+#define GAMEPAD_AXIS_BRAKE 11
+#define GAMEPAD_AXIS_STEERING 12
+#define GAMEPAD_CONDITIONED_AXIS_COUNT 13
+
+// The stick axes are conditioned in pairs so they can use a radial deadzone
+#define GAMEPAD_LEFT_STICK 0     // X and Y
+#define GAMEPAD_RIGHT_STICK 1    // Z and rZ
+#define GAMEPAD_STICK_COUNT 2
 
 // Forwards
 class GamepadDevice;
@@ -53,7 +75,12 @@ private:
     int16_t _hat3;
     int16_t _hat4;
 
-    GamepadCallbacks* _callbacks;
+    // Input conditioning
+    StickConditioner _sticks[GAMEPAD_STICK_COUNT];
+    AxisConditioner _axisConditioners[GAMEPAD_CONDITIONED_AXIS_COUNT - GAMEPAD_AXIS_RX];
+    uint32_t _avoidedReports;
+
+    GamepadCallbacks _callbacks;
 
 public:
     GamepadDevice();
@@ -62,6 +89,7 @@ public:
 
     void init(NimBLEHIDDevice* hid) override;
     const BaseCompositeDeviceConfiguration* getDeviceConfig() const override;
+    void restoreState() override;
 
     void setAxes(int16_t x = 0, int16_t y = 0, int16_t z = 0, int16_t rZ = 0, int16_t rX = 0, int16_t rY = 0, int16_t slider1 = 0, int16_t slider2 = 0);
     void press(uint8_t b = BUTTON_1);   // press BUTTON_1 by default
@@ -118,11 +146,23 @@ public:
 
     void sendGamepadReport(bool defer = false);
 
+    // Input conditioning, axis setters only send a report when the conditioned value changes
+    AxisConditioner& getAxisConditioner(uint8_t axis);
+    StickConditioner& getStickConditioner(uint8_t stick);
+    uint32_t getAvoidedReportCount() const;
+    void resetAvoidedReportCount();
+
     // callbacks
     Signal<uint8_t> onPlayerIndicatorChanged;
 
 private:
     void sendGamepadReportImp();
+    void sendGamepadReportIfChanged(bool changed);
+
+    void setupAxisConditioners();
+    int16_t* getAxisStorage(uint8_t axis);
+    bool updateAxis(uint8_t axis, int16_t value, uint32_t nowMs);
+    bool updateStick(uint8_t stick, int16_t x, int16_t y, uint32_t nowMs);
 
 
     // Output properties
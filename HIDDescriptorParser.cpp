@@ -0,0 +1,243 @@
+#include "HIDDescriptorParser.h"
+#include <string.h>
+
+// Item prefixes, see section 6.2.2 of the HID 1.11 specification
+#define HID_ITEM_LONG_PREFIX 0xFE
+
+#define HID_ITEM_TYPE_MAIN 0
+#define HID_ITEM_TYPE_GLOBAL 1
+
+#define HID_MAIN_INPUT 0x8
+#define HID_MAIN_OUTPUT 0x9
+#define HID_MAIN_COLLECTION 0xA
+#define HID_MAIN_FEATURE 0xB
+#define HID_MAIN_END_COLLECTION 0xC
+
+#define HID_GLOBAL_REPORT_SIZE 0x7
+#define HID_GLOBAL_REPORT_ID 0x8
+#define HID_GLOBAL_REPORT_COUNT 0x9
+#define HID_GLOBAL_PUSH 0xA
+#define HID_GLOBAL_POP 0xB
+
+HIDDescriptorParser::HIDDescriptorParser()
+{
+    reset();
+}
+
+void HIDDescriptorParser::reset()
+{
+    memset(_reports, 0, sizeof(_reports));
+    _reportCount = 0;
+    _error = HID_PARSE_OK;
+    _errorOwner = 0;
+    _errorOffset = 0;
+    _errorReportId = 0;
+}
+
+uint8_t HIDDescriptorParser::parse(const uint8_t* descriptor, size_t size, uint8_t owner)
+{
+    GlobalState state = {};
+    GlobalState stack[HID_PARSER_STACK_DEPTH];
+    uint8_t stackDepth = 0;
+    uint16_t collectionDepth = 0;
+    uint8_t partError = HID_PARSE_OK;
+
+    size_t offset = 0;
+    while (offset < size)
+    {
+        uint8_t prefix = descriptor[offset];
+
+        // Long items carry no report layout, skip over them
+        if (prefix == HID_ITEM_LONG_PREFIX)
+        {
+            if (offset + 2 >= size || offset + 3 + descriptor[offset + 1] > size)
+                return fail(HID_PARSE_TRUNCATED_ITEM, owner, offset);
+
+            offset += 3 + descriptor[offset + 1];
+            continue;
+        }
+
+        uint8_t dataSize = prefix & 0x03;
+        if (dataSize == 3)
+            dataSize = 4;
+        uint8_t type = (prefix >> 2) & 0x03;
+        uint8_t tag = prefix >> 4;
+
+        if (offset + 1 + dataSize > size)
+            return fail(HID_PARSE_TRUNCATED_ITEM, owner, offset);
+
+        // Data is little endian
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < dataSize; i++)
+        {
+            value |= (uint32_t)descriptor[offset + 1 + i] << (8 * i);
+        }
+
+        if (type == HID_ITEM_TYPE_MAIN)
+        {
+            if (tag == HID_MAIN_INPUT || tag == HID_MAIN_OUTPUT || tag == HID_MAIN_FEATURE)
+            {
+                uint8_t reportType = tag == HID_MAIN_INPUT ? HID_REPORT_TYPE_INPUT :
+                    (tag == HID_MAIN_OUTPUT ? HID_REPORT_TYPE_OUTPUT : HID_REPORT_TYPE_FEATURE);
+
+                uint8_t error = HID_PARSE_OK;
+                HIDReportInfo* report = findOrAddReport(state.reportId, owner, error);
+                if (report)
+                {
+                    report->bits[reportType] += state.reportSize * state.reportCount;
+                    if (report->getSize(reportType) > HID_REPORT_MAX_SIZE)
+                        error = HID_PARSE_REPORT_TOO_LARGE;
+                }
+
+                if (error != HID_PARSE_OK)
+                {
+                    fail(error, owner, offset, state.reportId);
+                    if (partError == HID_PARSE_OK)
+                        partError = error;
+                }
+            }
+            else if (tag == HID_MAIN_COLLECTION)
+            {
+                collectionDepth++;
+            }
+            else if (tag == HID_MAIN_END_COLLECTION)
+            {
+                if (collectionDepth == 0)
+                    return fail(HID_PARSE_UNBALANCED_COLLECTION, owner, offset);
+                collectionDepth--;
+            }
+        }
+        else if (type == HID_ITEM_TYPE_GLOBAL)
+        {
+            switch (tag)
+            {
+            case HID_GLOBAL_REPORT_SIZE:
+                state.reportSize = value;
+                break;
+            case HID_GLOBAL_REPORT_COUNT:
+                state.reportCount = value;
+                break;
+            case HID_GLOBAL_REPORT_ID:
+                if (value == 0 || value > 0xFF)
+                {
+                    fail(HID_PARSE_INVALID_REPORT_ID, owner, offset);
+                    if (partError == HID_PARSE_OK)
+                        partError = HID_PARSE_INVALID_REPORT_ID;
+                }
+                state.reportId = (uint8_t)value;
+                break;
+            case HID_GLOBAL_PUSH:
+                if (stackDepth >= HID_PARSER_STACK_DEPTH)
+                    return fail(HID_PARSE_STACK_ERROR, owner, offset);
+                stack[stackDepth++] = state;
+                break;
+            case HID_GLOBAL_POP:
+                if (stackDepth == 0)
+                    return fail(HID_PARSE_STACK_ERROR, owner, offset);
+                state = stack[--stackDepth];
+                break;
+            }
+        }
+
+        // Local items only name usages, they don't change the layout
+        offset += 1 + dataSize;
+    }
+
+    if (collectionDepth != 0)
+        return fail(HID_PARSE_UNBALANCED_COLLECTION, owner, size);
+
+    return partError;
+}
+
+uint8_t HIDDescriptorParser::fail(uint8_t error, uint8_t owner, size_t offset, uint8_t reportId)
+{
+    // Only the first error is kept, later ones are often caused by it
+    if (_error == HID_PARSE_OK)
+    {
+        _error = error;
+        _errorOwner = owner;
+        _errorOffset = offset;
+        _errorReportId = reportId;
+    }
+    return error;
+}
+
+HIDReportInfo* HIDDescriptorParser::findOrAddReport(uint8_t reportId, uint8_t owner, uint8_t& error)
+{
+    for (uint8_t i = 0; i < _reportCount; i++)
+    {
+        HIDReportInfo& report = _reports[i];
+        if (report.reportId == reportId)
+        {
+            if (report.owner != owner)
+            {
+                error = HID_PARSE_REPORT_ID_COLLISION;
+                return nullptr;
+            }
+            return &report;
+        }
+
+        // A map either prefixes every report with an ID or none of them
+        if ((report.reportId == 0) != (reportId == 0))
+        {
+            error = HID_PARSE_INVALID_REPORT_ID;
+            return nullptr;
+        }
+    }
+
+    if (_reportCount >= HID_PARSER_MAX_REPORTS)
+    {
+        error = HID_PARSE_TOO_MANY_REPORTS;
+        return nullptr;
+    }
+
+    HIDReportInfo& report = _reports[_reportCount++];
+    memset(&report, 0, sizeof(report));
+    report.reportId = reportId;
+    report.owner = owner;
+    return &report;
+}
+
+uint8_t HIDDescriptorParser::getError() const { return _error; }
+uint8_t HIDDescriptorParser::getErrorOwner() const { return _errorOwner; }
+size_t HIDDescriptorParser::getErrorOffset() const { return _errorOffset; }
+uint8_t HIDDescriptorParser::getErrorReportId() const { return _errorReportId; }
+
+uint8_t HIDDescriptorParser::getReportCount() const { return _reportCount; }
+
+const HIDReportInfo* HIDDescriptorParser::getReport(uint8_t index) const
+{
+    return index < _reportCount ? &_reports[index] : nullptr;
+}
+
+const HIDReportInfo* HIDDescriptorParser::findReport(uint8_t reportId) const
+{
+    for (uint8_t i = 0; i < _reportCount; i++)
+    {
+        if (_reports[i].reportId == reportId)
+            return &_reports[i];
+    }
+    return nullptr;
+}
+
+uint16_t HIDDescriptorParser::getReportSize(uint8_t reportId, uint8_t type) const
+{
+    const HIDReportInfo* report = findReport(reportId);
+    return report ? report->getSize(type) : 0;
+}
+
+const char* HIDDescriptorParser::getErrorName(uint8_t error)
+{
+    switch (error)
+    {
+    case HID_PARSE_OK: return "ok";
+    case HID_PARSE_TRUNCATED_ITEM: return "truncated item";
+    case HID_PARSE_UNBALANCED_COLLECTION: return "unbalanced collection";
+    case HID_PARSE_STACK_ERROR: return "push/pop mismatch";
+    case HID_PARSE_INVALID_REPORT_ID: return "invalid report ID";
+    case HID_PARSE_TOO_MANY_REPORTS: return "too many reports";
+    case HID_PARSE_REPORT_ID_COLLISION: return "report ID collision";
+    case HID_PARSE_REPORT_TOO_LARGE: return "report too large";
+    default: return "unknown";
+    }
+}
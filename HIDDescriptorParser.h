@@ -0,0 +1,85 @@
+#ifndef HID_DESCRIPTOR_PARSER_H
+#define HID_DESCRIPTOR_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HID_PARSER_MAX_REPORTS 32
+#define HID_PARSER_STACK_DEPTH 4
+
+#define HID_REPORT_TYPE_INPUT 0
+#define HID_REPORT_TYPE_OUTPUT 1
+#define HID_REPORT_TYPE_FEATURE 2
+#define HID_REPORT_TYPE_COUNT 3
+
+// Largest report a single GATT attribute can hold
+#define HID_REPORT_MAX_SIZE 512
+
+#define HID_PARSE_OK 0
+#define HID_PARSE_TRUNCATED_ITEM 1          // An item runs past the end of the descriptor
+#define HID_PARSE_UNBALANCED_COLLECTION 2   // End Collection without a Collection, or a Collection left open
+#define HID_PARSE_STACK_ERROR 3             // Push nested too deep, or Pop without Push
+#define HID_PARSE_INVALID_REPORT_ID 4       // Report ID 0, or reports with and without IDs in the same map
+#define HID_PARSE_TOO_MANY_REPORTS 5
+#define HID_PARSE_REPORT_ID_COLLISION 6     // Two parts of the map declare the same report ID
+#define HID_PARSE_REPORT_TOO_LARGE 7
+
+// Sizes of one report ID as declared by the descriptor
+struct HIDReportInfo {
+    uint8_t reportId;
+    uint8_t owner;                              // Part of the map that declared the report
+    uint32_t bits[HID_REPORT_TYPE_COUNT];       // Indexed by HID_REPORT_TYPE_*
+
+    // Bytes of the report without the report ID prefix, 0 if the report has no such type
+    uint16_t getSize(uint8_t type) const { return type < HID_REPORT_TYPE_COUNT ? (bits[type] + 7) / 8 : 0; }
+};
+
+// Walks the items of a HID report descriptor and works out how large every report is.
+// A composite report map is parsed one device part at a time, each with its own owner,
+// so a report ID declared by two devices is reported instead of silently merged.
+// Uses no heap, the results live in a fixed table of HID_PARSER_MAX_REPORTS entries.
+class HIDDescriptorParser
+{
+public:
+    HIDDescriptorParser();
+
+    void reset();
+
+    // Parses one part of a report map and adds its reports to the table.
+    // Returns the first error in this part, HID_PARSE_OK if there is none.
+    uint8_t parse(const uint8_t* descriptor, size_t size, uint8_t owner = 0);
+
+    // First error of everything parsed since the last reset
+    uint8_t getError() const;
+    uint8_t getErrorOwner() const;
+    size_t getErrorOffset() const;          // Offset of the offending item within its part
+    uint8_t getErrorReportId() const;       // For collisions, the report ID both parts declare
+
+    uint8_t getReportCount() const;
+    const HIDReportInfo* getReport(uint8_t index) const;
+    const HIDReportInfo* findReport(uint8_t reportId) const;
+    // Bytes of the report without the report ID prefix, 0 if it isn't declared
+    uint16_t getReportSize(uint8_t reportId, uint8_t type) const;
+
+    static const char* getErrorName(uint8_t error);
+
+private:
+    struct GlobalState {
+        uint32_t reportSize;
+        uint32_t reportCount;
+        uint8_t reportId;
+    };
+
+    uint8_t fail(uint8_t error, uint8_t owner, size_t offset, uint8_t reportId = 0);
+    HIDReportInfo* findOrAddReport(uint8_t reportId, uint8_t owner, uint8_t& error);
+
+    HIDReportInfo _reports[HID_PARSER_MAX_REPORTS];
+    uint8_t _reportCount;
+
+    uint8_t _error;
+    uint8_t _errorOwner;
+    size_t _errorOffset;
+    uint8_t _errorReportId;
+};
+
+#endif // HID_DESCRIPTOR_PARSER_H
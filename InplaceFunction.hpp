@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move-only stand-in for std::function<void()> that always keeps the callable inside the object.
+// A callable larger than Capacity fails to compile instead of falling back to the heap.
+template<size_t Capacity>
+class InplaceFunction
+{
+public:
+    InplaceFunction() : _invoke(nullptr), _manage(nullptr) {}
+
+    template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, InplaceFunction>::value>::type>
+    InplaceFunction(F&& func) :
+        _invoke(&invoke<typename std::decay<F>::type>),
+        _manage(&manage<typename std::decay<F>::type>)
+    {
+        typedef typename std::decay<F>::type Callable;
+        static_assert(sizeof(Callable) <= Capacity, "Callable does not fit, raise the InplaceFunction capacity");
+        static_assert(alignof(Callable) <= alignof(Storage), "Callable needs a stricter alignment than InplaceFunction offers");
+        new (&_storage) Callable(std::forward<F>(func));
+    }
+
+    InplaceFunction(InplaceFunction&& other) : _invoke(nullptr), _manage(nullptr)
+    {
+        take(other);
+    }
+
+    InplaceFunction& operator=(InplaceFunction&& other)
+    {
+        if (this != &other)
+        {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction&) = delete;
+    InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+    ~InplaceFunction()
+    {
+        reset();
+    }
+
+    void operator()()
+    {
+        _invoke(&_storage);
+    }
+
+    explicit operator bool() const
+    {
+        return _invoke != nullptr;
+    }
+
+    void reset()
+    {
+        if (_manage)
+        {
+            _manage(&_storage, nullptr);
+            _invoke = nullptr;
+            _manage = nullptr;
+        }
+    }
+
+private:
+    typedef typename std::aligned_storage<Capacity, alignof(max_align_t)>::type Storage;
+
+    template<class Callable>
+    static void invoke(void* storage)
+    {
+        (*static_cast<Callable*>(storage))();
+    }
+
+    // Moves the callable from source into destination, or destroys destination when source is null
+    template<class Callable>
+    static void manage(void* destination, void* source)
+    {
+        if (source)
+            new (destination) Callable(std::move(*static_cast<Callable*>(source)));
+        else
+            static_cast<Callable*>(destination)->~Callable();
+    }
+
+    void take(InplaceFunction& other)
+    {
+        if (!other._manage)
+            return;
+
+        other._manage(&_storage, &other._storage);
+        _invoke = other._invoke;
+        _manage = other._manage;
+        other.reset();
+    }
+
+    Storage _storage;
+    void (*_invoke)(void*);
+    void (*_manage)(void*, void*);
+};
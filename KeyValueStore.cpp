@@ -0,0 +1,90 @@
+#include "KeyValueStore.h"
+#include <stdio.h>
+
+#if defined(ESP_PLATFORM)
+#include "nvs.h"
+
+NvsKeyValueStore::NvsKeyValueStore(const char* nameSpace) :
+    _nameSpace(nameSpace)
+{
+}
+
+size_t NvsKeyValueStore::read(const char* key, uint8_t* buffer, size_t bufferSize)
+{
+    nvs_handle_t handle;
+    if (nvs_open(_nameSpace.c_str(), NVS_READONLY, &handle) != ESP_OK)
+        return 0;
+
+    size_t size = bufferSize;
+    esp_err_t result = nvs_get_blob(handle, key, buffer, &size);
+    nvs_close(handle);
+
+    return result == ESP_OK ? size : 0;
+}
+
+bool NvsKeyValueStore::write(const char* key, const uint8_t* data, size_t size)
+{
+    nvs_handle_t handle;
+    if (nvs_open(_nameSpace.c_str(), NVS_READWRITE, &handle) != ESP_OK)
+        return false;
+
+    bool success = nvs_set_blob(handle, key, data, size) == ESP_OK && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+
+    return success;
+}
+
+bool NvsKeyValueStore::erase(const char* key)
+{
+    nvs_handle_t handle;
+    if (nvs_open(_nameSpace.c_str(), NVS_READWRITE, &handle) != ESP_OK)
+        return false;
+
+    bool success = nvs_erase_key(handle, key) == ESP_OK && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+
+    return success;
+}
+#endif
+
+FileKeyValueStore::FileKeyValueStore(const char* directory) :
+    _directory(directory)
+{
+}
+
+std::string FileKeyValueStore::getPath(const char* key) const
+{
+    return _directory + "/" + key;
+}
+
+size_t FileKeyValueStore::read(const char* key, uint8_t* buffer, size_t bufferSize)
+{
+    FILE* file = fopen(getPath(key).c_str(), "rb");
+    if (!file)
+        return 0;
+
+    size_t size = fread(buffer, 1, bufferSize, file);
+
+    // A value that fills the whole buffer may have been truncated
+    bool truncated = size == bufferSize && fgetc(file) != EOF;
+    fclose(file);
+
+    return truncated ? 0 : size;
+}
+
+bool FileKeyValueStore::write(const char* key, const uint8_t* data, size_t size)
+{
+    FILE* file = fopen(getPath(key).c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool success = fwrite(data, 1, size, file) == size;
+    success = (fclose(file) == 0) && success;
+
+    return success;
+}
+
+bool FileKeyValueStore::erase(const char* key)
+{
+    return remove(getPath(key).c_str()) == 0;
+}
@@ -0,0 +1,54 @@
+#ifndef KEY_VALUE_STORE_H
+#define KEY_VALUE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Small persistent blob storage used to cache data between boots.
+// Keys are short identifiers (NVS limits them to 15 characters).
+class KeyValueStore
+{
+public:
+    virtual ~KeyValueStore() {}
+
+    // Copies the stored value into buffer and returns its size.
+    // Returns 0 if the key does not exist or the value does not fit into bufferSize.
+    virtual size_t read(const char* key, uint8_t* buffer, size_t bufferSize) = 0;
+    virtual bool write(const char* key, const uint8_t* data, size_t size) = 0;
+    virtual bool erase(const char* key) = 0;
+};
+
+#if defined(ESP_PLATFORM)
+// Stores values as blobs in an NVS namespace. NVS must already be initialised, which NimBLEDevice::init() takes care of.
+class NvsKeyValueStore : public KeyValueStore
+{
+public:
+    NvsKeyValueStore(const char* nameSpace = "compositehid");
+
+    size_t read(const char* key, uint8_t* buffer, size_t bufferSize) override;
+    bool write(const char* key, const uint8_t* data, size_t size) override;
+    bool erase(const char* key) override;
+
+private:
+    std::string _nameSpace;
+};
+#endif
+
+// Stores every value in its own file inside directory, for filesystems mounted through the VFS or host builds
+class FileKeyValueStore : public KeyValueStore
+{
+public:
+    FileKeyValueStore(const char* directory);
+
+    size_t read(const char* key, uint8_t* buffer, size_t bufferSize) override;
+    bool write(const char* key, const uint8_t* data, size_t size) override;
+    bool erase(const char* key) override;
+
+private:
+    std::string getPath(const char* key) const;
+
+    std::string _directory;
+};
+
+#endif // KEY_VALUE_STORE_H
@@ -17,13 +17,25 @@ KeyboardConfiguration::KeyboardConfiguration(uint8_t reportId) :
 
 uint8_t KeyboardConfiguration::getDeviceReportSize() const
 {
-    return sizeof(_keyboardHIDReportDescriptor);
+    return sizeof(KeyboardInputReport);
+}
+
+uint32_t KeyboardConfiguration::getConfigHash() const
+{
+    uint32_t hash = getBaseConfigHash();
+    hash = hashConfigBytes(hash, &_useMediaKeys, sizeof(_useMediaKeys));
+    return hash;
+}
+
+size_t KeyboardConfiguration::getDeviceReportDescriptorSize() const
+{
+    return sizeof(_keyboardHIDReportDescriptor) + (_useMediaKeys ? sizeof(_mediakeysHIDReportDescriptor) : 0);
 }
 
 size_t KeyboardConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize) const
 {
     size_t hidDescriptorSize = sizeof(_keyboardHIDReportDescriptor);
-    if(hidDescriptorSize < bufferSize){
+    if(hidDescriptorSize <= bufferSize){
         memcpy(buffer, _keyboardHIDReportDescriptor, hidDescriptorSize);
     } else {
         return -1;
@@ -31,7 +43,7 @@ size_t KeyboardConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSiz
 
     if(_useMediaKeys){
         size_t mediaKeysHidDescriptorSize = sizeof(_mediakeysHIDReportDescriptor);
-        if(hidDescriptorSize + mediaKeysHidDescriptorSize < bufferSize){
+        if(hidDescriptorSize + mediaKeysHidDescriptorSize <= bufferSize){
             memcpy(buffer + hidDescriptorSize, _mediakeysHIDReportDescriptor, mediaKeysHidDescriptorSize);
             hidDescriptorSize += mediaKeysHidDescriptorSize;
         } else {
@@ -9,7 +9,9 @@ public:
     KeyboardConfiguration();
     KeyboardConfiguration(uint8_t reportId);
     uint8_t getDeviceReportSize() const override;
+    uint32_t getConfigHash() const override;
     size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override;
+    size_t getDeviceReportDescriptorSize() const override;
 
     bool getUseMediaKeys() const;
     void setUseMediaKeys(bool value);
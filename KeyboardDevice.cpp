@@ -39,7 +39,7 @@ KeyboardDevice::KeyboardDevice() :
     _input(),
     _output(),
     _inputReport(),
-    _callbacks(nullptr)
+    _callbacks(this)
 {
     resetKeys();
 }
@@ -49,17 +49,15 @@ KeyboardDevice::KeyboardDevice(const KeyboardConfiguration& config) :
     _input(),
     _output(),
     _inputReport(),
-    _callbacks(nullptr)
+    _callbacks(this)
 {
     resetKeys();
 }
 
 KeyboardDevice::~KeyboardDevice()
 {
-    if (getOutput() && _callbacks){
+    if (getOutput()){
         getOutput()->setCallbacks(nullptr);
-        delete _callbacks;
-        _callbacks = nullptr;
     }
 }
 
@@ -68,10 +66,10 @@ void KeyboardDevice::init(NimBLEHIDDevice* hid)
     _input = hid->getInputReport(_config.getReportId());
     _mediaInput = hid->getInputReport(MEDIA_KEYS_REPORT_ID);
     _output = hid->getOutputReport(_config.getReportId());
-    _callbacks = new KeyboardCallbacks(this);
-    _output->setCallbacks(_callbacks);
+    _output->setCallbacks(&_callbacks);
 
     setCharacteristics(_input, _output);
+    registerInput(_mediaInput, MEDIA_KEYS_REPORT_ID);
 }
 
 const BaseCompositeDeviceConfiguration* KeyboardDevice::getDeviceConfig() const
@@ -79,6 +77,26 @@ const BaseCompositeDeviceConfiguration* KeyboardDevice::getDeviceConfig() const
     return &_config;
 }
 
+void KeyboardDevice::restoreState()
+{
+    sendKeyReportImpl();
+
+    if (_config.getUseMediaKeys())
+    {
+        sendMediaKeyReportImpl();
+    }
+}
+
+uint8_t KeyboardDevice::getCharacteristics(NimBLECharacteristic** characteristics, uint8_t maxCount)
+{
+    uint8_t count = BaseCompositeDevice::getCharacteristics(characteristics, maxCount);
+    if (_mediaInput && count < maxCount)
+    {
+        characteristics[count++] = _mediaInput;
+    }
+    return count;
+}
+
 void KeyboardDevice::resetKeys()
 {
     std::lock_guard<std::mutex> lock(_mutex);
@@ -188,6 +206,9 @@ void KeyboardDevice::keyRelease(uint8_t keyCode)
 
 void KeyboardDevice::sendKeyReport(bool defer)
 {
+    if(!shouldReport(getInput()))
+        return;
+
     if(defer || _config.getAutoDefer()){
         queueDeferredReport(std::bind(&KeyboardDevice::sendKeyReportImpl, this));
     } else {
@@ -203,11 +224,17 @@ void KeyboardDevice::sendKeyReportImpl()
     if (!input || !parentDevice)
         return;
 
-    if(!parentDevice->isConnected())
+    if(!parentDevice->isConnected()) {
+        countDroppedReport();
+        return;
+    }
+
+    // Hosts that didn't subscribe to this report never read it, skip building it
+    if(!isInputSubscribed(input))
         return;
 
     uint8_t currentReportIndex = 0;
-    uint8_t m[_config.getDeviceReportSize()];
+    uint8_t m[getInputReportSize()];
     memset(&m, 0, sizeof(m));
 
     // Copy key input report into buffer
@@ -216,11 +243,14 @@ void KeyboardDevice::sendKeyReportImpl()
         memcpy(&m[currentReportIndex], &_inputReport, sizeof(_inputReport));
         input->setValue((uint8_t*)&_inputReport, sizeof(_inputReport));
     }
-    input->notify();
+    notifyInput(input);
 }
 
 void KeyboardDevice::sendMediaKeyReport(bool defer)
 {
+    if(!shouldReport(_mediaInput))
+        return;
+
     if(defer || _config.getAutoDefer()){
         queueDeferredReport(std::bind(&KeyboardDevice::sendMediaKeyReportImpl, this));
     } else {
@@ -237,7 +267,13 @@ void KeyboardDevice::sendMediaKeyReportImpl()
     if (!input || !parentDevice)
         return;
 
-    if(!parentDevice->isConnected())
+    if(!parentDevice->isConnected()) {
+        countDroppedReport();
+        return;
+    }
+
+    // Hosts that didn't subscribe to this report never read it, skip building it
+    if(!isInputSubscribed(_mediaInput))
         return;
 
     uint8_t m[3];
@@ -252,5 +288,5 @@ void KeyboardDevice::sendMediaKeyReportImpl()
 
         _mediaInput->setValue((uint8_t*)&m, sizeof(m));
     }
-    _mediaInput->notify();
+    notifyInput(_mediaInput);
 }
\ No newline at end of file
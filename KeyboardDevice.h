@@ -60,7 +60,7 @@ private:
 
     KeyboardInputReport _inputReport;
     KeyboardMediaInputReport _mediaKeyInputReport;
-    KeyboardCallbacks* _callbacks;
+    KeyboardCallbacks _callbacks;
 
 public:
     KeyboardDevice();
@@ -69,6 +69,8 @@ public:
     
     void init(NimBLEHIDDevice* hid) override;
     const BaseCompositeDeviceConfiguration* getDeviceConfig() const override;
+    void restoreState() override;
+    uint8_t getCharacteristics(NimBLECharacteristic** characteristics, uint8_t maxCount) override;
 
     void resetKeys();
 
@@ -3,8 +3,11 @@
 
 MouseConfiguration::MouseConfiguration() : 
     BaseCompositeDeviceConfiguration(MOUSE_REPORT_ID),
+    _whichAxes{true, true, true, true},
+    _axisBits{MOUSE_AXIS_8_BIT, MOUSE_AXIS_8_BIT, MOUSE_AXIS_8_BIT, MOUSE_AXIS_8_BIT},
     _mouseButtonCount(5),
-    _whichAxes{true, true, false, false, false, false, true, true}
+    _highResolutionScrolling(false),
+    _scrollResolutionMultiplier(MOUSE_DEFAULT_SCROLL_RESOLUTION_MULTIPLIER)
 {               
 }
 
@@ -17,149 +20,290 @@ uint8_t MouseConfiguration::getDeviceReportSize() const
     // TODO: Make number of mouse buttons dynamic
     uint8_t numOfMouseButtonBytes = this->getMouseButtonNumBytes(); // 5 buttons @ 1 bit each means we need 3 bits of padding to pad to a byte
 
-    // TODO: Make number of mouse axis' dynamic? 
-    uint8_t numOfMouseAxisBytes = this->getMouseAxisCount(); //X, Y, Wheel, Horiz wheel;
+    uint8_t numOfMouseAxisBytes = 0; //X, Y, Wheel, Horiz wheel
+    for (uint8_t axis = 0; axis < MOUSE_POSSIBLE_AXIS_COUNT; axis++)
+    {
+        if (_whichAxes[axis])
+        {
+            numOfMouseAxisBytes += this->getAxisNumBytes(axis);
+        }
+    }
 
     // Mouse report size (bytes)
     uint8_t mouseReportSize = numOfMouseButtonBytes + numOfMouseAxisBytes;
     return mouseReportSize;
 }
 
+uint32_t MouseConfiguration::getConfigHash() const
+{
+    uint32_t hash = getBaseConfigHash();
+    hash = hashConfigBytes(hash, &_mouseButtonCount, sizeof(_mouseButtonCount));
+    hash = hashConfigBytes(hash, _whichAxes, sizeof(_whichAxes));
+    hash = hashConfigBytes(hash, _axisBits, sizeof(_axisBits));
+    hash = hashConfigBytes(hash, &_highResolutionScrolling, sizeof(_highResolutionScrolling));
+    hash = hashConfigBytes(hash, &_scrollResolutionMultiplier, sizeof(_scrollResolutionMultiplier));
+    return hash;
+}
+
+size_t MouseConfiguration::getDeviceReportDescriptorSize() const
+{
+    // The DescriptorWriter in makeDeviceReport only counts when there is no buffer
+    return makeDeviceReport(nullptr, 0);
+}
+
 size_t MouseConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize) const
 {
-    uint8_t tempHidReportDescriptor[150];
+    DescriptorWriter descriptor(buffer, bufferSize);
     int hidReportDescriptorSize = 0;
 
     // Mouse setup
-    tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);       
-    tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01; //Generic Desktop
+    descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);       
+    descriptor[hidReportDescriptorSize++] = 0x01; //Generic Desktop
 
-    tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE(1); 
-    tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02; //Mouse
+    descriptor[hidReportDescriptorSize++] = USAGE(1); 
+    descriptor[hidReportDescriptorSize++] = 0x02; //Mouse
 
-    tempHidReportDescriptor[hidReportDescriptorSize++] = COLLECTION(1);
-    tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01; //Application
+    descriptor[hidReportDescriptorSize++] = COLLECTION(1);
+    descriptor[hidReportDescriptorSize++] = 0x01; //Application
 
-    tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE(1);
-    tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01; //Pointer
+    descriptor[hidReportDescriptorSize++] = USAGE(1);
+    descriptor[hidReportDescriptorSize++] = 0x01; //Pointer
 
-    tempHidReportDescriptor[hidReportDescriptorSize++] = COLLECTION(1);
-    tempHidReportDescriptor[hidReportDescriptorSize++] = 0x0; //Physical
+    descriptor[hidReportDescriptorSize++] = COLLECTION(1);
+    descriptor[hidReportDescriptorSize++] = 0x0; //Physical
 
-    tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_ID(1);
-    tempHidReportDescriptor[hidReportDescriptorSize++] = this->getReportId(); //Mouse report ID
+    descriptor[hidReportDescriptorSize++] = REPORT_ID(1);
+    descriptor[hidReportDescriptorSize++] = this->getReportId(); //Mouse report ID
     
     // Buttons (Left, Right, Middle, Back, Forward)
     if (this->getMouseButtonCount() > 0)
     {
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09; //USAGE_PAGE (Button)
+        descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
+        descriptor[hidReportDescriptorSize++] = 0x09; //USAGE_PAGE (Button)
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE_MINIMUM(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01; //Button 1
+        descriptor[hidReportDescriptorSize++] = USAGE_MINIMUM(1);
+        descriptor[hidReportDescriptorSize++] = 0x01; //Button 1
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE_MAXIMUM(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = this->getMouseButtonCount();
+        descriptor[hidReportDescriptorSize++] = USAGE_MAXIMUM(1);
+        descriptor[hidReportDescriptorSize++] = this->getMouseButtonCount();
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = LOGICAL_MINIMUM(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+        descriptor[hidReportDescriptorSize++] = LOGICAL_MINIMUM(1);
+        descriptor[hidReportDescriptorSize++] = 0x00;
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+        descriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(1);
+        descriptor[hidReportDescriptorSize++] = 0x01;
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+        descriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
+        descriptor[hidReportDescriptorSize++] = 0x01;
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = this->getMouseButtonCount();
+        descriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
+        descriptor[hidReportDescriptorSize++] = this->getMouseButtonCount();
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = HIDINPUT(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02; //INPUT (Data, Variable, Absolute) ;5 button bits
+        descriptor[hidReportDescriptorSize++] = HIDINPUT(1);
+        descriptor[hidReportDescriptorSize++] = 0x02; //INPUT (Data, Variable, Absolute) ;5 button bits
         
         uint8_t mouseButtonPaddingBits = getMouseButtonPaddingBits();
         if (mouseButtonPaddingBits > 0)
         {
             // 5 buttons @ 1 bit each means we need 3 bits of padding to pad to a byte
             // The number of reports matches the number of bits needed to pad out to a byte
-            tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
-            tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+            descriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
+            descriptor[hidReportDescriptorSize++] = 0x01;
 
-            tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
-            tempHidReportDescriptor[hidReportDescriptorSize++] = mouseButtonPaddingBits;
+            descriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
+            descriptor[hidReportDescriptorSize++] = mouseButtonPaddingBits;
 
-            tempHidReportDescriptor[hidReportDescriptorSize++] = HIDINPUT(1);
-            tempHidReportDescriptor[hidReportDescriptorSize++] = 0x03; //INPUT (Constant, Variable, Absolute)
+            descriptor[hidReportDescriptorSize++] = HIDINPUT(1);
+            descriptor[hidReportDescriptorSize++] = 0x03; //INPUT (Constant, Variable, Absolute)
         }
     }
 
-    if (this->getMouseAxisCount() > 0)
+    // X/Y position, Wheel
+    if (this->getIncludeXAxis() || this->getIncludeYAxis() || this->getIncludeWheel())
     {
-        // X/Y position, Wheel
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01; //Generic Desktop
-
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x30; // X coordinate
+        descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
+        descriptor[hidReportDescriptorSize++] = 0x01; //Generic Desktop
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x031; // Y coordinate
+        hidReportDescriptorSize = appendAxisItems(descriptor, hidReportDescriptorSize, MOUSE_X_AXIS);
+        hidReportDescriptorSize = appendAxisItems(descriptor, hidReportDescriptorSize, MOUSE_Y_AXIS);
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x38; // Wheel
+        if (this->getIncludeWheel() && this->getHighResolutionScrolling())
+        {
+            // The multiplier only applies to the usages inside its logical collection
+            descriptor[hidReportDescriptorSize++] = COLLECTION(1);
+            descriptor[hidReportDescriptorSize++] = 0x02; //Logical
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = LOGICAL_MINIMUM(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81; // Logical Min (-127)
+            hidReportDescriptorSize = appendResolutionMultiplierItems(descriptor, hidReportDescriptorSize);
+            hidReportDescriptorSize = appendAxisItems(descriptor, hidReportDescriptorSize, MOUSE_WHEEL_AXIS);
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x7f; // Logical Max (127)
+            descriptor[hidReportDescriptorSize++] = END_COLLECTION(0);
+        }
+        else
+        {
+            hidReportDescriptorSize = appendAxisItems(descriptor, hidReportDescriptorSize, MOUSE_WHEEL_AXIS);
+        }
+    }
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x08; // Report Size (8). Whole byte, no padding needed
+    // Horizontal wheel
+    if (this->getIncludeHWheel())
+    {
+        if (this->getHighResolutionScrolling())
+        {
+            descriptor[hidReportDescriptorSize++] = COLLECTION(1);
+            descriptor[hidReportDescriptorSize++] = 0x02; //Logical
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x03; // Report Count (3). 3 bytes total
+            descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
+            descriptor[hidReportDescriptorSize++] = 0x01; //Generic Desktop
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = HIDINPUT(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x06; // Input (Data, Variable, Relative) ;3 bytes (X,Y,Wheel)
-    
-        // Horizontal wheel
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x0c; //Consumer Devices
+            hidReportDescriptorSize = appendResolutionMultiplierItems(descriptor, hidReportDescriptorSize);
+        }
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = USAGE(2);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x38; //AC Pan
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02;
+        descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
+        descriptor[hidReportDescriptorSize++] = 0x0c; //Consumer Devices
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = LOGICAL_MINIMUM(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81; // Logical Min (-127)
+        hidReportDescriptorSize = appendAxisItems(descriptor, hidReportDescriptorSize, MOUSE_HWHEEL_AXIS);
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x7f; // Logical Max (127)
+        if (this->getHighResolutionScrolling())
+        {
+            descriptor[hidReportDescriptorSize++] = END_COLLECTION(0);
+        }
+    }
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x08; // Report Size (8). Whole byte, no padding needed
+    // Pad the resolution multiplier feature report out to a byte
+    uint8_t multiplierPaddingBits = this->getFeatureReportSize() * 8 - this->getResolutionMultiplierCount() * 2;
+    if (multiplierPaddingBits > 0)
+    {
+        descriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
+        descriptor[hidReportDescriptorSize++] = multiplierPaddingBits;
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01; // Report Count (1). 1 byte total
+        descriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
+        descriptor[hidReportDescriptorSize++] = 0x01;
 
-        tempHidReportDescriptor[hidReportDescriptorSize++] = HIDINPUT(1);
-        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x06; // Input (Data, Variable, Relative) ;1 byte (Horizontal wheel)
+        descriptor[hidReportDescriptorSize++] = FEATURE(1);
+        descriptor[hidReportDescriptorSize++] = 0x03; // Feature (Constant, Variable, Absolute)
     }
 
     // End Collection (Application - Physical)
-    tempHidReportDescriptor[hidReportDescriptorSize++] = END_COLLECTION(0); //0xc0;
+    descriptor[hidReportDescriptorSize++] = END_COLLECTION(0); //0xc0;
 
     // END_COLLECTION (Application)
-    tempHidReportDescriptor[hidReportDescriptorSize++] = END_COLLECTION(0); //0xc0;
+    descriptor[hidReportDescriptorSize++] = END_COLLECTION(0); //0xc0;
 
 
-    if(hidReportDescriptorSize < bufferSize){
-        memcpy(buffer, tempHidReportDescriptor, hidReportDescriptorSize);
-    } else {
-        return -1;
+    return descriptor.finish(hidReportDescriptorSize);
+}
+
+size_t MouseConfiguration::appendAxisItems(DescriptorWriter& buffer, size_t index, uint8_t axis) const
+{
+    if (!this->getIncludeAxis(axis))
+    {
+        return index;
+    }
+
+    switch (axis)
+    {
+        case MOUSE_X_AXIS:
+            buffer[index++] = USAGE(1);
+            buffer[index++] = 0x30; // X coordinate
+            break;
+        case MOUSE_Y_AXIS:
+            buffer[index++] = USAGE(1);
+            buffer[index++] = 0x31; // Y coordinate
+            break;
+        case MOUSE_WHEEL_AXIS:
+            buffer[index++] = USAGE(1);
+            buffer[index++] = 0x38; // Wheel
+            break;
+        case MOUSE_HWHEEL_AXIS:
+            buffer[index++] = USAGE(2);
+            buffer[index++] = 0x38; //AC Pan
+            buffer[index++] = 0x02;
+            break;
     }
 
-    return hidReportDescriptorSize;
+    int32_t axisMin = this->getAxisMin(axis);
+    int32_t axisMax = this->getAxisMax(axis);
+
+    if (this->getAxisBits(axis) == MOUSE_AXIS_16_BIT)
+    {
+        buffer[index++] = LOGICAL_MINIMUM(2);
+        buffer[index++] = lowByte(axisMin); // Logical Min (-32767)
+        buffer[index++] = highByte(axisMin);
+
+        buffer[index++] = LOGICAL_MAXIMUM(2);
+        buffer[index++] = lowByte(axisMax); // Logical Max (32767)
+        buffer[index++] = highByte(axisMax);
+    }
+    else
+    {
+        buffer[index++] = LOGICAL_MINIMUM(1);
+        buffer[index++] = lowByte(axisMin); // Logical Min (-127)
+
+        buffer[index++] = LOGICAL_MAXIMUM(1);
+        buffer[index++] = lowByte(axisMax); // Logical Max (127)
+    }
+
+    buffer[index++] = REPORT_SIZE(1);
+    buffer[index++] = this->getAxisBits(axis); // Whole bytes, no padding needed
+
+    buffer[index++] = REPORT_COUNT(1);
+    buffer[index++] = 0x01;
+
+    buffer[index++] = HIDINPUT(1);
+    buffer[index++] = 0x06; // Input (Data, Variable, Relative)
+
+    return index;
+}
+
+size_t MouseConfiguration::appendResolutionMultiplierItems(DescriptorWriter& buffer, size_t index) const
+{
+    // Expects the Generic Desktop usage page to be current
+    buffer[index++] = USAGE(1);
+    buffer[index++] = 0x48; // Resolution Multiplier
+
+    buffer[index++] = LOGICAL_MINIMUM(1);
+    buffer[index++] = 0x00; // Logical Min (0) - Multiplier disabled
+
+    buffer[index++] = LOGICAL_MAXIMUM(1);
+    buffer[index++] = 0x01; // Logical Max (1) - Multiplier enabled
+
+    buffer[index++] = PHYSICAL_MINIMUM(1);
+    buffer[index++] = 0x01; // Physical Min (1) - One count per detent
+
+    buffer[index++] = PHYSICAL_MAXIMUM(1);
+    buffer[index++] = this->getScrollResolutionMultiplier(); // Physical Max - Counts per detent when enabled
+
+    buffer[index++] = REPORT_SIZE(1);
+    buffer[index++] = 0x02;
+
+    buffer[index++] = REPORT_COUNT(1);
+    buffer[index++] = 0x01;
+
+    buffer[index++] = FEATURE(1);
+    buffer[index++] = 0x02; // Feature (Data, Variable, Absolute)
+
+    // Reset the physical range so it does not apply to the wheel itself
+    buffer[index++] = PHYSICAL_MINIMUM(1);
+    buffer[index++] = 0x00;
+
+    buffer[index++] = PHYSICAL_MAXIMUM(1);
+    buffer[index++] = 0x00;
+
+    return index;
+}
+
+uint8_t MouseConfiguration::getResolutionMultiplierCount() const
+{
+    if (!this->getHighResolutionScrolling())
+        return 0;
+
+    return (uint8_t)this->getIncludeWheel() + (uint8_t)this->getIncludeHWheel();
+}
+
+uint8_t MouseConfiguration::getFeatureReportSize() const
+{
+    // 2 bits per multiplier, padded to a byte
+    return this->getResolutionMultiplierCount() > 0 ? 1 : 0;
 }
 
 uint16_t MouseConfiguration::getMouseButtonCount() const { return _mouseButtonCount; }
@@ -173,7 +317,74 @@ uint16_t MouseConfiguration::getMouseAxisCount() const {
     return count;
 }
 
+bool MouseConfiguration::getIncludeXAxis() const { return _whichAxes[MOUSE_X_AXIS]; }
+bool MouseConfiguration::getIncludeYAxis() const { return _whichAxes[MOUSE_Y_AXIS]; }
+bool MouseConfiguration::getIncludeWheel() const { return _whichAxes[MOUSE_WHEEL_AXIS]; }
+bool MouseConfiguration::getIncludeHWheel() const { return _whichAxes[MOUSE_HWHEEL_AXIS]; }
+const bool *MouseConfiguration::getWhichAxes() const { return _whichAxes; }
+
+bool MouseConfiguration::getIncludeAxis(uint8_t axis) const
+{
+    return axis < MOUSE_POSSIBLE_AXIS_COUNT && _whichAxes[axis];
+}
+
+uint8_t MouseConfiguration::getAxisBits(uint8_t axis) const
+{
+    return axis < MOUSE_POSSIBLE_AXIS_COUNT ? _axisBits[axis] : 0;
+}
+
+uint8_t MouseConfiguration::getAxisNumBytes(uint8_t axis) const
+{
+    return this->getAxisBits(axis) / 8;
+}
+
+int32_t MouseConfiguration::getAxisMin(uint8_t axis) const
+{
+    return -this->getAxisMax(axis);
+}
+
+int32_t MouseConfiguration::getAxisMax(uint8_t axis) const
+{
+    return this->getAxisBits(axis) == MOUSE_AXIS_16_BIT ? 32767 : 127;
+}
+
 void MouseConfiguration::setMouseButtonCount(uint16_t value) { _mouseButtonCount = value; }
+void MouseConfiguration::setIncludeXAxis(bool value) { _whichAxes[MOUSE_X_AXIS] = value; }
+void MouseConfiguration::setIncludeYAxis(bool value) { _whichAxes[MOUSE_Y_AXIS] = value; }
+void MouseConfiguration::setIncludeWheel(bool value) { _whichAxes[MOUSE_WHEEL_AXIS] = value; }
+void MouseConfiguration::setIncludeHWheel(bool value) { _whichAxes[MOUSE_HWHEEL_AXIS] = value; }
+
+void MouseConfiguration::setWhichAxes(bool xAxis, bool yAxis, bool wheel, bool hWheel)
+{
+    _whichAxes[MOUSE_X_AXIS] = xAxis;
+    _whichAxes[MOUSE_Y_AXIS] = yAxis;
+    _whichAxes[MOUSE_WHEEL_AXIS] = wheel;
+    _whichAxes[MOUSE_HWHEEL_AXIS] = hWheel;
+}
+
+void MouseConfiguration::setAxisBits(uint8_t axis, uint8_t bits)
+{
+    if (axis < MOUSE_POSSIBLE_AXIS_COUNT)
+    {
+        _axisBits[axis] = (bits == MOUSE_AXIS_16_BIT) ? MOUSE_AXIS_16_BIT : MOUSE_AXIS_8_BIT;
+    }
+}
+
+bool MouseConfiguration::getHighResolutionScrolling() const { return _highResolutionScrolling; }
+void MouseConfiguration::setHighResolutionScrolling(bool value) { _highResolutionScrolling = value; }
+uint8_t MouseConfiguration::getScrollResolutionMultiplier() const { return _scrollResolutionMultiplier; }
+
+void MouseConfiguration::setScrollResolutionMultiplier(uint8_t value)
+{
+    // Physical maximum is a signed byte in the descriptor
+    _scrollResolutionMultiplier = constrain(value, 1, 127);
+}
+
+void MouseConfiguration::setPointerAxisBits(uint8_t bits)
+{
+    setAxisBits(MOUSE_X_AXIS, bits);
+    setAxisBits(MOUSE_Y_AXIS, bits);
+}
 
 uint8_t MouseConfiguration::getMouseButtonPaddingBits() const
 {
@@ -13,8 +13,21 @@
 #define MOUSE_LOGICAL_BUTTON_4 0x04
 #define MOUSE_LOGICAL_BUTTON_5 0x05
 
-#define MOUSE_DEFAULT_AXIS_COUNT 2
-#define MOUSE_POSSIBLE_AXIS_COUNT 8
+#define MOUSE_DEFAULT_AXIS_COUNT 4
+#define MOUSE_POSSIBLE_AXIS_COUNT 4
+
+// Axis indices, in the order they appear in the report
+#define MOUSE_X_AXIS 0
+#define MOUSE_Y_AXIS 1
+#define MOUSE_WHEEL_AXIS 2
+#define MOUSE_HWHEEL_AXIS 3
+
+// Supported relative axis widths
+#define MOUSE_AXIS_8_BIT 8
+#define MOUSE_AXIS_16_BIT 16
+
+// Wheel counts per detent reported once the host enables high resolution scrolling
+#define MOUSE_DEFAULT_SCROLL_RESOLUTION_MULTIPLIER 8
 
 // Keyboard
 
@@ -23,7 +36,10 @@ class MouseConfiguration : public BaseCompositeDeviceConfiguration
 private:
     uint16_t _buttonCount;
     bool _whichAxes[MOUSE_POSSIBLE_AXIS_COUNT];
+    uint8_t _axisBits[MOUSE_POSSIBLE_AXIS_COUNT];
     uint16_t _mouseButtonCount;
+    bool _highResolutionScrolling;
+    uint8_t _scrollResolutionMultiplier;
 
 public:
     MouseConfiguration();
@@ -31,15 +47,49 @@ public:
     const char* getDeviceName() const override;
     uint8_t getDeviceReportSize() const override;
     size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override;
+    size_t getDeviceReportDescriptorSize() const override;
+    uint32_t getConfigHash() const override;
     uint8_t getMouseButtonNumBytes() const;
 
     uint16_t getMouseButtonCount() const;
     uint16_t getMouseAxisCount() const;
+    bool getIncludeXAxis() const;
+    bool getIncludeYAxis() const;
+    bool getIncludeWheel() const;
+    bool getIncludeHWheel() const;
+    const bool *getWhichAxes() const;
+    bool getIncludeAxis(uint8_t axis) const;
+    uint8_t getAxisBits(uint8_t axis) const;
+    uint8_t getAxisNumBytes(uint8_t axis) const;
+    int32_t getAxisMin(uint8_t axis) const;
+    int32_t getAxisMax(uint8_t axis) const;
 
     void setMouseButtonCount(uint16_t value);
+    void setIncludeXAxis(bool value);
+    void setIncludeYAxis(bool value);
+    void setIncludeWheel(bool value);
+    void setIncludeHWheel(bool value);
+    void setWhichAxes(bool xAxis, bool yAxis, bool wheel, bool hWheel);
+
+    // Width in bits of a relative axis (MOUSE_AXIS_8_BIT or MOUSE_AXIS_16_BIT)
+    void setAxisBits(uint8_t axis, uint8_t bits);
+    // Convenience for high resolution sensors, sets the width of both X and Y
+    void setPointerAxisBits(uint8_t bits);
+
+    // Adds a Resolution Multiplier feature to the wheels. Hosts that understand it
+    // switch the wheels into high resolution mode, after which every detent is sent
+    // as getScrollResolutionMultiplier() counts.
+    bool getHighResolutionScrolling() const;
+    void setHighResolutionScrolling(bool value);
+    uint8_t getScrollResolutionMultiplier() const;
+    void setScrollResolutionMultiplier(uint8_t value);
+    uint8_t getFeatureReportSize() const;
 
 private:
     uint8_t getMouseButtonPaddingBits() const;
+    size_t appendAxisItems(DescriptorWriter& buffer, size_t index, uint8_t axis) const;
+    size_t appendResolutionMultiplierItems(DescriptorWriter& buffer, size_t index) const;
+    uint8_t getResolutionMultiplierCount() const;
 };
 
 #endif
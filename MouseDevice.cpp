@@ -1,30 +1,93 @@
 #include "MouseDevice.h"
 #include "BleCompositeHID.h"
 
+#if defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define LOG_TAG "MouseDevice"
+#else
+#include "esp_log.h"
+static const char *LOG_TAG = "MouseDevice";
+#endif
+
+MouseCallbacks::MouseCallbacks(MouseDevice* device) :
+    _device(device)
+{
+}
+
+void MouseCallbacks::onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo)
+{
+    uint8_t featureValue = pCharacteristic->getValue<uint8_t>();
+    ESP_LOGD(LOG_TAG, "MouseCallbacks::onWrite - Resolution multiplier feature: %d", featureValue);
+    _device->setResolutionMultipliers(featureValue);
+}
+
+void MouseCallbacks::onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo)
+{
+    ESP_LOGD(LOG_TAG, "MouseCallbacks::onRead");
+}
+
+void MouseCallbacks::onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue)
+{
+    ESP_LOGD(LOG_TAG, "MouseCallbacks::onSubscribe");
+}
+
+void MouseCallbacks::onStatus(NimBLECharacteristic* pCharacteristic, int code)
+{
+    ESP_LOGD(LOG_TAG, "MouseCallbacks::onStatus, code: %d", code);
+}
+
 MouseDevice::MouseDevice():
     _config(MouseConfiguration()), // Use default config
+    _feature(nullptr),
+    _callbacks(this),
     _mouseButtons(),
+    _sentButtons(),
+    _resendState(false),
     _mouseX(0),
     _mouseY(0),
     _mouseWheel(0),
-    _mouseHWheel(0)
+    _mouseHWheel(0),
+    _wheelMultiplier(1),
+    _hWheelMultiplier(1)
 {
     this->resetButtons();
 }
 
 MouseDevice::MouseDevice(const MouseConfiguration& config):
     _config(config), // Copy config to avoid modification
+    _feature(nullptr),
+    _callbacks(this),
     _mouseButtons(),
+    _sentButtons(),
+    _resendState(false),
     _mouseX(0),
     _mouseY(0),
     _mouseWheel(0),
-    _mouseHWheel(0)
+    _mouseHWheel(0),
+    _wheelMultiplier(1),
+    _hWheelMultiplier(1)
 {
     this->resetButtons();
 }
 
+MouseDevice::~MouseDevice()
+{
+    if (_feature){
+        _feature->setCallbacks(nullptr);
+    }
+}
+
 void MouseDevice::init(NimBLEHIDDevice* hid)
 {
+    if (_config.getFeatureReportSize() > 0)
+    {
+        // The host writes this to switch the wheels into high resolution mode
+        _feature = hid->getFeatureReport(_config.getReportId());
+        uint8_t featureValue = 0x00;
+        _feature->setValue(&featureValue, sizeof(featureValue));
+        _feature->setCallbacks(&_callbacks);
+    }
+
     setCharacteristics(hid->getInputReport(_config.getReportId()), nullptr);
 }
 
@@ -33,6 +96,35 @@ const BaseCompositeDeviceConfiguration* MouseDevice::getDeviceConfig() const
     return &_config;
 }
 
+void MouseDevice::restoreState()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _resendState = true;
+    }
+    sendMouseReportImpl();
+}
+
+void MouseDevice::discardPendingState()
+{
+    // Motion meant for the host that left would arrive as a jump at the next one
+    std::lock_guard<std::mutex> lock(_mutex);
+    _mouseX = 0;
+    _mouseY = 0;
+    _mouseWheel = 0;
+    _mouseHWheel = 0;
+}
+
+uint8_t MouseDevice::getCharacteristics(NimBLECharacteristic** characteristics, uint8_t maxCount)
+{
+    uint8_t count = BaseCompositeDevice::getCharacteristics(characteristics, maxCount);
+    if (_feature && count < maxCount)
+    {
+        characteristics[count++] = _feature;
+    }
+    return count;
+}
+
 void MouseDevice::resetButtons()
 {
     std::lock_guard<std::mutex> lock(_mutex);
@@ -86,31 +178,95 @@ void MouseDevice::mouseRelease(uint8_t button)
     }
 }
 
-void MouseDevice::mouseMove(signed char x, signed char y, signed char scrollX, signed char scrollY)
+void MouseDevice::mouseMove(int32_t x, int32_t y, int32_t scrollX, int32_t scrollY)
+{
+    accumulateMotion(
+        (int64_t)x * MOUSE_FRACTIONAL_ONE,
+        (int64_t)y * MOUSE_FRACTIONAL_ONE,
+        (int64_t)scrollX * MOUSE_FRACTIONAL_ONE,
+        (int64_t)scrollY * MOUSE_FRACTIONAL_ONE
+    );
+}
+
+void MouseDevice::mouseMoveFractional(int32_t x, int32_t y, int32_t scrollX, int32_t scrollY)
+{
+    accumulateMotion(x, y, scrollX, scrollY);
+}
+
+bool MouseDevice::hasPendingMotion()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return hasPendingMotionLocked();
+}
+
+uint8_t MouseDevice::getWheelMultiplier()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _wheelMultiplier;
+}
+
+uint8_t MouseDevice::getHWheelMultiplier()
 {
-    if (x == -127)
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _hWheelMultiplier;
+}
+
+void MouseDevice::setResolutionMultipliers(uint8_t featureValue)
+{
+    // Each included wheel owns a 2 bit field, vertical wheel first
+    uint8_t bitOffset = 0;
+    uint8_t wheelMultiplier = 1;
+    uint8_t hWheelMultiplier = 1;
+
+    if (_config.getIncludeWheel())
     {
-        x = -126;
+        if ((featureValue >> bitOffset) & 0x03)
+            wheelMultiplier = _config.getScrollResolutionMultiplier();
+        bitOffset += 2;
     }
-    if (y == -127)
+    if (_config.getIncludeHWheel())
     {
-        y = -126;
+        if ((featureValue >> bitOffset) & 0x03)
+            hWheelMultiplier = _config.getScrollResolutionMultiplier();
     }
-    if (scrollX == -127)
+
+    bool wheelChanged = false;
+    bool hWheelChanged = false;
     {
-        scrollX = -126;
+        // Rescale pending scroll so that motion queued under the old multiplier is not lost or amplified
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (wheelMultiplier != _wheelMultiplier)
+        {
+            _mouseWheel = _mouseWheel * wheelMultiplier / _wheelMultiplier;
+            _wheelMultiplier = wheelMultiplier;
+            wheelChanged = true;
+        }
+        if (hWheelMultiplier != _hWheelMultiplier)
+        {
+            _mouseHWheel = _mouseHWheel * hWheelMultiplier / _hWheelMultiplier;
+            _hWheelMultiplier = hWheelMultiplier;
+            hWheelChanged = true;
+        }
     }
-    if (scrollY == -127)
+
+    if (wheelChanged)
+    {
+        onWheelMultiplierChanged.fire(wheelMultiplier);
+    }
+    if (hWheelChanged)
     {
-        scrollY = -126;
+        onHWheelMultiplierChanged.fire(hWheelMultiplier);
     }
+}
 
+void MouseDevice::accumulateMotion(int64_t x, int64_t y, int64_t scrollX, int64_t scrollY)
+{
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _mouseX = x;
-        _mouseY = y;
-        _mouseWheel = scrollY;
-        _mouseHWheel = scrollX;
+        accumulateAxis(MOUSE_X_AXIS, _mouseX, x);
+        accumulateAxis(MOUSE_Y_AXIS, _mouseY, y);
+        accumulateAxis(MOUSE_WHEEL_AXIS, _mouseWheel, scrollY * _wheelMultiplier); // Scroll is given in detents, reported in multiplier counts
+        accumulateAxis(MOUSE_HWHEEL_AXIS, _mouseHWheel, scrollX * _hWheelMultiplier);
     }
 
     if (_config.getAutoReport())
@@ -119,8 +275,53 @@ void MouseDevice::mouseMove(signed char x, signed char y, signed char scrollX, s
     }
 }
 
+bool MouseDevice::hasPendingMotionLocked() const
+{
+    // Only whole counts can be sent, fractions stay behind for the next move
+    return _mouseX >= MOUSE_FRACTIONAL_ONE || _mouseX <= -MOUSE_FRACTIONAL_ONE ||
+        _mouseY >= MOUSE_FRACTIONAL_ONE || _mouseY <= -MOUSE_FRACTIONAL_ONE ||
+        _mouseWheel >= MOUSE_FRACTIONAL_ONE || _mouseWheel <= -MOUSE_FRACTIONAL_ONE ||
+        _mouseHWheel >= MOUSE_FRACTIONAL_ONE || _mouseHWheel <= -MOUSE_FRACTIONAL_ONE;
+}
+
+void MouseDevice::accumulateAxis(uint8_t axis, int64_t& residual, int64_t motion)
+{
+    // Motion on axes that are not part of the report is dropped, it could never be sent
+    if (!_config.getIncludeAxis(axis))
+        return;
+
+    residual += motion;
+}
+
+// Takes as many whole counts from a residual as fit into one report field
+static int32_t drainMotionResidual(int64_t& residual, int32_t axisMin, int32_t axisMax)
+{
+    int64_t counts = residual / MOUSE_FRACTIONAL_ONE; // Truncates toward zero so the remainder keeps its sign
+    counts = constrain(counts, (int64_t)axisMin, (int64_t)axisMax);
+    residual -= counts * MOUSE_FRACTIONAL_ONE;
+    return (int32_t)counts;
+}
+
+uint8_t MouseDevice::writeAxis(uint8_t* report, uint8_t index, uint8_t axis, int64_t& residual)
+{
+    if (!_config.getIncludeAxis(axis))
+        return index;
+
+    int32_t value = drainMotionResidual(residual, _config.getAxisMin(axis), _config.getAxisMax(axis));
+    report[index++] = value;
+    if (_config.getAxisBits(axis) == MOUSE_AXIS_16_BIT)
+    {
+        report[index++] = (value >> 8);
+    }
+
+    return index;
+}
+
 void MouseDevice::sendMouseReport(bool defer)
 {
+    if (!shouldReport(getInput()))
+        return;
+
     if (defer || _config.getAutoDefer())
     {
         queueDeferredReport(std::bind(&MouseDevice::sendMouseReportImpl, this));
@@ -139,29 +340,46 @@ void MouseDevice::sendMouseReportImpl()
     if (!input || !parentDevice)
         return;
     
-    if(!parentDevice->isConnected())
+    if(!parentDevice->isConnected()) {
+        discardPendingState();
+        countDroppedReport();
         return;
+    }
 
-    uint8_t mouse_report[_config.getDeviceReportSize()];
-    uint8_t currentReportIndex = 0;
+    // Hosts that didn't subscribe to this report never read it, skip building it
+    if(!isInputSubscribed(input))
+        return;
 
-    { 
-        std::lock_guard<std::mutex> lock(_mutex);
-        
-        memset(&mouse_report, 0, sizeof(mouse_report));
-        memcpy(&mouse_report, &_mouseButtons, sizeof(_mouseButtons));
-        currentReportIndex += _config.getMouseButtonNumBytes();
+    uint8_t mouse_report[getInputReportSize()];
+
+    // Motion larger than a single report can carry is split over consecutive reports until every
+    // whole count has been sent
+    while (true)
+    {
+        uint8_t currentReportIndex = 0;
 
-        // TODO: Make dynamic based on axis counts
-        if (_config.getMouseAxisCount() > 0)
         {
-            mouse_report[currentReportIndex++] = _mouseX;
-            mouse_report[currentReportIndex++] = _mouseY;
-            mouse_report[currentReportIndex++] = _mouseWheel;
-            mouse_report[currentReportIndex++] = _mouseHWheel;
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            // Sends queued for moves an earlier send already drained have nothing left to report
+            bool buttonsChanged = memcmp(_sentButtons, _mouseButtons, sizeof(_mouseButtons)) != 0;
+            if (!_resendState && !buttonsChanged && !hasPendingMotionLocked())
+                return;
+
+            memset(&mouse_report, 0, sizeof(mouse_report));
+            memcpy(&mouse_report, &_mouseButtons, std::min((size_t)_config.getMouseButtonNumBytes(), sizeof(_mouseButtons)));
+            currentReportIndex += _config.getMouseButtonNumBytes();
+
+            currentReportIndex = writeAxis(mouse_report, currentReportIndex, MOUSE_X_AXIS, _mouseX);
+            currentReportIndex = writeAxis(mouse_report, currentReportIndex, MOUSE_Y_AXIS, _mouseY);
+            currentReportIndex = writeAxis(mouse_report, currentReportIndex, MOUSE_WHEEL_AXIS, _mouseWheel);
+            currentReportIndex = writeAxis(mouse_report, currentReportIndex, MOUSE_HWHEEL_AXIS, _mouseHWheel);
+
+            memcpy(_sentButtons, _mouseButtons, sizeof(_mouseButtons));
+            _resendState = false;
         }
-    }
 
-    input->setValue(mouse_report, sizeof(mouse_report));
-    input->notify();
-}
\ No newline at end of file
+        input->setValue(mouse_report, sizeof(mouse_report));
+        notifyInput(input);
+    }
+}
@@ -5,37 +5,85 @@
 #include "NimBLECharacteristic.h"
 #include <MouseConfiguration.h>
 #include <BaseCompositeDevice.h>
+#include <Callback.h>
 #include <mutex>
 
+// Relative motion is accumulated in Q16.16 fixed point so that sub-count
+// motion and motion beyond a single report's range are carried forward
+#define MOUSE_FRACTIONAL_BITS 16
+#define MOUSE_FRACTIONAL_ONE (1 << MOUSE_FRACTIONAL_BITS)
+
+// Forwards
+class MouseDevice;
+
+class MouseCallbacks : public NimBLECharacteristicCallbacks {
+public:
+    MouseCallbacks(MouseDevice* device);
+
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override;
+    void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override;
+    void onStatus(NimBLECharacteristic* pCharacteristic, int code) override;
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override;
+
+private:
+    MouseDevice* _device;
+};
+
 class MouseDevice : public BaseCompositeDevice {
+    friend class MouseCallbacks;
 private:
     MouseConfiguration _config;
     NimBLECharacteristic* _input;
     NimBLECharacteristic* _output;
+    NimBLECharacteristic* _feature;
+    MouseCallbacks _callbacks;
 
     uint8_t _mouseButtons[16]; // 8 bits x 16 --> 128 bits
-    signed char _mouseX;
-    signed char _mouseY;
-    signed char _mouseWheel;
-    signed char _mouseHWheel;
+    uint8_t _sentButtons[16];  // Buttons as the host last saw them
+    bool _resendState;         // Send the next report even if nothing changed
+    int64_t _mouseX;        // Q16.16 residuals still to be sent
+    int64_t _mouseY;
+    int64_t _mouseWheel;
+    int64_t _mouseHWheel;
+    uint8_t _wheelMultiplier;   // Counts per detent negotiated with the host
+    uint8_t _hWheelMultiplier;
 
 public:
     MouseDevice();
     MouseDevice(const MouseConfiguration& config);
+    ~MouseDevice();
     
     void init(NimBLEHIDDevice* hid) override;
     const BaseCompositeDeviceConfiguration* getDeviceConfig() const override;
+    void restoreState() override;
+    void discardPendingState() override;
+    uint8_t getCharacteristics(NimBLECharacteristic** characteristics, uint8_t maxCount) override;
 
     void resetButtons();
     void mouseClick(uint8_t button = MOUSE_LOGICAL_LEFT_BUTTON);
     void mousePress(uint8_t button = MOUSE_LOGICAL_LEFT_BUTTON);
     void mouseRelease(uint8_t button = MOUSE_LOGICAL_LEFT_BUTTON);
-    void mouseMove(signed char x, signed char y, signed char scrollX = 0, signed char scrollY = 0);
+    void mouseMove(int32_t x, int32_t y, int32_t scrollX = 0, int32_t scrollY = 0);
+    // Same as mouseMove but takes Q16.16 fixed-point deltas (MOUSE_FRACTIONAL_ONE == 1 count)
+    void mouseMoveFractional(int32_t x, int32_t y, int32_t scrollX = 0, int32_t scrollY = 0);
+    bool hasPendingMotion();
+
+    // Counts per detent the wheels are currently reporting at (1 until the host enables high resolution scrolling)
+    uint8_t getWheelMultiplier();
+    uint8_t getHWheelMultiplier();
+    // Fired with the new multiplier of the wheel whose multiplier the host changed
+    Signal<uint8_t> onWheelMultiplierChanged;
+    Signal<uint8_t> onHWheelMultiplierChanged;
     
     void sendMouseReport(bool defer = false);
 
 private:
     void sendMouseReportImpl();
+    void accumulateMotion(int64_t x, int64_t y, int64_t scrollX, int64_t scrollY);
+    bool hasPendingMotionLocked() const;
+    void accumulateAxis(uint8_t axis, int64_t& residual, int64_t motion);
+    uint8_t writeAxis(uint8_t* report, uint8_t index, uint8_t axis, int64_t& residual);
+    void setResolutionMultipliers(uint8_t featureValue);
 
     // Threading
     std::mutex _mutex;
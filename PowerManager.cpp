@@ -0,0 +1,198 @@
+#include "PowerManager.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+
+#if defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define LOG_TAG "PowerManager"
+#else
+#include "esp_log.h"
+static const char *LOG_TAG = "PowerManager";
+#endif
+
+PowerManager::PowerManager() :
+    _idleTimeout(0),
+    _timer(NULL),
+    _idle(false),
+    _lastActivityMs(0),
+    _stateSinceMs(0),
+    _activeMs(0),
+    _idleMs(0),
+    _idleEntries(0),
+    _activeMicroAmps(0),
+    _idleMicroAmps(0)
+#if defined(CONFIG_PM_ENABLE)
+    , _sleepLock(NULL)
+#endif
+{
+}
+
+PowerManager::~PowerManager()
+{
+    end();
+}
+
+bool PowerManager::begin(uint32_t idleTimeoutMs, bool lightSleep, uint16_t maxCpuMhz, uint16_t minCpuMhz)
+{
+    _idleTimeout = idleTimeoutMs;
+    _lastActivityMs = millis();
+    _stateSinceMs = millis();
+
+    if (_idleTimeout == 0)
+        return true;
+
+#if defined(CONFIG_PM_ENABLE)
+    if (lightSleep) {
+        esp_pm_config_t config = {};
+        config.max_freq_mhz = maxCpuMhz;
+        config.min_freq_mhz = minCpuMhz;
+        config.light_sleep_enable = true;
+        if (esp_pm_configure(&config) != ESP_OK) {
+            ESP_LOGW(LOG_TAG, "Automatic light sleep could not be enabled, only idle time is tracked.");
+        }
+    }
+
+    // Held while active, so light sleep only happens once input has gone quiet
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "hidActive", &_sleepLock) == ESP_OK) {
+        esp_pm_lock_acquire(_sleepLock);
+    } else {
+        _sleepLock = NULL;
+    }
+#else
+    (void)maxCpuMhz;
+    (void)minCpuMhz;
+    if (lightSleep) {
+        ESP_LOGW(LOG_TAG, "Automatic light sleep needs CONFIG_PM_ENABLE, only idle time is tracked.");
+    }
+#endif
+
+    _timer = xTimerCreate("powerIdle", pdMS_TO_TICKS(_idleTimeout), pdFALSE, this, timerCallback);
+    if (_timer == NULL || xTimerStart(_timer, 0) != pdPASS) {
+        ESP_LOGE(LOG_TAG, "Failed to start the power idle timer!");
+        return false;
+    }
+    return true;
+}
+
+void PowerManager::end()
+{
+    if (_timer != NULL) {
+        xTimerDelete(_timer, 0);
+        _timer = NULL;
+    }
+
+#if defined(CONFIG_PM_ENABLE)
+    if (_sleepLock != NULL) {
+        if (!_idle)
+            esp_pm_lock_release(_sleepLock);
+        esp_pm_lock_delete(_sleepLock);
+        _sleepLock = NULL;
+    }
+#endif
+}
+
+void PowerManager::onActivity()
+{
+    _lastActivityMs.store(millis(), std::memory_order_relaxed);
+
+    // The idle timer checks the timestamp when it fires, only leaving idle needs more than that
+    if (_idle.load(std::memory_order_relaxed)) {
+        setIdle(false);
+        if (_timer != NULL) {
+            xTimerChangePeriod(_timer, pdMS_TO_TICKS(_idleTimeout), 0);
+        }
+    }
+}
+
+bool PowerManager::isIdle() const
+{
+    return _idle;
+}
+
+bool PowerManager::enableWakeupPin(uint8_t pin, bool level)
+{
+    if (gpio_wakeup_enable((gpio_num_t)pin, level ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL) != ESP_OK)
+        return false;
+
+    return esp_sleep_enable_gpio_wakeup() == ESP_OK;
+}
+
+void PowerManager::setCurrentEstimate(uint32_t activeMicroAmps, uint32_t idleMicroAmps)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _activeMicroAmps = activeMicroAmps;
+    _idleMicroAmps = idleMicroAmps;
+}
+
+PowerStats PowerManager::getStats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    PowerStats stats;
+    uint32_t current = millis() - _stateSinceMs;
+    stats.activeMs = _activeMs + (_idle ? 0 : current);
+    stats.idleMs = _idleMs + (_idle ? current : 0);
+    stats.idleEntries = _idleEntries;
+
+    // uA * ms to uAh
+    stats.estimatedMicroAmpHours = 0;
+    if (_activeMicroAmps > 0 && _idleMicroAmps > 0) {
+        uint64_t charge = (uint64_t)stats.activeMs * _activeMicroAmps + (uint64_t)stats.idleMs * _idleMicroAmps;
+        stats.estimatedMicroAmpHours = charge / 3600000;
+    }
+    return stats;
+}
+
+void PowerManager::timerCallback(TimerHandle_t timer)
+{
+    PowerManager* manager = (PowerManager*)pvTimerGetTimerID(timer);
+    manager->onTimer();
+}
+
+void PowerManager::onTimer()
+{
+    uint32_t elapsed = millis() - _lastActivityMs.load(std::memory_order_relaxed);
+    if (elapsed >= _idleTimeout) {
+        setIdle(true);
+    } else {
+        // Input came in since the timer was armed, wait out the rest
+        xTimerChangePeriod(_timer, pdMS_TO_TICKS(_idleTimeout - elapsed), 0);
+    }
+}
+
+void PowerManager::setIdle(bool idle)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_idle == idle)
+            return;
+
+        // Input that raced the idle timer keeps the device active for the rest of the timeout
+        uint32_t now = millis();
+        uint32_t quiet = now - _lastActivityMs.load(std::memory_order_relaxed);
+        if (idle && quiet < _idleTimeout) {
+            xTimerChangePeriod(_timer, pdMS_TO_TICKS(_idleTimeout - quiet), 0);
+            return;
+        }
+
+        if (idle) {
+            _activeMs += now - _stateSinceMs;
+            _idleEntries++;
+        } else {
+            _idleMs += now - _stateSinceMs;
+        }
+        _stateSinceMs = now;
+        _idle = idle;
+
+#if defined(CONFIG_PM_ENABLE)
+        if (_sleepLock != NULL) {
+            if (idle)
+                esp_pm_lock_release(_sleepLock);
+            else
+                esp_pm_lock_acquire(_sleepLock);
+        }
+#endif
+    }
+
+    onIdleChanged.fire(idle);
+}
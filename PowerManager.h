@@ -0,0 +1,75 @@
+#ifndef ESP32_POWER_MANAGER_H
+#define ESP32_POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <Callback.h>
+#include <atomic>
+#include <mutex>
+#include "sdkconfig.h"
+#include "freertos/timers.h"
+
+#if defined(CONFIG_PM_ENABLE)
+#include "esp_pm.h"
+#endif
+
+// Time spent active and idle since begin(), with a charge estimate from the configured currents
+struct PowerStats {
+    uint32_t activeMs;
+    uint32_t idleMs;
+    uint32_t idleEntries;
+    uint32_t estimatedMicroAmpHours;    // 0 unless both currents were configured
+};
+
+// Tracks when input has been quiet for the idle timeout. While idle it releases its power management
+// lock, so with automatic light sleep enabled the chip sleeps between BLE connection events and wakes
+// for the controller, a wakeup pin or the next report. Nothing is delayed: the first report after
+// idling takes the lock back before it is sent.
+class PowerManager
+{
+public:
+    PowerManager();
+    ~PowerManager();
+
+    // idleTimeoutMs 0 keeps the device active for good. lightSleep needs CONFIG_PM_ENABLE, and
+    // CONFIG_BT_CTRL_MODEM_SLEEP for the controller to sleep along with the CPU.
+    bool begin(uint32_t idleTimeoutMs, bool lightSleep, uint16_t maxCpuMhz, uint16_t minCpuMhz);
+    void end();
+
+    // Call on any input, from a task. Cheap while active, leaves idle straight away.
+    void onActivity();
+    bool isIdle() const;
+
+    // Wakes the chip from light sleep when the pin reaches level, for inputs that change while idle
+    bool enableWakeupPin(uint8_t pin, bool level);
+
+    // Currents drawn while active and idle, used for the charge estimate
+    void setCurrentEstimate(uint32_t activeMicroAmps, uint32_t idleMicroAmps);
+    PowerStats getStats();
+
+    // Fired with true when the device goes idle and false when input wakes it
+    Signal<bool> onIdleChanged;
+
+private:
+    static void timerCallback(TimerHandle_t timer);
+    void onTimer();
+    void setIdle(bool idle);
+
+    uint32_t _idleTimeout;
+    TimerHandle_t _timer;
+    std::atomic<bool> _idle;
+    std::atomic<uint32_t> _lastActivityMs;
+
+    std::mutex _mutex;
+    uint32_t _stateSinceMs;
+    uint32_t _activeMs;
+    uint32_t _idleMs;
+    uint32_t _idleEntries;
+    uint32_t _activeMicroAmps;
+    uint32_t _idleMicroAmps;
+
+#if defined(CONFIG_PM_ENABLE)
+    esp_pm_lock_handle_t _sleepLock;
+#endif
+};
+
+#endif // ESP32_POWER_MANAGER_H
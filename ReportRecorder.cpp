@@ -0,0 +1,342 @@
+#include "ReportRecorder.h"
+#include "BleCompositeHID.h"
+#include <string.h>
+
+// Unsigned LEB128, 7 bits per byte with the high bit set on all but the last
+static size_t putVarint(uint8_t* buffer, uint32_t value)
+{
+    size_t size = 0;
+    while (value >= 0x80) {
+        buffer[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[size++] = (uint8_t)value;
+    return size;
+}
+
+FileReportLogStorage::FileReportLogStorage(const char* path) :
+    _path(path),
+    _file(nullptr)
+{
+}
+
+FileReportLogStorage::~FileReportLogStorage()
+{
+    if (_file)
+        fclose(_file);
+}
+
+bool FileReportLogStorage::open()
+{
+    if (!_file)
+        _file = fopen(_path.c_str(), "a+b");
+    return _file != nullptr;
+}
+
+bool FileReportLogStorage::clear()
+{
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+
+    FILE* file = fopen(_path.c_str(), "wb");
+    if (!file)
+        return false;
+    fclose(file);
+
+    return open();
+}
+
+bool FileReportLogStorage::append(const uint8_t* data, size_t size)
+{
+    // A stream in update mode has to be repositioned between reading and writing
+    if (!open() || fseek(_file, 0, SEEK_END) != 0)
+        return false;
+    return fwrite(data, 1, size, _file) == size;
+}
+
+size_t FileReportLogStorage::read(size_t offset, uint8_t* buffer, size_t size)
+{
+    if (!open() || fseek(_file, offset, SEEK_SET) != 0)
+        return 0;
+    return fread(buffer, 1, size, _file);
+}
+
+void FileReportLogStorage::flush()
+{
+    if (_file)
+        fflush(_file);
+}
+
+// ---------------
+
+MemoryReportLogStorage::MemoryReportLogStorage(uint8_t* buffer, size_t capacity) :
+    _buffer(buffer),
+    _capacity(capacity),
+    _size(0)
+{
+}
+
+bool MemoryReportLogStorage::clear()
+{
+    _size = 0;
+    return true;
+}
+
+bool MemoryReportLogStorage::append(const uint8_t* data, size_t size)
+{
+    if (size > _capacity - _size)
+        return false;
+
+    memcpy(_buffer + _size, data, size);
+    _size += size;
+    return true;
+}
+
+size_t MemoryReportLogStorage::read(size_t offset, uint8_t* buffer, size_t size)
+{
+    if (offset >= _size)
+        return 0;
+
+    if (size > _size - offset)
+        size = _size - offset;
+    memcpy(buffer, _buffer + offset, size);
+    return size;
+}
+
+// ---------------
+
+ReportRecorder::ReportRecorder(ReportLogStorage* storage) :
+    _storage(storage),
+    _recording(false),
+    _lastMicros(0),
+    _recorded(0),
+    _dropped(0)
+{
+}
+
+bool ReportRecorder::start()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint8_t header[REPORT_LOG_HEADER_SIZE];
+    memcpy(header, REPORT_LOG_MAGIC, 4);
+    header[4] = REPORT_LOG_VERSION;
+
+    if (!_storage->clear() || !_storage->append(header, sizeof(header))) {
+        _recording = false;
+        return false;
+    }
+
+    _lastMicros = micros();
+    _recorded = 0;
+    _dropped = 0;
+    _recording = true;
+    return true;
+}
+
+void ReportRecorder::stop()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_recording)
+        return;
+
+    _recording = false;
+    _storage->flush();
+}
+
+bool ReportRecorder::isRecording() const
+{
+    return _recording;
+}
+
+void ReportRecorder::record(uint8_t deviceIndex, uint8_t reportId, const uint8_t* data, size_t length)
+{
+    if (!_recording.load(std::memory_order_relaxed))
+        return;
+
+    if (length > REPORT_LOG_MAX_REPORT_SIZE) {
+        _dropped++;
+        return;
+    }
+
+    // Two varints of at most 5 bytes, the device index and the report ID
+    uint8_t record[12 + REPORT_LOG_MAX_REPORT_SIZE];
+
+    // Reports can come from several tasks, the timestamp is taken under the lock so deltas never go backwards
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_recording)
+        return;
+
+    uint32_t now = micros();
+    size_t size = putVarint(record, now - _lastMicros);
+    record[size++] = deviceIndex;
+    record[size++] = reportId;
+    size += putVarint(record + size, length);
+    memcpy(record + size, data, length);
+    size += length;
+
+    if (!_storage->append(record, size)) {
+        _dropped++;
+        return;
+    }
+
+    _lastMicros = now;
+    _recorded++;
+}
+
+uint32_t ReportRecorder::getRecordedCount() const
+{
+    return _recorded;
+}
+
+uint32_t ReportRecorder::getDroppedCount() const
+{
+    return _dropped;
+}
+
+// ---------------
+
+ReportLogReader::ReportLogReader(ReportLogStorage* storage) :
+    _storage(storage),
+    _offset(0),
+    _bufferSize(0),
+    _bufferPosition(0),
+    _offsetMicros(0)
+{
+}
+
+bool ReportLogReader::begin()
+{
+    _offset = 0;
+    _bufferSize = 0;
+    _bufferPosition = 0;
+    _offsetMicros = 0;
+
+    uint8_t header[REPORT_LOG_HEADER_SIZE];
+    return readBytes(header, sizeof(header)) && memcmp(header, REPORT_LOG_MAGIC, 4) == 0 && header[4] == REPORT_LOG_VERSION;
+}
+
+bool ReportLogReader::readBytes(uint8_t* buffer, size_t size)
+{
+    while (size > 0) {
+        if (_bufferPosition == _bufferSize) {
+            _offset += _bufferSize;
+            _bufferSize = _storage->read(_offset, _buffer, sizeof(_buffer));
+            _bufferPosition = 0;
+            if (_bufferSize == 0)
+                return false;
+        }
+
+        size_t count = _bufferSize - _bufferPosition;
+        if (count > size)
+            count = size;
+        memcpy(buffer, _buffer + _bufferPosition, count);
+        _bufferPosition += count;
+        buffer += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool ReportLogReader::readVarint(uint64_t& value)
+{
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        uint8_t byte;
+        if (!readBytes(&byte, 1))
+            return false;
+
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool ReportLogReader::next(RecordedReport& report)
+{
+    uint64_t delta;
+    uint64_t length;
+    uint8_t ids[2];
+    if (!readVarint(delta) || !readBytes(ids, sizeof(ids)) || !readVarint(length) || length > REPORT_LOG_MAX_REPORT_SIZE)
+        return false;
+
+    if (!readBytes(report.data, length))
+        return false;
+
+    _offsetMicros += delta;
+    report.offsetMicros = _offsetMicros;
+    report.deviceIndex = ids[0];
+    report.reportId = ids[1];
+    report.length = length;
+    return true;
+}
+
+// ---------------
+
+ReportReplayer::ReportReplayer(ReportLogStorage* storage) :
+    _storage(storage),
+    _stopRequested(false),
+    _skipped(0)
+{
+}
+
+int32_t ReportReplayer::replay(BleCompositeHID& hid, float speed)
+{
+    ReportLogReader reader(_storage);
+    if (!reader.begin())
+        return -1;
+
+    _stopRequested = false;
+    _skipped = 0;
+
+    int32_t sent = 0;
+    RecordedReport report;
+    uint32_t lastMicros = micros();
+    uint64_t elapsedMicros = 0;
+    while (!_stopRequested && reader.next(report)) {
+        if (speed > 0 && !waitUntil(lastMicros, elapsedMicros, (uint64_t)(report.offsetMicros / speed)))
+            break;
+
+        if (hid.replayReport(report.deviceIndex, report.reportId, report.data, report.length)) {
+            sent++;
+        } else {
+            _skipped++;
+        }
+    }
+    return sent;
+}
+
+bool ReportReplayer::waitUntil(uint32_t& lastMicros, uint64_t& elapsedMicros, uint64_t dueMicros)
+{
+    while (!_stopRequested) {
+        // Accumulated from 32 bit deltas, so a replay outlasts micros() wrapping around
+        uint32_t now = micros();
+        elapsedMicros += (uint32_t)(now - lastMicros);
+        lastMicros = now;
+
+        if (elapsedMicros >= dueMicros)
+            return true;
+
+        // Sleep through most of the wait and spin the last tick, so reports keep their recorded spacing
+        uint64_t remaining = dueMicros - elapsedMicros;
+        if (remaining > 2000) {
+            vTaskDelay(((remaining - 1000) / 1000) / portTICK_PERIOD_MS);
+        } else {
+            delayMicroseconds(remaining);
+        }
+    }
+    return false;
+}
+
+void ReportReplayer::stop()
+{
+    _stopRequested = true;
+}
+
+uint32_t ReportReplayer::getSkippedCount() const
+{
+    return _skipped;
+}
@@ -0,0 +1,160 @@
+#ifndef REPORT_RECORDER_H
+#define REPORT_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+// Report logs start with the magic and a version byte. Every record after that is the time since the
+// previous record in microseconds and the payload length as LEB128 varints, the device index, the report
+// ID and the payload. A report of a few bytes sent at a steady rate takes around 5 bytes of overhead.
+#define REPORT_LOG_MAGIC "CHRL"
+#define REPORT_LOG_VERSION 1
+#define REPORT_LOG_HEADER_SIZE 5
+#ifndef REPORT_LOG_MAX_REPORT_SIZE
+#define REPORT_LOG_MAX_REPORT_SIZE 128     // Longer reports are not recorded and counted as dropped
+#endif
+
+class BleCompositeHID;
+
+// Where a report log is kept. Records are only ever appended, and read back from the start.
+class ReportLogStorage
+{
+public:
+    virtual ~ReportLogStorage() {}
+
+    // Empties the log
+    virtual bool clear() = 0;
+    virtual bool append(const uint8_t* data, size_t size) = 0;
+    // Copies up to size bytes from offset into buffer and returns how many there were
+    virtual size_t read(size_t offset, uint8_t* buffer, size_t size) = 0;
+    // Makes appended data durable, called when recording stops
+    virtual void flush() {}
+};
+
+// Keeps the log in a file. On the device that is any filesystem mounted through the VFS, such as an SD card
+// under "/sd" or LittleFS under "/littlefs", on Linux any path. The file stays open between calls.
+class FileReportLogStorage : public ReportLogStorage
+{
+public:
+    FileReportLogStorage(const char* path);
+    ~FileReportLogStorage();
+
+    bool clear() override;
+    bool append(const uint8_t* data, size_t size) override;
+    size_t read(size_t offset, uint8_t* buffer, size_t size) override;
+    void flush() override;
+
+private:
+    bool open();
+
+    std::string _path;
+    FILE* _file;
+};
+
+// Keeps the log in a caller-provided buffer, the cheapest sink while recording. Appending fails once it is full.
+class MemoryReportLogStorage : public ReportLogStorage
+{
+public:
+    MemoryReportLogStorage(uint8_t* buffer, size_t capacity);
+
+    bool clear() override;
+    bool append(const uint8_t* data, size_t size) override;
+    size_t read(size_t offset, uint8_t* buffer, size_t size) override;
+
+    size_t getSize() const { return _size; }
+    const uint8_t* getData() const { return _buffer; }
+
+private:
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _size;
+};
+
+struct RecordedReport {
+    uint64_t offsetMicros;                  // Time since recording started
+    uint8_t deviceIndex;                    // Position of the device in the order devices were added
+    uint8_t reportId;
+    uint16_t length;
+    uint8_t data[REPORT_LOG_MAX_REPORT_SIZE];
+};
+
+// Appends every report BleCompositeHID sends to a log, see BleCompositeHID::setReportRecorder.
+// Reports are recorded once when they are built, however many hosts they go to.
+class ReportRecorder
+{
+public:
+    ReportRecorder(ReportLogStorage* storage);
+
+    // Empties the storage and starts a new log
+    bool start();
+    void stop();
+    bool isRecording() const;
+
+    void record(uint8_t deviceIndex, uint8_t reportId, const uint8_t* data, size_t length);
+
+    uint32_t getRecordedCount() const;
+    // Reports that were too long or that the storage refused
+    uint32_t getDroppedCount() const;
+
+private:
+    ReportLogStorage* _storage;
+    std::mutex _mutex;
+    std::atomic<bool> _recording;
+    uint32_t _lastMicros;
+    std::atomic<uint32_t> _recorded;
+    std::atomic<uint32_t> _dropped;
+};
+
+// Reads the records of a log one after another
+class ReportLogReader
+{
+public:
+    ReportLogReader(ReportLogStorage* storage);
+
+    // Checks the header and goes back to the first record
+    bool begin();
+    // False at the end of the log or at a record that is cut short or too long
+    bool next(RecordedReport& report);
+
+private:
+    bool readVarint(uint64_t& value);
+    bool readBytes(uint8_t* buffer, size_t size);
+
+    ReportLogStorage* _storage;
+    size_t _offset;                         // Storage offset of _buffer
+    uint8_t _buffer[64];
+    size_t _bufferSize;
+    size_t _bufferPosition;
+    uint64_t _offsetMicros;
+};
+
+// Sends a recorded log again through BleCompositeHID::replayReport. Reports go out in the recorded order
+// with the recorded payloads, so two replays of one log give a host identical input. Only the pacing
+// depends on the scheduler. Replaying blocks the calling task until the log ends or stop() is called.
+class ReportReplayer
+{
+public:
+    ReportReplayer(ReportLogStorage* storage);
+
+    // speed scales the recorded pacing: 1 is the original timing, 2 twice as fast, 0 sends back to back.
+    // Returns the number of reports sent, or -1 if the log can't be read.
+    int32_t replay(BleCompositeHID& hid, float speed = 1.0f);
+    void stop();
+
+    // Records of the last replay that named a device or report the composite device doesn't have
+    uint32_t getSkippedCount() const;
+
+private:
+    // Waits until elapsedMicros, advanced from lastMicros, reaches dueMicros. False if stopped meanwhile.
+    bool waitUntil(uint32_t& lastMicros, uint64_t& elapsedMicros, uint64_t dueMicros);
+
+    ReportLogStorage* _storage;
+    std::atomic<bool> _stopRequested;
+    uint32_t _skipped;
+};
+
+#endif // REPORT_RECORDER_H
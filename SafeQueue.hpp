@@ -116,6 +116,28 @@ public:
 
 	}
 
+	// Removes every item predicate returns true for, the rest keep their order. Returns how many were removed.
+	template<class Predicate>
+	size_type RemoveIf(Predicate predicate) {
+
+		std::lock_guard<std::mutex> lock(mtx);
+
+		size_type size = q.size();
+		size_type removed = 0;
+		for (size_type i = 0; i < size; i++) {
+			T item = std::move(q.front());
+			q.pop();
+			if (predicate(item)) {
+				removed++;
+			} else {
+				q.push(std::move(item));
+			}
+		}
+
+		return removed;
+
+	}
+
 	void Finish() {
 
 		std::unique_lock<std::mutex> lock(mtx);
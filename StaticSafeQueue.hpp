@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stddef.h>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+// Fixed capacity version of SafeQueue with the same interface. Items live in a ring buffer that is
+// part of the object, so nothing is allocated once it exists. Produce returns false when the queue
+// is full and leaves the item untouched.
+template<class T, size_t Capacity>
+class StaticSafeQueue {
+
+    T items[Capacity];
+    size_t head = 0;
+    size_t count = 0;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    std::condition_variable sync_wait;
+    bool finish_processing = false;
+    int sync_counter = 0;
+
+    void DecreaseSyncCounter() {
+        if (--sync_counter == 0) {
+            sync_wait.notify_one();
+        }
+    }
+
+    void Pop(T& item) {
+        item = std::move(items[head]);
+        items[head] = T();
+        head = (head + 1) % Capacity;
+        count--;
+    }
+
+public:
+
+    typedef size_t size_type;
+
+    StaticSafeQueue() {}
+
+    ~StaticSafeQueue() {
+        Finish();
+    }
+
+    bool Produce(T&& item) {
+
+        std::lock_guard<std::mutex> lock(mtx);
+
+        if (count == Capacity) {
+            return false;
+        }
+
+        items[(head + count) % Capacity] = std::move(item);
+        count++;
+        cv.notify_one();
+
+        return true;
+
+    }
+
+    size_type Size() {
+
+        std::lock_guard<std::mutex> lock(mtx);
+
+        return count;
+
+    }
+
+    bool Consume(T& item) {
+
+        std::lock_guard<std::mutex> lock(mtx);
+
+        if (count == 0) {
+            return false;
+        }
+
+        Pop(item);
+        return true;
+
+    }
+
+    bool ConsumeSync(T& item) {
+
+        std::unique_lock<std::mutex> lock(mtx);
+
+        sync_counter++;
+
+        cv.wait(lock, [&] {
+            return count > 0 || finish_processing;
+        });
+
+        if (count == 0) {
+            DecreaseSyncCounter();
+            return false;
+        }
+
+        Pop(item);
+
+        DecreaseSyncCounter();
+        return true;
+
+    }
+
+    // Removes every item predicate returns true for, the rest keep their order. Returns how many were removed.
+    template<class Predicate>
+    size_type RemoveIf(Predicate predicate) {
+
+        std::lock_guard<std::mutex> lock(mtx);
+
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            T& item = items[(head + i) % Capacity];
+            if (predicate(item)) {
+                continue;
+            }
+            if (kept != i) {
+                items[(head + kept) % Capacity] = std::move(item);
+            }
+            kept++;
+        }
+
+        size_t removed = count - kept;
+        for (size_t i = kept; i < count; i++) {
+            items[(head + i) % Capacity] = T();
+        }
+        count = kept;
+
+        return removed;
+
+    }
+
+    void Finish() {
+
+        std::unique_lock<std::mutex> lock(mtx);
+
+        finish_processing = true;
+        cv.notify_all();
+
+        sync_wait.wait(lock, [&]() {
+            return sync_counter == 0;
+        });
+
+        finish_processing = false;
+
+    }
+
+};
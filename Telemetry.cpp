@@ -0,0 +1,202 @@
+#include "Telemetry.h"
+
+Telemetry::Telemetry() :
+    _queueDepth(0),
+    _queueHighWater(0),
+    _connections(0),
+    _connectedMs(0),
+    _connectedSinceMs(0),
+    _periodStartMs(0)
+{
+    for (uint8_t slot = 0; slot < TELEMETRY_MAX_DEVICES; slot++)
+    {
+        _deviceNames[slot].store(nullptr, std::memory_order_relaxed);
+        for (uint8_t counter = 0; counter < TELEMETRY_DEVICE_COUNTERS; counter++)
+        {
+            _counters[slot][counter].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    for (uint8_t bucket = 0; bucket < TELEMETRY_LATENCY_BUCKETS; bucket++)
+    {
+        _queueLatency[bucket].store(0, std::memory_order_relaxed);
+    }
+
+    CodeTable* tables[] = { &_notifyStatus, &_disconnectReasons };
+    for (CodeTable* table : tables)
+    {
+        for (uint8_t i = 0; i < TELEMETRY_MAX_CODES; i++)
+        {
+            table->codes[i].store(0, std::memory_order_relaxed);
+            table->counts[i].store(0, std::memory_order_relaxed);
+        }
+        table->other.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint8_t Telemetry::registerDevice(const char* deviceName)
+{
+    for (uint8_t slot = 0; slot < TELEMETRY_MAX_DEVICES; slot++)
+    {
+        const char* expected = nullptr;
+        if (_deviceNames[slot].compare_exchange_strong(expected, deviceName ? deviceName : "", std::memory_order_relaxed))
+        {
+            // A reused slot starts from zero
+            for (uint8_t counter = 0; counter < TELEMETRY_DEVICE_COUNTERS; counter++)
+            {
+                _counters[slot][counter].store(0, std::memory_order_relaxed);
+            }
+            return slot;
+        }
+    }
+    return TELEMETRY_SLOT_NONE;
+}
+
+void Telemetry::unregisterDevice(uint8_t slot)
+{
+    if (slot < TELEMETRY_MAX_DEVICES)
+        _deviceNames[slot].store(nullptr, std::memory_order_relaxed);
+}
+
+void Telemetry::onNotifyStatus(int code)
+{
+    countCode(_notifyStatus, code);
+}
+
+void Telemetry::onConnected(uint32_t nowMs, bool firstHost)
+{
+    _connections.fetch_add(1, std::memory_order_relaxed);
+    if (firstHost)
+        _connectedSinceMs.store(nowMs ? nowMs : 1, std::memory_order_relaxed);
+}
+
+void Telemetry::onDisconnected(uint32_t nowMs, bool lastHost, int reason)
+{
+    countCode(_disconnectReasons, reason);
+
+    if (lastHost)
+    {
+        uint32_t since = _connectedSinceMs.exchange(0, std::memory_order_relaxed);
+        if (since != 0)
+            _connectedMs.fetch_add(nowMs - since, std::memory_order_relaxed);
+    }
+}
+
+TelemetrySnapshot Telemetry::getSnapshot(uint32_t nowMs, bool reset)
+{
+    TelemetrySnapshot snapshot;
+    getSnapshot(snapshot, nowMs, reset);
+    return snapshot;
+}
+
+void Telemetry::getSnapshot(TelemetrySnapshot& snapshot, uint32_t nowMs, bool reset)
+{
+    snapshot = TelemetrySnapshot();
+
+    uint32_t periodStart = reset ? _periodStartMs.exchange(nowMs, std::memory_order_relaxed) : _periodStartMs.load(std::memory_order_relaxed);
+    snapshot.periodMs = nowMs - periodStart;
+
+    for (uint8_t slot = 0; slot < TELEMETRY_MAX_DEVICES; slot++)
+    {
+        snapshot.devices[slot].deviceName = _deviceNames[slot].load(std::memory_order_relaxed);
+        for (uint8_t counter = 0; counter < TELEMETRY_DEVICE_COUNTERS; counter++)
+        {
+            snapshot.devices[slot].counters[counter] = read(_counters[slot][counter], reset);
+        }
+    }
+
+    snapshot.notifyStatusCount = readCodes(_notifyStatus, snapshot.notifyStatus, snapshot.otherNotifyStatus, reset);
+    snapshot.disconnectReasonCount = readCodes(_disconnectReasons, snapshot.disconnectReasons, snapshot.otherDisconnectReasons, reset);
+
+    for (uint8_t bucket = 0; bucket < TELEMETRY_LATENCY_BUCKETS; bucket++)
+    {
+        snapshot.queueLatency[bucket] = read(_queueLatency[bucket], reset);
+    }
+
+    // The high water mark starts again from the current depth
+    snapshot.deferredQueueDepth = _queueDepth.load(std::memory_order_relaxed);
+    snapshot.deferredQueueHighWater = reset ?
+        _queueHighWater.exchange(_queueDepth.load(std::memory_order_relaxed), std::memory_order_relaxed) :
+        _queueHighWater.load(std::memory_order_relaxed);
+    snapshot.connections = read(_connections, reset);
+
+    // Count the connection still in progress up to now
+    snapshot.connectedMs = read(_connectedMs, reset);
+    uint32_t since = _connectedSinceMs.load(std::memory_order_relaxed);
+    if (since != 0)
+    {
+        snapshot.connectedMs += nowMs - since;
+        if (reset)
+            _connectedSinceMs.compare_exchange_strong(since, nowMs ? nowMs : 1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t Telemetry::getLatencyPercentile(const uint32_t* buckets, uint8_t percent)
+{
+    uint64_t total = 0;
+    for (uint8_t bucket = 0; bucket < TELEMETRY_LATENCY_BUCKETS; bucket++)
+    {
+        total += buckets[bucket];
+    }
+    if (total == 0)
+        return 0;
+
+    uint64_t target = (total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t bucket = 0; bucket < TELEMETRY_LATENCY_BUCKETS; bucket++)
+    {
+        seen += buckets[bucket];
+        if (seen >= target && seen > 0)
+            return 1UL << bucket;
+    }
+    return 1UL << (TELEMETRY_LATENCY_BUCKETS - 1);
+}
+
+void Telemetry::countCode(CodeTable& table, int32_t code)
+{
+    // 0 marks a free entry, so it can't get one of its own
+    if (code == 0)
+    {
+        table.other.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    for (uint8_t i = 0; i < TELEMETRY_MAX_CODES; i++)
+    {
+        int32_t current = table.codes[i].load(std::memory_order_relaxed);
+        if (current == 0 && table.codes[i].compare_exchange_strong(current, code, std::memory_order_relaxed))
+            current = code;
+
+        if (current == code)
+        {
+            table.counts[i].fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    table.other.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint8_t Telemetry::readCodes(CodeTable& table, TelemetryCodeCount* out, uint32_t& other, bool reset)
+{
+    // Codes keep their entries across resets, only the counts start again
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < TELEMETRY_MAX_CODES; i++)
+    {
+        int32_t code = table.codes[i].load(std::memory_order_relaxed);
+        uint32_t value = read(table.counts[i], reset);
+        if (code != 0 && value > 0)
+        {
+            out[count].code = code;
+            out[count].count = value;
+            count++;
+        }
+    }
+    other = read(table.other, reset);
+    return count;
+}
+
+uint32_t Telemetry::read(std::atomic<uint32_t>& value, bool reset)
+{
+    return reset ? value.exchange(0, std::memory_order_relaxed) : value.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,122 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#define TELEMETRY_MAX_DEVICES 8
+#define TELEMETRY_MAX_CODES 8               // Distinct notify status codes and disconnect reasons kept apart
+#define TELEMETRY_SLOT_NONE 0xFF
+#define TELEMETRY_LATENCY_BUCKETS 16        // Bucket n counts latencies below 2^n microseconds, the last one everything above
+
+// Per device counters, used as indexes into the counter table
+#define TELEMETRY_REPORTS_BUILT 0           // Reports built and handed to notifyReport
+#define TELEMETRY_REPORTS_NOTIFIED 1        // Notifications the stack accepted, one per host
+#define TELEMETRY_REPORTS_SUPPRESSED 2      // Not built because no host subscribed to them
+#define TELEMETRY_REPORTS_DROPPED 3         // Dropped because no host was connected, expired in the queue or found it full
+#define TELEMETRY_NOTIFY_FAILURES 4         // notify() calls the stack refused
+#define TELEMETRY_BYTES_SENT 5
+#define TELEMETRY_DEVICE_COUNTERS 6
+
+struct DeviceTelemetry {
+    const char* deviceName;                 // nullptr for an unused slot
+    uint32_t counters[TELEMETRY_DEVICE_COUNTERS];
+};
+
+struct TelemetryCodeCount {
+    int32_t code;
+    uint32_t count;
+};
+
+struct TelemetrySnapshot {
+    uint32_t periodMs;                      // Time covered since the last reset
+    DeviceTelemetry devices[TELEMETRY_MAX_DEVICES];
+
+    // Notify status codes other than success, as reported through onStatus
+    TelemetryCodeCount notifyStatus[TELEMETRY_MAX_CODES];
+    uint8_t notifyStatusCount;
+    uint32_t otherNotifyStatus;             // Failures whose code didn't fit into the table
+
+    TelemetryCodeCount disconnectReasons[TELEMETRY_MAX_CODES];
+    uint8_t disconnectReasonCount;
+    uint32_t otherDisconnectReasons;
+
+    uint32_t deferredQueueDepth;
+    uint32_t deferredQueueHighWater;
+    // Time deferred reports spent in the queue before they were sent
+    uint32_t queueLatency[TELEMETRY_LATENCY_BUCKETS];
+    uint32_t connections;
+    uint32_t connectedMs;                   // Time at least one host was connected
+};
+
+// Fixed size counter block. Every update is a single relaxed atomic operation, so the report paths
+// never take a lock for it. Snapshots read each counter on its own and resetting exchanges it with 0,
+// so no update is lost, but counters of one snapshot may be a few updates apart.
+class Telemetry
+{
+public:
+    Telemetry();
+
+    // Returns the slot the device counts into, TELEMETRY_SLOT_NONE if all slots are taken
+    uint8_t registerDevice(const char* deviceName);
+    void unregisterDevice(uint8_t slot);
+
+    void add(uint8_t slot, uint8_t counter, uint32_t amount = 1) {
+        if (slot < TELEMETRY_MAX_DEVICES && counter < TELEMETRY_DEVICE_COUNTERS)
+            _counters[slot][counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    void onNotifyStatus(int code);
+    void onConnected(uint32_t nowMs, bool firstHost);
+    void onDisconnected(uint32_t nowMs, bool lastHost, int reason);
+
+    void onReportQueued() {
+        uint32_t depth = _queueDepth.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint32_t highWater = _queueHighWater.load(std::memory_order_relaxed);
+        while (depth > highWater && !_queueHighWater.compare_exchange_weak(highWater, depth, std::memory_order_relaxed)) {}
+    }
+    void onReportDequeued() { _queueDepth.fetch_sub(1, std::memory_order_relaxed); }
+
+    void addQueueLatency(uint32_t micros) {
+        uint8_t bucket = 0;
+        while (bucket < TELEMETRY_LATENCY_BUCKETS - 1 && micros >= (1UL << bucket))
+            bucket++;
+        _queueLatency[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Upper bound in microseconds of the bucket holding the given percentile of a latency histogram,
+    // 0 if the histogram is empty. Counts can be differences between two snapshots.
+    static uint32_t getLatencyPercentile(const uint32_t* buckets, uint8_t percent);
+
+    TelemetrySnapshot getSnapshot(uint32_t nowMs, bool reset = false);
+    // Same as above, filled in place for callers that can't spare the stack for a snapshot
+    void getSnapshot(TelemetrySnapshot& snapshot, uint32_t nowMs, bool reset = false);
+
+private:
+    struct CodeTable {
+        std::atomic<int32_t> codes[TELEMETRY_MAX_CODES];
+        std::atomic<uint32_t> counts[TELEMETRY_MAX_CODES];
+        std::atomic<uint32_t> other;
+    };
+
+    static void countCode(CodeTable& table, int32_t code);
+    static uint8_t readCodes(CodeTable& table, TelemetryCodeCount* out, uint32_t& other, bool reset);
+    static uint32_t read(std::atomic<uint32_t>& value, bool reset);
+
+    std::atomic<const char*> _deviceNames[TELEMETRY_MAX_DEVICES];
+    std::atomic<uint32_t> _counters[TELEMETRY_MAX_DEVICES][TELEMETRY_DEVICE_COUNTERS];
+
+    CodeTable _notifyStatus;
+    CodeTable _disconnectReasons;
+
+    std::atomic<uint32_t> _queueDepth;
+    std::atomic<uint32_t> _queueHighWater;
+    std::atomic<uint32_t> _queueLatency[TELEMETRY_LATENCY_BUCKETS];
+    std::atomic<uint32_t> _connections;
+    std::atomic<uint32_t> _connectedMs;
+    std::atomic<uint32_t> _connectedSinceMs;    // 0 while no host is connected
+    std::atomic<uint32_t> _periodStartMs;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,353 @@
+#include "TouchConfiguration.h"
+#include "HIDTypes.h"
+
+TouchConfiguration::TouchConfiguration() :
+    BaseCompositeDeviceConfiguration(TOUCH_REPORT_ID),
+    _touchType(TOUCH_TYPE_TOUCHSCREEN),
+    _maxContacts(5),
+    _contactsPerReport(5),
+    _logicalMaxX(4095),
+    _logicalMaxY(4095),
+    _physicalMaxX(1000),
+    _physicalMaxY(1000)
+{
+}
+
+const char* TouchConfiguration::getDeviceName() const {
+    return TOUCH_DEVICE_NAME;
+}
+
+uint8_t TouchConfiguration::getDeviceReportSize() const
+{
+    // Contact slots, then scan time (2 bytes) and contact count (1 byte)
+    uint8_t reportSize = this->getContactsPerReport() * TOUCH_CONTACT_NUM_BYTES + 3;
+
+    // Touchpad click button + 7 bits padding
+    if (this->getIncludeButton())
+    {
+        reportSize++;
+    }
+
+    return reportSize;
+}
+
+uint32_t TouchConfiguration::getConfigHash() const
+{
+    uint32_t hash = getBaseConfigHash();
+    hash = hashConfigBytes(hash, &_touchType, sizeof(_touchType));
+    hash = hashConfigBytes(hash, &_maxContacts, sizeof(_maxContacts));
+    hash = hashConfigBytes(hash, &_contactsPerReport, sizeof(_contactsPerReport));
+    hash = hashConfigBytes(hash, &_logicalMaxX, sizeof(_logicalMaxX));
+    hash = hashConfigBytes(hash, &_logicalMaxY, sizeof(_logicalMaxY));
+    hash = hashConfigBytes(hash, &_physicalMaxX, sizeof(_physicalMaxX));
+    hash = hashConfigBytes(hash, &_physicalMaxY, sizeof(_physicalMaxY));
+    return hash;
+}
+
+size_t TouchConfiguration::getDeviceReportDescriptorSize() const
+{
+    // The DescriptorWriter in makeDeviceReport only counts when there is no buffer
+    return makeDeviceReport(nullptr, 0);
+}
+
+size_t TouchConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize) const
+{
+    DescriptorWriter descriptor(buffer, bufferSize);
+    size_t hidReportDescriptorSize = 0;
+
+    descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
+    descriptor[hidReportDescriptorSize++] = 0x0D; // Digitizer
+
+    descriptor[hidReportDescriptorSize++] = USAGE(1);
+    descriptor[hidReportDescriptorSize++] = this->getTouchType(); // Touch Screen or Touch Pad
+
+    descriptor[hidReportDescriptorSize++] = COLLECTION(1);
+    descriptor[hidReportDescriptorSize++] = 0x01; // Application
+
+    descriptor[hidReportDescriptorSize++] = REPORT_ID(1);
+    descriptor[hidReportDescriptorSize++] = this->getReportId();
+
+    // One finger collection per contact slot
+    for (uint8_t slot = 0; slot < this->getContactsPerReport(); slot++)
+    {
+        hidReportDescriptorSize = appendContactItems(descriptor, hidReportDescriptorSize);
+    }
+
+    descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
+    descriptor[hidReportDescriptorSize++] = 0x0D; // Digitizer
+
+    // Scan time, in 100us units
+    descriptor[hidReportDescriptorSize++] = UNIT_EXPONENT(1);
+    descriptor[hidReportDescriptorSize++] = 0x0C; // Unit Exponent (-4)
+
+    descriptor[hidReportDescriptorSize++] = UNIT(2);
+    descriptor[hidReportDescriptorSize++] = 0x01; // Seconds
+    descriptor[hidReportDescriptorSize++] = 0x10;
+
+    descriptor[hidReportDescriptorSize++] = LOGICAL_MINIMUM(1);
+    descriptor[hidReportDescriptorSize++] = 0x00;
+
+    descriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(3); // 4 byte item
+    descriptor[hidReportDescriptorSize++] = 0xFF; // Logical Max (65535)
+    descriptor[hidReportDescriptorSize++] = 0xFF;
+    descriptor[hidReportDescriptorSize++] = 0x00;
+    descriptor[hidReportDescriptorSize++] = 0x00;
+
+    descriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
+    descriptor[hidReportDescriptorSize++] = 0x10;
+
+    descriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
+    descriptor[hidReportDescriptorSize++] = 0x01;
+
+    descriptor[hidReportDescriptorSize++] = USAGE(1);
+    descriptor[hidReportDescriptorSize++] = 0x56; // Scan Time
+
+    descriptor[hidReportDescriptorSize++] = HIDINPUT(1);
+    descriptor[hidReportDescriptorSize++] = 0x02; // Input (Data, Variable, Absolute)
+
+    descriptor[hidReportDescriptorSize++] = UNIT_EXPONENT(1);
+    descriptor[hidReportDescriptorSize++] = 0x00;
+
+    descriptor[hidReportDescriptorSize++] = UNIT(1);
+    descriptor[hidReportDescriptorSize++] = 0x00;
+
+    // Contact count, only the first report of a frame carries the total
+    descriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(1);
+    descriptor[hidReportDescriptorSize++] = 0x7F; // Logical Max (127)
+
+    descriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
+    descriptor[hidReportDescriptorSize++] = 0x08;
+
+    descriptor[hidReportDescriptorSize++] = USAGE(1);
+    descriptor[hidReportDescriptorSize++] = 0x54; // Contact Count
+
+    descriptor[hidReportDescriptorSize++] = HIDINPUT(1);
+    descriptor[hidReportDescriptorSize++] = 0x02; // Input (Data, Variable, Absolute)
+
+    if (this->getIncludeButton())
+    {
+        descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
+        descriptor[hidReportDescriptorSize++] = 0x09; // Button
+
+        descriptor[hidReportDescriptorSize++] = USAGE(1);
+        descriptor[hidReportDescriptorSize++] = 0x01; // Button 1
+
+        descriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(1);
+        descriptor[hidReportDescriptorSize++] = 0x01;
+
+        descriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
+        descriptor[hidReportDescriptorSize++] = 0x01;
+
+        descriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
+        descriptor[hidReportDescriptorSize++] = 0x01;
+
+        descriptor[hidReportDescriptorSize++] = HIDINPUT(1);
+        descriptor[hidReportDescriptorSize++] = 0x02; // Input (Data, Variable, Absolute)
+
+        descriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
+        descriptor[hidReportDescriptorSize++] = 0x07;
+
+        descriptor[hidReportDescriptorSize++] = HIDINPUT(1);
+        descriptor[hidReportDescriptorSize++] = 0x03; // Input (Constant, Variable, Absolute) ;7 bit padding
+    }
+
+    // Feature: Contact Count Maximum (and Pad Type for touchpads)
+    descriptor[hidReportDescriptorSize++] = USAGE_PAGE(1);
+    descriptor[hidReportDescriptorSize++] = 0x0D; // Digitizer
+
+    if (this->getTouchType() == TOUCH_TYPE_TOUCHPAD)
+    {
+        descriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(1);
+        descriptor[hidReportDescriptorSize++] = 0x0F;
+
+        descriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
+        descriptor[hidReportDescriptorSize++] = 0x04;
+
+        descriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
+        descriptor[hidReportDescriptorSize++] = 0x02;
+
+        descriptor[hidReportDescriptorSize++] = USAGE(1);
+        descriptor[hidReportDescriptorSize++] = 0x55; // Contact Count Maximum
+
+        descriptor[hidReportDescriptorSize++] = USAGE(1);
+        descriptor[hidReportDescriptorSize++] = 0x59; // Pad Type
+    }
+    else
+    {
+        descriptor[hidReportDescriptorSize++] = LOGICAL_MAXIMUM(1);
+        descriptor[hidReportDescriptorSize++] = this->getMaxContacts();
+
+        descriptor[hidReportDescriptorSize++] = REPORT_SIZE(1);
+        descriptor[hidReportDescriptorSize++] = 0x08;
+
+        descriptor[hidReportDescriptorSize++] = REPORT_COUNT(1);
+        descriptor[hidReportDescriptorSize++] = 0x01;
+
+        descriptor[hidReportDescriptorSize++] = USAGE(1);
+        descriptor[hidReportDescriptorSize++] = 0x55; // Contact Count Maximum
+    }
+
+    descriptor[hidReportDescriptorSize++] = FEATURE(1);
+    descriptor[hidReportDescriptorSize++] = 0x02; // Feature (Data, Variable, Absolute)
+
+    // END_COLLECTION (Application)
+    descriptor[hidReportDescriptorSize++] = END_COLLECTION(0);
+
+    return descriptor.finish(hidReportDescriptorSize);
+}
+
+size_t TouchConfiguration::appendContactItems(DescriptorWriter& buffer, size_t index) const
+{
+    buffer[index++] = USAGE_PAGE(1);
+    buffer[index++] = 0x0D; // Digitizer
+
+    buffer[index++] = USAGE(1);
+    buffer[index++] = 0x22; // Finger
+
+    buffer[index++] = COLLECTION(1);
+    buffer[index++] = 0x02; // Logical
+
+    // Tip switch and confidence bits
+    buffer[index++] = LOGICAL_MINIMUM(1);
+    buffer[index++] = 0x00;
+
+    buffer[index++] = LOGICAL_MAXIMUM(1);
+    buffer[index++] = 0x01;
+
+    buffer[index++] = REPORT_SIZE(1);
+    buffer[index++] = 0x01;
+
+    buffer[index++] = REPORT_COUNT(1);
+    buffer[index++] = 0x01;
+
+    buffer[index++] = USAGE(1);
+    buffer[index++] = 0x42; // Tip Switch
+
+    buffer[index++] = HIDINPUT(1);
+    buffer[index++] = 0x02; // Input (Data, Variable, Absolute)
+
+    buffer[index++] = USAGE(1);
+    buffer[index++] = 0x47; // Confidence
+
+    buffer[index++] = HIDINPUT(1);
+    buffer[index++] = 0x02; // Input (Data, Variable, Absolute)
+
+    buffer[index++] = REPORT_COUNT(1);
+    buffer[index++] = 0x06;
+
+    buffer[index++] = HIDINPUT(1);
+    buffer[index++] = 0x03; // Input (Constant, Variable, Absolute) ;6 bit padding
+
+    // Contact identifier
+    buffer[index++] = LOGICAL_MAXIMUM(2);
+    buffer[index++] = 0xFF; // Logical Max (255)
+    buffer[index++] = 0x00;
+
+    buffer[index++] = REPORT_SIZE(1);
+    buffer[index++] = 0x08;
+
+    buffer[index++] = REPORT_COUNT(1);
+    buffer[index++] = 0x01;
+
+    buffer[index++] = USAGE(1);
+    buffer[index++] = 0x51; // Contact Identifier
+
+    buffer[index++] = HIDINPUT(1);
+    buffer[index++] = 0x02; // Input (Data, Variable, Absolute)
+
+    // Absolute position, physical size in 0.1 mm
+    buffer[index++] = USAGE_PAGE(1);
+    buffer[index++] = 0x01; // Generic Desktop
+
+    buffer[index++] = UNIT_EXPONENT(1);
+    buffer[index++] = 0x0E; // Unit Exponent (-2)
+
+    buffer[index++] = UNIT(1);
+    buffer[index++] = 0x11; // Centimeters
+
+    buffer[index++] = REPORT_SIZE(1);
+    buffer[index++] = 0x10;
+
+    buffer[index++] = LOGICAL_MAXIMUM(2);
+    buffer[index++] = lowByte(this->getLogicalMaxX());
+    buffer[index++] = highByte(this->getLogicalMaxX());
+
+    buffer[index++] = PHYSICAL_MAXIMUM(2);
+    buffer[index++] = lowByte(this->getPhysicalMaxX());
+    buffer[index++] = highByte(this->getPhysicalMaxX());
+
+    buffer[index++] = USAGE(1);
+    buffer[index++] = 0x30; // X
+
+    buffer[index++] = HIDINPUT(1);
+    buffer[index++] = 0x02; // Input (Data, Variable, Absolute)
+
+    buffer[index++] = LOGICAL_MAXIMUM(2);
+    buffer[index++] = lowByte(this->getLogicalMaxY());
+    buffer[index++] = highByte(this->getLogicalMaxY());
+
+    buffer[index++] = PHYSICAL_MAXIMUM(2);
+    buffer[index++] = lowByte(this->getPhysicalMaxY());
+    buffer[index++] = highByte(this->getPhysicalMaxY());
+
+    buffer[index++] = USAGE(1);
+    buffer[index++] = 0x31; // Y
+
+    buffer[index++] = HIDINPUT(1);
+    buffer[index++] = 0x02; // Input (Data, Variable, Absolute)
+
+    // Reset units so they do not leak into the following items
+    buffer[index++] = PHYSICAL_MAXIMUM(1);
+    buffer[index++] = 0x00;
+
+    buffer[index++] = UNIT_EXPONENT(1);
+    buffer[index++] = 0x00;
+
+    buffer[index++] = UNIT(1);
+    buffer[index++] = 0x00;
+
+    buffer[index++] = END_COLLECTION(0);
+
+    return index;
+}
+
+uint8_t TouchConfiguration::getTouchType() const { return _touchType; }
+uint8_t TouchConfiguration::getMaxContacts() const { return _maxContacts; }
+uint8_t TouchConfiguration::getContactsPerReport() const { return _contactsPerReport; }
+uint16_t TouchConfiguration::getLogicalMaxX() const { return _logicalMaxX; }
+uint16_t TouchConfiguration::getLogicalMaxY() const { return _logicalMaxY; }
+uint16_t TouchConfiguration::getPhysicalMaxX() const { return _physicalMaxX; }
+uint16_t TouchConfiguration::getPhysicalMaxY() const { return _physicalMaxY; }
+bool TouchConfiguration::getIncludeButton() const { return _touchType == TOUCH_TYPE_TOUCHPAD; }
+
+uint8_t TouchConfiguration::getFeatureReportSize() const
+{
+    // Contact Count Maximum (touchpads share the byte with Pad Type)
+    return 1;
+}
+
+void TouchConfiguration::setTouchType(uint8_t value) { _touchType = value; }
+
+void TouchConfiguration::setMaxContacts(uint8_t value)
+{
+    // Also keeps it within the 4 bit field touchpads use
+    _maxContacts = constrain(value, 1, TOUCH_POSSIBLE_CONTACTS);
+}
+
+void TouchConfiguration::setContactsPerReport(uint8_t value)
+{
+    _contactsPerReport = constrain(value, 1, TOUCH_POSSIBLE_CONTACTS_PER_REPORT);
+}
+
+void TouchConfiguration::setLogicalMax(uint16_t x, uint16_t y)
+{
+    // Logical maximum is a signed 16 bit item
+    _logicalMaxX = std::min(x, (uint16_t)0x7FFF);
+    _logicalMaxY = std::min(y, (uint16_t)0x7FFF);
+}
+
+void TouchConfiguration::setPhysicalMax(uint16_t x, uint16_t y)
+{
+    _physicalMaxX = std::min(x, (uint16_t)0x7FFF);
+    _physicalMaxY = std::min(y, (uint16_t)0x7FFF);
+}
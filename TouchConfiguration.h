@@ -0,0 +1,66 @@
+#ifndef ESP32_BLE_TOUCH_CONFIG_H
+#define ESP32_BLE_TOUCH_CONFIG_H
+
+#include <BaseCompositeDevice.h>
+
+#define TOUCH_REPORT_ID 0x30
+#define TOUCH_DEVICE_NAME "Touch"
+
+// Digitizer page application usages
+#define TOUCH_TYPE_TOUCHSCREEN 0x04
+#define TOUCH_TYPE_TOUCHPAD 0x05
+
+// Contacts that can be tracked at once
+#define TOUCH_POSSIBLE_CONTACTS 10
+
+// Contact slots that fit into a single report. Frames with more active
+// contacts are split over several reports (hybrid mode).
+#define TOUCH_POSSIBLE_CONTACTS_PER_REPORT 5
+
+// Bytes per contact slot: tip/confidence flags, contact id, 16 bit X, 16 bit Y
+#define TOUCH_CONTACT_NUM_BYTES 6
+
+class TouchConfiguration : public BaseCompositeDeviceConfiguration
+{
+public:
+    TouchConfiguration();
+
+    const char* getDeviceName() const override;
+    uint8_t getDeviceReportSize() const override;
+    uint32_t getConfigHash() const override;
+    size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override;
+    size_t getDeviceReportDescriptorSize() const override;
+
+    uint8_t getTouchType() const;
+    uint8_t getMaxContacts() const;
+    uint8_t getContactsPerReport() const;
+    uint16_t getLogicalMaxX() const;
+    uint16_t getLogicalMaxY() const;
+    uint16_t getPhysicalMaxX() const;
+    uint16_t getPhysicalMaxY() const;
+    bool getIncludeButton() const;
+    uint8_t getFeatureReportSize() const;
+
+    void setTouchType(uint8_t value);
+    // Reported to the host as Contact Count Maximum
+    void setMaxContacts(uint8_t value);
+    // Contact slots per report. The report grows by TOUCH_CONTACT_NUM_BYTES per slot,
+    // so keep it small enough to fit the negotiated ATT MTU.
+    void setContactsPerReport(uint8_t value);
+    void setLogicalMax(uint16_t x, uint16_t y);
+    // Physical size of the surface in 0.1 mm units
+    void setPhysicalMax(uint16_t x, uint16_t y);
+
+private:
+    size_t appendContactItems(DescriptorWriter& buffer, size_t index) const;
+
+    uint8_t _touchType;
+    uint8_t _maxContacts;
+    uint8_t _contactsPerReport;
+    uint16_t _logicalMaxX;
+    uint16_t _logicalMaxY;
+    uint16_t _physicalMaxX;
+    uint16_t _physicalMaxY;
+};
+
+#endif
@@ -0,0 +1,331 @@
+#include "TouchDevice.h"
+#include "BleCompositeHID.h"
+
+#if defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define LOG_TAG "TouchDevice"
+#else
+#include "esp_log.h"
+static const char *LOG_TAG = "TouchDevice";
+#endif
+
+TouchDevice::TouchDevice() :
+    _config(TouchConfiguration()),
+    _feature(nullptr),
+    _contacts(),
+    _contactUsed(),
+    _buttonPressed(false)
+{
+}
+
+TouchDevice::TouchDevice(const TouchConfiguration& config) :
+    _config(config),
+    _feature(nullptr),
+    _contacts(),
+    _contactUsed(),
+    _buttonPressed(false)
+{
+}
+
+void TouchDevice::init(NimBLEHIDDevice* hid)
+{
+    auto input = hid->getInputReport(_config.getReportId());
+
+    // Contact Count Maximum is static, the host only ever reads it
+    _feature = hid->getFeatureReport(_config.getReportId());
+    uint8_t featureValue = _config.getMaxContacts() & 0x0F; // Pad type 0 (depressible) in the upper nibble for touchpads
+    if (_config.getTouchType() != TOUCH_TYPE_TOUCHPAD)
+    {
+        featureValue = _config.getMaxContacts();
+    }
+    _feature->setValue(&featureValue, sizeof(featureValue));
+
+    setCharacteristics(input, nullptr);
+}
+
+const BaseCompositeDeviceConfiguration* TouchDevice::getDeviceConfig() const
+{
+    return &_config;
+}
+
+void TouchDevice::restoreState()
+{
+    sendTouchReportImpl();
+}
+
+uint8_t TouchDevice::getCharacteristics(NimBLECharacteristic** characteristics, uint8_t maxCount)
+{
+    uint8_t count = BaseCompositeDevice::getCharacteristics(characteristics, maxCount);
+    if (_feature && count < maxCount)
+    {
+        characteristics[count++] = _feature;
+    }
+    return count;
+}
+
+void TouchDevice::resetContacts()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (uint8_t slot = 0; slot < TOUCH_POSSIBLE_CONTACTS; slot++)
+    {
+        _contacts[slot] = TouchContact();
+        _contactUsed[slot] = false;
+    }
+    _buttonPressed = false;
+}
+
+int8_t TouchDevice::findSlot(uint8_t id) const
+{
+    for (uint8_t slot = 0; slot < TOUCH_POSSIBLE_CONTACTS; slot++)
+    {
+        if (_contactUsed[slot] && _contacts[slot].id == id)
+            return slot;
+    }
+    return -1;
+}
+
+int8_t TouchDevice::findFreeSlot() const
+{
+    uint8_t used = 0;
+    for (uint8_t slot = 0; slot < TOUCH_POSSIBLE_CONTACTS; slot++)
+    {
+        if (_contactUsed[slot])
+            used++;
+    }
+
+    // Never track more contacts than the host was told about
+    if (used >= _config.getMaxContacts())
+        return -1;
+
+    for (uint8_t slot = 0; slot < TOUCH_POSSIBLE_CONTACTS; slot++)
+    {
+        if (!_contactUsed[slot])
+            return slot;
+    }
+    return -1;
+}
+
+void TouchDevice::updateContact(uint8_t id, bool tipSwitch, uint16_t x, uint16_t y, bool confidence)
+{
+    int8_t slot = findSlot(id);
+    if (slot < 0)
+    {
+        // Lifting a contact the host never saw is a no-op
+        if (!tipSwitch)
+            return;
+
+        slot = findFreeSlot();
+        if (slot < 0)
+        {
+            ESP_LOGW(LOG_TAG, "No free slot for contact %d", id);
+            return;
+        }
+        _contactUsed[slot] = true;
+    }
+
+    _contacts[slot].id = id;
+    _contacts[slot].tipSwitch = tipSwitch;
+    _contacts[slot].confidence = confidence;
+    if (tipSwitch)
+    {
+        // A lifted contact is reported at its last position
+        _contacts[slot].x = std::min(x, _config.getLogicalMaxX());
+        _contacts[slot].y = std::min(y, _config.getLogicalMaxY());
+    }
+}
+
+void TouchDevice::setContact(uint8_t id, uint16_t x, uint16_t y, bool confidence)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        updateContact(id, true, x, y, confidence);
+    }
+
+    if (_config.getAutoReport())
+    {
+        sendTouchReport();
+    }
+}
+
+void TouchDevice::releaseContact(uint8_t id)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        updateContact(id, false, 0, 0, true);
+    }
+
+    if (_config.getAutoReport())
+    {
+        sendTouchReport();
+    }
+}
+
+void TouchDevice::setContacts(const TouchContact* contacts, uint8_t count)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Lift everything that is not part of the new frame
+        for (uint8_t slot = 0; slot < TOUCH_POSSIBLE_CONTACTS; slot++)
+        {
+            if (!_contactUsed[slot])
+                continue;
+
+            bool present = false;
+            for (uint8_t i = 0; i < count; i++)
+            {
+                if (contacts[i].id == _contacts[slot].id && contacts[i].tipSwitch)
+                {
+                    present = true;
+                    break;
+                }
+            }
+            if (!present)
+                _contacts[slot].tipSwitch = false;
+        }
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            updateContact(contacts[i].id, contacts[i].tipSwitch, contacts[i].x, contacts[i].y, contacts[i].confidence);
+        }
+    }
+
+    if (_config.getAutoReport())
+    {
+        sendTouchReport();
+    }
+}
+
+void TouchDevice::pressButton()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _buttonPressed = true;
+    }
+
+    if (_config.getAutoReport())
+    {
+        sendTouchReport();
+    }
+}
+
+void TouchDevice::releaseButton()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _buttonPressed = false;
+    }
+
+    if (_config.getAutoReport())
+    {
+        sendTouchReport();
+    }
+}
+
+uint8_t TouchDevice::getContactCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint8_t count = 0;
+    for (uint8_t slot = 0; slot < TOUCH_POSSIBLE_CONTACTS; slot++)
+    {
+        if (_contactUsed[slot] && _contacts[slot].tipSwitch)
+            count++;
+    }
+    return count;
+}
+
+void TouchDevice::sendTouchReport(bool defer)
+{
+    if (!shouldReport(getInput()))
+        return;
+
+    if (defer || _config.getAutoDefer())
+    {
+        queueDeferredReport(std::bind(&TouchDevice::sendTouchReportImpl, this));
+    }
+    else
+    {
+        sendTouchReportImpl();
+    }
+}
+
+void TouchDevice::sendTouchReportImpl()
+{
+    auto input = getInput();
+    auto parentDevice = this->getParent();
+
+    if (!input || !parentDevice)
+        return;
+
+    if(!parentDevice->isConnected()) {
+        countDroppedReport();
+        return;
+    }
+
+    // Hosts that didn't subscribe to this report never read it, skip building it
+    if(!isInputSubscribed(input))
+        return;
+
+    uint8_t m[getInputReportSize()];
+    uint8_t contactsPerReport = _config.getContactsPerReport();
+
+    // Snapshot the frame so every report of it shares the same scan time and contact list
+    TouchContact frame[TOUCH_POSSIBLE_CONTACTS];
+    uint8_t frameCount = 0;
+    bool buttonPressed;
+    uint16_t scanTime = (micros() / 100) & 0xFFFF; // 100us units, wraps around
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (uint8_t slot = 0; slot < TOUCH_POSSIBLE_CONTACTS; slot++)
+        {
+            if (!_contactUsed[slot])
+                continue;
+
+            frame[frameCount++] = _contacts[slot];
+
+            // Lifted contacts are reported once, then their slot is freed
+            if (!_contacts[slot].tipSwitch)
+                _contactUsed[slot] = false;
+        }
+        buttonPressed = _buttonPressed;
+    }
+
+    // Hybrid mode: the first report carries the total contact count, the
+    // following reports of the same frame carry 0
+    uint8_t sent = 0;
+    do
+    {
+        uint8_t currentReportIndex = 0;
+        memset(&m, 0, sizeof(m));
+
+        for (uint8_t slot = 0; slot < contactsPerReport; slot++)
+        {
+            if (sent + slot < frameCount)
+            {
+                const TouchContact& contact = frame[sent + slot];
+                m[currentReportIndex] = (contact.tipSwitch ? 0x01 : 0x00) | (contact.confidence ? 0x02 : 0x00);
+                m[currentReportIndex + 1] = contact.id;
+                m[currentReportIndex + 2] = lowByte(contact.x);
+                m[currentReportIndex + 3] = highByte(contact.x);
+                m[currentReportIndex + 4] = lowByte(contact.y);
+                m[currentReportIndex + 5] = highByte(contact.y);
+            }
+            currentReportIndex += TOUCH_CONTACT_NUM_BYTES;
+        }
+
+        m[currentReportIndex++] = lowByte(scanTime);
+        m[currentReportIndex++] = highByte(scanTime);
+        m[currentReportIndex++] = (sent == 0) ? frameCount : 0;
+
+        if (_config.getIncludeButton())
+        {
+            m[currentReportIndex++] = buttonPressed ? 0x01 : 0x00;
+        }
+
+        input->setValue(m, sizeof(m));
+        notifyInput(input);
+
+        sent += contactsPerReport;
+    } while (sent < frameCount);
+}
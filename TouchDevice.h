@@ -0,0 +1,62 @@
+#ifndef ESP32_TOUCH_DEVICE_H
+#define ESP32_TOUCH_DEVICE_H
+
+#include "NimBLECharacteristic.h"
+#include <TouchConfiguration.h>
+#include <BaseCompositeDevice.h>
+#include <mutex>
+
+struct TouchContact {
+    uint8_t id = 0;
+    bool tipSwitch = false;     // Finger is touching the surface
+    bool confidence = true;     // Clear to false for palms and other unintended contacts
+    uint16_t x = 0;
+    uint16_t y = 0;
+};
+
+class TouchDevice : public BaseCompositeDevice {
+private:
+    TouchConfiguration _config;
+    NimBLECharacteristic* _feature;
+
+    TouchContact _contacts[TOUCH_POSSIBLE_CONTACTS];
+    bool _contactUsed[TOUCH_POSSIBLE_CONTACTS];
+    bool _buttonPressed;
+
+public:
+    TouchDevice();
+    TouchDevice(const TouchConfiguration& config);
+
+    void init(NimBLEHIDDevice* hid) override;
+    const BaseCompositeDeviceConfiguration* getDeviceConfig() const override;
+    void restoreState() override;
+    uint8_t getCharacteristics(NimBLECharacteristic** characteristics, uint8_t maxCount) override;
+
+    void resetContacts();
+
+    // Update one contact. A contact keeps its slot until it has been reported lifted.
+    void setContact(uint8_t id, uint16_t x, uint16_t y, bool confidence = true);
+    void releaseContact(uint8_t id);
+    // Replace the whole frame at once, contacts missing from the list are lifted.
+    // Sends a single frame when auto report is on, instead of one per finger.
+    void setContacts(const TouchContact* contacts, uint8_t count);
+
+    // Touchpad click (only reported when the touch type is TOUCH_TYPE_TOUCHPAD)
+    void pressButton();
+    void releaseButton();
+
+    uint8_t getContactCount();
+
+    void sendTouchReport(bool defer = false);
+
+private:
+    void sendTouchReportImpl();
+    int8_t findSlot(uint8_t id) const;
+    int8_t findFreeSlot() const;
+    void updateContact(uint8_t id, bool tipSwitch, uint16_t x, uint16_t y, bool confidence);
+
+    // Threading
+    std::mutex _mutex;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "XboxDescriptors.h"
 #include "BaseCompositeDevice.h"
+#include "XboxHaptics.h"
 
 class XboxGamepadDeviceConfiguration : public BaseCompositeDeviceConfiguration {
 public:
@@ -11,6 +12,31 @@ public:
     virtual size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override { 
         return -1;
     }
+
+    // The Xbox descriptors are fixed, so the controller model and report ID identify them
+    virtual uint32_t getConfigHash() const override { return getBaseConfigHash(); }
+
+    // Plays the duration, start delay and loop count of rumble reports on a timer task
+    // and reports the resulting motor duty through XboxGamepadDevice::onHapticsDuty
+    void setUseHapticsEngine(bool value);
+    bool getUseHapticsEngine() const;
+
+    void setHapticsTickMs(uint32_t milliseconds);
+    uint32_t getHapticsTickMs() const;
+
+    // Placement of the haptics task, which runs for the lifetime of the device and sleeps while nothing plays.
+    // Like BLEHostConfiguration::setAutoSendTask, core is 0, 1 or TASK_CORE_ANY and the stack is in bytes.
+    void setHapticsTask(uint8_t core, uint8_t priority, uint32_t stackSize);
+    uint8_t getHapticsTaskCore() const;
+    uint8_t getHapticsTaskPriority() const;
+    uint32_t getHapticsTaskStackSize() const;
+
+private:
+    bool _useHapticsEngine;
+    uint32_t _hapticsTickMs;
+    uint8_t _hapticsTaskCore;
+    uint8_t _hapticsTaskPriority;
+    uint32_t _hapticsTaskStackSize;
 };
 
 
@@ -20,6 +46,7 @@ public:
     virtual BLEHostConfiguration getIdealHostConfiguration() const override;
     virtual uint8_t getDeviceReportSize() const override;
     virtual size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override;
+    virtual size_t getDeviceReportDescriptorSize() const override;
 };
 
 
@@ -29,6 +56,7 @@ public:
     virtual BLEHostConfiguration getIdealHostConfiguration() const override;
     virtual uint8_t getDeviceReportSize() const override;
     virtual size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override;
+    virtual size_t getDeviceReportDescriptorSize() const override;
 };
 
 #endif // XBOX_GAMEPAD_CONFIGURATION_H
@@ -5,10 +5,31 @@
 
 // XboxGamepadDeviceConfiguration methods
 XboxGamepadDeviceConfiguration::XboxGamepadDeviceConfiguration(uint8_t reportId) : 
-    BaseCompositeDeviceConfiguration(reportId)
+    BaseCompositeDeviceConfiguration(reportId),
+    _useHapticsEngine(false),
+    _hapticsTickMs(XBOX_HAPTICS_DEFAULT_TICK_MS),
+    _hapticsTaskCore(TASK_CORE_ANY),
+    _hapticsTaskPriority(5),
+    _hapticsTaskStackSize(2048)
 {
 }
 
+void XboxGamepadDeviceConfiguration::setUseHapticsEngine(bool value) { _useHapticsEngine = value; }
+bool XboxGamepadDeviceConfiguration::getUseHapticsEngine() const { return _useHapticsEngine; }
+
+void XboxGamepadDeviceConfiguration::setHapticsTickMs(uint32_t milliseconds) { _hapticsTickMs = milliseconds > 0 ? milliseconds : 1; }
+uint32_t XboxGamepadDeviceConfiguration::getHapticsTickMs() const { return _hapticsTickMs; }
+
+void XboxGamepadDeviceConfiguration::setHapticsTask(uint8_t core, uint8_t priority, uint32_t stackSize)
+{
+    _hapticsTaskCore = core;
+    _hapticsTaskPriority = priority;
+    _hapticsTaskStackSize = stackSize;
+}
+uint8_t XboxGamepadDeviceConfiguration::getHapticsTaskCore() const { return _hapticsTaskCore; }
+uint8_t XboxGamepadDeviceConfiguration::getHapticsTaskPriority() const { return _hapticsTaskPriority; }
+uint32_t XboxGamepadDeviceConfiguration::getHapticsTaskStackSize() const { return _hapticsTaskStackSize; }
+
 BLEHostConfiguration XboxOneSControllerDeviceConfiguration::getIdealHostConfiguration() const {
     // Fake a xbox controller
     BLEHostConfiguration config;
@@ -53,9 +74,13 @@ uint8_t XboxOneSControllerDeviceConfiguration::getDeviceReportSize() const {
     return sizeof(XboxGamepadInputReportData); //16
 }
 
+size_t XboxOneSControllerDeviceConfiguration::getDeviceReportDescriptorSize() const {
+    return sizeof(XboxOneS_1708_HIDDescriptor);
+}
+
 size_t XboxOneSControllerDeviceConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize) const {
     size_t hidDescriptorSize = sizeof(XboxOneS_1708_HIDDescriptor);
-    if(hidDescriptorSize < bufferSize){
+    if(hidDescriptorSize <= bufferSize){
         memcpy(buffer, XboxOneS_1708_HIDDescriptor, hidDescriptorSize);
     } else {
         return -1;
@@ -112,9 +137,13 @@ uint8_t XboxSeriesXControllerDeviceConfiguration::getDeviceReportSize() const {
     return sizeof(XboxGamepadInputReportData); //16;
 }
 
+size_t XboxSeriesXControllerDeviceConfiguration::getDeviceReportDescriptorSize() const {
+    return sizeof(XboxOneS_1914_HIDDescriptor);
+}
+
 size_t XboxSeriesXControllerDeviceConfiguration::makeDeviceReport(uint8_t* buffer, size_t bufferSize) const {
     size_t hidDescriptorSize = sizeof(XboxOneS_1914_HIDDescriptor);
-    if(hidDescriptorSize < bufferSize){
+    if(hidDescriptorSize <= bufferSize){
         memcpy(buffer, XboxOneS_1914_HIDDescriptor, hidDescriptorSize);
     } else {
         return -1;
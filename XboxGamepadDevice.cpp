@@ -10,6 +10,9 @@
 static const char *LOG_TAG = "XboxGamepadDevice";
 #endif
 
+// The byte layout itself is checked against notes/packet_logs.txt by extras/host/test/test_xbox_report.cpp
+static_assert(sizeof(XboxGamepadInputReportData) == XBOX_INPUT_REPORT_SIZE, "Xbox input report no longer matches the HID descriptor size");
+
 XboxGamepadCallbacks::XboxGamepadCallbacks(XboxGamepadDevice* device) : _device(device)
 {
 }
@@ -17,10 +20,11 @@ XboxGamepadCallbacks::XboxGamepadCallbacks(XboxGamepadDevice* device) : _device(
 void XboxGamepadCallbacks::onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo)
 {    
     // An example packet we might receive from XInput might look like 0x0300002500ff00ff
-    XboxGamepadOutputReportData vibrationData = pCharacteristic->getValue<uint64_t>();
+    NimBLEAttValue value = pCharacteristic->getValue();
+    XboxGamepadOutputReportData vibrationData(value.data(), value.size());
     
     ESP_LOGD(LOG_TAG, "XboxGamepadCallbacks::onWrite, Size: %d, DC enable: %d, magnitudeWeak: %d, magnitudeStrong: %d, duration: %d, start delay: %d, loop count: %d", 
-        pCharacteristic->getValue().size(),
+        value.size(),
         vibrationData.dcEnableActuators, 
         vibrationData.weakMotorMagnitude, 
         vibrationData.strongMotorMagnitude, 
@@ -30,6 +34,7 @@ void XboxGamepadCallbacks::onWrite(NimBLECharacteristic* pCharacteristic, NimBLE
     );
 
     _device->onVibrate.fire(vibrationData);
+    _device->playHaptics(vibrationData);
 }
 
 void XboxGamepadCallbacks::onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo)
@@ -48,25 +53,51 @@ void XboxGamepadCallbacks::onStatus(NimBLECharacteristic* pCharacteristic, int c
 }
 
 XboxGamepadDevice::XboxGamepadDevice() :
-    _config(new XboxOneSControllerDeviceConfiguration()),
+    _leftStick(XBOX_STICK_MIN, XBOX_STICK_MAX),
+    _rightStick(XBOX_STICK_MIN, XBOX_STICK_MAX),
+    _leftTrigger(XBOX_TRIGGER_MIN, XBOX_TRIGGER_MAX, false),
+    _rightTrigger(XBOX_TRIGGER_MIN, XBOX_TRIGGER_MAX, false),
+    _avoidedReports(0),
+    _hapticsTaskHandle(nullptr),
+    _hapticsStopRequested(false),
+    _hapticsTaskExited(false),
     _extra_input(nullptr),
-    _callbacks(nullptr)
+    _callbacks(this),
+    _config(new XboxOneSControllerDeviceConfiguration())
 {
 }
 
 // XboxGamepadDevice methods
 XboxGamepadDevice::XboxGamepadDevice(XboxGamepadDeviceConfiguration* config) :
-    _config(config),
+    _leftStick(XBOX_STICK_MIN, XBOX_STICK_MAX),
+    _rightStick(XBOX_STICK_MIN, XBOX_STICK_MAX),
+    _leftTrigger(XBOX_TRIGGER_MIN, XBOX_TRIGGER_MAX, false),
+    _rightTrigger(XBOX_TRIGGER_MIN, XBOX_TRIGGER_MAX, false),
+    _avoidedReports(0),
+    _hapticsTaskHandle(nullptr),
+    _hapticsStopRequested(false),
+    _hapticsTaskExited(false),
     _extra_input(nullptr),
-    _callbacks(nullptr)
+    _callbacks(this),
+    _config(config)
 {
 }
 
 XboxGamepadDevice::~XboxGamepadDevice() {
-    if (getOutput() && _callbacks){
+    // No more output reports, so nothing wakes the haptics task after it was stopped
+    if (getOutput()){
         getOutput()->setCallbacks(nullptr);
-        delete _callbacks;
-        _callbacks = nullptr;
+    }
+
+    if (_hapticsTaskHandle){
+        // Deleting the task could leave the engine mutex locked, ask it to finish and wait until it has.
+        // It checks at least once per haptics tick.
+        _hapticsStopRequested = true;
+        xTaskNotifyGive(_hapticsTaskHandle);
+        while (!_hapticsTaskExited) {
+            vTaskDelay(1);
+        }
+        _hapticsTaskHandle = nullptr;
     }
 
     if(_extra_input){
@@ -87,10 +118,53 @@ void XboxGamepadDevice::init(NimBLEHIDDevice* hid) {
 
     // Create output characteristic to handle events coming from the computer
     auto output = hid->getOutputReport(XBOX_OUTPUT_REPORT_ID);
-    _callbacks = new XboxGamepadCallbacks(this);
-    output->setCallbacks(_callbacks);
+    output->setCallbacks(&_callbacks);
 
     setCharacteristics(input, output);
+
+    if (_config->getUseHapticsEngine() && !_hapticsTaskHandle)
+    {
+        BleCompositeHID::createTask(hapticsTask, "haptics", _config->getHapticsTaskCore(), _config->getHapticsTaskPriority(),
+            _config->getHapticsTaskStackSize(), this, &_hapticsTaskHandle);
+    }
+}
+
+void XboxGamepadDevice::playHaptics(const XboxGamepadOutputReportData& data)
+{
+    if (!_hapticsTaskHandle)
+        return;
+
+    _haptics.play(data, millis());
+    xTaskNotifyGive(_hapticsTaskHandle);
+}
+
+void XboxGamepadDevice::hapticsTask(void* pvParameter)
+{
+    XboxGamepadDevice* device = (XboxGamepadDevice*)pvParameter;
+    const TickType_t tickPeriod = pdMS_TO_TICKS(device->_config->getHapticsTickMs());
+
+    while (!device->_hapticsStopRequested)
+    {
+        // Sleep until an output report arrives when nothing is playing
+        if (!device->_haptics.isActive())
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        TickType_t lastWake = xTaskGetTickCount();
+        while (!device->_hapticsStopRequested && device->_haptics.isActive())
+        {
+            if (device->_haptics.tick(millis()))
+            {
+                device->onHapticsDuty.fire(device->_haptics.getDuty());
+            }
+            vTaskDelayUntil(&lastWake, tickPeriod);
+        }
+    }
+
+    // The destructor returns once this is set, the device must not be touched after it
+    device->_hapticsTaskExited = true;
+    vTaskDelete(NULL);
 }
 
 const BaseCompositeDeviceConfiguration* XboxGamepadDevice::getDeviceConfig() const {
@@ -98,9 +172,13 @@ const BaseCompositeDeviceConfiguration* XboxGamepadDevice::getDeviceConfig() con
     return _config;
 }
 
+void XboxGamepadDevice::restoreState() {
+    sendGamepadReportImpl();
+}
+
 void XboxGamepadDevice::resetInputs() {
     std::lock_guard<std::mutex> lock(_mutex);
-    memset(&_inputReport, 0, sizeof(XboxGamepadInputReportData));
+    _inputReport = XboxGamepadInputReportData();
 
     _inputReport.x = XBOX_AXIS_CENTER_OFFSET;
     _inputReport.y = XBOX_AXIS_CENTER_OFFSET;
@@ -151,17 +229,18 @@ void XboxGamepadDevice::setLeftThumb(int16_t x, int16_t y) {
     x = constrain(x, XBOX_STICK_MIN, XBOX_STICK_MAX);
     y = constrain(y, XBOX_STICK_MIN, XBOX_STICK_MAX);
 
-    if(_inputReport.x != x || _inputReport.y != y){
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _inputReport.x = (uint16_t)(x + XBOX_AXIS_CENTER_OFFSET);
-            _inputReport.y = (uint16_t)(y + XBOX_AXIS_CENTER_OFFSET);
-        }
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        XboxStickPosition position = conditionStick(_leftStick, x, y);
+        changed = position.x != _inputReport.x || position.y != _inputReport.y;
+        _inputReport.x = position.x;
+        _inputReport.y = position.y;
+    }
 
-        if (_config->getAutoReport())
-        {
-            sendGamepadReport();
-        }
+    if (_config->getAutoReport())
+    {
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -169,47 +248,50 @@ void XboxGamepadDevice::setRightThumb(int16_t z, int16_t rZ) {
     z = constrain(z, XBOX_STICK_MIN, XBOX_STICK_MAX);
     rZ = constrain(rZ, XBOX_STICK_MIN, XBOX_STICK_MAX);
 
-    if(_inputReport.z != z || _inputReport.rz != rZ){
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _inputReport.z = (uint16_t)(z + XBOX_AXIS_CENTER_OFFSET);
-            _inputReport.rz = (uint16_t)(rZ+ XBOX_AXIS_CENTER_OFFSET);
-        }
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        XboxStickPosition position = conditionStick(_rightStick, z, rZ);
+        changed = position.x != _inputReport.z || position.y != _inputReport.rz;
+        _inputReport.z = position.x;
+        _inputReport.rz = position.y;
+    }
 
-        if (_config->getAutoReport())
-        {
-            sendGamepadReport();
-        }
+    if (_config->getAutoReport())
+    {
+        sendGamepadReportIfChanged(changed);
     }
 }
 
 void XboxGamepadDevice::setLeftTrigger(uint16_t value) {
     value = constrain(value, XBOX_TRIGGER_MIN, XBOX_TRIGGER_MAX);
 
-    if (_inputReport.brake != value) {
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _inputReport.brake = value;
-        }
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        uint16_t brake = conditionTrigger(_leftTrigger, value);
+        changed = brake != _inputReport.brake;
+        _inputReport.brake = brake;
+    }
 
-        if (_config->getAutoReport()) {
-            sendGamepadReport();
-        }
+    if (_config->getAutoReport()) {
+        sendGamepadReportIfChanged(changed);
     }
 }
 
 void XboxGamepadDevice::setRightTrigger(uint16_t value) {
     value = constrain(value, XBOX_TRIGGER_MIN, XBOX_TRIGGER_MAX);
 
-    if (_inputReport.accelerator != value) {
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _inputReport.accelerator = value;
-        }
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        uint16_t accelerator = conditionTrigger(_rightTrigger, value);
+        changed = accelerator != _inputReport.accelerator;
+        _inputReport.accelerator = accelerator;
+    }
 
-        if (_config->getAutoReport()) {
-            sendGamepadReport();
-        }
+    if (_config->getAutoReport()) {
+        sendGamepadReportIfChanged(changed);
     }
 }
 
@@ -217,15 +299,68 @@ void XboxGamepadDevice::setTriggers(uint16_t left, uint16_t right) {
     left = constrain(left, XBOX_TRIGGER_MIN, XBOX_TRIGGER_MAX);
     right = constrain(right, XBOX_TRIGGER_MIN, XBOX_TRIGGER_MAX);
 
-    if (_inputReport.brake != left || _inputReport.accelerator != right) {
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _inputReport.brake = left;
-            _inputReport.accelerator = right;
-        }
-        if (_config->getAutoReport()) {
-            sendGamepadReport();
-        }
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        uint16_t brake = conditionTrigger(_leftTrigger, left);
+        uint16_t accelerator = conditionTrigger(_rightTrigger, right);
+        changed = brake != _inputReport.brake || accelerator != _inputReport.accelerator;
+        _inputReport.brake = brake;
+        _inputReport.accelerator = accelerator;
+    }
+
+    if (_config->getAutoReport()) {
+        sendGamepadReportIfChanged(changed);
+    }
+}
+
+StickConditioner& XboxGamepadDevice::getLeftStickConditioner() {
+    return _leftStick;
+}
+
+StickConditioner& XboxGamepadDevice::getRightStickConditioner() {
+    return _rightStick;
+}
+
+AxisConditioner& XboxGamepadDevice::getLeftTriggerConditioner() {
+    return _leftTrigger;
+}
+
+AxisConditioner& XboxGamepadDevice::getRightTriggerConditioner() {
+    return _rightTrigger;
+}
+
+uint32_t XboxGamepadDevice::getAvoidedReportCount() const {
+    return _avoidedReports;
+}
+
+void XboxGamepadDevice::resetAvoidedReportCount() {
+    _avoidedReports = 0;
+}
+
+// Must be called with _mutex held. Returns report values, the caller assigns them to the packed report
+// fields itself since references to those would be unaligned.
+XboxStickPosition XboxGamepadDevice::conditionStick(StickConditioner& stick, int16_t x, int16_t y) {
+    int32_t conditionedX = x;
+    int32_t conditionedY = y;
+    stick.process(conditionedX, conditionedY, millis());
+
+    XboxStickPosition position;
+    position.x = (uint16_t)(conditionedX + XBOX_AXIS_CENTER_OFFSET);
+    position.y = (uint16_t)(conditionedY + XBOX_AXIS_CENTER_OFFSET);
+    return position;
+}
+
+// Must be called with _mutex held
+uint16_t XboxGamepadDevice::conditionTrigger(AxisConditioner& trigger, uint16_t value) {
+    return (uint16_t)trigger.process(value, millis());
+}
+
+void XboxGamepadDevice::sendGamepadReportIfChanged(bool changed) {
+    if (changed) {
+        sendGamepadReport();
+    } else {
+        _avoidedReports++;
     }
 }
 
@@ -329,6 +464,9 @@ void XboxGamepadDevice::releaseShare() {
 }
 
 void XboxGamepadDevice::sendGamepadReport(bool defer) {
+    if(!shouldReport(getInput()))
+        return;
+
     if(defer || _config->getAutoDefer()){
         queueDeferredReport(std::bind(&XboxGamepadDevice::sendGamepadReportImpl, this));
     } else {
@@ -343,14 +481,20 @@ void XboxGamepadDevice::sendGamepadReportImpl(){
     if (!input || !parentDevice)
         return;
 
-    if(!parentDevice->isConnected())
+    if(!parentDevice->isConnected()) {
+        countDroppedReport();
+        return;
+    }
+
+    // Hosts that didn't subscribe to this report never read it, skip building it
+    if(!isInputSubscribed(input))
         return;
 
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        size_t packedSize = sizeof(_inputReport);
-        ESP_LOGD(LOG_TAG, "Sending gamepad report, size: %d", packedSize);
-        input->setValue((uint8_t*)&_inputReport, packedSize);
+        XboxGamepadInputReportBytes report = _inputReport.serialize();
+        ESP_LOGD(LOG_TAG, "Sending gamepad report, size: %d", sizeof(report.bytes));
+        input->setValue(report.bytes, sizeof(report.bytes));
     }
-    input->notify();
+    notifyInput(input);
 }
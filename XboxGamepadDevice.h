@@ -3,6 +3,7 @@
 
 #include <NimBLECharacteristic.h>
 #include <Callback.h>
+#include <atomic>
 #include <mutex>
 
 #include "BLEHostConfiguration.h"
@@ -10,6 +11,8 @@
 #include "GamepadDevice.h"
 #include "XboxDescriptors.h"
 #include "XboxGamepadConfiguration.h"
+#include "XboxHaptics.h"
+#include "AxisConditioner.h"
 
 // Button bitmasks
 #define XBOX_BUTTON_A 0x01
@@ -82,16 +85,25 @@ private:
     XboxGamepadDevice* _device;
 };
 
+// Size of the reports on the wire, excluding the report ID
+#define XBOX_INPUT_REPORT_SIZE 16
+#define XBOX_OUTPUT_REPORT_SIZE 8
+
+struct XboxGamepadOutputReportBytes {
+    uint8_t bytes[XBOX_OUTPUT_REPORT_SIZE];
+};
+
 struct XboxGamepadOutputReportData {
     uint8_t dcEnableActuators = 0x00;   // 4bits for DC Enable Actuators, 4bits padding
     uint8_t leftTriggerMagnitude = 0;
     uint8_t rightTriggerMagnitude = 0; 
     uint8_t weakMotorMagnitude = 0;
     uint8_t strongMotorMagnitude = 0; 
-    uint8_t duration = 0;               // UNUSED
-    uint8_t startDelay = 0;             // UNUSED
-    uint8_t loopCount = 0;              // UNUSED
+    uint8_t duration = 0;               // On time in 10ms steps
+    uint8_t startDelay = 0;             // Off time before each on period in 10ms steps
+    uint8_t loopCount = 0;              // Extra repeats after the first
 
+    // value holds the report bytes in little endian order, byte 0 is dcEnableActuators
     constexpr XboxGamepadOutputReportData(uint64_t value = 0) noexcept : 
         dcEnableActuators((value & 0xFF)),
         leftTriggerMagnitude((value >> 8) & 0xFF),
@@ -102,6 +114,41 @@ struct XboxGamepadOutputReportData {
         startDelay((value >> 48) & 0xFF),
         loopCount((value >> 56) & 0xFF)
     {}
+
+    // Decodes the report straight from the received bytes, missing trailing bytes read as 0
+    constexpr XboxGamepadOutputReportData(const uint8_t* data, size_t size) noexcept :
+        dcEnableActuators(size > 0 ? data[0] : 0),
+        leftTriggerMagnitude(size > 1 ? data[1] : 0),
+        rightTriggerMagnitude(size > 2 ? data[2] : 0),
+        weakMotorMagnitude(size > 3 ? data[3] : 0),
+        strongMotorMagnitude(size > 4 ? data[4] : 0),
+        duration(size > 5 ? data[5] : 0),
+        startDelay(size > 6 ? data[6] : 0),
+        loopCount(size > 7 ? data[7] : 0)
+    {}
+
+    constexpr XboxGamepadOutputReportBytes serialize() const {
+        return {{
+            dcEnableActuators,
+            leftTriggerMagnitude,
+            rightTriggerMagnitude,
+            weakMotorMagnitude,
+            strongMotorMagnitude,
+            duration,
+            startDelay,
+            loopCount
+        }};
+    }
+};
+
+// A stick's conditioned axes as report values, centered on XBOX_AXIS_CENTER_OFFSET
+struct XboxStickPosition {
+    uint16_t x;
+    uint16_t y;
+};
+
+struct XboxGamepadInputReportBytes {
+    uint8_t bytes[XBOX_INPUT_REPORT_SIZE];
 };
 
 #pragma pack(push, 1)
@@ -115,6 +162,33 @@ struct XboxGamepadInputReportData {
     uint8_t hat = 0x00;         // 4bits for hat switch (Dpad) + 4 bit padding (1 byte) 
     uint16_t buttons = 0x00;    // 15 * 1bit for buttons + 1 bit padding (2 bytes)
     uint8_t share = 0x00;      // 1 bits for share/menu button + 7 bit padding (1 byte)
+
+    constexpr XboxGamepadInputReportData() noexcept {}
+
+    constexpr XboxGamepadInputReportData(uint16_t leftX, uint16_t leftY, uint16_t rightX, uint16_t rightY,
+            uint16_t leftTrigger, uint16_t rightTrigger, uint8_t hatValue, uint16_t buttonBits, uint8_t shareBit) noexcept :
+        x(leftX), y(leftY), z(rightX), rz(rightY), brake(leftTrigger), accelerator(rightTrigger), hat(hatValue), buttons(buttonBits), share(shareBit)
+    {}
+
+    // Wire layout of XboxOneS_1708_HIDDescriptor, little endian and independent of how the host packs this struct.
+    // Padding bits are always sent as 0.
+    constexpr XboxGamepadInputReportBytes serialize() const {
+        return {{
+            lowByte16(x), highByte16(x),
+            lowByte16(y), highByte16(y),
+            lowByte16(z), highByte16(z),
+            lowByte16(rz), highByte16(rz),
+            lowByte16(brake), (uint8_t)(highByte16(brake) & 0x03),
+            lowByte16(accelerator), (uint8_t)(highByte16(accelerator) & 0x03),
+            (uint8_t)(hat & 0x0F),
+            lowByte16(buttons), (uint8_t)(highByte16(buttons) & 0x7F),
+            (uint8_t)(share & 0x01)
+        }};
+    }
+
+private:
+    static constexpr uint8_t lowByte16(uint16_t value) { return (uint8_t)(value & 0xFF); }
+    static constexpr uint8_t highByte16(uint16_t value) { return (uint8_t)(value >> 8); }
 };
 #pragma pack(pop)
 
@@ -169,9 +243,13 @@ public:
 
     void init(NimBLEHIDDevice* hid) override;
     const BaseCompositeDeviceConfiguration* getDeviceConfig() const override;
+    void restoreState() override;
 
     Signal<XboxGamepadOutputReportData> onVibrate;
 
+    // Fired from the haptics task whenever the motor duty changes, only when the haptics engine is enabled
+    Signal<XboxHapticsDuty> onHapticsDuty;
+
     // Input Controls
     void resetInputs();
     void press(uint16_t button = XBOX_BUTTON_A);    
@@ -192,13 +270,37 @@ public:
     
     void sendGamepadReport(bool defer = false);
 
+    // Input conditioning, axis setters only send a report when the conditioned value changes
+    StickConditioner& getLeftStickConditioner();
+    StickConditioner& getRightStickConditioner();
+    AxisConditioner& getLeftTriggerConditioner();
+    AxisConditioner& getRightTriggerConditioner();
+    uint32_t getAvoidedReportCount() const;
+    void resetAvoidedReportCount();
+
 private:
+    friend class XboxGamepadCallbacks;
+
     void sendGamepadReportImpl();
+    void sendGamepadReportIfChanged(bool changed);
+    XboxStickPosition conditionStick(StickConditioner& stick, int16_t x, int16_t y);
+    uint16_t conditionTrigger(AxisConditioner& trigger, uint16_t value);
+    void playHaptics(const XboxGamepadOutputReportData& data);
+    static void hapticsTask(void* pvParameter);
 
     XboxGamepadInputReportData _inputReport;
+    StickConditioner _leftStick;
+    StickConditioner _rightStick;
+    AxisConditioner _leftTrigger;
+    AxisConditioner _rightTrigger;
+    std::atomic<uint32_t> _avoidedReports;
+    XboxHapticsEngine _haptics;
+    TaskHandle_t _hapticsTaskHandle;
+    std::atomic<bool> _hapticsStopRequested;
+    std::atomic<bool> _hapticsTaskExited;
 
     NimBLECharacteristic* _extra_input;
-    XboxGamepadCallbacks* _callbacks;
+    XboxGamepadCallbacks _callbacks;
     XboxGamepadDeviceConfiguration* _config;
 
     // Threading
@@ -0,0 +1,114 @@
+#include "XboxHaptics.h"
+#include "XboxGamepadDevice.h"
+
+XboxHapticsEngine::XboxHapticsEngine()
+{
+}
+
+void XboxHapticsEngine::play(const XboxGamepadOutputReportData& data, uint32_t nowMs)
+{
+    const uint8_t actuatorBits[XBOX_HAPTICS_ACTUATOR_COUNT] = {
+        XBOX_ACTUATOR_WEAK_MOTOR,
+        XBOX_ACTUATOR_STRONG_MOTOR,
+        XBOX_ACTUATOR_RIGHT_TRIGGER,
+        XBOX_ACTUATOR_LEFT_TRIGGER
+    };
+    const uint8_t magnitudes[XBOX_HAPTICS_ACTUATOR_COUNT] = {
+        data.weakMotorMagnitude,
+        data.strongMotorMagnitude,
+        data.rightTriggerMagnitude,
+        data.leftTriggerMagnitude
+    };
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (uint8_t i = 0; i < XBOX_HAPTICS_ACTUATOR_COUNT; i++)
+    {
+        if (!(data.dcEnableActuators & actuatorBits[i]))
+            continue;
+
+        // Overlapping updates restart this actuator's timeline from now
+        Timeline& timeline = _timelines[i];
+        timeline.duty = magnitudeToDuty(magnitudes[i]);
+        timeline.startMs = nowMs;
+        timeline.delayMs = (uint32_t)data.startDelay * XBOX_HAPTICS_TIME_UNIT_MS;
+        timeline.onMs = (uint32_t)data.duration * XBOX_HAPTICS_TIME_UNIT_MS;
+        timeline.repeats = data.loopCount;
+        timeline.active = timeline.duty > 0 && timeline.onMs > 0;
+    }
+}
+
+void XboxHapticsEngine::stop()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (uint8_t i = 0; i < XBOX_HAPTICS_ACTUATOR_COUNT; i++)
+    {
+        _timelines[i].active = false;
+    }
+}
+
+bool XboxHapticsEngine::tick(uint32_t nowMs)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    XboxHapticsDuty duty;
+    duty.weakMotor = evaluate(_timelines[XBOX_HAPTICS_WEAK_MOTOR], nowMs);
+    duty.strongMotor = evaluate(_timelines[XBOX_HAPTICS_STRONG_MOTOR], nowMs);
+    duty.rightTrigger = evaluate(_timelines[XBOX_HAPTICS_RIGHT_TRIGGER], nowMs);
+    duty.leftTrigger = evaluate(_timelines[XBOX_HAPTICS_LEFT_TRIGGER], nowMs);
+
+    if (duty == _duty)
+        return false;
+
+    _duty = duty;
+    return true;
+}
+
+bool XboxHapticsEngine::isActive()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (uint8_t i = 0; i < XBOX_HAPTICS_ACTUATOR_COUNT; i++)
+    {
+        if (_timelines[i].active)
+            return true;
+    }
+
+    // Still needs a tick to bring the outputs back to zero
+    return _duty != XboxHapticsDuty();
+}
+
+XboxHapticsDuty XboxHapticsEngine::getDuty()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _duty;
+}
+
+uint8_t XboxHapticsEngine::evaluate(Timeline& timeline, uint32_t nowMs)
+{
+    if (!timeline.active)
+        return 0;
+
+    // Each loop is an off period of delayMs followed by an on period of onMs
+    uint32_t elapsed = nowMs - timeline.startMs;
+    uint32_t period = timeline.delayMs + timeline.onMs;
+    uint32_t loop = elapsed / period;
+
+    if (loop > timeline.repeats)
+    {
+        timeline.active = false;
+        return 0;
+    }
+
+    uint32_t phase = elapsed % period;
+    return phase >= timeline.delayMs ? timeline.duty : 0;
+}
+
+uint8_t XboxHapticsEngine::magnitudeToDuty(uint8_t magnitude)
+{
+    if (magnitude > XBOX_HAPTICS_MAX_MAGNITUDE)
+        magnitude = XBOX_HAPTICS_MAX_MAGNITUDE;
+
+    return (uint8_t)(((uint16_t)magnitude * 255 + XBOX_HAPTICS_MAX_MAGNITUDE / 2) / XBOX_HAPTICS_MAX_MAGNITUDE);
+}
@@ -0,0 +1,82 @@
+#ifndef XBOX_HAPTICS_H
+#define XBOX_HAPTICS_H
+
+#include <stdint.h>
+#include <mutex>
+
+// DC enable actuator bits in the output report
+#define XBOX_ACTUATOR_WEAK_MOTOR 0x01
+#define XBOX_ACTUATOR_STRONG_MOTOR 0x02
+#define XBOX_ACTUATOR_RIGHT_TRIGGER 0x04
+#define XBOX_ACTUATOR_LEFT_TRIGGER 0x08
+
+// Timeline indices
+#define XBOX_HAPTICS_WEAK_MOTOR 0
+#define XBOX_HAPTICS_STRONG_MOTOR 1
+#define XBOX_HAPTICS_RIGHT_TRIGGER 2
+#define XBOX_HAPTICS_LEFT_TRIGGER 3
+#define XBOX_HAPTICS_ACTUATOR_COUNT 4
+
+// Output report magnitudes are a percentage
+#define XBOX_HAPTICS_MAX_MAGNITUDE 100
+
+// Duration and start delay are sent in 10ms steps
+#define XBOX_HAPTICS_TIME_UNIT_MS 10
+
+#define XBOX_HAPTICS_DEFAULT_TICK_MS 10
+
+// Forwards
+struct XboxGamepadOutputReportData;
+
+// PWM duty per actuator, 0 - 255
+struct XboxHapticsDuty {
+    uint8_t weakMotor = 0;
+    uint8_t strongMotor = 0;
+    uint8_t rightTrigger = 0;
+    uint8_t leftTrigger = 0;
+
+    bool operator==(const XboxHapticsDuty& other) const {
+        return weakMotor == other.weakMotor && strongMotor == other.strongMotor &&
+            rightTrigger == other.rightTrigger && leftTrigger == other.leftTrigger;
+    }
+    bool operator!=(const XboxHapticsDuty& other) const { return !(*this == other); }
+};
+
+// Plays the rumble timelines described by Xbox output reports.
+// Each enabled actuator waits for the start delay, runs at its magnitude for the duration,
+// and repeats that loopCount more times. A new report only replaces the timelines of the
+// actuators it enables, the others keep playing.
+// Time is always passed in by the caller so the engine can be driven by a virtual clock.
+class XboxHapticsEngine {
+public:
+    XboxHapticsEngine();
+
+    void play(const XboxGamepadOutputReportData& data, uint32_t nowMs);
+    void stop();
+
+    // Evaluates every timeline at nowMs, returns true when the duty output changed
+    bool tick(uint32_t nowMs);
+
+    bool isActive();
+    XboxHapticsDuty getDuty();
+
+private:
+    struct Timeline {
+        bool active = false;
+        uint8_t duty = 0;
+        uint32_t startMs = 0;
+        uint32_t delayMs = 0;
+        uint32_t onMs = 0;
+        uint16_t repeats = 0;
+    };
+
+    static uint8_t evaluate(Timeline& timeline, uint32_t nowMs);
+    static uint8_t magnitudeToDuty(uint8_t magnitude);
+
+    Timeline _timelines[XBOX_HAPTICS_ACTUATOR_COUNT];
+    XboxHapticsDuty _duty;
+
+    std::mutex _mutex;
+};
+
+#endif // XBOX_HAPTICS_H
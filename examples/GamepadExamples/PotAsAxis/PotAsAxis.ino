@@ -1,7 +1,8 @@
 /*
  * Reads a potentiometer on pin 34 and maps the reading to the X axis
  *
- * Potentiometers can be noisy, so the sketch can take multiple samples to average out the readings
+ * Potentiometers can be noisy, so the sketch can take multiple samples to average out the readings.
+ * The X axis conditioner then smooths what is left and ignores jitter, so reports are only sent for real movement
  */
 
 #include <Arduino.h>
@@ -22,6 +23,12 @@ void setup()
     Serial.println("Starting BLE work!");
     
     gamepad = new GamepadDevice();
+
+    // Smooth the reading and only move the axis once it changes by at least 64 units
+    AxisConditioner& xConditioner = gamepad->getAxisConditioner(GAMEPAD_AXIS_X);
+    xConditioner.setEmaFilter(64);
+    xConditioner.setHysteresis(64);
+
     compositeHID.addDevice(gamepad);
 
     compositeHID.addDevice(gamepad);
@@ -57,6 +64,8 @@ void loop()
         // Print readings to serial port
         Serial.print("Sent: ");
         Serial.print(adjustedValue);
+        Serial.print("\tAvoided reports: ");
+        Serial.print(gamepad->getAvoidedReportCount());
         Serial.print("\tRaw Avg: ");
         Serial.print(potValue);
         Serial.print("\tRaw: {");
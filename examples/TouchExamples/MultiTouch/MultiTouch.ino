@@ -0,0 +1,57 @@
+#include <Arduino.h>
+#include <TouchDevice.h>
+#include <BleCompositeHID.h>
+
+BleCompositeHID compositeHID("ESP32 Touchscreen", "Mystfit", 100);
+BLEHostConfiguration bleHostConfig;
+TouchDevice* touch;
+
+void setup()
+{
+    Serial.begin(115200);
+
+    // Set our advertised appearance to a digitizer
+    bleHostConfig.setHidType(HID_DIGITIZER_TABLET);
+
+    // Two fingers, both packed into a single report per frame
+    TouchConfiguration touchConfig;
+    touchConfig.setTouchType(TOUCH_TYPE_TOUCHSCREEN);
+    touchConfig.setMaxContacts(2);
+    touchConfig.setContactsPerReport(2);
+    touchConfig.setLogicalMax(4095, 4095);
+    touchConfig.setPhysicalMax(1500, 1000); // 150mm x 100mm
+
+    touch = new TouchDevice(touchConfig);
+    compositeHID.addDevice(touch);
+    compositeHID.begin(bleHostConfig);
+
+    Serial.println("Waiting for connection");
+    delay(3000);
+}
+
+void loop()
+{
+    if (compositeHID.isConnected())
+    {
+        // Pinch out from the centre of the screen
+        TouchContact contacts[2];
+        contacts[0].id = 0;
+        contacts[1].id = 1;
+        contacts[0].tipSwitch = true;
+        contacts[1].tipSwitch = true;
+
+        for (uint16_t offset = 0; offset < 1500; offset += 50)
+        {
+            contacts[0].x = 2048 - offset;
+            contacts[0].y = 2048;
+            contacts[1].x = 2048 + offset;
+            contacts[1].y = 2048;
+            touch->setContacts(contacts, 2);
+            delay(16);
+        }
+
+        // Lift both fingers
+        touch->setContacts(nullptr, 0);
+        delay(2000);
+    }
+}
@@ -10,14 +10,15 @@ BleCompositeHID compositeHID("ESP32 SeriesX Controller", "Mystfit", 100);
 
 void OnVibrateEvent(XboxGamepadOutputReportData data)
 {
-    if(data.weakMotorMagnitude > 0 || data.strongMotorMagnitude > 0){
-        digitalWrite(ledPin, LOW);
-    } else {
-        digitalWrite(ledPin, HIGH);
-    }
     Serial.println("Vibration event. Weak motor: " + String(data.weakMotorMagnitude) + " Strong motor: " + String(data.strongMotorMagnitude));
 }
 
+void OnHapticsDutyEvent(XboxHapticsDuty duty)
+{
+    // The haptics engine takes care of the rumble timing, drive the LED brightness from the strongest motor
+    analogWrite(ledPin, max(duty.weakMotor, duty.strongMotor));
+}
+
 void setup()
 {
     Serial.begin(115200);
@@ -29,6 +30,9 @@ void setup()
     //XboxOneSControllerDeviceConfiguration* config = new XboxOneSControllerDeviceConfiguration();
     XboxSeriesXControllerDeviceConfiguration* config = new XboxSeriesXControllerDeviceConfiguration();
 
+    // Play rumble durations, delays and loops for us instead of just forwarding the raw output report
+    config->setUseHapticsEngine(true);
+
     // The composite HID device pretends to be a valid Xbox controller via vendor and product IDs (VID/PID).
     // Platforms like windows/linux need this in order to pick an XInput driver over the generic BLE GATT HID driver. 
     BLEHostConfiguration hostConfig = config->getIdealHostConfiguration();
@@ -45,6 +49,10 @@ void setup()
     FunctionSlot<XboxGamepadOutputReportData> vibrationSlot(OnVibrateEvent);
     gamepad->onVibrate.attach(vibrationSlot);
 
+    // Set up the motor duty handler, called whenever the played rumble changes
+    FunctionSlot<XboxHapticsDuty> hapticsSlot(OnHapticsDutyEvent);
+    gamepad->onHapticsDuty.attach(hapticsSlot);
+
     // Add all child devices to the top-level composite HID device to manage them
     compositeHID.addDevice(gamepad);
 
@@ -0,0 +1,64 @@
+#pragma once
+
+// Arduino core stand-in for the host emulation build, only what the library uses
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#define PROGMEM
+#define HEX 16
+#define DEC 10
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+// Time since the program started
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+uint32_t getCpuFrequencyMhz();
+uint32_t getXtalFrequencyMhz();
+
+class String
+{
+public:
+    String() {}
+    String(const char* value) : _value(value ? value : "") {}
+    String(const std::string& value) : _value(value) {}
+
+    const char* c_str() const { return _value.c_str(); }
+    unsigned int length() const { return _value.size(); }
+    bool operator==(const String& other) const { return _value == other._value; }
+    String operator+(const String& other) const { return String(_value + other._value); }
+
+private:
+    std::string _value;
+};
+
+// Writes to stdout
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baud);
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char* value);
+    size_t print(long value, int base = DEC);
+    size_t print(const String& value) { return print(value.c_str()); }
+    size_t println();
+    size_t println(const char* value);
+    size_t println(long value, int base = DEC);
+    size_t println(const String& value) { return println(value.c_str()); }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+// Stand-in for the Callback library: slots are copied into the signal when attached and fired in order
+
+template<typename... Args>
+class Slot
+{
+public:
+    virtual ~Slot() {}
+    virtual void operator()(Args... args) const = 0;
+    virtual Slot* clone() const = 0;
+};
+
+template<typename... Args>
+class FunctionSlot : public Slot<Args...>
+{
+public:
+    FunctionSlot(void (*function)(Args...)) : _function(function) {}
+    void operator()(Args... args) const override { _function(args...); }
+    Slot<Args...>* clone() const override { return new FunctionSlot(_function); }
+
+private:
+    void (*_function)(Args...);
+};
+
+template<typename Object, typename... Args>
+class MethodSlot : public Slot<Args...>
+{
+public:
+    MethodSlot(Object* object, void (Object::*method)(Args...)) : _object(object), _method(method) {}
+    void operator()(Args... args) const override { (_object->*_method)(args...); }
+    Slot<Args...>* clone() const override { return new MethodSlot(_object, _method); }
+
+private:
+    Object* _object;
+    void (Object::*_method)(Args...);
+};
+
+template<typename... Args>
+class Signal
+{
+public:
+    void attach(const Slot<Args...>& slot) { _slots.emplace_back(slot.clone()); }
+    void fire(Args... args) const
+    {
+        for (const auto& slot : _slots)
+            (*slot)(args...);
+    }
+
+private:
+    std::vector<std::unique_ptr<Slot<Args...>>> _slots;
+};
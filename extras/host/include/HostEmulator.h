@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+#include "NimBLEStandIn.h"
+
+// One notification the library handed to the stand-in stack
+struct EmulatedNotification {
+    uint32_t timestampMicros;   // micros() when notify() was called
+    uint16_t connHandle;
+    uint16_t attrHandle;
+    uint8_t reportId;           // 0 for characteristics that aren't HID reports
+    int status;                 // What notify() reported through onStatus, 0 if the notification was accepted
+    std::vector<uint8_t> data;
+};
+
+// Plays the central's side against the stand-in NimBLE stack and keeps the log of every notification.
+// Connection events are delivered on the emulated host task, these calls wait until the callbacks ran.
+class HostEmulator
+{
+public:
+    // Waits for the server task to finish setting up and start advertising, false on timeout
+    static bool waitForAdvertising(uint32_t timeoutMs = 1000);
+
+    // Connects a central the way a HID host does: connection, MTU exchange, then pairing or encryption with a bond.
+    // Returns the connection handle, or BLE_HS_CONN_HANDLE_NONE if advertising doesn't accept this address.
+    static uint16_t connect(const NimBLEAddress& address, uint16_t mtu = BLE_ATT_MTU_DFLT, bool bond = true);
+    // Disconnects from the central's side, 0x213 is the remote user terminating the connection
+    static void disconnect(uint16_t connHandle, int reason = 0x213);
+
+    static void subscribe(uint16_t connHandle, NimBLECharacteristic* characteristic, bool enable = true);
+    // Enables notifications on every characteristic that supports them, like a HID host after connecting
+    static void subscribeAll(uint16_t connHandle);
+    // Writes an output or feature report from the central
+    static void write(uint16_t connHandle, NimBLECharacteristic* characteristic, const uint8_t* data, size_t length);
+
+    // Report characteristic of the HID service, type is 1 input, 2 output or 3 feature. Null if there is none.
+    static NimBLECharacteristic* findReport(uint8_t reportId, uint8_t type = 1);
+
+    // Makes notify() fail with code, like a stack that ran out of buffers. 0 lets notifications through again.
+    static void setNotifyResult(int code);
+
+    // Keeps the notification log, on by default. Off, notify() allocates nothing, which allocation tests rely on.
+    static void setLogNotifications(bool enabled);
+    static std::vector<EmulatedNotification> getNotifications();
+    static size_t getNotificationCount();
+    static void clearNotifications();
+
+    // Runs function on the emulated host task and waits for it, or runs it straight away on that task
+    static void runOnHost(std::function<void()> function);
+    // Queues function for the emulated host task, delayMs from now
+    static void postToHost(std::function<void()> function, uint32_t delayMs = 0);
+};
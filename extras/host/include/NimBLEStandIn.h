@@ -0,0 +1,425 @@
+#pragma once
+
+// NimBLE-Arduino 2.x stand-in for the host emulation build. It keeps the GATT table in memory, hands
+// notifications to the HostEmulator log and delivers server and characteristic callbacks on an emulated
+// host task, like the real stack does. Only the API the library uses is here.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nimconfig.h"
+
+#define BLE_HS_EAGAIN 1
+#define BLE_HS_EALREADY 2
+#define BLE_HS_EINVAL 3
+#define BLE_HS_ENOMEM 6
+#define BLE_HS_ENOTCONN 7
+#define BLE_HS_ETIMEOUT 13
+#define BLE_HS_EDONE 14
+
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+#define BLE_ATT_MTU_DFLT 23
+#define BLE_ATT_ATTR_MAX_LEN 512
+
+#define BLE_GAP_LE_PHY_1M 1
+#define BLE_GAP_LE_PHY_2M 2
+#define BLE_GAP_LE_PHY_CODED 3
+#define BLE_GAP_LE_PHY_1M_MASK 0x01
+#define BLE_GAP_LE_PHY_2M_MASK 0x02
+#define BLE_GAP_LE_PHY_CODED_MASK 0x04
+#define BLE_GAP_LE_PHY_ANY_MASK 0x0F
+
+#define BLE_GAP_CONN_MODE_NON 0
+#define BLE_GAP_CONN_MODE_DIR 1
+#define BLE_GAP_CONN_MODE_UND 2
+
+#define BLE_ADDR_PUBLIC 0
+#define BLE_ADDR_RANDOM 1
+
+// Appearance values
+#define GENERIC_HID 0x03C0
+#define HID_KEYBOARD 0x03C1
+#define HID_MOUSE 0x03C2
+#define HID_JOYSTICK 0x03C3
+#define HID_GAMEPAD 0x03C4
+#define HID_TABLET 0x03C5
+#define HID_CARD_READER 0x03C6
+#define HID_DIGITAL_PEN 0x03C7
+#define HID_BARCODE 0x03C8
+#define HID_BRAILLE_DISPLAY 0x03C9
+
+#define PNPVersionField 1
+
+namespace NIMBLE_PROPERTY {
+    enum {
+        BROADCAST = 0x0001,
+        READ = 0x0002,
+        WRITE_NR = 0x0004,
+        WRITE = 0x0008,
+        NOTIFY = 0x0010,
+        INDICATE = 0x0020,
+        READ_ENC = 0x0200,
+        WRITE_ENC = 0x1000
+    };
+}
+
+class NimBLEAddress
+{
+public:
+    NimBLEAddress();
+    NimBLEAddress(const uint8_t address[6], uint8_t type = BLE_ADDR_PUBLIC);
+    // "aa:bb:cc:dd:ee:ff"
+    NimBLEAddress(const std::string& address, uint8_t type = BLE_ADDR_PUBLIC);
+
+    std::string toString() const;
+    uint8_t getType() const { return _type; }
+    const uint8_t* getVal() const { return _address; }
+    bool isNull() const;
+    bool operator==(const NimBLEAddress& other) const;
+    bool operator!=(const NimBLEAddress& other) const { return !(*this == other); }
+
+private:
+    uint8_t _address[6];
+    uint8_t _type;
+};
+
+// 16 bit UUIDs and 128 bit UUID strings, compared by their normalized text
+class NimBLEUUID
+{
+public:
+    NimBLEUUID() {}
+    NimBLEUUID(uint16_t uuid);
+    NimBLEUUID(const char* uuid);
+    NimBLEUUID(const std::string& uuid);
+
+    std::string toString() const { return _value; }
+    bool operator==(const NimBLEUUID& other) const { return _value == other._value; }
+    bool operator!=(const NimBLEUUID& other) const { return _value != other._value; }
+
+private:
+    std::string _value;
+};
+
+class NimBLEAttValue
+{
+public:
+    NimBLEAttValue() {}
+    NimBLEAttValue(const uint8_t* data, size_t size) : _data(data, data + size) {}
+
+    const uint8_t* data() const { return _data.data(); }
+    size_t size() const { return _data.size(); }
+    size_t length() const { return _data.size(); }
+    // Not terminated, for logging short printable values only
+    const char* c_str() const { return (const char*)_data.data(); }
+    operator std::string() const { return std::string(_data.begin(), _data.end()); }
+
+    template<typename T>
+    T getValue(time_t* timestamp = nullptr, bool skipSizeCheck = false) const
+    {
+        T value = T();
+        if (skipSizeCheck || _data.size() >= sizeof(T))
+            memcpy(&value, _data.data(), _data.size() < sizeof(T) ? _data.size() : sizeof(T));
+        return value;
+    }
+
+private:
+    std::vector<uint8_t> _data;
+};
+
+class NimBLEConnInfo
+{
+public:
+    NimBLEConnInfo() {}
+
+    NimBLEAddress getAddress() const { return _address; }
+    NimBLEAddress getIdAddress() const { return _address; }
+    uint16_t getConnHandle() const { return _connHandle; }
+    uint16_t getConnInterval() const { return _interval; }
+    uint16_t getConnLatency() const { return _latency; }
+    uint16_t getConnTimeout() const { return _timeout; }
+    uint16_t getMTU() const { return _mtu; }
+    bool isBonded() const { return _bonded; }
+    bool isEncrypted() const { return _encrypted; }
+    bool isAuthenticated() const { return _authenticated; }
+
+private:
+    friend class NimBLEServer;
+    friend class HostEmulator;
+
+    NimBLEAddress _address;
+    uint16_t _connHandle = BLE_HS_CONN_HANDLE_NONE;
+    uint16_t _interval = 6;
+    uint16_t _latency = 0;
+    uint16_t _timeout = 600;
+    uint16_t _mtu = BLE_ATT_MTU_DFLT;
+    bool _bonded = false;
+    bool _encrypted = false;
+    bool _authenticated = false;
+};
+
+class NimBLECharacteristic;
+class NimBLEService;
+class NimBLEServer;
+class NimBLEAdvertising;
+
+class NimBLECharacteristicCallbacks
+{
+public:
+    virtual ~NimBLECharacteristicCallbacks() {}
+    virtual void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) {}
+    virtual void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) {}
+    virtual void onStatus(NimBLECharacteristic* pCharacteristic, int code) {}
+    virtual void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) {}
+};
+
+class NimBLEDescriptor
+{
+public:
+    NimBLEDescriptor(const NimBLEUUID& uuid) : _uuid(uuid) {}
+
+    NimBLEUUID getUUID() const { return _uuid; }
+    void setValue(const uint8_t* data, size_t length) { _value = NimBLEAttValue(data, length); }
+    NimBLEAttValue getValue() const { return _value; }
+
+private:
+    NimBLEUUID _uuid;
+    NimBLEAttValue _value;
+};
+
+class NimBLECharacteristic
+{
+public:
+    NimBLECharacteristic(const NimBLEUUID& uuid, uint16_t properties, NimBLEService* service);
+
+    NimBLEUUID getUUID() const { return _uuid; }
+    uint16_t getHandle() const { return _handle; }
+    uint16_t getProperties() const { return _properties; }
+    NimBLEService* getService() const { return _service; }
+
+    void setValue(const uint8_t* data, size_t length);
+    void setValue(const std::string& value) { setValue((const uint8_t*)value.data(), value.size()); }
+    void setValue(const NimBLEAttValue& value) { setValue(value.data(), value.size()); }
+    template<typename T>
+    void setValue(const T& value) { setValue((const uint8_t*)&value, sizeof(T)); }
+
+    NimBLEAttValue getValue(time_t* timestamp = nullptr) const;
+    template<typename T>
+    T getValue(time_t* timestamp = nullptr, bool skipSizeCheck = false) const { return getValue().getValue<T>(timestamp, skipSizeCheck); }
+    size_t getLength() const;
+
+    // Sends the current value to one connection, or to every subscribed one with BLE_HS_CONN_HANDLE_NONE.
+    // Every attempt ends up in the HostEmulator log and is reported through onStatus.
+    bool notify(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool notify(const uint8_t* value, size_t length, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool indicate(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const { return notify(connHandle); }
+
+    void setCallbacks(NimBLECharacteristicCallbacks* callbacks) { _callbacks = callbacks; }
+    NimBLECharacteristicCallbacks* getCallbacks() const { return _callbacks; }
+
+    NimBLEDescriptor* createDescriptor(const NimBLEUUID& uuid, uint32_t properties = NIMBLE_PROPERTY::READ, uint16_t maxLength = 100);
+    NimBLEDescriptor* getDescriptorByUUID(const NimBLEUUID& uuid) const;
+
+    // Report ID of a HID report characteristic, 0 for any other
+    uint8_t getReportId() const { return _reportId; }
+    void setReportId(uint8_t reportId) { _reportId = reportId; }
+
+private:
+    friend class NimBLEService;
+
+    NimBLEUUID _uuid;
+    uint16_t _properties;
+    uint16_t _handle;
+    uint8_t _reportId;
+    NimBLEService* _service;
+    NimBLECharacteristicCallbacks* _callbacks;
+    std::vector<std::unique_ptr<NimBLEDescriptor>> _descriptors;
+    std::vector<uint8_t> _value;
+};
+
+typedef NimBLECharacteristic BLECharacteristic;
+
+class NimBLEService
+{
+public:
+    NimBLEService(const NimBLEUUID& uuid, NimBLEServer* server) : _uuid(uuid), _server(server), _started(false) {}
+
+    NimBLEUUID getUUID() const { return _uuid; }
+    NimBLEServer* getServer() const { return _server; }
+
+    NimBLECharacteristic* createCharacteristic(const NimBLEUUID& uuid,
+        uint32_t properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE, uint16_t maxLength = BLE_ATT_ATTR_MAX_LEN);
+    NimBLECharacteristic* getCharacteristic(const NimBLEUUID& uuid, uint16_t instanceId = 0) const;
+    // Characteristics stay owned by the service until it is destroyed, removed ones are only hidden
+    void addCharacteristic(NimBLECharacteristic* characteristic);
+    void removeCharacteristic(NimBLECharacteristic* characteristic, bool deleteCharacteristic = false);
+    std::vector<NimBLECharacteristic*> getCharacteristics() const;
+
+    bool start();
+    bool isStarted() const { return _started; }
+
+private:
+    NimBLEUUID _uuid;
+    NimBLEServer* _server;
+    bool _started;
+    std::vector<std::unique_ptr<NimBLECharacteristic>> _owned;
+    std::vector<NimBLECharacteristic*> _characteristics;
+};
+
+class NimBLEServerCallbacks
+{
+public:
+    virtual ~NimBLEServerCallbacks() {}
+    virtual void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) {}
+    virtual void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) {}
+    virtual void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo) {}
+    virtual void onAuthenticationComplete(NimBLEConnInfo& connInfo) {}
+    virtual void onConnParamsUpdate(NimBLEConnInfo& connInfo) {}
+    virtual void onPhyUpdate(NimBLEConnInfo& connInfo, uint8_t txPhy, uint8_t rxPhy) {}
+};
+
+class NimBLEServer
+{
+public:
+    NimBLEServer();
+    ~NimBLEServer();
+
+    NimBLEService* createService(const NimBLEUUID& uuid);
+    NimBLEService* getServiceByUUID(const NimBLEUUID& uuid, uint16_t instanceId = 0) const;
+    void addService(NimBLEService* service);
+    void removeService(NimBLEService* service, bool deleteService = false);
+    std::vector<NimBLEService*> getServices() const;
+
+    void setCallbacks(NimBLEServerCallbacks* callbacks, bool deleteCallbacks = true);
+    NimBLEServerCallbacks* getCallbacks() const { return _callbacks; }
+    void advertiseOnDisconnect(bool enable) { _advertiseOnDisconnect = enable; }
+    bool start();
+
+    // Connection management, parameter and PHY changes are applied and reported back through the callbacks
+    uint8_t getConnectedCount() const;
+    std::vector<uint16_t> getPeerDevices() const;
+    NimBLEConnInfo getPeerInfoByHandle(uint16_t connHandle) const;
+    uint16_t getPeerMTU(uint16_t connHandle) const;
+    bool disconnect(uint16_t connHandle, uint8_t reason = 0x13) const;
+    bool updateConnParams(uint16_t connHandle, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) const;
+    void setDataLen(uint16_t connHandle, uint16_t octets) const;
+    bool updatePhy(uint16_t connHandle, uint8_t txPhyMask, uint8_t rxPhyMask, uint16_t phyOptions = 0);
+    bool startAdvertising(uint32_t duration = 0);
+    bool stopAdvertising();
+
+private:
+    friend class HostEmulator;
+    friend class NimBLEDevice;
+
+    NimBLEServerCallbacks* _callbacks;
+    bool _deleteCallbacks;
+    bool _advertiseOnDisconnect;
+    std::vector<std::unique_ptr<NimBLEService>> _owned;
+    std::vector<NimBLEService*> _services;
+};
+
+class NimBLEAdvertising
+{
+public:
+    NimBLEAdvertising();
+
+    // A duration in milliseconds ends advertising with the completion callback, so does a connection
+    bool start(uint32_t duration = 0, const NimBLEAddress* directAddress = nullptr);
+    bool stop();
+    bool isAdvertising();
+
+    bool setAppearance(uint16_t appearance) { _appearance = appearance; return true; }
+    bool addServiceUUID(const NimBLEUUID& uuid) { _serviceUUIDs.push_back(uuid); return true; }
+    bool setName(const std::string& name) { _name = name; return true; }
+    bool enableScanResponse(bool enable) { return true; }
+    bool setMinInterval(uint16_t interval) { _minInterval = interval; return true; }
+    bool setMaxInterval(uint16_t interval) { _maxInterval = interval; return true; }
+    bool setConnectableMode(uint8_t mode) { _connectableMode = mode; return true; }
+    bool setScanFilter(bool scanRequestWhitelistOnly, bool connectWhitelistOnly) { _connectAcceptListOnly = connectWhitelistOnly; return true; }
+    void setAdvertisingCompleteCallback(std::function<void(NimBLEAdvertising*)> callback) { _completeCallback = callback; }
+
+    // Emulation only
+    uint8_t getConnectableMode() const { return _connectableMode; }
+    bool getConnectAcceptListOnly() const { return _connectAcceptListOnly; }
+    const NimBLEAddress& getDirectAddress() const { return _directAddress; }
+    std::string getName() const { return _name; }
+
+private:
+    friend class HostEmulator;
+    void onComplete();
+
+    bool _advertising;
+    uint32_t _generation;
+    uint16_t _appearance;
+    uint16_t _minInterval;
+    uint16_t _maxInterval;
+    uint8_t _connectableMode;
+    bool _connectAcceptListOnly;
+    NimBLEAddress _directAddress;
+    std::string _name;
+    std::vector<NimBLEUUID> _serviceUUIDs;
+    std::function<void(NimBLEAdvertising*)> _completeCallback;
+};
+
+class NimBLEDevice
+{
+public:
+    static bool init(const std::string& deviceName);
+    static bool deinit(bool clearAll = false);
+    static bool isInitialized();
+
+    static NimBLEServer* createServer();
+    static NimBLEServer* getServer();
+    static NimBLEAdvertising* getAdvertising();
+
+    static void setSecurityAuth(bool bonding, bool mitm, bool secureConnection);
+    static void setSecurityAuth(uint8_t authReq);
+    static int setMTU(uint16_t mtu);
+    static uint16_t getMTU();
+    static bool setDefaultPhy(uint8_t txPhyMask, uint8_t rxPhyMask);
+
+    // Bonds made by emulated hosts, oldest first
+    static int getNumBonds();
+    static NimBLEAddress getBondedAddress(int index);
+    static bool whiteListAdd(const NimBLEAddress& address);
+    static bool whiteListRemove(const NimBLEAddress& address);
+    static bool onWhiteList(const NimBLEAddress& address);
+};
+
+class NimBLEHIDDevice
+{
+public:
+    NimBLEHIDDevice(NimBLEServer* server);
+
+    void setReportMap(uint8_t* map, uint16_t size);
+    void startServices();
+    bool setManufacturer(const std::string& name);
+    void setPnp(uint8_t sig, uint16_t vid, uint16_t pid, uint16_t version);
+    void setHidInfo(uint8_t country, uint8_t flags);
+    void setBatteryLevel(uint8_t level, bool notify = false);
+
+    // Returns the report characteristic with that ID, creating it on first use
+    NimBLECharacteristic* getInputReport(uint8_t reportId);
+    NimBLECharacteristic* getOutputReport(uint8_t reportId);
+    NimBLECharacteristic* getFeatureReport(uint8_t reportId);
+
+    NimBLECharacteristic* getReportMap() { return _reportMap; }
+    NimBLECharacteristic* getProtocolMode() { return _protocolMode; }
+    NimBLEService* getHidService() { return _hidService; }
+    NimBLEService* getDeviceInfoService() { return _deviceInfoService; }
+    NimBLEService* getBatteryService() { return _batteryService; }
+
+private:
+    NimBLECharacteristic* getReport(uint8_t reportId, uint8_t type, uint32_t properties);
+
+    NimBLEService* _hidService;
+    NimBLEService* _deviceInfoService;
+    NimBLEService* _batteryService;
+    NimBLECharacteristic* _reportMap;
+    NimBLECharacteristic* _protocolMode;
+    NimBLECharacteristic* _batteryLevel;
+};
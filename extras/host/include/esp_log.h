@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdio.h>
+
+// Messages up to this level are printed to stderr: 1 error, 2 warning, 3 info, 4 debug, 5 verbose
+#ifndef COMPOSITE_HID_HOST_LOG_LEVEL
+#define COMPOSITE_HID_HOST_LOG_LEVEL 2
+#endif
+
+#define ESP_HOST_LOG(level, letter, tag, format, ...) \
+    do { if (level <= COMPOSITE_HID_HOST_LOG_LEVEL) fprintf(stderr, letter " (%s) " format "\n", tag, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_HOST_LOG(1, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_HOST_LOG(2, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_HOST_LOG(3, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_HOST_LOG(4, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_HOST_LOG(5, "V", tag, format, ##__VA_ARGS__)
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <limits.h>
+
+// FreeRTOS stand-in for the host emulation build. Tasks are threads and the tick is one millisecond.
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portNUM_PROCESSORS 2
+
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY INT_MAX
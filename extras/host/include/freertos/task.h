@@ -0,0 +1,27 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct EmulatedTask;
+typedef EmulatedTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+// Each task runs on its own thread. Deleting another task takes effect the next time that task blocks
+// in vTaskDelay, deleting the calling task (NULL) only marks it, the task function is expected to return.
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+    UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t period);
+TickType_t xTaskGetTickCount();
+// Threads the emulator didn't start, like the test's main(), get a handle of their own
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+// Direct to task notifications used as a counting semaphore
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+// Reports the configured stack depth, the host can't measure what a thread used
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
@@ -0,0 +1,6 @@
+#pragma once
+
+#define CONFIG_BT_NIMBLE_ROLE_PERIPHERAL 1
+#ifndef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define CONFIG_BT_NIMBLE_MAX_CONNECTIONS 3
+#endif
@@ -0,0 +1,7 @@
+#pragma once
+
+// SDK configuration of the host emulation build. Power management and the Arduino log wrapper are left out,
+// so PowerManager only tracks idle time and the library logs through esp_log.h.
+#define CONFIG_BT_ENABLED 1
+#define CONFIG_BT_NIMBLE_GAP_DEVICE_NAME_MAX_LEN 31
+#define CONFIG_FREERTOS_NUMBER_OF_CORES 2
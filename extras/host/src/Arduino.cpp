@@ -0,0 +1,84 @@
+#include "Arduino.h"
+
+#include <stdarg.h>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+static std::chrono::steady_clock::time_point getStartTime()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+// Start counting with the program rather than on the first call
+static const std::chrono::steady_clock::time_point startTime = getStartTime();
+
+unsigned long millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - getStartTime()).count();
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - getStartTime()).count();
+}
+
+void delay(unsigned long ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+uint32_t getCpuFrequencyMhz()
+{
+    return 240;
+}
+
+uint32_t getXtalFrequencyMhz()
+{
+    return 40;
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+}
+
+size_t HardwareSerial::printf(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vprintf(format, args);
+    va_end(args);
+    return written > 0 ? written : 0;
+}
+
+size_t HardwareSerial::print(const char* value)
+{
+    return printf("%s", value);
+}
+
+size_t HardwareSerial::print(long value, int base)
+{
+    return base == HEX ? printf("%lx", value) : printf("%ld", value);
+}
+
+size_t HardwareSerial::println()
+{
+    return printf("\n");
+}
+
+size_t HardwareSerial::println(const char* value)
+{
+    return printf("%s\n", value);
+}
+
+size_t HardwareSerial::println(long value, int base)
+{
+    return print(value, base) + println();
+}
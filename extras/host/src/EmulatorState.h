@@ -0,0 +1,33 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "HostEmulator.h"
+
+struct EmulatedConnection {
+    NimBLEConnInfo info;
+    std::set<uint16_t> subscriptions;      // Attribute handles the central enabled notifications on
+};
+
+// State the stand-in stack shares between the device side and the emulated central. Callbacks into the
+// library are never made while holding the mutex, copy what they need out first.
+struct EmulatorState {
+    std::recursive_mutex mutex;
+    bool initialized = false;
+    NimBLEServer* server = nullptr;
+    NimBLEAdvertising* advertising = nullptr;
+    std::map<uint16_t, EmulatedConnection> connections;
+    uint16_t nextConnHandle = 1;
+    uint16_t nextAttrHandle = 1;
+    uint16_t preferredMTU = 255;
+    std::vector<NimBLEAddress> bonds;
+    std::vector<NimBLEAddress> acceptList;
+    int notifyResult = 0;
+    bool logNotifications = true;
+    std::vector<EmulatedNotification> notifications;
+};
+
+EmulatorState& getEmulatorState();
@@ -0,0 +1,23 @@
+#include "esp_heap_caps.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return 0;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup()
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio, gpio_int_type_t type)
+{
+    return ESP_OK;
+}
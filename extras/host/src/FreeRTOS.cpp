@@ -0,0 +1,310 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "Arduino.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct EmulatedTask {
+    TaskFunction_t function;
+    void* parameter;
+    uint32_t stackDepth;
+    std::atomic<bool> deleted;
+    uint32_t notifyCount;
+};
+
+struct EmulatedTimer {
+    TickType_t period;
+    bool autoReload;
+    void* timerId;
+    TimerCallbackFunction_t callback;
+    bool active;
+    bool deleted;
+    std::chrono::steady_clock::time_point due;
+};
+
+namespace {
+
+// Unwinds a task that another task deleted, caught by the thread wrapper
+struct TaskDeleted {};
+
+thread_local EmulatedTask* currentTask = nullptr;
+
+// Tasks and timers are never freed, a handle may still be used after it was deleted
+std::mutex registryMutex;
+std::vector<EmulatedTask*>* tasks = new std::vector<EmulatedTask*>();
+
+std::mutex notifyMutex;
+std::condition_variable* notifyCondition = new std::condition_variable();
+
+void runTask(EmulatedTask* task)
+{
+    currentTask = task;
+    try
+    {
+        task->function(task->parameter);
+    }
+    catch (const TaskDeleted&)
+    {
+    }
+}
+
+// The FreeRTOS timer task, one thread that runs every timer callback
+class TimerService
+{
+public:
+    TimerService()
+    {
+        std::thread(&TimerService::run, this).detach();
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<EmulatedTimer*> timers;
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            EmulatedTimer* next = nullptr;
+            for (auto timer : timers)
+            {
+                if (timer->active && !timer->deleted && (!next || timer->due < next->due))
+                    next = timer;
+            }
+
+            if (!next)
+            {
+                condition.wait(lock);
+                continue;
+            }
+            if (next->due > std::chrono::steady_clock::now())
+            {
+                condition.wait_until(lock, next->due);
+                continue;
+            }
+
+            if (next->autoReload)
+                next->due += std::chrono::milliseconds(next->period);
+            else
+                next->active = false;
+
+            TimerCallbackFunction_t callback = next->callback;
+            lock.unlock();
+            callback(next);
+            lock.lock();
+        }
+    }
+};
+
+TimerService& getTimerService()
+{
+    static TimerService* service = new TimerService();
+    return *service;
+}
+
+}
+
+// ---------------
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+    UBaseType_t priority, TaskHandle_t* handle)
+{
+    EmulatedTask* task = new EmulatedTask();
+    task->function = function;
+    task->parameter = parameter;
+    task->stackDepth = stackDepth;
+    task->deleted = false;
+    task->notifyCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        tasks->push_back(task);
+    }
+
+    if (handle)
+        *handle = task;
+
+    std::thread(runTask, task).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t coreId)
+{
+    if (coreId != tskNO_AFFINITY && (coreId < 0 || coreId >= portNUM_PROCESSORS))
+        return pdFAIL;
+    return xTaskCreate(function, name, stackDepth, parameter, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task)
+        task = currentTask;
+    if (task)
+        task->deleted = true;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    // Sleep in slices so a task deleted from elsewhere stops promptly
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks);
+    while (true)
+    {
+        if (currentTask && currentTask->deleted)
+            throw TaskDeleted();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= until)
+            break;
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(until - now, std::chrono::milliseconds(10)));
+    }
+
+    if (ticks == 0)
+        std::this_thread::yield();
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t period)
+{
+    TickType_t wakeTime = *previousWakeTime + period;
+    TickType_t now = xTaskGetTickCount();
+    // A wake time that already passed returns straight away, like FreeRTOS
+    if ((int32_t)(wakeTime - now) > 0)
+        vTaskDelay(wakeTime - now);
+    *previousWakeTime = wakeTime;
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    thread_local EmulatedTask foreignTask;
+    return currentTask ? currentTask : &foreignTask;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    std::lock_guard<std::mutex> lock(notifyMutex);
+    task->notifyCount++;
+    notifyCondition->notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    EmulatedTask* task = currentTask;
+    if (!task)
+        return 0;
+
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ticksToWait);
+    std::unique_lock<std::mutex> lock(notifyMutex);
+    while (task->notifyCount == 0)
+    {
+        if (task->deleted)
+            throw TaskDeleted();
+
+        auto now = std::chrono::steady_clock::now();
+        if (ticksToWait != portMAX_DELAY && now >= until)
+            return 0;
+        notifyCondition->wait_for(lock, std::chrono::milliseconds(10));
+    }
+
+    uint32_t count = task->notifyCount;
+    task->notifyCount = clearCountOnExit ? 0 : count - 1;
+    return count;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    if (!task)
+        task = currentTask;
+    return task ? task->stackDepth : 0;
+}
+
+// ---------------
+
+TimerHandle_t xTimerCreate(const char* name, TickType_t period, UBaseType_t autoReload, void* timerId,
+    TimerCallbackFunction_t callback)
+{
+    EmulatedTimer* timer = new EmulatedTimer();
+    timer->period = period;
+    timer->autoReload = autoReload != pdFALSE;
+    timer->timerId = timerId;
+    timer->callback = callback;
+    timer->active = false;
+    timer->deleted = false;
+
+    TimerService& service = getTimerService();
+    std::lock_guard<std::mutex> lock(service.mutex);
+    service.timers.push_back(timer);
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait)
+{
+    return xTimerReset(timer, ticksToWait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait)
+{
+    TimerService& service = getTimerService();
+    std::lock_guard<std::mutex> lock(service.mutex);
+    timer->active = false;
+    service.condition.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait)
+{
+    TimerService& service = getTimerService();
+    std::lock_guard<std::mutex> lock(service.mutex);
+    if (timer->deleted)
+        return pdFAIL;
+    timer->active = true;
+    timer->due = std::chrono::steady_clock::now() + std::chrono::milliseconds(timer->period);
+    service.condition.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticksToWait)
+{
+    // Like FreeRTOS, changing the period also starts a dormant timer
+    {
+        TimerService& service = getTimerService();
+        std::lock_guard<std::mutex> lock(service.mutex);
+        timer->period = period;
+    }
+    return xTimerReset(timer, ticksToWait);
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticksToWait)
+{
+    TimerService& service = getTimerService();
+    std::lock_guard<std::mutex> lock(service.mutex);
+    timer->active = false;
+    timer->deleted = true;
+    service.condition.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer)
+{
+    TimerService& service = getTimerService();
+    std::lock_guard<std::mutex> lock(service.mutex);
+    return timer->active ? pdTRUE : pdFALSE;
+}
+
+void* pvTimerGetTimerID(TimerHandle_t timer)
+{
+    return timer->timerId;
+}
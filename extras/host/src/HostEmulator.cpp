@@ -0,0 +1,369 @@
+#include "HostEmulator.h"
+#include "EmulatorState.h"
+#include "Arduino.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+#define UUID_HID_SERVICE 0x1812
+#define UUID_REPORT 0x2a4d
+#define UUID_REPORT_REFERENCE 0x2908
+
+namespace {
+
+struct HostEvent {
+    std::chrono::steady_clock::time_point due;
+    uint64_t sequence;
+    std::function<void()> function;
+};
+
+// The emulated host task, one thread that runs events in due order and in the order they were posted.
+// Never destroyed, the library's tasks may still post to it while the program exits.
+class HostTask
+{
+public:
+    HostTask() : _sequence(0)
+    {
+        std::thread thread(&HostTask::run, this);
+        _threadId = thread.get_id();
+        thread.detach();
+    }
+
+    void post(std::function<void()> function, uint32_t delayMs)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        HostEvent event;
+        event.due = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs);
+        event.sequence = _sequence++;
+        event.function = std::move(function);
+        _events.push_back(std::move(event));
+        _condition.notify_one();
+    }
+
+    bool isCurrent() const
+    {
+        return std::this_thread::get_id() == _threadId;
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            if (_events.empty())
+            {
+                _condition.wait(lock);
+                continue;
+            }
+
+            auto next = std::min_element(_events.begin(), _events.end(), [](const HostEvent& a, const HostEvent& b) {
+                return a.due != b.due ? a.due < b.due : a.sequence < b.sequence;
+            });
+            if (next->due > std::chrono::steady_clock::now())
+            {
+                _condition.wait_until(lock, next->due);
+                continue;
+            }
+
+            std::function<void()> function = std::move(next->function);
+            _events.erase(next);
+            lock.unlock();
+            function();
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::vector<HostEvent> _events;
+    uint64_t _sequence;
+    std::thread::id _threadId;
+};
+
+HostTask& getHostTask()
+{
+    static HostTask* task = new HostTask();
+    return *task;
+}
+
+NimBLEServerCallbacks* getServerCallbacks()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return state.server ? state.server->getCallbacks() : nullptr;
+}
+
+}
+
+
+bool HostEmulator::waitForAdvertising(uint32_t timeoutMs)
+{
+    uint32_t start = millis();
+    while (millis() - start < timeoutMs)
+    {
+        {
+            EmulatorState& state = getEmulatorState();
+            std::lock_guard<std::recursive_mutex> lock(state.mutex);
+            if (state.advertising && state.advertising->_advertising)
+                return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+uint16_t HostEmulator::connect(const NimBLEAddress& address, uint16_t mtu, bool bond)
+{
+    uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE;
+    runOnHost([&]() {
+        EmulatorState& state = getEmulatorState();
+        NimBLEConnInfo info;
+        bool wasBonded;
+        {
+            std::lock_guard<std::recursive_mutex> lock(state.mutex);
+            NimBLEAdvertising* advertising = state.advertising;
+            if (!state.server || !advertising || !advertising->_advertising)
+                return;
+            if (advertising->_connectableMode == BLE_GAP_CONN_MODE_NON)
+                return;
+            if (!advertising->_directAddress.isNull() && advertising->_directAddress != address)
+                return;
+            if (advertising->_connectAcceptListOnly &&
+                std::find(state.acceptList.begin(), state.acceptList.end(), address) == state.acceptList.end())
+                return;
+
+            connHandle = state.nextConnHandle++;
+            info._address = address;
+            info._connHandle = connHandle;
+            state.connections[connHandle].info = info;
+
+            // A connection ends advertising without the completion callback firing for a timeout
+            advertising->_advertising = false;
+            advertising->_generation++;
+
+            wasBonded = std::find(state.bonds.begin(), state.bonds.end(), address) != state.bonds.end();
+        }
+
+        NimBLEServerCallbacks* callbacks = getServerCallbacks();
+        if (callbacks)
+            callbacks->onConnect(state.server, info);
+
+        uint16_t negotiated = std::min(mtu, NimBLEDevice::getMTU());
+        if (negotiated != BLE_ATT_MTU_DFLT)
+        {
+            {
+                std::lock_guard<std::recursive_mutex> lock(state.mutex);
+                auto connection = state.connections.find(connHandle);
+                if (connection == state.connections.end())
+                    return;
+                connection->second.info._mtu = negotiated;
+                info = connection->second.info;
+            }
+            if (callbacks)
+                callbacks->onMTUChange(negotiated, info);
+        }
+
+        if (bond || wasBonded)
+        {
+            {
+                std::lock_guard<std::recursive_mutex> lock(state.mutex);
+                auto connection = state.connections.find(connHandle);
+                if (connection == state.connections.end())
+                    return;
+                connection->second.info._encrypted = true;
+                connection->second.info._bonded = true;
+                info = connection->second.info;
+                if (!wasBonded)
+                    state.bonds.push_back(address);
+            }
+            if (callbacks)
+                callbacks->onAuthenticationComplete(info);
+        }
+    });
+    return connHandle;
+}
+
+void HostEmulator::disconnect(uint16_t connHandle, int reason)
+{
+    runOnHost([connHandle, reason]() {
+        EmulatorState& state = getEmulatorState();
+        NimBLEConnInfo info;
+        bool advertiseOnDisconnect;
+        {
+            std::lock_guard<std::recursive_mutex> lock(state.mutex);
+            auto connection = state.connections.find(connHandle);
+            if (connection == state.connections.end())
+                return;
+            info = connection->second.info;
+            state.connections.erase(connection);
+            advertiseOnDisconnect = state.server && state.server->_advertiseOnDisconnect;
+        }
+
+        NimBLEServerCallbacks* callbacks = getServerCallbacks();
+        if (callbacks)
+            callbacks->onDisconnect(state.server, info, reason);
+
+        if (advertiseOnDisconnect)
+            NimBLEDevice::getAdvertising()->start();
+    });
+}
+
+void HostEmulator::subscribe(uint16_t connHandle, NimBLECharacteristic* characteristic, bool enable)
+{
+    if (!characteristic)
+        return;
+
+    runOnHost([connHandle, characteristic, enable]() {
+        EmulatorState& state = getEmulatorState();
+        NimBLEConnInfo info;
+        {
+            std::lock_guard<std::recursive_mutex> lock(state.mutex);
+            auto connection = state.connections.find(connHandle);
+            if (connection == state.connections.end())
+                return;
+            if (enable)
+                connection->second.subscriptions.insert(characteristic->getHandle());
+            else
+                connection->second.subscriptions.erase(characteristic->getHandle());
+            info = connection->second.info;
+        }
+
+        if (characteristic->getCallbacks())
+            characteristic->getCallbacks()->onSubscribe(characteristic, info, enable ? 1 : 0);
+    });
+}
+
+void HostEmulator::subscribeAll(uint16_t connHandle)
+{
+    std::vector<NimBLECharacteristic*> characteristics;
+    {
+        EmulatorState& state = getEmulatorState();
+        std::lock_guard<std::recursive_mutex> lock(state.mutex);
+        if (!state.server)
+            return;
+        for (auto service : state.server->getServices())
+        {
+            for (auto characteristic : service->getCharacteristics())
+            {
+                if (characteristic->getProperties() & (NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::INDICATE))
+                    characteristics.push_back(characteristic);
+            }
+        }
+    }
+
+    for (auto characteristic : characteristics)
+        subscribe(connHandle, characteristic);
+}
+
+void HostEmulator::write(uint16_t connHandle, NimBLECharacteristic* characteristic, const uint8_t* data, size_t length)
+{
+    if (!characteristic)
+        return;
+
+    std::vector<uint8_t> value(data, data + length);
+    runOnHost([connHandle, characteristic, value]() {
+        EmulatorState& state = getEmulatorState();
+        NimBLEConnInfo info;
+        {
+            std::lock_guard<std::recursive_mutex> lock(state.mutex);
+            auto connection = state.connections.find(connHandle);
+            if (connection == state.connections.end())
+                return;
+            info = connection->second.info;
+        }
+
+        characteristic->setValue(value.data(), value.size());
+        if (characteristic->getCallbacks())
+            characteristic->getCallbacks()->onWrite(characteristic, info);
+    });
+}
+
+NimBLECharacteristic* HostEmulator::findReport(uint8_t reportId, uint8_t type)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    if (!state.server)
+        return nullptr;
+
+    NimBLEService* hidService = state.server->getServiceByUUID(NimBLEUUID((uint16_t)UUID_HID_SERVICE));
+    if (!hidService)
+        return nullptr;
+
+    for (auto characteristic : hidService->getCharacteristics())
+    {
+        if (characteristic->getUUID() != NimBLEUUID((uint16_t)UUID_REPORT))
+            continue;
+
+        NimBLEDescriptor* reference = characteristic->getDescriptorByUUID(NimBLEUUID((uint16_t)UUID_REPORT_REFERENCE));
+        if (reference && reference->getValue().size() == 2 &&
+            reference->getValue().data()[0] == reportId && reference->getValue().data()[1] == type)
+            return characteristic;
+    }
+    return nullptr;
+}
+
+void HostEmulator::setNotifyResult(int code)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    state.notifyResult = code;
+}
+
+void HostEmulator::setLogNotifications(bool enabled)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    state.logNotifications = enabled;
+}
+
+std::vector<EmulatedNotification> HostEmulator::getNotifications()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return state.notifications;
+}
+
+size_t HostEmulator::getNotificationCount()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return state.notifications.size();
+}
+
+void HostEmulator::clearNotifications()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    state.notifications.clear();
+}
+
+void HostEmulator::runOnHost(std::function<void()> function)
+{
+    HostTask& task = getHostTask();
+    if (task.isCurrent())
+    {
+        function();
+        return;
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    task.post([&]() {
+        function();
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        condition.notify_one();
+    }, 0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&]() { return done; });
+}
+
+void HostEmulator::postToHost(std::function<void()> function, uint32_t delayMs)
+{
+    getHostTask().post(std::move(function), delayMs);
+}
@@ -0,0 +1,695 @@
+#include "NimBLEStandIn.h"
+#include "EmulatorState.h"
+#include "Arduino.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+#define UUID_HID_SERVICE 0x1812
+#define UUID_DEVICE_INFO_SERVICE 0x180a
+#define UUID_BATTERY_SERVICE 0x180f
+#define UUID_HID_INFORMATION 0x2a4a
+#define UUID_REPORT_MAP 0x2a4b
+#define UUID_HID_CONTROL_POINT 0x2a4c
+#define UUID_REPORT 0x2a4d
+#define UUID_PROTOCOL_MODE 0x2a4e
+#define UUID_MANUFACTURER_NAME 0x2a29
+#define UUID_PNP_ID 0x2a50
+#define UUID_BATTERY_LEVEL 0x2a19
+#define UUID_REPORT_REFERENCE 0x2908
+
+#define REPORT_TYPE_INPUT 1
+#define REPORT_TYPE_OUTPUT 2
+#define REPORT_TYPE_FEATURE 3
+
+EmulatorState& getEmulatorState()
+{
+    // Never destroyed, detached task threads may still use it while the program exits
+    static EmulatorState* state = new EmulatorState();
+    return *state;
+}
+
+// ---------------
+
+NimBLEAddress::NimBLEAddress() : _address(), _type(BLE_ADDR_PUBLIC)
+{
+}
+
+NimBLEAddress::NimBLEAddress(const uint8_t address[6], uint8_t type) : _type(type)
+{
+    memcpy(_address, address, sizeof(_address));
+}
+
+NimBLEAddress::NimBLEAddress(const std::string& address, uint8_t type) : _address(), _type(type)
+{
+    unsigned int bytes[6] = {};
+    if (sscanf(address.c_str(), "%x:%x:%x:%x:%x:%x", &bytes[5], &bytes[4], &bytes[3], &bytes[2], &bytes[1], &bytes[0]) == 6)
+    {
+        for (uint8_t i = 0; i < 6; i++)
+            _address[i] = bytes[i];
+    }
+}
+
+std::string NimBLEAddress::toString() const
+{
+    char text[18];
+    snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+        _address[5], _address[4], _address[3], _address[2], _address[1], _address[0]);
+    return text;
+}
+
+bool NimBLEAddress::isNull() const
+{
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        if (_address[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+bool NimBLEAddress::operator==(const NimBLEAddress& other) const
+{
+    return _type == other._type && memcmp(_address, other._address, sizeof(_address)) == 0;
+}
+
+// ---------------
+
+NimBLEUUID::NimBLEUUID(uint16_t uuid)
+{
+    char text[7];
+    snprintf(text, sizeof(text), "0x%04x", uuid);
+    _value = text;
+}
+
+NimBLEUUID::NimBLEUUID(const char* uuid) : NimBLEUUID(std::string(uuid))
+{
+}
+
+NimBLEUUID::NimBLEUUID(const std::string& uuid)
+{
+    std::string value = uuid;
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    // "2a4d" and "0x2a4d" are the same 16 bit UUID
+    if (value.size() == 4)
+        value = "0x" + value;
+    _value = value;
+}
+
+// ---------------
+
+NimBLECharacteristic::NimBLECharacteristic(const NimBLEUUID& uuid, uint16_t properties, NimBLEService* service) :
+    _uuid(uuid),
+    _properties(properties),
+    _reportId(0),
+    _service(service),
+    _callbacks(nullptr)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    _handle = state.nextAttrHandle++;
+}
+
+void NimBLECharacteristic::setValue(const uint8_t* data, size_t length)
+{
+    std::lock_guard<std::recursive_mutex> lock(getEmulatorState().mutex);
+    _value.assign(data, data + length);
+}
+
+NimBLEAttValue NimBLECharacteristic::getValue(time_t* timestamp) const
+{
+    std::lock_guard<std::recursive_mutex> lock(getEmulatorState().mutex);
+    return NimBLEAttValue(_value.data(), _value.size());
+}
+
+size_t NimBLECharacteristic::getLength() const
+{
+    std::lock_guard<std::recursive_mutex> lock(getEmulatorState().mutex);
+    return _value.size();
+}
+
+bool NimBLECharacteristic::notify(uint16_t connHandle) const
+{
+    // Copied to the stack, notifying allocates nothing unless the log is on
+    uint8_t value[BLE_ATT_ATTR_MAX_LEN];
+    size_t length;
+    {
+        std::lock_guard<std::recursive_mutex> lock(getEmulatorState().mutex);
+        length = std::min(_value.size(), sizeof(value));
+        memcpy(value, _value.data(), length);
+    }
+    return notify(value, length, connHandle);
+}
+
+bool NimBLECharacteristic::notify(const uint8_t* value, size_t length, uint16_t connHandle) const
+{
+    EmulatorState& state = getEmulatorState();
+    uint16_t targets[CONFIG_BT_NIMBLE_MAX_CONNECTIONS];
+    size_t targetCount = 0;
+    {
+        std::lock_guard<std::recursive_mutex> lock(state.mutex);
+        if (connHandle != BLE_HS_CONN_HANDLE_NONE)
+        {
+            targets[targetCount++] = connHandle;
+        }
+        else
+        {
+            for (const auto& connection : state.connections)
+            {
+                if (connection.second.subscriptions.count(_handle) && targetCount < CONFIG_BT_NIMBLE_MAX_CONNECTIONS)
+                    targets[targetCount++] = connection.first;
+            }
+        }
+    }
+
+    bool success = true;
+    for (size_t i = 0; i < targetCount; i++)
+    {
+        uint16_t target = targets[i];
+        int status;
+        {
+            std::lock_guard<std::recursive_mutex> lock(state.mutex);
+            auto connection = state.connections.find(target);
+            if (connection == state.connections.end())
+                status = BLE_HS_ENOTCONN;
+            else if (length > (size_t)(connection->second.info.getMTU() - 3))
+                status = BLE_HS_EINVAL;
+            else
+                status = state.notifyResult;
+
+            if (state.logNotifications)
+            {
+                EmulatedNotification notification;
+                notification.timestampMicros = micros();
+                notification.connHandle = target;
+                notification.attrHandle = _handle;
+                notification.reportId = _reportId;
+                notification.status = status;
+                notification.data.assign(value, value + length);
+                state.notifications.push_back(std::move(notification));
+            }
+        }
+
+        // NimBLE reports the notify-tx event from within notify()
+        if (_callbacks)
+            _callbacks->onStatus(const_cast<NimBLECharacteristic*>(this), status);
+
+        if (status != 0)
+            success = false;
+    }
+    return success;
+}
+
+NimBLEDescriptor* NimBLECharacteristic::createDescriptor(const NimBLEUUID& uuid, uint32_t properties, uint16_t maxLength)
+{
+    _descriptors.emplace_back(new NimBLEDescriptor(uuid));
+    return _descriptors.back().get();
+}
+
+NimBLEDescriptor* NimBLECharacteristic::getDescriptorByUUID(const NimBLEUUID& uuid) const
+{
+    for (const auto& descriptor : _descriptors)
+    {
+        if (descriptor->getUUID() == uuid)
+            return descriptor.get();
+    }
+    return nullptr;
+}
+
+// ---------------
+
+NimBLECharacteristic* NimBLEService::createCharacteristic(const NimBLEUUID& uuid, uint32_t properties, uint16_t maxLength)
+{
+    _owned.emplace_back(new NimBLECharacteristic(uuid, properties, this));
+    _characteristics.push_back(_owned.back().get());
+    return _owned.back().get();
+}
+
+NimBLECharacteristic* NimBLEService::getCharacteristic(const NimBLEUUID& uuid, uint16_t instanceId) const
+{
+    for (auto characteristic : _characteristics)
+    {
+        if (characteristic->getUUID() == uuid && instanceId-- == 0)
+            return characteristic;
+    }
+    return nullptr;
+}
+
+void NimBLEService::addCharacteristic(NimBLECharacteristic* characteristic)
+{
+    if (std::find(_characteristics.begin(), _characteristics.end(), characteristic) == _characteristics.end())
+        _characteristics.push_back(characteristic);
+}
+
+void NimBLEService::removeCharacteristic(NimBLECharacteristic* characteristic, bool deleteCharacteristic)
+{
+    _characteristics.erase(std::remove(_characteristics.begin(), _characteristics.end(), characteristic), _characteristics.end());
+}
+
+std::vector<NimBLECharacteristic*> NimBLEService::getCharacteristics() const
+{
+    return _characteristics;
+}
+
+bool NimBLEService::start()
+{
+    _started = true;
+    return true;
+}
+
+// ---------------
+
+NimBLEServer::NimBLEServer() :
+    _callbacks(nullptr),
+    _deleteCallbacks(false),
+    _advertiseOnDisconnect(true)
+{
+}
+
+NimBLEServer::~NimBLEServer()
+{
+    if (_deleteCallbacks)
+        delete _callbacks;
+}
+
+NimBLEService* NimBLEServer::createService(const NimBLEUUID& uuid)
+{
+    _owned.emplace_back(new NimBLEService(uuid, this));
+    _services.push_back(_owned.back().get());
+    return _owned.back().get();
+}
+
+NimBLEService* NimBLEServer::getServiceByUUID(const NimBLEUUID& uuid, uint16_t instanceId) const
+{
+    for (auto service : _services)
+    {
+        if (service->getUUID() == uuid && instanceId-- == 0)
+            return service;
+    }
+    return nullptr;
+}
+
+void NimBLEServer::addService(NimBLEService* service)
+{
+    if (std::find(_services.begin(), _services.end(), service) == _services.end())
+        _services.push_back(service);
+}
+
+void NimBLEServer::removeService(NimBLEService* service, bool deleteService)
+{
+    _services.erase(std::remove(_services.begin(), _services.end(), service), _services.end());
+}
+
+std::vector<NimBLEService*> NimBLEServer::getServices() const
+{
+    return _services;
+}
+
+void NimBLEServer::setCallbacks(NimBLEServerCallbacks* callbacks, bool deleteCallbacks)
+{
+    _callbacks = callbacks;
+    _deleteCallbacks = deleteCallbacks;
+}
+
+bool NimBLEServer::start()
+{
+    for (auto service : _services)
+        service->start();
+    return true;
+}
+
+uint8_t NimBLEServer::getConnectedCount() const
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return state.connections.size();
+}
+
+std::vector<uint16_t> NimBLEServer::getPeerDevices() const
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    std::vector<uint16_t> handles;
+    for (const auto& connection : state.connections)
+        handles.push_back(connection.first);
+    return handles;
+}
+
+NimBLEConnInfo NimBLEServer::getPeerInfoByHandle(uint16_t connHandle) const
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    auto connection = state.connections.find(connHandle);
+    return connection != state.connections.end() ? connection->second.info : NimBLEConnInfo();
+}
+
+uint16_t NimBLEServer::getPeerMTU(uint16_t connHandle) const
+{
+    return getPeerInfoByHandle(connHandle).getMTU();
+}
+
+bool NimBLEServer::disconnect(uint16_t connHandle, uint8_t reason) const
+{
+    // The controller reports a disconnect this side asked for as a local termination
+    HostEmulator::postToHost([connHandle]() { HostEmulator::disconnect(connHandle, 0x216); });
+    return true;
+}
+
+bool NimBLEServer::updateConnParams(uint16_t connHandle, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) const
+{
+    // The emulated central accepts every request and picks the shortest interval offered
+    HostEmulator::postToHost([this, connHandle, minInterval, latency, timeout]() {
+        EmulatorState& state = getEmulatorState();
+        NimBLEConnInfo info;
+        {
+            std::lock_guard<std::recursive_mutex> lock(state.mutex);
+            auto connection = state.connections.find(connHandle);
+            if (connection == state.connections.end())
+                return;
+            connection->second.info._interval = minInterval;
+            connection->second.info._latency = latency;
+            connection->second.info._timeout = timeout;
+            info = connection->second.info;
+        }
+        if (_callbacks)
+            _callbacks->onConnParamsUpdate(info);
+    });
+    return true;
+}
+
+void NimBLEServer::setDataLen(uint16_t connHandle, uint16_t octets) const
+{
+}
+
+bool NimBLEServer::updatePhy(uint16_t connHandle, uint8_t txPhyMask, uint8_t rxPhyMask, uint16_t phyOptions)
+{
+    HostEmulator::postToHost([this, connHandle, txPhyMask, rxPhyMask]() {
+        NimBLEConnInfo info = getPeerInfoByHandle(connHandle);
+        if (info.getConnHandle() == BLE_HS_CONN_HANDLE_NONE || !_callbacks)
+            return;
+        _callbacks->onPhyUpdate(info,
+            (txPhyMask & BLE_GAP_LE_PHY_2M_MASK) ? BLE_GAP_LE_PHY_2M : BLE_GAP_LE_PHY_1M,
+            (rxPhyMask & BLE_GAP_LE_PHY_2M_MASK) ? BLE_GAP_LE_PHY_2M : BLE_GAP_LE_PHY_1M);
+    });
+    return true;
+}
+
+bool NimBLEServer::startAdvertising(uint32_t duration)
+{
+    return NimBLEDevice::getAdvertising()->start(duration);
+}
+
+bool NimBLEServer::stopAdvertising()
+{
+    return NimBLEDevice::getAdvertising()->stop();
+}
+
+// ---------------
+
+NimBLEAdvertising::NimBLEAdvertising() :
+    _advertising(false),
+    _generation(0),
+    _appearance(0),
+    _minInterval(0),
+    _maxInterval(0),
+    _connectableMode(BLE_GAP_CONN_MODE_UND),
+    _connectAcceptListOnly(false)
+{
+}
+
+bool NimBLEAdvertising::start(uint32_t duration, const NimBLEAddress* directAddress)
+{
+    uint32_t generation;
+    {
+        std::lock_guard<std::recursive_mutex> lock(getEmulatorState().mutex);
+        _advertising = true;
+        _directAddress = directAddress ? *directAddress : NimBLEAddress();
+        generation = ++_generation;
+    }
+
+    if (duration > 0)
+    {
+        HostEmulator::postToHost([this, generation]() {
+            {
+                std::lock_guard<std::recursive_mutex> lock(getEmulatorState().mutex);
+                if (!_advertising || _generation != generation)
+                    return;
+                _advertising = false;
+            }
+            onComplete();
+        }, duration);
+    }
+    return true;
+}
+
+bool NimBLEAdvertising::stop()
+{
+    std::lock_guard<std::recursive_mutex> lock(getEmulatorState().mutex);
+    _advertising = false;
+    _generation++;
+    return true;
+}
+
+bool NimBLEAdvertising::isAdvertising()
+{
+    std::lock_guard<std::recursive_mutex> lock(getEmulatorState().mutex);
+    return _advertising;
+}
+
+void NimBLEAdvertising::onComplete()
+{
+    if (_completeCallback)
+        _completeCallback(this);
+}
+
+// ---------------
+
+bool NimBLEDevice::init(const std::string& deviceName)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    state.initialized = true;
+    return true;
+}
+
+bool NimBLEDevice::deinit(bool clearAll)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    state.initialized = false;
+    state.connections.clear();
+    delete state.server;
+    state.server = nullptr;
+    delete state.advertising;
+    state.advertising = nullptr;
+    if (clearAll)
+    {
+        state.bonds.clear();
+        state.acceptList.clear();
+    }
+    return true;
+}
+
+bool NimBLEDevice::isInitialized()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return state.initialized;
+}
+
+NimBLEServer* NimBLEDevice::createServer()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    if (!state.server)
+        state.server = new NimBLEServer();
+    return state.server;
+}
+
+NimBLEServer* NimBLEDevice::getServer()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return state.server;
+}
+
+NimBLEAdvertising* NimBLEDevice::getAdvertising()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    if (!state.advertising)
+        state.advertising = new NimBLEAdvertising();
+    return state.advertising;
+}
+
+void NimBLEDevice::setSecurityAuth(bool bonding, bool mitm, bool secureConnection)
+{
+}
+
+void NimBLEDevice::setSecurityAuth(uint8_t authReq)
+{
+}
+
+int NimBLEDevice::setMTU(uint16_t mtu)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    state.preferredMTU = mtu;
+    return 0;
+}
+
+uint16_t NimBLEDevice::getMTU()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return state.preferredMTU;
+}
+
+bool NimBLEDevice::setDefaultPhy(uint8_t txPhyMask, uint8_t rxPhyMask)
+{
+    return true;
+}
+
+int NimBLEDevice::getNumBonds()
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return state.bonds.size();
+}
+
+NimBLEAddress NimBLEDevice::getBondedAddress(int index)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return index >= 0 && index < (int)state.bonds.size() ? state.bonds[index] : NimBLEAddress();
+}
+
+bool NimBLEDevice::whiteListAdd(const NimBLEAddress& address)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    if (std::find(state.acceptList.begin(), state.acceptList.end(), address) == state.acceptList.end())
+        state.acceptList.push_back(address);
+    return true;
+}
+
+bool NimBLEDevice::whiteListRemove(const NimBLEAddress& address)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    auto entry = std::find(state.acceptList.begin(), state.acceptList.end(), address);
+    if (entry == state.acceptList.end())
+        return false;
+    state.acceptList.erase(entry);
+    return true;
+}
+
+bool NimBLEDevice::onWhiteList(const NimBLEAddress& address)
+{
+    EmulatorState& state = getEmulatorState();
+    std::lock_guard<std::recursive_mutex> lock(state.mutex);
+    return std::find(state.acceptList.begin(), state.acceptList.end(), address) != state.acceptList.end();
+}
+
+// ---------------
+
+NimBLEHIDDevice::NimBLEHIDDevice(NimBLEServer* server)
+{
+    _deviceInfoService = server->createService(NimBLEUUID((uint16_t)UUID_DEVICE_INFO_SERVICE));
+    _hidService = server->createService(NimBLEUUID((uint16_t)UUID_HID_SERVICE));
+    _batteryService = server->createService(NimBLEUUID((uint16_t)UUID_BATTERY_SERVICE));
+
+    _hidService->createCharacteristic(NimBLEUUID((uint16_t)UUID_HID_INFORMATION), NIMBLE_PROPERTY::READ);
+    _reportMap = _hidService->createCharacteristic(NimBLEUUID((uint16_t)UUID_REPORT_MAP), NIMBLE_PROPERTY::READ);
+    _hidService->createCharacteristic(NimBLEUUID((uint16_t)UUID_HID_CONTROL_POINT), NIMBLE_PROPERTY::WRITE_NR);
+    _protocolMode = _hidService->createCharacteristic(NimBLEUUID((uint16_t)UUID_PROTOCOL_MODE), NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::READ);
+    uint8_t reportMode = 0x01;
+    _protocolMode->setValue(&reportMode, sizeof(reportMode));
+
+    _batteryLevel = _batteryService->createCharacteristic(NimBLEUUID((uint16_t)UUID_BATTERY_LEVEL), NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+}
+
+void NimBLEHIDDevice::setReportMap(uint8_t* map, uint16_t size)
+{
+    _reportMap->setValue(map, size);
+}
+
+void NimBLEHIDDevice::startServices()
+{
+    _deviceInfoService->start();
+    _hidService->start();
+    _batteryService->start();
+}
+
+bool NimBLEHIDDevice::setManufacturer(const std::string& name)
+{
+    NimBLEUUID uuid((uint16_t)UUID_MANUFACTURER_NAME);
+    NimBLECharacteristic* characteristic = _deviceInfoService->getCharacteristic(uuid);
+    if (!characteristic)
+        characteristic = _deviceInfoService->createCharacteristic(uuid, NIMBLE_PROPERTY::READ);
+    characteristic->setValue(name);
+    return true;
+}
+
+void NimBLEHIDDevice::setPnp(uint8_t sig, uint16_t vid, uint16_t pid, uint16_t version)
+{
+    NimBLEUUID uuid((uint16_t)UUID_PNP_ID);
+    NimBLECharacteristic* characteristic = _deviceInfoService->getCharacteristic(uuid);
+    if (!characteristic)
+        characteristic = _deviceInfoService->createCharacteristic(uuid, NIMBLE_PROPERTY::READ);
+
+    uint8_t pnp[] = { sig, (uint8_t)vid, (uint8_t)(vid >> 8), (uint8_t)pid, (uint8_t)(pid >> 8), (uint8_t)version, (uint8_t)(version >> 8) };
+    characteristic->setValue(pnp, sizeof(pnp));
+}
+
+void NimBLEHIDDevice::setHidInfo(uint8_t country, uint8_t flags)
+{
+    uint8_t info[] = { 0x11, 0x01, country, flags };
+    _hidService->getCharacteristic(NimBLEUUID((uint16_t)UUID_HID_INFORMATION))->setValue(info, sizeof(info));
+}
+
+void NimBLEHIDDevice::setBatteryLevel(uint8_t level, bool notify)
+{
+    _batteryLevel->setValue(&level, sizeof(level));
+    if (notify)
+        _batteryLevel->notify();
+}
+
+NimBLECharacteristic* NimBLEHIDDevice::getInputReport(uint8_t reportId)
+{
+    return getReport(reportId, REPORT_TYPE_INPUT, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::READ_ENC);
+}
+
+NimBLECharacteristic* NimBLEHIDDevice::getOutputReport(uint8_t reportId)
+{
+    return getReport(reportId, REPORT_TYPE_OUTPUT, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR |
+        NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC);
+}
+
+NimBLECharacteristic* NimBLEHIDDevice::getFeatureReport(uint8_t reportId)
+{
+    return getReport(reportId, REPORT_TYPE_FEATURE, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE |
+        NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC);
+}
+
+NimBLECharacteristic* NimBLEHIDDevice::getReport(uint8_t reportId, uint8_t type, uint32_t properties)
+{
+    NimBLEUUID uuid((uint16_t)UUID_REPORT);
+    NimBLEUUID referenceUuid((uint16_t)UUID_REPORT_REFERENCE);
+    for (auto characteristic : _hidService->getCharacteristics())
+    {
+        if (characteristic->getUUID() != uuid)
+            continue;
+
+        NimBLEDescriptor* reference = characteristic->getDescriptorByUUID(referenceUuid);
+        if (reference && reference->getValue().size() == 2 &&
+            reference->getValue().data()[0] == reportId && reference->getValue().data()[1] == type)
+            return characteristic;
+    }
+
+    NimBLECharacteristic* characteristic = _hidService->createCharacteristic(uuid, properties);
+    characteristic->setReportId(reportId);
+    uint8_t reference[] = { reportId, type };
+    characteristic->createDescriptor(referenceUuid, NIMBLE_PROPERTY::READ)->setValue(reference, sizeof(reference));
+    return characteristic;
+}
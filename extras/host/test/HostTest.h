@@ -0,0 +1,63 @@
+#pragma once
+
+// Minimal checks for the host tests. Every test is its own executable that returns non-zero from
+// main() when a check failed, which is all ctest looks at.
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "Arduino.h"
+#include "BleCompositeHID.h"
+#include "HostEmulator.h"
+
+static int hostTestFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            hostTestFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+    do { \
+        long long expectedValue = (long long)(expected); \
+        long long actualValue = (long long)(actual); \
+        if (expectedValue != actualValue) { \
+            printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #expected, #actual, \
+                expectedValue, actualValue); \
+            hostTestFailures++; \
+        } \
+    } while (0)
+
+#define HOST_TEST_RESULT() \
+    (printf("%s\n", hostTestFailures ? "FAILED" : "passed"), hostTestFailures ? 1 : 0)
+
+// Starts hid, connects a central that subscribes to every report and waits for the subscriptions to settle,
+// then starts telemetry over. Returns the connection handle, BLE_HS_CONN_HANDLE_NONE if hid never advertised.
+static inline uint16_t connectHost(BleCompositeHID* hid, const char* address = "11:22:33:44:55:66", uint16_t mtu = 185)
+{
+    hid->begin();
+    if (!HostEmulator::waitForAdvertising(2000))
+        return BLE_HS_CONN_HANDLE_NONE;
+
+    uint16_t connHandle = HostEmulator::connect(NimBLEAddress(std::string(address)), mtu);
+    HostEmulator::subscribeAll(connHandle);
+    delay(50);
+    HostEmulator::clearNotifications();
+    hid->getTelemetry(true);
+    return connHandle;
+}
+
+// Notifications logged for one report ID, in the order they were sent
+static inline std::vector<EmulatedNotification> notificationsFor(uint8_t reportId)
+{
+    std::vector<EmulatedNotification> result;
+    for (const auto& notification : HostEmulator::getNotifications())
+    {
+        if (notification.reportId == reportId)
+            result.push_back(notification);
+    }
+    return result;
+}
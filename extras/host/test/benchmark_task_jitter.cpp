@@ -0,0 +1,107 @@
+// Wake-up jitter of the library's own tasks, placed through the task settings of the configurations:
+//  - the Xbox haptics task, from the times the motor duty flips during a rumble that toggles every 10 ms
+//  - the autoSend task, from the queue latency of reports queued at a steady rate
+// On the host every task is a thread and pinning has no effect, so the numbers are a baseline to compare
+// scheduler changes against, not a prediction of the chip. Fails only if a task never ran.
+
+#include "HostTest.h"
+#include "XboxGamepadDevice.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+static std::mutex dutyMutex;
+static std::vector<uint32_t> dutyChangeMicros;
+
+static void onHapticsDuty(XboxHapticsDuty duty)
+{
+    std::lock_guard<std::mutex> lock(dutyMutex);
+    dutyChangeMicros.push_back(micros());
+}
+
+static void printJitter(const char* name, std::vector<int32_t> deviations)
+{
+    if (deviations.empty())
+        return;
+
+    std::sort(deviations.begin(), deviations.end());
+    int64_t total = 0;
+    for (int32_t deviation : deviations)
+        total += deviation;
+    printf("%s: %zu samples, mean %lld us, p50 %d us, p99 %d us, max %d us\n", name, deviations.size(),
+        (long long)(total / (int64_t)deviations.size()), deviations[deviations.size() / 2],
+        deviations[deviations.size() * 99 / 100], deviations.back());
+}
+
+static void measureHapticsJitter(XboxGamepadDevice* gamepad, uint16_t connHandle)
+{
+    // Weak motor at full strength: 10 ms off, 10 ms on, 50 more times
+    const uint8_t rumble[XBOX_OUTPUT_REPORT_SIZE] = { XBOX_ACTUATOR_WEAK_MOTOR, 0, 0, XBOX_HAPTICS_MAX_MAGNITUDE, 0, 1, 1, 50 };
+    HostEmulator::write(connHandle, HostEmulator::findReport(XBOX_OUTPUT_REPORT_ID, 2), rumble, sizeof(rumble));
+    delay(51 * 2 * XBOX_HAPTICS_TIME_UNIT_MS + 100);
+
+    std::vector<int32_t> deviations;
+    {
+        std::lock_guard<std::mutex> lock(dutyMutex);
+        for (size_t i = 1; i < dutyChangeMicros.size(); i++)
+        {
+            int32_t interval = (int32_t)(dutyChangeMicros[i] - dutyChangeMicros[i - 1]);
+            deviations.push_back(std::abs(interval - XBOX_HAPTICS_TIME_UNIT_MS * 1000));
+        }
+        CHECK(dutyChangeMicros.size() >= 50);
+    }
+    printJitter("haptics task, duty flip vs 10 ms", deviations);
+}
+
+static void measureAutoSendLatency(BleCompositeHID* hid, XboxGamepadDevice* gamepad)
+{
+    hid->getTelemetry(true);
+    for (int i = 0; i < 500; i++)
+    {
+        gamepad->setLeftThumb((int16_t)(i * 64), 0);
+        delay(2);
+    }
+    delay(100);
+
+    TelemetrySnapshot telemetry = hid->getTelemetry(true);
+    uint32_t sent = 0;
+    for (uint8_t bucket = 0; bucket < TELEMETRY_LATENCY_BUCKETS; bucket++)
+        sent += telemetry.queueLatency[bucket];
+    CHECK(sent > 0);
+
+    printf("autoSend task, queue latency: %u reports, p50 < %u us, p99 < %u us\n", sent,
+        Telemetry::getLatencyPercentile(telemetry.queueLatency, 50),
+        Telemetry::getLatencyPercentile(telemetry.queueLatency, 99));
+}
+
+int main()
+{
+    XboxSeriesXControllerDeviceConfiguration* config = new XboxSeriesXControllerDeviceConfiguration();
+    config->setUseHapticsEngine(true);
+    config->setHapticsTask(1, 10, 2048);
+    config->setAutoDefer(true);
+
+    BLEHostConfiguration hostConfig = config->getIdealHostConfiguration();
+    hostConfig.setQueuedSending(true);
+    hostConfig.setQueueSendRate(0);         // No pacing, the latency is only the time the task takes to wake up
+    hostConfig.setAutoSendTask(0, 6, 4096);
+
+    BleCompositeHID* hid = new BleCompositeHID("Jitter Benchmark", "Test", 100);
+    XboxGamepadDevice* gamepad = new XboxGamepadDevice(config);
+    FunctionSlot<XboxHapticsDuty> dutySlot(onHapticsDuty);
+    gamepad->onHapticsDuty.attach(dutySlot);
+    hid->addDevice(gamepad);
+
+    hid->begin(hostConfig);
+    CHECK(HostEmulator::waitForAdvertising(2000));
+    uint16_t connHandle = HostEmulator::connect(NimBLEAddress(std::string("11:22:33:44:55:66")), 185);
+    HostEmulator::subscribeAll(connHandle);
+    delay(50);
+    HostEmulator::setLogNotifications(false);
+
+    measureHapticsJitter(gamepad, connHandle);
+    measureAutoSendLatency(hid, gamepad);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,103 @@
+// With COMPOSITE_HID_STATIC_ALLOCATION the report path must not touch the heap once a host is connected.
+// Every operator new in the process is counted while reports are sent directly and through the queue.
+
+#include "HostTest.h"
+#include "GamepadDevice.h"
+#include "KeyboardDevice.h"
+#include "MouseDevice.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+#if !defined(COMPOSITE_HID_STATIC_ALLOCATION)
+#error "test_allocations needs the static allocation mode, see COMPOSITE_HID_HOST_STATIC_ALLOCATION"
+#endif
+
+static std::atomic<bool> countingAllocations(false);
+static std::atomic<uint32_t> allocations(0);
+
+static void* allocate(size_t size)
+{
+    if (countingAllocations.load(std::memory_order_relaxed))
+        allocations++;
+
+    void* pointer = malloc(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return malloc(size ? size : 1); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return malloc(size ? size : 1); }
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+
+static uint32_t countNotified(BleCompositeHID* hid)
+{
+    TelemetrySnapshot telemetry = hid->getTelemetry();
+    uint32_t notified = 0;
+    for (const auto& device : telemetry.devices)
+    {
+        if (device.deviceName)
+            notified += device.counters[TELEMETRY_REPORTS_NOTIFIED];
+    }
+    return notified;
+}
+
+// One round of every kind of report: direct keyboard and mouse reports, queued keyboard reports and
+// gamepad reports, which auto-defer
+static void sendReports(BleCompositeHID* hid, GamepadDevice* gamepad, KeyboardDevice* keyboard, MouseDevice* mouse)
+{
+    keyboard->keyPress(KEY_A);
+    keyboard->keyRelease(KEY_A);
+    keyboard->mediaKeyPress(KEY_MEDIA_MUTE);
+    keyboard->mediaKeyRelease(KEY_MEDIA_MUTE);
+    mouse->mouseMove(5, -5, 1);
+    mouse->mouseClick();
+
+    keyboard->sendKeyReport(true);
+    keyboard->sendMediaKeyReport(true);
+
+    gamepad->press(BUTTON_1);
+    gamepad->setAxes(100, -100, 0, 0, 0, 0, 0, 0);
+    gamepad->release(BUTTON_1);
+    hid->sendDeferredReports();
+}
+
+int main()
+{
+    BleCompositeHID* hid = new BleCompositeHID("Allocation Test", "Test", 100);
+    GamepadDevice* gamepad = new GamepadDevice();
+    KeyboardDevice* keyboard = new KeyboardDevice();
+    MouseDevice* mouse = new MouseDevice();
+    hid->addDevice(gamepad);
+    hid->addDevice(keyboard);
+    hid->addDevice(mouse);
+
+    uint16_t connHandle = connectHost(hid);
+    CHECK(connHandle != BLE_HS_CONN_HANDLE_NONE);
+    HostEmulator::setLogNotifications(false);
+
+    // The first round sizes every characteristic value, later rounds reuse the storage
+    sendReports(hid, gamepad, keyboard, mouse);
+    uint32_t notified = countNotified(hid);
+    sendReports(hid, gamepad, keyboard, mouse);
+    uint32_t perRound = countNotified(hid) - notified;
+    CHECK(perRound >= 8);
+
+    notified = countNotified(hid);
+    countingAllocations = true;
+    for (int round = 0; round < 50; round++)
+        sendReports(hid, gamepad, keyboard, mouse);
+    countingAllocations = false;
+
+    CHECK_EQUAL(0, allocations.load());
+    CHECK_EQUAL(perRound * 50, countNotified(hid) - notified);
+
+    return HOST_TEST_RESULT();
+}
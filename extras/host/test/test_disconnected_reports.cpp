@@ -0,0 +1,71 @@
+// Reports made while no host is connected with DISCONNECTED_REPORTS_KEEP: none of them is replayed,
+// the device sends its current state once when the host is back, and only if a report was recent enough.
+
+#include "HostTest.h"
+#include "KeyboardDevice.h"
+#include "MouseDevice.h"
+#include "KeyboardDescriptors.h"
+
+#define TEST_ADDRESS "11:22:33:44:55:66"
+#define TEST_TTL_MS 300
+
+static uint16_t reconnect()
+{
+    CHECK(HostEmulator::waitForAdvertising(2000));
+    uint16_t connHandle = HostEmulator::connect(NimBLEAddress(std::string(TEST_ADDRESS)), 185);
+    HostEmulator::subscribeAll(connHandle);
+    delay(50);
+    return connHandle;
+}
+
+int main()
+{
+    BLEHostConfiguration config;
+    config.setRestoreStateOnReconnect(false);
+    config.setDisconnectedReportPolicy(DISCONNECTED_REPORTS_KEEP);
+    config.setDisconnectedReportTTL(TEST_TTL_MS);
+    config.setQueuedSending(true);
+
+    BleCompositeHID* hid = new BleCompositeHID("Disconnected Test", "Test", 100);
+    KeyboardDevice* keyboard = new KeyboardDevice();
+    MouseDevice* mouse = new MouseDevice();
+    hid->addDevice(keyboard);
+    hid->addDevice(mouse);
+
+    hid->begin(config);
+    CHECK(HostEmulator::waitForAdvertising(2000));
+    uint16_t connHandle = HostEmulator::connect(NimBLEAddress(std::string(TEST_ADDRESS)), 185);
+    HostEmulator::subscribeAll(connHandle);
+    delay(50);
+
+    // Typing while the host is away, direct and queued
+    HostEmulator::disconnect(connHandle);
+    HostEmulator::clearNotifications();
+    for (uint8_t key = KEY_A; key < KEY_A + 10; key++)
+    {
+        keyboard->keyPress(key);
+        keyboard->sendKeyReport(true);
+        keyboard->keyRelease(key);
+    }
+    keyboard->keyPress(KEY_Z);
+    delay(20);
+    CHECK_EQUAL(0, HostEmulator::getNotificationCount());
+
+    // The keyboard sends its current state once, the mouse had nothing to send
+    connHandle = reconnect();
+    auto keys = notificationsFor(KEYBOARD_REPORT_ID);
+    CHECK_EQUAL(1, keys.size());
+    if (keys.size() == 1)
+        CHECK_EQUAL(KEY_Z, keys[0].data[2]);
+    CHECK_EQUAL(0, notificationsFor(MOUSE_REPORT_ID).size());
+
+    // A report older than the TTL isn't worth restoring
+    HostEmulator::disconnect(connHandle);
+    keyboard->keyRelease(KEY_Z);
+    delay(TEST_TTL_MS + 100);
+    HostEmulator::clearNotifications();
+    connHandle = reconnect();
+    CHECK_EQUAL(0, notificationsFor(KEYBOARD_REPORT_ID).size());
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,188 @@
+// Plays recorded rumble report streams through XboxHapticsEngine on a virtual clock, then checks that an
+// Xbox gamepad with the haptics task running can be removed and destroyed while it plays.
+
+#include "HostTest.h"
+#include "XboxGamepadDevice.h"
+
+#include <mutex>
+#include <vector>
+
+#define HAPTICS_TEST_TICK_MS 10
+
+// An output report as it arrived from the host, atMs on the virtual clock
+struct RecordedRumble {
+    uint32_t atMs;
+    uint8_t report[XBOX_OUTPUT_REPORT_SIZE];
+};
+
+struct DutyChange {
+    uint32_t atMs;
+    uint8_t weakMotor;
+    uint8_t strongMotor;
+};
+
+// Ticks the engine every HAPTICS_TEST_TICK_MS from 0 to endMs, playing each report when it is due
+static std::vector<DutyChange> playStream(XboxHapticsEngine& engine, const RecordedRumble* stream, size_t count, uint32_t endMs)
+{
+    std::vector<DutyChange> changes;
+    size_t next = 0;
+    for (uint32_t nowMs = 0; nowMs <= endMs; nowMs += HAPTICS_TEST_TICK_MS)
+    {
+        while (next < count && stream[next].atMs <= nowMs)
+        {
+            engine.play(XboxGamepadOutputReportData(stream[next].report, XBOX_OUTPUT_REPORT_SIZE), nowMs);
+            next++;
+        }
+
+        if (engine.tick(nowMs))
+        {
+            XboxHapticsDuty duty = engine.getDuty();
+            DutyChange change = { nowMs, duty.weakMotor, duty.strongMotor };
+            changes.push_back(change);
+        }
+    }
+    return changes;
+}
+
+static void checkChanges(const DutyChange* expected, size_t count, const std::vector<DutyChange>& actual)
+{
+    CHECK_EQUAL(count, actual.size());
+    for (size_t i = 0; i < count && i < actual.size(); i++)
+    {
+        CHECK_EQUAL(expected[i].atMs, actual[i].atMs);
+        CHECK_EQUAL(expected[i].weakMotor, actual[i].weakMotor);
+        CHECK_EQUAL(expected[i].strongMotor, actual[i].strongMotor);
+    }
+}
+
+static void testOverlappingReports()
+{
+    // Bytes: actuators, left trigger, right trigger, weak, strong, duration, start delay, loop count
+    const RecordedRumble stream[] = {
+        // Weak motor at 50% for 50 ms
+        { 0, { XBOX_ACTUATOR_WEAK_MOTOR, 0, 0, 50, 0, 5, 0, 0 } },
+        // Strong motor joins, twice 10 ms off then 20 ms on, the weak motor keeps playing
+        { 20, { XBOX_ACTUATOR_STRONG_MOTOR, 0, 0, 0, 100, 2, 1, 1 } },
+        // A short weak pulse once everything stopped
+        { 100, { XBOX_ACTUATOR_WEAK_MOTOR, 0, 0, 20, 0, 1, 0, 0 } },
+    };
+    const DutyChange expected[] = {
+        { 0, 128, 0 },
+        { 30, 128, 255 },
+        { 50, 0, 0 },
+        { 60, 0, 255 },
+        { 80, 0, 0 },
+        { 100, 51, 0 },
+        { 110, 0, 0 },
+    };
+
+    XboxHapticsEngine engine;
+    std::vector<DutyChange> changes = playStream(engine, stream, sizeof(stream) / sizeof(stream[0]), 200);
+    checkChanges(expected, sizeof(expected) / sizeof(expected[0]), changes);
+    CHECK(!engine.isActive());
+}
+
+static void testReplacedTimeline()
+{
+    const RecordedRumble stream[] = {
+        // A long rumble cut short by a report that switches the same motor off
+        { 0, { XBOX_ACTUATOR_STRONG_MOTOR, 0, 0, 0, 80, 100, 0, 0 } },
+        { 30, { XBOX_ACTUATOR_STRONG_MOTOR, 0, 0, 0, 0, 0, 0, 0 } },
+        // Magnitudes above 100% are clamped
+        { 50, { XBOX_ACTUATOR_WEAK_MOTOR, 0, 0, 250, 0, 1, 0, 0 } },
+    };
+    const DutyChange expected[] = {
+        { 0, 0, 204 },
+        { 30, 0, 0 },
+        { 50, 255, 0 },
+        { 60, 0, 0 },
+    };
+
+    XboxHapticsEngine engine;
+    std::vector<DutyChange> changes = playStream(engine, stream, sizeof(stream) / sizeof(stream[0]), 100);
+    checkChanges(expected, sizeof(expected) / sizeof(expected[0]), changes);
+}
+
+static void testStopNeedsATickToClearTheOutput()
+{
+    XboxHapticsEngine engine;
+    const uint8_t report[XBOX_OUTPUT_REPORT_SIZE] = { XBOX_ACTUATOR_WEAK_MOTOR | XBOX_ACTUATOR_STRONG_MOTOR, 0, 0, 100, 100, 255, 0, 255 };
+    engine.play(XboxGamepadOutputReportData(report, sizeof(report)), 1000);
+    CHECK(engine.tick(1000));
+    CHECK(engine.isActive());
+
+    engine.stop();
+    // The outputs are still driven until the next tick brings them to zero
+    CHECK(engine.isActive());
+    CHECK(engine.tick(1010));
+    CHECK(engine.getDuty() == XboxHapticsDuty());
+    CHECK(!engine.isActive());
+}
+
+static void testClockWrapsAround()
+{
+    XboxHapticsEngine engine;
+    const uint8_t report[XBOX_OUTPUT_REPORT_SIZE] = { XBOX_ACTUATOR_WEAK_MOTOR, 0, 0, 100, 0, 3, 0, 0 };
+    uint32_t start = 0xFFFFFFFF - 15;
+    engine.play(XboxGamepadOutputReportData(report, sizeof(report)), start);
+    CHECK(engine.tick(start));
+    CHECK(!engine.tick(start + 20));
+    CHECK(engine.tick(start + 30));
+    CHECK_EQUAL(0, engine.getDuty().weakMotor);
+}
+
+static std::mutex dutyMutex;
+static uint32_t dutyChanges = 0;
+
+static void onHapticsDuty(XboxHapticsDuty duty)
+{
+    std::lock_guard<std::mutex> lock(dutyMutex);
+    dutyChanges++;
+}
+
+static void testDestroyWhilePlaying()
+{
+    XboxSeriesXControllerDeviceConfiguration* config = new XboxSeriesXControllerDeviceConfiguration();
+    config->setUseHapticsEngine(true);
+    config->setHapticsTickMs(1);
+
+    BleCompositeHID* hid = new BleCompositeHID("Haptics Test", "Test", 100);
+    XboxGamepadDevice* gamepad = new XboxGamepadDevice(config);
+    FunctionSlot<XboxHapticsDuty> dutySlot(onHapticsDuty);
+    gamepad->onHapticsDuty.attach(dutySlot);
+    hid->addDevice(gamepad);
+
+    uint16_t connHandle = connectHost(hid);
+    CHECK(connHandle != BLE_HS_CONN_HANDLE_NONE);
+
+    // Flips every 10 ms for several seconds, the task is mid-rumble when the device goes away
+    const uint8_t rumble[XBOX_OUTPUT_REPORT_SIZE] = { XBOX_ACTUATOR_WEAK_MOTOR, 0, 0, 100, 0, 1, 1, 255 };
+    HostEmulator::write(connHandle, HostEmulator::findReport(XBOX_OUTPUT_REPORT_ID, 2), rumble, sizeof(rumble));
+    delay(100);
+
+    hid->removeDevice(gamepad);
+    delete gamepad;
+
+    uint32_t changesAtDelete;
+    {
+        std::lock_guard<std::mutex> lock(dutyMutex);
+        changesAtDelete = dutyChanges;
+    }
+    CHECK(changesAtDelete >= 5);
+
+    // With the sanitizers a task still running on the freed device would fault here
+    delay(100);
+    std::lock_guard<std::mutex> lock(dutyMutex);
+    CHECK_EQUAL(changesAtDelete, dutyChanges);
+}
+
+int main()
+{
+    testOverlappingReports();
+    testReplacedTimeline();
+    testStopNeedsATickToClearTheOutput();
+    testClockWrapsAround();
+    testDestroyWhilePlaying();
+
+    return HOST_TEST_RESULT();
+}
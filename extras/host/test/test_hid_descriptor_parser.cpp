@@ -0,0 +1,224 @@
+// Hand built descriptors through HIDDescriptorParser: per type sizes with Push and Pop, and every error
+// with the owner, offset and report ID it is reported at.
+
+#include "HostTest.h"
+#include "HIDDescriptorParser.h"
+
+#include <string.h>
+
+static void testSizesWithPushAndPop()
+{
+    const uint8_t descriptor[] = {
+        0x05, 0x01,         // USAGE_PAGE (Generic Desktop)
+        0x09, 0x05,         // USAGE (Game Pad)
+        0xA1, 0x01,         // COLLECTION (Application)
+        0x85, 0x01,         //   REPORT_ID (1)
+        0x75, 0x08,         //   REPORT_SIZE (8)
+        0x95, 0x02,         //   REPORT_COUNT (2)
+        0x81, 0x02,         //   INPUT (Data, Var, Abs)
+        0xA4,               //   PUSH
+        0x85, 0x02,         //     REPORT_ID (2)
+        0x75, 0x01,         //     REPORT_SIZE (1)
+        0x95, 0x05,         //     REPORT_COUNT (5)
+        0x91, 0x02,         //     OUTPUT (Data, Var, Abs)
+        0x75, 0x03,         //     REPORT_SIZE (3)
+        0x95, 0x01,         //     REPORT_COUNT (1)
+        0x91, 0x01,         //     OUTPUT (Const)
+        0xB4,               //   POP, back to report 1 with 2 x 8 bits
+        0xB1, 0x02,         //   FEATURE (Data, Var, Abs)
+        0x81, 0x02,         //   INPUT (Data, Var, Abs)
+        0xC0                // END_COLLECTION
+    };
+
+    HIDDescriptorParser parser;
+    CHECK_EQUAL(HID_PARSE_OK, parser.parse(descriptor, sizeof(descriptor)));
+    CHECK_EQUAL(HID_PARSE_OK, parser.getError());
+    CHECK_EQUAL(2, parser.getReportCount());
+    CHECK_EQUAL(4, parser.getReportSize(1, HID_REPORT_TYPE_INPUT));
+    CHECK_EQUAL(0, parser.getReportSize(1, HID_REPORT_TYPE_OUTPUT));
+    CHECK_EQUAL(2, parser.getReportSize(1, HID_REPORT_TYPE_FEATURE));
+    CHECK_EQUAL(0, parser.getReportSize(2, HID_REPORT_TYPE_INPUT));
+    CHECK_EQUAL(1, parser.getReportSize(2, HID_REPORT_TYPE_OUTPUT));
+    CHECK_EQUAL(0, parser.getReportSize(3, HID_REPORT_TYPE_INPUT));
+}
+
+static void testReportIdCollision()
+{
+    const uint8_t first[] = {
+        0x85, 0x03,         // REPORT_ID (3)
+        0x75, 0x08,         // REPORT_SIZE (8)
+        0x95, 0x01,         // REPORT_COUNT (1)
+        0x81, 0x02          // INPUT (Data, Var, Abs)
+    };
+    const uint8_t second[] = {
+        0x85, 0x04,         // REPORT_ID (4)
+        0x75, 0x08,         // REPORT_SIZE (8)
+        0x95, 0x02,         // REPORT_COUNT (2)
+        0x81, 0x02,         // INPUT (Data, Var, Abs)
+        0x85, 0x03,         // REPORT_ID (3), already declared by the first part
+        0x81, 0x02          // INPUT (Data, Var, Abs)
+    };
+
+    HIDDescriptorParser parser;
+    CHECK_EQUAL(HID_PARSE_OK, parser.parse(first, sizeof(first), 0));
+    CHECK_EQUAL(HID_PARSE_REPORT_ID_COLLISION, parser.parse(second, sizeof(second), 1));
+    CHECK_EQUAL(HID_PARSE_REPORT_ID_COLLISION, parser.getError());
+    CHECK_EQUAL(1, parser.getErrorOwner());
+    CHECK_EQUAL(10, parser.getErrorOffset());
+    CHECK_EQUAL(3, parser.getErrorReportId());
+
+    // The first part keeps its report, the colliding input isn't added to it
+    CHECK_EQUAL(1, parser.getReportSize(3, HID_REPORT_TYPE_INPUT));
+    CHECK_EQUAL(0, parser.findReport(3)->owner);
+    CHECK_EQUAL(2, parser.getReportSize(4, HID_REPORT_TYPE_INPUT));
+
+    // The same part declaring an ID again adds to its report
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_OK, parser.parse(first, sizeof(first), 0));
+    CHECK_EQUAL(HID_PARSE_OK, parser.parse(first, sizeof(first), 0));
+    CHECK_EQUAL(2, parser.getReportSize(3, HID_REPORT_TYPE_INPUT));
+}
+
+static void testTruncatedItems()
+{
+    // A long item that fits is skipped
+    const uint8_t longItem[] = {
+        0xFE, 0x02, 0x10, 0xAA, 0xBB,   // Long item with 2 data bytes
+        0x85, 0x01,                     // REPORT_ID (1)
+        0x75, 0x08,                     // REPORT_SIZE (8)
+        0x95, 0x01,                     // REPORT_COUNT (1)
+        0x81, 0x02                      // INPUT (Data, Var, Abs)
+    };
+    HIDDescriptorParser parser;
+    CHECK_EQUAL(HID_PARSE_OK, parser.parse(longItem, sizeof(longItem)));
+    CHECK_EQUAL(1, parser.getReportSize(1, HID_REPORT_TYPE_INPUT));
+
+    // One that claims more data than is left
+    const uint8_t truncatedLong[] = {
+        0x85, 0x01,                     // REPORT_ID (1)
+        0xFE, 0x05, 0x10, 0xAA, 0xBB    // Long item with 5 data bytes, 2 present
+    };
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_TRUNCATED_ITEM, parser.parse(truncatedLong, sizeof(truncatedLong), 2));
+    CHECK_EQUAL(2, parser.getErrorOwner());
+    CHECK_EQUAL(2, parser.getErrorOffset());
+
+    // One cut off before its data size byte
+    const uint8_t truncatedHeader[] = { 0x85, 0x01, 0xFE };
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_TRUNCATED_ITEM, parser.parse(truncatedHeader, sizeof(truncatedHeader)));
+    CHECK_EQUAL(2, parser.getErrorOffset());
+
+    // A short item missing its last data byte
+    const uint8_t truncatedShort[] = {
+        0x85, 0x01,                     // REPORT_ID (1)
+        0x26, 0xFF                      // LOGICAL_MAXIMUM with 2 data bytes, 1 present
+    };
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_TRUNCATED_ITEM, parser.parse(truncatedShort, sizeof(truncatedShort)));
+    CHECK_EQUAL(2, parser.getErrorOffset());
+}
+
+static void testUnbalancedCollections()
+{
+    const uint8_t extraEnd[] = {
+        0xA1, 0x01,         // COLLECTION (Application)
+        0xC0,               // END_COLLECTION
+        0xC0                // END_COLLECTION without a collection
+    };
+    HIDDescriptorParser parser;
+    CHECK_EQUAL(HID_PARSE_UNBALANCED_COLLECTION, parser.parse(extraEnd, sizeof(extraEnd)));
+    CHECK_EQUAL(3, parser.getErrorOffset());
+
+    // A collection left open is reported at the end of the part
+    const uint8_t leftOpen[] = {
+        0xA1, 0x01,         // COLLECTION (Application)
+        0xA1, 0x00,         //   COLLECTION (Physical)
+        0xC0                //   END_COLLECTION
+    };
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_UNBALANCED_COLLECTION, parser.parse(leftOpen, sizeof(leftOpen), 1));
+    CHECK_EQUAL(1, parser.getErrorOwner());
+    CHECK_EQUAL(sizeof(leftOpen), parser.getErrorOffset());
+}
+
+static void testPushAndPopMismatch()
+{
+    const uint8_t popWithoutPush[] = {
+        0x75, 0x08,         // REPORT_SIZE (8)
+        0xA4,               // PUSH
+        0xB4,               // POP
+        0xB4                // POP without PUSH
+    };
+    HIDDescriptorParser parser;
+    CHECK_EQUAL(HID_PARSE_STACK_ERROR, parser.parse(popWithoutPush, sizeof(popWithoutPush)));
+    CHECK_EQUAL(4, parser.getErrorOffset());
+
+    // One PUSH more than the stack holds
+    uint8_t tooDeep[HID_PARSER_STACK_DEPTH + 1];
+    for (size_t i = 0; i < sizeof(tooDeep); i++)
+        tooDeep[i] = 0xA4;
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_STACK_ERROR, parser.parse(tooDeep, sizeof(tooDeep)));
+    CHECK_EQUAL(HID_PARSER_STACK_DEPTH, parser.getErrorOffset());
+}
+
+static void testMixedReportIds()
+{
+    const uint8_t mixed[] = {
+        0x75, 0x08,         // REPORT_SIZE (8)
+        0x95, 0x01,         // REPORT_COUNT (1)
+        0x81, 0x02,         // INPUT without a report ID
+        0x85, 0x01,         // REPORT_ID (1)
+        0x81, 0x02          // INPUT (Data, Var, Abs)
+    };
+    HIDDescriptorParser parser;
+    CHECK_EQUAL(HID_PARSE_INVALID_REPORT_ID, parser.parse(mixed, sizeof(mixed)));
+    CHECK_EQUAL(8, parser.getErrorOffset());
+    CHECK_EQUAL(1, parser.getErrorReportId());
+    CHECK_EQUAL(1, parser.getReportCount());
+
+    // Across parts too: a part without IDs after one with them
+    const uint8_t declared[] = { 0x85, 0x01, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02 };
+    const uint8_t undeclared[] = { 0x75, 0x08, 0x95, 0x01, 0x81, 0x02 };
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_OK, parser.parse(declared, sizeof(declared), 0));
+    CHECK_EQUAL(HID_PARSE_INVALID_REPORT_ID, parser.parse(undeclared, sizeof(undeclared), 1));
+    CHECK_EQUAL(1, parser.getErrorOwner());
+    CHECK_EQUAL(4, parser.getErrorOffset());
+
+    // Report ID 0 is reserved
+    const uint8_t zeroId[] = { 0x85, 0x00 };
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_INVALID_REPORT_ID, parser.parse(zeroId, sizeof(zeroId)));
+    CHECK_EQUAL(0, parser.getErrorOffset());
+}
+
+static void testFirstErrorIsKept()
+{
+    const uint8_t popWithoutPush[] = { 0xB4 };
+    const uint8_t extraEnd[] = { 0xC0 };
+    HIDDescriptorParser parser;
+    CHECK_EQUAL(HID_PARSE_STACK_ERROR, parser.parse(popWithoutPush, sizeof(popWithoutPush), 0));
+    CHECK_EQUAL(HID_PARSE_UNBALANCED_COLLECTION, parser.parse(extraEnd, sizeof(extraEnd), 1));
+    CHECK_EQUAL(HID_PARSE_STACK_ERROR, parser.getError());
+    CHECK_EQUAL(0, parser.getErrorOwner());
+    CHECK(strcmp("push/pop mismatch", HIDDescriptorParser::getErrorName(parser.getError())) == 0);
+
+    parser.reset();
+    CHECK_EQUAL(HID_PARSE_OK, parser.getError());
+    CHECK_EQUAL(0, parser.getReportCount());
+}
+
+int main()
+{
+    testSizesWithPushAndPop();
+    testReportIdCollision();
+    testTruncatedItems();
+    testUnbalancedCollections();
+    testPushAndPopMismatch();
+    testMixedReportIds();
+    testFirstErrorIsKept();
+
+    return HOST_TEST_RESULT();
+}
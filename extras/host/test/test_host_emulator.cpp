@@ -0,0 +1,209 @@
+// Drives a gamepad, keyboard and mouse composite device through the emulated central:
+// connect, subscribe, send, and check what the stack was handed.
+
+#include "HostTest.h"
+#include "GamepadDevice.h"
+#include "KeyboardDevice.h"
+#include "MouseDevice.h"
+#include "KeyboardDescriptors.h"
+
+static void testReportsReachTheHost(BleCompositeHID* hid, GamepadDevice* gamepad, KeyboardDevice* keyboard, MouseDevice* mouse)
+{
+    uint32_t start = micros();
+
+    keyboard->keyPress(KEY_A);
+    keyboard->keyRelease(KEY_A);
+    auto keys = notificationsFor(KEYBOARD_REPORT_ID);
+    CHECK_EQUAL(2, keys.size());
+    if (keys.size() == 2)
+    {
+        CHECK_EQUAL(8, keys[0].data.size());
+        CHECK_EQUAL(KEY_A, keys[0].data[2]);
+        CHECK_EQUAL(0, keys[1].data[2]);
+        CHECK_EQUAL(0, keys[0].status);
+        CHECK(keys[0].timestampMicros - start <= keys[1].timestampMicros - start);
+    }
+
+    keyboard->mediaKeyPress(KEY_MEDIA_MUTE);
+    keyboard->mediaKeyRelease(KEY_MEDIA_MUTE);
+    auto media = notificationsFor(MEDIA_KEYS_REPORT_ID);
+    CHECK_EQUAL(2, media.size());
+    if (media.size() == 2)
+        CHECK_EQUAL(3, media[0].data.size());
+
+    mouse->mouseMove(3, -2);
+    auto moves = notificationsFor(MOUSE_REPORT_ID);
+    CHECK_EQUAL(1, moves.size());
+    if (moves.size() == 1)
+    {
+        CHECK_EQUAL(3, (int8_t)moves[0].data[1]);
+        CHECK_EQUAL(-2, (int8_t)moves[0].data[2]);
+    }
+
+    // Gamepad reports go through the deferred queue, which this test sends by hand
+    gamepad->press(BUTTON_1);
+    CHECK_EQUAL(0, notificationsFor(GAMEPAD_REPORT_ID).size());
+    hid->sendDeferredReports();
+    auto buttons = notificationsFor(GAMEPAD_REPORT_ID);
+    CHECK_EQUAL(1, buttons.size());
+    if (buttons.size() == 1)
+        CHECK_EQUAL(0x01, buttons[0].data[0] & 0x01);
+    gamepad->release(BUTTON_1);
+    hid->sendDeferredReports();
+
+    TelemetrySnapshot telemetry = hid->getTelemetry(true);
+    uint32_t notified = 0;
+    for (const auto& device : telemetry.devices)
+    {
+        if (device.deviceName)
+            notified += device.counters[TELEMETRY_REPORTS_NOTIFIED];
+    }
+    CHECK_EQUAL(HostEmulator::getNotificationCount(), notified);
+    HostEmulator::clearNotifications();
+}
+
+static void testLargeMotionIsSplit(MouseDevice* mouse)
+{
+    // 8 bit axes carry 127 counts, the rest of the move follows in further reports
+    mouse->mouseMove(1000, 0);
+    auto moves = notificationsFor(MOUSE_REPORT_ID);
+    CHECK_EQUAL(8, moves.size());
+    for (size_t i = 0; i < moves.size(); i++)
+        CHECK_EQUAL(i + 1 < moves.size() ? 127 : 111, (int8_t)moves[i].data[1]);
+    CHECK(!mouse->hasPendingMotion());
+    HostEmulator::clearNotifications();
+}
+
+static uint8_t wheelMultiplier = 0;
+static uint8_t hWheelMultiplier = 0;
+
+static void onWheelMultiplier(uint8_t multiplier)
+{
+    wheelMultiplier = multiplier;
+}
+
+static void onHWheelMultiplier(uint8_t multiplier)
+{
+    hWheelMultiplier = multiplier;
+}
+
+static void testWheelMultipliersChangeSeparately(uint16_t connHandle, MouseDevice* mouse)
+{
+    static FunctionSlot<uint8_t> wheelSlot(onWheelMultiplier);
+    static FunctionSlot<uint8_t> hWheelSlot(onHWheelMultiplier);
+    mouse->onWheelMultiplierChanged.attach(wheelSlot);
+    mouse->onHWheelMultiplierChanged.attach(hWheelSlot);
+
+    // The wheel's multiplier is in bits 0-1 of the feature report, the horizontal wheel's in bits 2-3
+    NimBLECharacteristic* feature = HostEmulator::findReport(MOUSE_REPORT_ID, 3);
+    CHECK(feature != nullptr);
+    const uint8_t hWheelOnly = 0x04;
+    HostEmulator::write(connHandle, feature, &hWheelOnly, sizeof(hWheelOnly));
+    delay(50);
+    CHECK_EQUAL(0, wheelMultiplier);
+    CHECK_EQUAL(MOUSE_DEFAULT_SCROLL_RESOLUTION_MULTIPLIER, hWheelMultiplier);
+    CHECK_EQUAL(1, mouse->getWheelMultiplier());
+    CHECK_EQUAL(MOUSE_DEFAULT_SCROLL_RESOLUTION_MULTIPLIER, mouse->getHWheelMultiplier());
+}
+
+static void testRefusedNotificationsAreCounted(BleCompositeHID* hid, KeyboardDevice* keyboard)
+{
+    HostEmulator::setNotifyResult(BLE_HS_ENOMEM);
+    keyboard->keyPress(KEY_B);
+    HostEmulator::setNotifyResult(0);
+    keyboard->keyRelease(KEY_B);
+
+    auto keys = notificationsFor(KEYBOARD_REPORT_ID);
+    CHECK_EQUAL(2, keys.size());
+    if (keys.size() == 2)
+    {
+        CHECK_EQUAL(BLE_HS_ENOMEM, keys[0].status);
+        CHECK_EQUAL(0, keys[1].status);
+    }
+
+    TelemetrySnapshot telemetry = hid->getTelemetry(true);
+    uint32_t failures = 0;
+    for (const auto& device : telemetry.devices)
+    {
+        if (device.deviceName)
+            failures += device.counters[TELEMETRY_NOTIFY_FAILURES];
+    }
+    CHECK_EQUAL(1, failures);
+    CHECK_EQUAL(1, telemetry.notifyStatusCount);
+    CHECK_EQUAL(BLE_HS_ENOMEM, telemetry.notifyStatus[0].code);
+    HostEmulator::clearNotifications();
+}
+
+static void testReconnect(BleCompositeHID* hid, uint16_t connHandle, KeyboardDevice* keyboard)
+{
+    HostEmulator::disconnect(connHandle);
+    CHECK(!hid->isConnected());
+
+    // Nothing reaches the stack without a host
+    keyboard->keyPress(KEY_C);
+    keyboard->keyRelease(KEY_C);
+    CHECK_EQUAL(0, HostEmulator::getNotificationCount());
+
+    CHECK(HostEmulator::waitForAdvertising(2000));
+    connHandle = HostEmulator::connect(NimBLEAddress(std::string("11:22:33:44:55:66")), 185);
+    CHECK(connHandle != BLE_HS_CONN_HANDLE_NONE);
+    HostEmulator::subscribeAll(connHandle);
+    delay(50);
+    CHECK(hid->isConnected());
+    HostEmulator::clearNotifications();
+
+    keyboard->keyPress(KEY_D);
+    auto keys = notificationsFor(KEYBOARD_REPORT_ID);
+    CHECK_EQUAL(1, keys.size());
+    if (keys.size() == 1)
+    {
+        CHECK_EQUAL(connHandle, keys[0].connHandle);
+        CHECK_EQUAL(KEY_D, keys[0].data[2]);
+    }
+}
+
+static void testRemoveWithQueuedReports(BleCompositeHID* hid, GamepadDevice* gamepad)
+{
+    HostEmulator::clearNotifications();
+    gamepad->press(BUTTON_2);
+    gamepad->release(BUTTON_2);
+
+    // The queued reports go with the device, with the sanitizers sending one would fault on the freed gamepad
+    CHECK_EQUAL(2, hid->getTelemetry().deferredQueueDepth);
+    hid->removeDevice(gamepad);
+    CHECK_EQUAL(0, hid->getTelemetry().deferredQueueDepth);
+    delete gamepad;
+    hid->sendDeferredReports();
+    CHECK_EQUAL(0, notificationsFor(GAMEPAD_REPORT_ID).size());
+}
+
+int main()
+{
+    // Never deleted, the library's tasks keep running until the process exits
+    BleCompositeHID* hid = new BleCompositeHID("Host Test", "Test", 100);
+    GamepadDevice* gamepad = new GamepadDevice();
+    KeyboardDevice* keyboard = new KeyboardDevice();
+    MouseConfiguration mouseConfig;
+    mouseConfig.setHighResolutionScrolling(true);
+    MouseDevice* mouse = new MouseDevice(mouseConfig);
+    hid->addDevice(gamepad);
+    hid->addDevice(keyboard);
+    hid->addDevice(mouse);
+
+    uint16_t connHandle = connectHost(hid);
+    CHECK(connHandle != BLE_HS_CONN_HANDLE_NONE);
+    CHECK(hid->isConnected());
+
+    CHECK(HostEmulator::findReport(KEYBOARD_REPORT_ID) != nullptr);
+    CHECK(HostEmulator::findReport(MOUSE_REPORT_ID) != nullptr);
+    CHECK(HostEmulator::findReport(GAMEPAD_REPORT_ID) != nullptr);
+
+    testReportsReachTheHost(hid, gamepad, keyboard, mouse);
+    testLargeMotionIsSplit(mouse);
+    testWheelMultipliersChangeSeparately(connHandle, mouse);
+    testRefusedNotificationsAreCounted(hid, keyboard);
+    testReconnect(hid, connHandle, keyboard);
+    testRemoveWithQueuedReports(hid, gamepad);
+
+    return HOST_TEST_RESULT();
+}
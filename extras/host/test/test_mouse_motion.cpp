@@ -0,0 +1,108 @@
+// Mouse motion reaches the host with exact totals: large moves are split over as many reports as they need,
+// fractions carry over until they add up to whole counts, and batched sends don't add empty reports.
+
+#include "HostTest.h"
+#include "MouseDevice.h"
+
+static int32_t totalX = 0;
+static int32_t totalY = 0;
+
+// Adds up the motion of the mouse reports sent since the last call, returns how many there were
+static size_t collectMotion()
+{
+    auto moves = notificationsFor(MOUSE_REPORT_ID);
+    for (const auto& move : moves)
+    {
+        CHECK(move.data[1] != 0 || move.data[2] != 0);
+        totalX += (int8_t)move.data[1];
+        totalY += (int8_t)move.data[2];
+    }
+    HostEmulator::clearNotifications();
+    return moves.size();
+}
+
+static void resetTotals()
+{
+    totalX = 0;
+    totalY = 0;
+}
+
+static void testLargeMoves(MouseDevice* mouse)
+{
+    resetTotals();
+    mouse->mouseMove(1000, -700);
+    mouse->sendMouseReport();
+    CHECK_EQUAL(8, collectMotion());
+    CHECK_EQUAL(1000, totalX);
+    CHECK_EQUAL(-700, totalY);
+    CHECK(!mouse->hasPendingMotion());
+}
+
+static void testFractionalMoves(MouseDevice* mouse)
+{
+    // A third of a count at a time, every send that completes a whole count reports it
+    resetTotals();
+    size_t reports = 0;
+    for (int i = 0; i < 30; i++)
+    {
+        mouse->mouseMoveFractional(MOUSE_FRACTIONAL_ONE / 3 + 1, -(MOUSE_FRACTIONAL_ONE / 3 + 1));
+        mouse->sendMouseReport();
+        reports += collectMotion();
+    }
+    CHECK_EQUAL(10, reports);
+    CHECK_EQUAL(10, totalX);
+    CHECK_EQUAL(-10, totalY);
+    CHECK(!mouse->hasPendingMotion());
+}
+
+static void testBatchedMoves(BleCompositeHID* hid, MouseDevice* mouse)
+{
+    // The first queued send drains all of it, the ones queued after it find nothing left
+    resetTotals();
+    for (int i = 0; i < 5; i++)
+    {
+        mouse->mouseMove(100, -50);
+        mouse->sendMouseReport(true);
+    }
+    CHECK_EQUAL(0, collectMotion());
+    hid->sendDeferredReports();
+    CHECK_EQUAL(4, collectMotion());
+    CHECK_EQUAL(500, totalX);
+    CHECK_EQUAL(-250, totalY);
+    CHECK(!mouse->hasPendingMotion());
+}
+
+static void testButtonsWithoutMotion(MouseDevice* mouse)
+{
+    // A button change is still sent on its own, an unchanged report isn't
+    mouse->mousePress(MOUSE_LOGICAL_LEFT_BUTTON);
+    mouse->sendMouseReport();
+    mouse->sendMouseReport();
+    auto presses = notificationsFor(MOUSE_REPORT_ID);
+    CHECK_EQUAL(1, presses.size());
+    if (presses.size() == 1)
+        CHECK_EQUAL(0x01, presses[0].data[0] & 0x01);
+    mouse->mouseRelease(MOUSE_LOGICAL_LEFT_BUTTON);
+    mouse->sendMouseReport();
+    CHECK_EQUAL(2, notificationsFor(MOUSE_REPORT_ID).size());
+    HostEmulator::clearNotifications();
+}
+
+int main()
+{
+    BleCompositeHID* hid = new BleCompositeHID("Mouse Motion Test", "Test", 100);
+    MouseConfiguration mouseConfig;
+    mouseConfig.setAutoReport(false);
+    MouseDevice* mouse = new MouseDevice(mouseConfig);
+    hid->addDevice(mouse);
+
+    uint16_t connHandle = connectHost(hid);
+    CHECK(connHandle != BLE_HS_CONN_HANDLE_NONE);
+
+    testLargeMoves(mouse);
+    testFractionalMoves(mouse);
+    testBatchedMoves(hid, mouse);
+    testButtonsWithoutMotion(mouse);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,71 @@
+// Reports that don't go through the deferred queue are held to the notify window too: with a window of 1
+// every notification after the first waits for the previous one's connection event. State restored from
+// the stack's callbacks and reports sent with the device list locked never wait.
+
+#include "HostTest.h"
+#include "KeyboardDevice.h"
+#include "MouseDevice.h"
+#include "KeyboardDescriptors.h"
+
+// Scheduling on the host may wake the sender slightly before the interval has fully passed
+#define TEST_SLACK_MICROS 500
+
+static void checkSpacing(const std::vector<EmulatedNotification>& notifications, uint32_t intervalMicros)
+{
+    for (size_t i = 1; i < notifications.size(); i++)
+    {
+        uint32_t gap = notifications[i].timestampMicros - notifications[i - 1].timestampMicros;
+        CHECK(gap + TEST_SLACK_MICROS >= intervalMicros);
+    }
+}
+
+int main()
+{
+    BLEHostConfiguration config;
+    config.setNotifyWindow(1);
+
+    BleCompositeHID* hid = new BleCompositeHID("Notify Window Test", "Test", 100);
+    KeyboardDevice* keyboard = new KeyboardDevice();
+    MouseDevice* mouse = new MouseDevice();
+    hid->addDevice(keyboard);
+    hid->addDevice(mouse);
+
+    hid->begin(config);
+    CHECK(HostEmulator::waitForAdvertising(2000));
+    uint16_t connHandle = HostEmulator::connect(NimBLEAddress(std::string("11:22:33:44:55:66")), 185);
+    HostEmulator::subscribeAll(connHandle);
+    delay(50);
+    HostEmulator::clearNotifications();
+
+    uint32_t intervalMicros = hid->getNegotiatedConnectionParameters(0).minInterval * 1250UL;
+    CHECK(intervalMicros > 0);
+
+    // Direct sends
+    keyboard->keyPress(KEY_A);
+    keyboard->keyRelease(KEY_A);
+    keyboard->keyPress(KEY_B);
+    keyboard->keyRelease(KEY_B);
+    auto keys = notificationsFor(KEYBOARD_REPORT_ID);
+    CHECK_EQUAL(4, keys.size());
+    checkSpacing(keys, intervalMicros);
+    HostEmulator::clearNotifications();
+
+    // A move split over several reports
+    mouse->mouseMove(400, 0);
+    auto moves = notificationsFor(MOUSE_REPORT_ID);
+    CHECK_EQUAL(4, moves.size());
+    checkSpacing(moves, intervalMicros);
+    HostEmulator::clearNotifications();
+
+    // The subscribe callbacks restore the keyboard and the mouse without waiting for each other
+    HostEmulator::disconnect(connHandle);
+    CHECK(HostEmulator::waitForAdvertising(2000));
+    connHandle = HostEmulator::connect(NimBLEAddress(std::string("11:22:33:44:55:66")), 185);
+    uint32_t start = micros();
+    HostEmulator::subscribeAll(connHandle);
+    CHECK(micros() - start < intervalMicros);
+    CHECK_EQUAL(1, notificationsFor(KEYBOARD_REPORT_ID).size());
+    CHECK_EQUAL(1, notificationsFor(MOUSE_REPORT_ID).size());
+
+    return HOST_TEST_RESULT();
+}
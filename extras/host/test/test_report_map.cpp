@@ -0,0 +1,75 @@
+// The report map is sized before it is built. Configurations written before that, whose makeDeviceReport
+// needs a buffer, are sized through the default getDeviceReportDescriptorSize, at startup and when hot-plugged.
+
+#include "HostTest.h"
+#include "KeyboardDevice.h"
+#include "KeyboardDescriptors.h"
+
+#include <string.h>
+
+#define LEGACY_REPORT_ID 0x70
+
+class LegacyConfiguration : public BaseCompositeDeviceConfiguration
+{
+public:
+    LegacyConfiguration() : BaseCompositeDeviceConfiguration(LEGACY_REPORT_ID) {}
+
+    const char* getDeviceName() const override { return "Legacy"; }
+    uint8_t getDeviceReportSize() const override { return 1; }
+
+    // Copies into the buffer without checking for null, like the configurations before the map was measured
+    size_t makeDeviceReport(uint8_t* buffer, size_t bufferSize) const override
+    {
+        const uint8_t descriptor[] = {
+            0x06, 0x00, 0xFF,   // USAGE_PAGE (Vendor defined)
+            0x09, 0x01,         // USAGE (1)
+            0xA1, 0x01,         // COLLECTION (Application)
+            0x85, LEGACY_REPORT_ID,
+            0x09, 0x02,         //   USAGE (2)
+            0x15, 0x00,         //   LOGICAL_MINIMUM (0)
+            0x26, 0xFF, 0x00,   //   LOGICAL_MAXIMUM (255)
+            0x75, 0x08,         //   REPORT_SIZE (8)
+            0x95, 0x01,         //   REPORT_COUNT (1)
+            0x81, 0x02,         //   INPUT (Data, Var, Abs)
+            0xC0                // END_COLLECTION
+        };
+        if (sizeof(descriptor) > bufferSize)
+            return -1;
+        memcpy(buffer, descriptor, sizeof(descriptor));
+        return sizeof(descriptor);
+    }
+};
+
+class LegacyDevice : public BaseCompositeDevice
+{
+public:
+    void init(NimBLEHIDDevice* hid) override { setCharacteristics(hid->getInputReport(LEGACY_REPORT_ID), nullptr); }
+    const BaseCompositeDeviceConfiguration* getDeviceConfig() const override { return &_config; }
+
+private:
+    LegacyConfiguration _config;
+};
+
+int main()
+{
+    BleCompositeHID* hid = new BleCompositeHID("Report Map Test", "Test", 100);
+    KeyboardDevice* keyboard = new KeyboardDevice();
+    LegacyDevice* legacy = new LegacyDevice();
+    hid->addDevice(keyboard);
+    hid->addDevice(legacy);
+
+    uint16_t connHandle = connectHost(hid);
+    CHECK(connHandle != BLE_HS_CONN_HANDLE_NONE);
+    CHECK(hid->getReportMapInfo().findReport(KEYBOARD_REPORT_ID) != nullptr);
+    CHECK(hid->getReportMapInfo().findReport(LEGACY_REPORT_ID) != nullptr);
+    CHECK_EQUAL(1, hid->getReportMapInfo().getReportSize(LEGACY_REPORT_ID, HID_REPORT_TYPE_INPUT));
+
+    // Hot-plugged, the device's part goes through the same sizing
+    hid->removeDevice(legacy);
+    CHECK(hid->getReportMapInfo().findReport(LEGACY_REPORT_ID) == nullptr);
+    hid->addDevice(legacy);
+    CHECK(hid->getReportMapInfo().findReport(LEGACY_REPORT_ID) != nullptr);
+    CHECK(hid->getReportMapInfo().findReport(KEYBOARD_REPORT_ID) != nullptr);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,151 @@
+// Records a session into memory and replays it against a fresh composite device: every replay, back to back
+// or at the recorded pace, gives the host the same report IDs and payloads, and a log cut short ends cleanly.
+
+#include "HostTest.h"
+#include "KeyboardDevice.h"
+#include "MouseDevice.h"
+#include "KeyboardDescriptors.h"
+
+#include <string.h>
+
+#define TEST_LOG_CAPACITY 4096
+
+// Scheduling on the host may wake the replayer slightly before a report is due
+#define TEST_SLACK_MICROS 2000
+
+static uint8_t logBuffer[TEST_LOG_CAPACITY];
+static uint8_t truncatedBuffer[TEST_LOG_CAPACITY];
+
+static BleCompositeHID* createComposite(const char* name, KeyboardDevice*& keyboard, MouseDevice*& mouse)
+{
+    // Devices are added in the same order every time, the log names them by that position
+    BleCompositeHID* hid = new BleCompositeHID(name, "Test", 100);
+    keyboard = new KeyboardDevice();
+    mouse = new MouseDevice();
+    hid->addDevice(keyboard);
+    hid->addDevice(mouse);
+    return hid;
+}
+
+static std::vector<EmulatedNotification> recordSession(BleCompositeHID* hid, KeyboardDevice* keyboard, MouseDevice* mouse,
+    MemoryReportLogStorage& storage)
+{
+    ReportRecorder recorder(&storage);
+    hid->setReportRecorder(&recorder);
+    CHECK(recorder.start());
+
+    keyboard->keyPress(KEY_H);
+    delay(5);
+    keyboard->keyRelease(KEY_H);
+    delay(10);
+    mouse->mouseMove(300, -20);
+    delay(5);
+    keyboard->mediaKeyPress(KEY_MEDIA_MUTE);
+    keyboard->mediaKeyRelease(KEY_MEDIA_MUTE);
+    delay(20);
+    mouse->mousePress();
+    mouse->mouseRelease();
+
+    recorder.stop();
+    hid->setReportRecorder(nullptr);
+
+    auto sent = HostEmulator::getNotifications();
+    CHECK_EQUAL(sent.size(), recorder.getRecordedCount());
+    CHECK_EQUAL(0, recorder.getDroppedCount());
+    HostEmulator::clearNotifications();
+    return sent;
+}
+
+static void checkSameReports(const std::vector<EmulatedNotification>& expected, size_t count)
+{
+    auto replayed = HostEmulator::getNotifications();
+    CHECK_EQUAL(count, replayed.size());
+    for (size_t i = 0; i < count && i < replayed.size(); i++)
+    {
+        CHECK_EQUAL(expected[i].reportId, replayed[i].reportId);
+        CHECK_EQUAL(expected[i].data.size(), replayed[i].data.size());
+        CHECK(expected[i].data == replayed[i].data);
+    }
+    HostEmulator::clearNotifications();
+}
+
+static void testReplayBackToBack(BleCompositeHID* hid, MemoryReportLogStorage& storage, const std::vector<EmulatedNotification>& expected)
+{
+    ReportReplayer replayer(&storage);
+    CHECK_EQUAL(expected.size(), replayer.replay(*hid, 0));
+    CHECK_EQUAL(0, replayer.getSkippedCount());
+    checkSameReports(expected, expected.size());
+}
+
+static void testReplayAtRecordedPace(BleCompositeHID* hid, MemoryReportLogStorage& storage, const std::vector<EmulatedNotification>& expected)
+{
+    ReportReplayer replayer(&storage);
+    CHECK_EQUAL(expected.size(), replayer.replay(*hid, 1.0f));
+    CHECK_EQUAL(0, replayer.getSkippedCount());
+
+    // Only the pacing depends on the scheduler, the reports are never closer together than the log has them
+    ReportLogReader reader(&storage);
+    RecordedReport report;
+    uint64_t firstMicros = 0;
+    uint64_t lastMicros = 0;
+    CHECK(reader.begin());
+    for (size_t i = 0; reader.next(report); i++)
+    {
+        if (i == 0)
+            firstMicros = report.offsetMicros;
+        lastMicros = report.offsetMicros;
+    }
+    auto replayed = HostEmulator::getNotifications();
+    if (replayed.size() == expected.size() && !expected.empty())
+    {
+        uint32_t replayedSpan = replayed.back().timestampMicros - replayed.front().timestampMicros;
+        CHECK(replayedSpan + TEST_SLACK_MICROS >= lastMicros - firstMicros);
+    }
+    checkSameReports(expected, expected.size());
+}
+
+static void testTruncatedLog(BleCompositeHID* hid, MemoryReportLogStorage& storage, const std::vector<EmulatedNotification>& expected)
+{
+    // The last record loses its final payload byte, every record before it still replays
+    size_t size = storage.getSize() - 1;
+    memcpy(truncatedBuffer, storage.getData(), size);
+    MemoryReportLogStorage truncated(truncatedBuffer, sizeof(truncatedBuffer));
+    truncated.append(truncatedBuffer, size);
+
+    ReportReplayer replayer(&truncated);
+    CHECK_EQUAL(expected.size() - 1, replayer.replay(*hid, 0));
+    CHECK_EQUAL(0, replayer.getSkippedCount());
+    checkSameReports(expected, expected.size() - 1);
+
+    // A log without a complete header can't be replayed at all
+    MemoryReportLogStorage headerOnly(truncatedBuffer, sizeof(truncatedBuffer));
+    headerOnly.append(storage.getData(), REPORT_LOG_HEADER_SIZE - 1);
+    ReportReplayer headerReplayer(&headerOnly);
+    CHECK_EQUAL(-1, headerReplayer.replay(*hid, 0));
+    CHECK_EQUAL(0, HostEmulator::getNotificationCount());
+}
+
+int main()
+{
+    // Never deleted, the library's tasks keep running until the process exits
+    KeyboardDevice* keyboard;
+    MouseDevice* mouse;
+    BleCompositeHID* recording = createComposite("Recorder Test", keyboard, mouse);
+    CHECK(connectHost(recording) != BLE_HS_CONN_HANDLE_NONE);
+
+    MemoryReportLogStorage storage(logBuffer, sizeof(logBuffer));
+    std::vector<EmulatedNotification> expected = recordSession(recording, keyboard, mouse, storage);
+    CHECK(expected.size() >= 8);
+
+    // The replay goes to a composite device that never saw the session, on a stack set up from scratch
+    recording->end();
+    NimBLEDevice::deinit(true);
+    BleCompositeHID* replaying = createComposite("Replay Test", keyboard, mouse);
+    CHECK(connectHost(replaying) != BLE_HS_CONN_HANDLE_NONE);
+
+    testReplayBackToBack(replaying, storage, expected);
+    testReplayAtRecordedPace(replaying, storage, expected);
+    testTruncatedLog(replaying, storage, expected);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,117 @@
+// Checks the Xbox reports byte for byte against the captures in notes/packet_logs.txt
+
+#include "HostTest.h"
+#include "XboxGamepadDevice.h"
+
+#include <string.h>
+
+// Xbox wireless controller 1914 with the right trigger pressed, the input report after the report ID,
+// the size header and the unknown bytes
+static const uint8_t capturedControllerReport[XBOX_INPUT_REPORT_SIZE] = {
+    0xa6, 0x81, // X axis
+    0x1d, 0x7c, // Y axis
+    0x4c, 0x81, // Z axis
+    0xe8, 0x81, // rZ axis
+    0x00, 0x00, // Brake (Left trigger)
+    0xa0, 0x01, // Accelerator (Right trigger)
+    0x00,       // Hat switch
+    0x00, 0x00, // Button bitflags
+    0x00        // Share button
+};
+
+// The rumble example XInput sends, 0x0300002500ff00ff as it arrives on the output report
+static const uint8_t capturedRumbleReport[XBOX_OUTPUT_REPORT_SIZE] = { 0xff, 0x00, 0xff, 0x00, 0x25, 0x00, 0x00, 0x03 };
+
+static bool sameBytes(const uint8_t* expected, const std::vector<uint8_t>& actual, size_t size)
+{
+    return actual.size() == size && memcmp(expected, actual.data(), size) == 0;
+}
+
+static void testDeviceSendsTheCapturedReport(BleCompositeHID* hid, XboxGamepadDevice* gamepad)
+{
+    // The same stick and trigger positions set through the public API, sticks are centered on 0 there
+    gamepad->setLeftThumb(0x81a6 - XBOX_AXIS_CENTER_OFFSET, 0x7c1d - XBOX_AXIS_CENTER_OFFSET);
+    gamepad->setRightThumb(0x814c - XBOX_AXIS_CENTER_OFFSET, 0x81e8 - XBOX_AXIS_CENTER_OFFSET);
+    gamepad->setRightTrigger(0x01a0);
+    hid->sendDeferredReports();
+
+    auto reports = notificationsFor(XBOX_INPUT_REPORT_ID);
+    CHECK(!reports.empty());
+    if (!reports.empty())
+        CHECK(sameBytes(capturedControllerReport, reports.back().data, XBOX_INPUT_REPORT_SIZE));
+    HostEmulator::clearNotifications();
+}
+
+static void testButtonsAndHat(BleCompositeHID* hid, XboxGamepadDevice* gamepad)
+{
+    gamepad->resetInputs();
+    gamepad->press(XBOX_BUTTON_A | XBOX_BUTTON_RS);
+    gamepad->pressDPadDirection(XBOX_BUTTON_DPAD_SOUTHWEST);
+    gamepad->pressShare();
+    hid->sendDeferredReports();
+
+    auto reports = notificationsFor(XBOX_INPUT_REPORT_ID);
+    CHECK(!reports.empty());
+    if (!reports.empty())
+    {
+        const uint8_t expected[XBOX_INPUT_REPORT_SIZE] = {
+            0x00, 0x80, 0x00, 0x80, 0x00, 0x80, 0x00, 0x80,
+            0x00, 0x00, 0x00, 0x00,
+            XBOX_BUTTON_DPAD_SOUTHWEST,
+            0x01, 0x40,
+            0x01
+        };
+        CHECK(sameBytes(expected, reports.back().data, XBOX_INPUT_REPORT_SIZE));
+    }
+    HostEmulator::clearNotifications();
+}
+
+static void testPaddingBitsAreCleared()
+{
+    XboxGamepadInputReportData report(0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xff, 0xffff, 0xff);
+    XboxGamepadInputReportBytes bytes = report.serialize();
+    CHECK_EQUAL(0x03, bytes.bytes[9]);
+    CHECK_EQUAL(0x03, bytes.bytes[11]);
+    CHECK_EQUAL(0x0f, bytes.bytes[12]);
+    CHECK_EQUAL(0x7f, bytes.bytes[14]);
+    CHECK_EQUAL(0x01, bytes.bytes[15]);
+}
+
+static void testRumbleReportDecodes()
+{
+    XboxGamepadOutputReportData fromBytes(capturedRumbleReport, sizeof(capturedRumbleReport));
+    CHECK_EQUAL(0xff, fromBytes.dcEnableActuators);
+    CHECK_EQUAL(0x00, fromBytes.leftTriggerMagnitude);
+    CHECK_EQUAL(0xff, fromBytes.rightTriggerMagnitude);
+    CHECK_EQUAL(0x00, fromBytes.weakMotorMagnitude);
+    CHECK_EQUAL(0x25, fromBytes.strongMotorMagnitude);
+    CHECK_EQUAL(0x00, fromBytes.duration);
+    CHECK_EQUAL(0x00, fromBytes.startDelay);
+    CHECK_EQUAL(0x03, fromBytes.loopCount);
+
+    XboxGamepadOutputReportBytes bytes = XboxGamepadOutputReportData(0x0300002500ff00ffULL).serialize();
+    CHECK(memcmp(capturedRumbleReport, bytes.bytes, sizeof(capturedRumbleReport)) == 0);
+
+    // A short write leaves the missing fields at 0
+    XboxGamepadOutputReportData shortReport(capturedRumbleReport, 3);
+    CHECK_EQUAL(0xff, shortReport.rightTriggerMagnitude);
+    CHECK_EQUAL(0x00, shortReport.strongMotorMagnitude);
+    CHECK_EQUAL(0x00, shortReport.loopCount);
+}
+
+int main()
+{
+    BleCompositeHID* hid = new BleCompositeHID("Xbox Report Test", "Test", 100);
+    XboxGamepadDevice* gamepad = new XboxGamepadDevice();
+    hid->addDevice(gamepad);
+
+    uint16_t connHandle = connectHost(hid);
+    CHECK(connHandle != BLE_HS_CONN_HANDLE_NONE);
+
+    testDeviceSendsTheCapturedReport(hid, gamepad);
+    testButtonsAndHat(hid, gamepad);
+    testPaddingBitsAreCleared();
+    testRumbleReportDecodes();
+
+    return HOST_TEST_RESULT();
+}